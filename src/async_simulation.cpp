@@ -0,0 +1,414 @@
+#include "async_simulation.h"
+
+#include "defs.h"
+#include "performance_report.h"
+#include "progress.h"
+#include "random.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+Color getOtherColor(Color color)
+{
+	return (color == Color::Red ? Color::Blue : Color::Red);
+}
+
+// Maintaining the index costs a FenwickTree update per neighbor of a flipped
+// node, drawing a step a few random numbers. So only the flips are drawn if
+// the flips per step times the updates per flip stay below this, and the
+// steps are drawn one by one otherwise. The nodes are only indexed again
+// below half of it, so the mode doesn't change back and forth.
+double const MAX_INDEXED_COST = 0.5;
+
+double getMeanDegree(Graph const& graph)
+{
+	double degrees = 0;
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		degrees += graph.degree(node_id);
+	}
+
+	return (graph.getNumberOfNodes() == 0 ? 0 : degrees/graph.getNumberOfNodes());
+}
+
+} // end anonymous
+
+AsyncSimulation::AsyncSimulation(Graph const& graph, DynamicsType dynamics_type,
+                                 Coloring initial_coloring)
+	: graph(graph), type(dynamics_type), initial_coloring(initial_coloring),
+	  seed(Random().getSizeT(0, SIZE_MAX)), coloring(graph.getNumberOfNodes()),
+	  disagreeing_edges(graph.getNumberOfNodes()),
+	  disagreeing_weights(graph.isWeighted() ? graph.getNumberOfNodes() : 0),
+	  flip_cost(getMeanDegree(graph) + 1)
+{
+	debug_assert(initial_coloring.size() == graph.getNumberOfNodes());
+
+	if (dynamics_type == DynamicsType::HMajority) {
+		Error("HMajority is only supported by the multi-color simulation.");
+	}
+
+	clear();
+}
+
+Result AsyncSimulation::run(std::int64_t max_rounds, float win_threshold, std::size_t trial)
+{
+	clear();
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	max_rounds = (max_rounds == -1 ? number_of_nodes : max_rounds);
+	std::uint64_t const max_steps = max_rounds*number_of_nodes;
+	auto const random_key = CounterRandom::makeKey(seed, trial);
+
+	auto report = getActiveReport();
+	if (report) {
+		report->beginSimulation(trial);
+		report->beginRound();
+	}
+	auto progress = getActiveProgressMonitor();
+	if (progress) { progress->beginTrial(trial, max_rounds); }
+
+	// completed rounds and the flips since, for the report and the progress
+	std::size_t round = 0;
+	std::size_t round_flips = 0;
+
+	auto stop_reason = StopReason::MaxRounds;
+	while (true) {
+		if (isWon(win_threshold)) {
+			// the weighted volume is only summed up exactly when it matters
+			if (graph.isWeighted()) {
+				blue_volume = calculateVolumes()[static_cast<std::size_t>(Color::Blue)];
+			}
+			if (isWon(win_threshold)) {
+				stop_reason = StopReason::WinThreshold;
+				break;
+			}
+		}
+		if (indexed && number_of_active_nodes == 0) {
+			// The coloring is the same since the last flip, so that is where
+			// the fixed point was reached, also if it was only found after
+			// more steps drawn one by one.
+			number_of_steps = last_flip_step;
+			stop_reason = StopReason::FixedPoint;
+			break;
+		}
+		if (number_of_steps == max_steps) {
+			// the steps drawn one by one may have ended in a fixed point
+			if (!indexed) {
+				buildIndex();
+				continue;
+			}
+			break;
+		}
+
+		auto const flips = number_of_flips;
+		if (indexed && probabilities.getTotal()/number_of_nodes*flip_cost > MAX_INDEXED_COST) {
+			indexed = false;
+		}
+		if (indexed) {
+			simulateNextFlip(max_steps, random_key);
+		}
+		else {
+			// the steps up to the end of the round; their flips decide whether
+			// to index the nodes again
+			auto const first_step = number_of_steps;
+			simulateSteps(std::min(max_steps, (round + 1)*number_of_nodes), win_threshold,
+			              random_key);
+			auto const flip_rate = double(number_of_flips - flips)/(number_of_steps - first_step);
+			if (flip_rate*flip_cost < MAX_INDEXED_COST/2 || coloring.isUnimodal()) {
+				buildIndex();
+			}
+		}
+		round_flips += number_of_flips - flips;
+
+		if (number_of_steps/number_of_nodes > round) {
+			round = number_of_steps/number_of_nodes;
+			if (report) {
+				report->endRound(round_flips);
+				report->beginRound();
+			}
+			if (progress) { progress->setRound(round, getColorVolumes()); }
+			round_flips = 0;
+		}
+	}
+	round = (number_of_steps + number_of_nodes - 1)/number_of_nodes;
+
+	if (report) {
+		report->endRound(round_flips);
+		report->endSimulation(number_of_nodes);
+	}
+	if (progress) {
+		progress->setRound(round, getColorVolumes());
+		progress->endTrial();
+	}
+
+	return Result{
+		graph.getFilename(),
+		getWinningColor(win_threshold),
+		coloring.getColorFractions(),
+		getColorVolumes(),
+		round,
+		stop_reason
+	};
+}
+
+void AsyncSimulation::setSeed(std::uint64_t new_seed)
+{
+	seed = new_seed;
+}
+
+std::uint64_t AsyncSimulation::getSeed() const
+{
+	return seed;
+}
+
+std::uint64_t AsyncSimulation::getNumberOfSteps() const
+{
+	return number_of_steps;
+}
+
+std::size_t AsyncSimulation::getNumberOfFlips() const
+{
+	return number_of_flips;
+}
+
+Coloring const& AsyncSimulation::getColoring() const
+{
+	return coloring;
+}
+
+Color AsyncSimulation::getWinningColor(float win_threshold) const
+{
+	auto volumes = getColorVolumes();
+
+	for (auto color: COLORS) {
+		std::size_t color_index = static_cast<std::size_t>(color);
+		if (volumes[color_index] >= win_threshold) {
+			return color;
+		}
+	}
+
+	return Color::None;
+}
+
+// the same values as Simulation::getColorVolumes
+std::vector<float> AsyncSimulation::getColorVolumes() const
+{
+	std::vector<double> counts(COLORS.size());
+	if (graph.isWeighted()) {
+		counts = calculateVolumes();
+	}
+	else {
+		counts[static_cast<std::size_t>(Color::Red)] = graph.getTotalVolume() - blue_volume;
+		counts[static_cast<std::size_t>(Color::Blue)] = blue_volume;
+	}
+
+	std::vector<float> volume(COLORS.size());
+	for (std::size_t i = 0; i < volume.size(); ++i) {
+		volume[i] = counts[i]/graph.getTotalVolume();
+	}
+
+	return volume;
+}
+
+void AsyncSimulation::clear()
+{
+	coloring.assign(initial_coloring);
+	number_of_steps = 0;
+	number_of_flips = 0;
+	last_flip_step = 0;
+
+	if (graph.isWeighted()) {
+		blue_volume = calculateVolumes()[static_cast<std::size_t>(Color::Blue)];
+	}
+	else {
+		blue_volume = 0;
+		for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+			if (coloring.get(node_id) == Color::Blue) {
+				blue_volume += graph.degree(node_id);
+			}
+		}
+	}
+
+	buildIndex();
+}
+
+void AsyncSimulation::buildIndex()
+{
+	auto const neighbors = graph.getNeighbors();
+	auto const weights = graph.getWeights();
+	std::vector<double> initial_probabilities(graph.getNumberOfNodes());
+	number_of_active_nodes = 0;
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		auto const color = coloring.get(node_id);
+		std::size_t edges = 0;
+		double weight = 0;
+		for (auto i = graph.getOffsets()[node_id]; i < graph.getEnds()[node_id]; ++i) {
+			if (coloring.get(neighbors[i]) != color) {
+				++edges;
+				weight += (weights ? weights[i] : 1);
+			}
+		}
+
+		disagreeing_edges[node_id] = edges;
+		if (weights) { disagreeing_weights[node_id] = weight; }
+		initial_probabilities[node_id] = calculateProbability(node_id);
+		if (edges != 0) { ++number_of_active_nodes; }
+	}
+	probabilities.assign(initial_probabilities);
+	indexed = true;
+}
+
+void AsyncSimulation::simulateNextFlip(std::uint64_t max_steps, std::uint64_t random_key)
+{
+	// the steps until the next flip, including it, are geometric
+	CounterRandom random(random_key, 0, number_of_flips);
+	auto const flip_probability = probabilities.getTotal()/graph.getNumberOfNodes();
+	double steps = 1;
+	if (flip_probability < 1) {
+		steps += std::floor(std::log(1 - random.getDouble())/std::log1p(-flip_probability));
+	}
+	if (steps > max_steps - number_of_steps) {
+		number_of_steps = max_steps;
+		return;
+	}
+	number_of_steps += static_cast<std::uint64_t>(steps);
+
+	// rounding can rarely select a node that can't change
+	Graph::NodeID node_id;
+	do {
+		node_id = probabilities.find(random.getDouble()*probabilities.getTotal());
+	} while (probabilities.get(node_id) == 0);
+	flip(node_id);
+}
+
+void AsyncSimulation::simulateSteps(std::uint64_t last_step, float win_threshold,
+                                    std::uint64_t random_key)
+{
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	while (number_of_steps < last_step) {
+		CounterRandom random(random_key, 1, number_of_steps);
+		++number_of_steps;
+
+		auto const node_id = random.getSizeT(0, number_of_nodes - 1);
+		auto const old_color = coloring.get(node_id);
+		auto new_color = coloring.get(graph.getRandomNeighbor(node_id, random));
+		if (type == DynamicsType::TwoChoices &&
+		    coloring.get(graph.getRandomNeighbor(node_id, random)) != new_color) {
+			new_color = old_color;
+		}
+
+		if (new_color != old_color) {
+			setColor(node_id, new_color);
+			// consensus is a fixed point; the other ones are found by the index
+			if (isWon(win_threshold) || coloring.isUnimodal()) { return; }
+		}
+	}
+}
+
+double AsyncSimulation::calculateProbability(Graph::NodeID node_id) const
+{
+	auto const edges = disagreeing_edges[node_id];
+	auto const degree = graph.degree(node_id);
+
+	// the fraction of samples of the other color
+	double fraction;
+	if (edges == 0 || edges == degree) {
+		fraction = (edges == 0 ? 0 : 1);
+	}
+	else if (graph.isWeighted()) {
+		fraction = std::min(disagreeing_weights[node_id]/graph.volume(node_id), 1.);
+	}
+	else {
+		fraction = static_cast<double>(edges)/degree;
+	}
+
+	// TwoChoices flips if both samples have the other color
+	return (type == DynamicsType::VoterModel ? fraction : fraction*fraction);
+}
+
+void AsyncSimulation::updateProbability(Graph::NodeID node_id)
+{
+	// the weight is updated by differences, so it is summed up again if it
+	// lost all precision
+	if (graph.isWeighted() && disagreeing_edges[node_id] != 0 &&
+	    disagreeing_weights[node_id] <= 0) {
+		auto const color = coloring.get(node_id);
+		auto const weights = graph.getWeights();
+		disagreeing_weights[node_id] = 0;
+		for (auto i = graph.getOffsets()[node_id]; i < graph.getEnds()[node_id]; ++i) {
+			if (coloring.get(graph.getNeighbors()[i]) != color) {
+				disagreeing_weights[node_id] += weights[i];
+			}
+		}
+	}
+
+	auto const was_active = (probabilities.get(node_id) > 0);
+	auto const probability = calculateProbability(node_id);
+	if (was_active != (probability > 0)) {
+		if (was_active) { --number_of_active_nodes; }
+		else { ++number_of_active_nodes; }
+	}
+	probabilities.set(node_id, probability);
+}
+
+void AsyncSimulation::flip(Graph::NodeID node_id)
+{
+	auto const new_color = getOtherColor(coloring.get(node_id));
+	setColor(node_id, new_color);
+
+	// the neighbors of the new color now agree with the node, the others
+	// disagree; loops always agree
+	auto const neighbors = graph.getNeighbors();
+	auto const weights = graph.getWeights();
+	std::size_t edges = 0;
+	double weight = 0;
+	for (auto i = graph.getOffsets()[node_id]; i < graph.getEnds()[node_id]; ++i) {
+		auto const neighbor = neighbors[i];
+		if (neighbor == node_id) { continue; }
+
+		double const edge_weight = (weights ? weights[i] : 1);
+		if (coloring.get(neighbor) == new_color) {
+			--disagreeing_edges[neighbor];
+			if (weights) { disagreeing_weights[neighbor] -= edge_weight; }
+		}
+		else {
+			++disagreeing_edges[neighbor];
+			if (weights) { disagreeing_weights[neighbor] += edge_weight; }
+			++edges;
+			weight += edge_weight;
+		}
+		updateProbability(neighbor);
+	}
+
+	disagreeing_edges[node_id] = edges;
+	if (weights) { disagreeing_weights[node_id] = weight; }
+	updateProbability(node_id);
+}
+
+void AsyncSimulation::setColor(Graph::NodeID node_id, Color new_color)
+{
+	coloring.set(node_id, new_color);
+	blue_volume += (new_color == Color::Blue ? 1 : -1)*graph.volume(node_id);
+	++number_of_flips;
+	last_flip_step = number_of_steps;
+}
+
+std::vector<double> AsyncSimulation::calculateVolumes() const
+{
+	std::vector<double> counts(COLORS.size());
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		auto color_index = static_cast<std::size_t>(coloring.get(node_id));
+		counts[color_index] += graph.volume(node_id);
+	}
+
+	return counts;
+}
+
+bool AsyncSimulation::isWon(float win_threshold) const
+{
+	auto const total_volume = graph.getTotalVolume();
+	float const blue = blue_volume/total_volume;
+	float const red = (total_volume - blue_volume)/total_volume;
+	return std::max(red, blue) >= win_threshold;
+}
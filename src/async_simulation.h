@@ -0,0 +1,97 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "fenwick_tree.h"
+#include "graph.h"
+
+#include <cstdint>
+#include <vector>
+
+//
+// AsyncSimulation
+//
+// Asynchronous dynamics (random sequential scheduling): in every step, one
+// node drawn uniformly at random updates its color from the current
+// coloring, and n steps count as one round. Instead of simulating every
+// step, only the steps that flip a node are drawn: a FenwickTree holds the
+// probability of every node that its update flips it (the fraction of its
+// neighbors of the other color for the VoterModel, its square for
+// TwoChoices). With R being their sum, the number of steps until the next
+// flip is geometric with success probability R/n, and the flipping node is
+// drawn proportionally to its probability. A flip only changes the
+// probabilities of the node and its neighbors, so the work is proportional to
+// the degrees of the flipped nodes instead of the number of steps. While a
+// large part of the steps flips a node, e.g., early in the VoterModel, the
+// steps are drawn one by one without the index, which is cheaper then. Both
+// simulate the same process. Only two colors are supported.
+//
+
+class AsyncSimulation
+{
+public:
+	AsyncSimulation(Graph const& graph, DynamicsType dynamics_type, Coloring initial_coloring);
+	// The random numbers of the i-th flip only depend on the seed, the trial
+	// and i, so a trial can be replayed given its seed and number. The run
+	// stops at a fixed point as soon as no node has a neighbor of the other
+	// color; its steps are the ones up to the flip that reached it. The rounds
+	// of the result are the steps divided by n, rounded up.
+	Result run(std::int64_t max_rounds, float win_threshold, std::size_t trial = 0);
+	// the seed is taken from the clock unless it is set
+	void setSeed(std::uint64_t seed);
+	std::uint64_t getSeed() const;
+	// steps and flips of the last run
+	std::uint64_t getNumberOfSteps() const;
+	std::size_t getNumberOfFlips() const;
+
+	Coloring const& getColoring() const;
+	Color getWinningColor(float win_threshold) const;
+	std::vector<float> getColorVolumes() const;
+
+private:
+	Graph const& graph;
+	DynamicsType const type;
+	Coloring const initial_coloring;
+	std::uint64_t seed;
+
+	Coloring coloring;
+	// Per node, the number of its edges to the other color and, in weighted
+	// graphs, their weight. The number decides exactly whether the node can
+	// change, while the weight is updated by differences.
+	std::vector<std::size_t> disagreeing_edges;
+	std::vector<double> disagreeing_weights;
+	FenwickTree probabilities;
+	// nodes with a probability above zero
+	std::size_t number_of_active_nodes = 0;
+	// Whether the structures above are up to date. While most steps flip a
+	// node, the steps are drawn one by one instead, which is cheaper than
+	// updating the index on every flip.
+	bool indexed = false;
+	// FenwickTree updates per flip, the mean degree plus one
+	double const flip_cost;
+	// exact in unweighted graphs
+	double blue_volume = 0;
+
+	std::uint64_t number_of_steps = 0;
+	std::size_t number_of_flips = 0;
+	// the step of the last flip
+	std::uint64_t last_flip_step = 0;
+
+	void clear();
+	// O(n + m)
+	void buildIndex();
+	// Skips the steps up to the next flip, unless max_steps is reached first.
+	void simulateNextFlip(std::uint64_t max_steps, std::uint64_t random_key);
+	// Draws the steps up to last_step one by one, without the index, but
+	// stops as soon as a color wins or all nodes have the same color.
+	void simulateSteps(std::uint64_t last_step, float win_threshold, std::uint64_t random_key);
+	double calculateProbability(Graph::NodeID node_id) const;
+	void updateProbability(Graph::NodeID node_id);
+	// with the update of the index
+	void flip(Graph::NodeID node_id);
+	void setColor(Graph::NodeID node_id, Color new_color);
+	// summed up in the order of the nodes, like Simulation does
+	std::vector<double> calculateVolumes() const;
+	// by the tracked blue volume
+	bool isWon(float win_threshold) const;
+};
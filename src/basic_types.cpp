@@ -1,5 +1,7 @@
 #include "basic_types.h"
 
+#include <sstream>
+
 //
 // DynamicsType
 //
@@ -12,6 +14,9 @@ DynamicsType toDynamicsType(std::string const& dynamics_type_string)
 	else if (dynamics_type_string == "TwoChoices") {
 		return DynamicsType::TwoChoices;
 	}
+	else if (dynamics_type_string == "HMajority") {
+		return DynamicsType::HMajority;
+	}
 
 	Error("No matching dynamics type on call of toDynamicsType");
 }
@@ -20,7 +25,8 @@ std::string toString(DynamicsType dynamics_type)
 {
 	switch (dynamics_type) {
 	case DynamicsType::VoterModel: return "VoterModel";
-	case DynamicsType::TwoChoices: default: return "TwoChoices";
+	case DynamicsType::TwoChoices: return "TwoChoices";
+	case DynamicsType::HMajority: default: return "HMajority";
 	}
 }
 
@@ -48,6 +54,58 @@ std::string toString(CPMethod cp_method)
 	}
 }
 
+//
+// RoundKernel
+//
+
+RoundKernel toRoundKernel(std::string const& round_kernel_string)
+{
+	if (round_kernel_string == "reference") {
+		return RoundKernel::Reference;
+	}
+	else if (round_kernel_string == "blocked") {
+		return RoundKernel::Blocked;
+	}
+	else if (round_kernel_string == "degree_classes") {
+		return RoundKernel::DegreeClasses;
+	}
+
+	Error("No matching round kernel on call of toRoundKernel");
+}
+
+std::string toString(RoundKernel round_kernel)
+{
+	switch (round_kernel) {
+	case RoundKernel::Reference: return "reference";
+	case RoundKernel::Blocked: return "blocked";
+	case RoundKernel::DegreeClasses: default: return "degree_classes";
+	}
+}
+
+//
+// UpdateModel
+//
+
+UpdateModel toUpdateModel(std::string const& update_model_string)
+{
+	if (update_model_string == "sync") {
+		return UpdateModel::Synchronous;
+	}
+	else if (update_model_string == "async") {
+		return UpdateModel::Asynchronous;
+	}
+
+	Error("No matching update model on call of toUpdateModel");
+}
+
+std::string toString(UpdateModel update_model)
+{
+	switch (update_model) {
+	case UpdateModel::Synchronous: return "sync";
+	case UpdateModel::Asynchronous: default: return "async";
+	}
+}
+
 //
 // Color
 //
@@ -60,3 +118,33 @@ std::string toString(Color color)
 	case Color::None: default: return "none";
 	}
 }
+
+//
+// StopReason
+//
+
+std::string toString(StopReason stop_reason)
+{
+	switch (stop_reason) {
+	case StopReason::WinThreshold: return "win_threshold";
+	case StopReason::MaxRounds: return "max_rounds";
+	case StopReason::FixedPoint: return "fixed_point";
+	case StopReason::Oscillation: default: return "oscillation";
+	}
+}
+
+std::string toString(Result const& result)
+{
+	std::stringstream ss;
+	if (result.color_fractions.size() == COLORS.size() || result.winning_color == Color::None) {
+		ss << toString(result.winning_color) << " ";
+	}
+	else {
+		ss << static_cast<int>(result.winning_color) << " ";
+	}
+	for (auto fraction: result.color_fractions) { ss << fraction << " "; }
+	for (auto volume: result.color_volumes) { ss << volume << " "; }
+	ss << result.number_of_rounds << " " << toString(result.stop_reason);
+
+	return ss.str();
+}
@@ -3,6 +3,7 @@
 #include "defs.h"
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -10,9 +11,12 @@
 // DynamicsType
 //
 
+// HMajority adopts the most frequent color among h sampled neighbors, ties
+// are broken uniformly at random. It is only run by the MultiColorSimulation.
 enum class DynamicsType {
 	VoterModel,
 	TwoChoices,
+	HMajority
 };
 DynamicsType toDynamicsType(std::string const& dynamics_type_string);
 std::string toString(DynamicsType dynamics_type);
@@ -28,6 +32,40 @@ enum class CPMethod {
 CPMethod toCPMethod(std::string const& cp_method_string);
 std::string toString(CPMethod cp_method);
 
+//
+// RoundKernel
+//
+// Reference updates one node after the other. Blocked first samples the
+// neighbors of a block of nodes and prefetches their colors, then gathers the
+// colors and finally decides the new colors of the whole block at once.
+// DegreeClasses works like Blocked, but on the nodes of one degree class at a
+// time (see DegreeClasses), so nodes of degree one need no random numbers and
+// nodes whose degree is a power of two sample with a shift.
+//
+
+enum class RoundKernel {
+	Reference,
+	Blocked,
+	DegreeClasses
+};
+RoundKernel toRoundKernel(std::string const& round_kernel_string);
+std::string toString(RoundKernel round_kernel);
+
+//
+// UpdateModel
+//
+// Synchronous updates all nodes at once in every round. Asynchronous updates
+// one node drawn uniformly at random after the other, n updates per round; it
+// is run by the AsyncSimulation.
+//
+
+enum class UpdateModel {
+	Synchronous,
+	Asynchronous
+};
+UpdateModel toUpdateModel(std::string const& update_model_string);
+std::string toString(UpdateModel update_model);
+
 //
 // ExperimentData
 //
@@ -40,22 +78,100 @@ struct ExperimentData
 	std::int64_t max_rounds;
 	float win_threshold;
 	std::size_t number_of_exps;
+
+	// optional settings given as key=value after the mandatory columns
+	RoundKernel round_kernel;
+	// taken from the clock, or from the run ledger, if not given
+	std::uint64_t seed;
+	// if not -1, only this trial is run (to replay it with the same seed)
+	std::int64_t replay_trial;
+	// more than two colors are run by the MultiColorSimulation
+	std::size_t number_of_colors = 2;
+	// number of samples of HMajority
+	std::size_t h = 3;
+	UpdateModel update_model = UpdateModel::Synchronous;
+	// whether the seed was given as an option
+	bool seed_given = false;
 };
 using ExperimentsData = std::vector<ExperimentData>;
 
+//
+// ParallelOptions
+//
+
+struct ParallelOptions
+{
+	std::size_t number_of_threads = 1;
+	bool numa_aware = false;
+	// if non-zero, a NUMA topology with this many nodes is simulated
+	std::size_t simulated_numa_nodes = 0;
+};
+
+//
+// CheckpointOptions
+//
+
+struct CheckpointOptions
+{
+	// seconds between two checkpoints during a trial; 0 disables checkpoints
+	double interval_seconds = 60;
+	// continue from the checkpoint of a previous run
+	bool resume = false;
+	// skip the trials recorded in the run ledger of the result files prefix
+	bool ledger = true;
+};
+
+//
+// ReportOptions
+//
+
+struct ReportOptions
+{
+	// write a performance report per experiment (see performance_report.h)
+	bool enabled = false;
+	// also read hardware counters around the round kernel
+	bool hardware_counters = false;
+};
+
 //
 // Color
 //
 
-enum class Color : int_fast8_t {
+// With more than two colors (see PackedColoring), the colors are the values
+// 0, ..., k-1, so Red and Blue are the first two of them.
+enum class Color : std::uint8_t {
 	Red = 0,
 	Blue = 1,
-	None = -1
+	None = 255
 };
 std::array<Color, 2> const COLORS = {Color::Red, Color::Blue};
+// every value but None can be a color
+std::size_t const MAX_NUMBER_OF_COLORS = 255;
 
 std::string toString(Color color);
 
+//
+// StopReason
+//
+// Why a simulation stopped. FixedPoint and Oscillation are only reported if
+// the coloring provably cannot change anymore or provably alternates between
+// two colorings forever. All dynamics sample neighbors at random, so a node
+// can change as long as one of its neighbors has another color: a fixed point
+// is a coloring in which every connected component has a single color. On a
+// connected graph, this is consensus, which stops at the win threshold first
+// (unless it is above 1), so FixedPoint is otherwise only reported on graphs
+// that updates split into several components. A round without flips alone
+// doesn't stop a trial.
+//
+
+enum class StopReason {
+	WinThreshold,
+	MaxRounds,
+	FixedPoint,
+	Oscillation
+};
+std::string toString(StopReason stop_reason);
+
 //
 // Result
 //
@@ -67,5 +183,10 @@ struct Result
 	std::vector<float> color_fractions;
 	std::vector<float> color_volumes;
 	std::size_t number_of_rounds;
+	StopReason stop_reason;
 };
+// winning_color frac_red frac_blue vol_red vol_blue num_rounds stop_reason; with
+// more than two colors, the colors are numbers and all fractions and volumes
+// are listed
+std::string toString(Result const& result);
 using Results = std::vector<Result>;
@@ -0,0 +1,199 @@
+#include "batch_experiments.h"
+
+#include "async_simulation.h"
+#include "core_periphery.h"
+#include "defs.h"
+#include "experiments.h"
+#include "multi_color_simulation.h"
+#include "random.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+
+// Mixes the index of the graph in the pool into the seed of the experiment,
+// so graphs of the same size don't get the same random numbers.
+std::uint64_t getGraphSeed(std::uint64_t seed, std::size_t index)
+{
+	return CounterRandom::makeKey(seed, index);
+}
+
+// All trials of the experiment on one graph with its seed, run sequentially.
+Results runTrials(Graph const& graph, ExperimentData const& experiment_data, std::uint64_t seed)
+{
+	auto core_periphery_coloring = calculateCorePeripheryColoring(graph, experiment_data.cp_method);
+	auto const replay_trial = experiment_data.replay_trial;
+	auto is_run = [&](std::size_t trial) {
+		return replay_trial == -1 || (std::size_t)replay_trial == trial;
+	};
+
+	Results results;
+	if (isMultiColorExperiment(experiment_data)) {
+		MultiColorSimulation simulation(graph, experiment_data.dynamics_type,
+		                                createMultiColorInitialColoring(core_periphery_coloring,
+		                                                                experiment_data.number_of_colors,
+		                                                                seed),
+		                                experiment_data.h);
+		simulation.setSeed(seed);
+		for (std::size_t trial = 0; trial < experiment_data.number_of_exps; ++trial) {
+			if (is_run(trial)) {
+				results.push_back(simulation.run(experiment_data.max_rounds,
+				                                 experiment_data.win_threshold, trial));
+			}
+		}
+		return results;
+	}
+
+	if (experiment_data.update_model == UpdateModel::Asynchronous) {
+		AsyncSimulation simulation(graph, experiment_data.dynamics_type, core_periphery_coloring);
+		simulation.setSeed(seed);
+		for (std::size_t trial = 0; trial < experiment_data.number_of_exps; ++trial) {
+			if (is_run(trial)) {
+				results.push_back(simulation.run(experiment_data.max_rounds,
+				                                 experiment_data.win_threshold, trial));
+			}
+		}
+		return results;
+	}
+
+	Simulation simulation(graph, experiment_data.dynamics_type, core_periphery_coloring);
+	simulation.setRoundKernel(experiment_data.round_kernel);
+	simulation.setSeed(seed);
+	for (std::size_t trial = 0; trial < experiment_data.number_of_exps; ++trial) {
+		if (is_run(trial)) {
+			results.push_back(simulation.run(experiment_data.max_rounds,
+			                                 experiment_data.win_threshold, trial));
+		}
+	}
+	return results;
+}
+
+} // end anonymous
+
+void BatchExperiments::run()
+{
+	// checked before the result file is written, as no trial would run
+	if (number_of_threads == 0) {
+		Error("The batch experiments need at least one thread.");
+	}
+	Print("Running the batch experiments.");
+
+	std::ifstream file(experiments_file);
+	if (!file.is_open()) {
+		Error("The experiments file couldn't be opened");
+	}
+
+	ExperimentsData experiments_data;
+	Random seeder;
+	std::string line;
+	ExperimentData experiment_data;
+	while (std::getline(file, line)) {
+		if (readExperiment(line, seeder, experiment_data)) {
+			experiments_data.push_back(experiment_data);
+		}
+	}
+
+	std::ofstream out(result_file);
+	if (!out.is_open()) {
+		Error("The result file couldn't be opened. Filename: " + result_file);
+	}
+
+	// consecutive experiments on the same graphs share the pool
+	std::unique_ptr<GraphPool> pool;
+	std::string pool_path;
+	for (ExperimentID id = 0; id < experiments_data.size(); ++id) {
+		auto const& graph_file = experiments_data[id].graph_file;
+		if (!pool || pool_path != graph_file) {
+			pool.reset();
+			pool.reset(new GraphPool(graph_file));
+			pool_path = graph_file;
+		}
+
+		run(id, experiments_data[id], *pool, out);
+	}
+
+	if (!out) {
+		Error("Writing the result file failed. Filename: " + result_file);
+	}
+}
+
+void BatchExperiments::run(ExperimentID id, ExperimentData const& experiment_data,
+                           GraphPool const& pool, std::ostream& out)
+{
+	writeInformation(id, experiment_data, pool, out);
+
+	// The results of a graph are written as soon as the results of all graphs
+	// before it are written, so the file is in the order of the graphs.
+	std::mutex mutex;
+	std::vector<Results> results(pool.size());
+	std::vector<bool> finished(pool.size(), false);
+	std::size_t next_to_write = 0;
+	auto write_finished = [&]() {
+		for (; next_to_write < pool.size() && finished[next_to_write]; ++next_to_write) {
+			auto const& graph = pool.getGraph(next_to_write);
+			auto const seed = getGraphSeed(experiment_data.seed, next_to_write);
+			auto trial = (experiment_data.replay_trial == -1 ? 0 : experiment_data.replay_trial);
+			for (auto const& result: results[next_to_write]) {
+				out << graph.getFilename() << " " << graph.getNumberOfNodes() << " "
+				    << graph.getNumberOfEdges()/2 << " " << seed << " " << trial++ << ": "
+				    << toString(result) << "\n";
+			}
+			Results().swap(results[next_to_write]);
+		}
+	};
+
+	{
+		ThreadPool threads(number_of_threads);
+		for (std::size_t index = 0; index < pool.size(); ++index) {
+			threads.submit([&, index]() {
+				auto graph_results = runTrials(pool.getGraph(index), experiment_data,
+				                               getGraphSeed(experiment_data.seed, index));
+
+				std::lock_guard<std::mutex> lock(mutex);
+				results[index] = std::move(graph_results);
+				finished[index] = true;
+				write_finished();
+			});
+		}
+	}
+
+	out << "\n";
+}
+
+void BatchExperiments::writeInformation(ExperimentID id, ExperimentData const& experiment_data,
+                                        GraphPool const& pool, std::ostream& out)
+{
+	out << "Experiment data\n";
+	out << "===============\n";
+	out << "ID: " << id << "\n";
+	out << "Graphs: " << experiment_data.graph_file << "\n";
+	out << "Number of graphs: " << pool.size() << "\n";
+	out << "Dynamics type: " << toString(experiment_data.dynamics_type) << "\n";
+	out << "Core extraction method: " << toString(experiment_data.cp_method) << "\n";
+	out << "Max rounds: " << experiment_data.max_rounds << "\n";
+	out << "Round kernel: " << toString(experiment_data.round_kernel) << "\n";
+	// the seed of every graph is derived from it and the index of the graph
+	out << "Seed: " << experiment_data.seed << "\n";
+	out << "Number of experiments: " << experiment_data.number_of_exps << "\n";
+	if (isMultiColorExperiment(experiment_data)) {
+		out << "Number of colors: " << experiment_data.number_of_colors << "\n";
+		if (experiment_data.dynamics_type == DynamicsType::HMajority) {
+			out << "Samples (h): " << experiment_data.h << "\n";
+		}
+	}
+	out << "\n";
+
+	if (isMultiColorExperiment(experiment_data)) {
+		out << "Results: (graph nodes edges seed trial: winning_color frac_0 ... frac_k-1 vol_0 ... vol_k-1 num_rounds stop_reason)\n";
+	}
+	else {
+		out << "Results: (graph nodes edges seed trial: winning_color frac_red frac_blue vol_red vol_blue num_rounds stop_reason)\n";
+	}
+	out << "========\n";
+}
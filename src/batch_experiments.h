@@ -0,0 +1,43 @@
+#pragma once
+
+#include "basic_types.h"
+#include "graph_pool.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+//
+// BatchExperiments
+//
+// Runs every line of an experiments file on all graphs of a graph container
+// file or directory (see GraphPool), given in the graph column. The graphs are
+// distributed over a pool of threads, each of which runs all trials of a
+// graph sequentially, and all results go into one result file: per
+// experiment a header and then a line per trial, in the order of the graphs
+// and independent of the number of threads. Every graph gets its own seed,
+// derived from the one of the experiment and the index of the graph, which is
+// written next to its results.
+//
+
+class BatchExperiments
+{
+public:
+	BatchExperiments(std::string const& experiments_file, std::string const& result_file,
+	                 std::size_t number_of_threads)
+		: experiments_file(experiments_file), result_file(result_file),
+		  number_of_threads(number_of_threads) {}
+	void run();
+
+private:
+	std::string const experiments_file;
+	std::string const result_file;
+	std::size_t const number_of_threads;
+
+	using ExperimentID = std::size_t;
+
+	void run(ExperimentID id, ExperimentData const& experiment_data, GraphPool const& pool,
+	         std::ostream& out);
+	void writeInformation(ExperimentID id, ExperimentData const& experiment_data,
+	                      GraphPool const& pool, std::ostream& out);
+};
@@ -0,0 +1,392 @@
+#include "benchmarks.h"
+
+#include "core_periphery.h"
+#include "defs.h"
+#include "huge_page_allocator.h"
+#include "multi_color_simulation.h"
+#include "performance_report.h"
+#include "simd_kernels.h"
+#include "simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// fastest of the given number of calls of fn
+template <typename Function>
+double minimumSeconds(std::size_t repetitions, Function fn)
+{
+	auto seconds = std::numeric_limits<double>::max();
+	for (std::size_t i = 0; i < std::max<std::size_t>(repetitions, 1); ++i) {
+		auto start = Clock::now();
+		fn();
+		seconds = std::min(seconds, secondsSince(start));
+	}
+
+	return seconds;
+}
+
+BenchmarkReport::Metrics perEdge(double seconds, std::size_t number_of_edges)
+{
+	return {
+		{"seconds", seconds},
+		{"edges", static_cast<double>(number_of_edges)},
+		{"ns_per_edge", seconds*1e9/number_of_edges},
+		{"edges_per_second", number_of_edges/seconds}
+	};
+}
+
+// anonymous memory currently backed by transparent huge pages
+double getAnonHugePagesKB()
+{
+	std::string const key = "AnonHugePages:";
+
+	std::ifstream file("/proc/self/smaps_rollup");
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, key.size(), key) == 0) {
+			return std::stod(line.substr(key.size()));
+		}
+	}
+
+	return 0;
+}
+
+Coloring createRandomColoring(std::size_t size, std::uint64_t seed)
+{
+	Coloring coloring(size, Color::Blue);
+
+	std::mt19937_64 generator(seed);
+	for (std::size_t i = 0; i < size; ++i) {
+		if (generator() & 1) {
+			coloring.set(i, Color::Red);
+		}
+	}
+
+	return coloring;
+}
+
+} // end anonymous
+
+//
+// BenchmarkReport
+//
+
+void BenchmarkReport::add(std::string const& benchmark, std::string const& graph,
+                          Metrics const& metrics)
+{
+	entries.push_back({benchmark, graph, metrics});
+}
+
+void BenchmarkReport::writeJson(std::ostream& out) const
+{
+	out << "[\n";
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		auto const& entry = entries[i];
+		out << "  {\"benchmark\": \"" << escapeJson(entry.benchmark) << "\", "
+		    << "\"graph\": \"" << escapeJson(entry.graph) << "\"";
+		for (auto const& metric: entry.metrics) {
+			out << ", \"" << escapeJson(metric.first) << "\": " << metric.second;
+		}
+		out << "}" << (i + 1 < entries.size() ? "," : "") << "\n";
+	}
+	out << "]\n";
+}
+
+//
+// Benchmarks
+//
+
+Graph::Edges createRandomEdges(std::size_t number_of_nodes, std::size_t average_degree,
+                               std::uint64_t seed)
+{
+	Graph::Edges edges;
+	edges.reserve(number_of_nodes*average_degree/2);
+
+	// the ring makes the graph connected
+	for (Graph::NodeID node_id = 0; node_id < number_of_nodes; ++node_id) {
+		edges.emplace_back(node_id, (node_id + 1) % number_of_nodes);
+	}
+
+	std::mt19937_64 generator(seed);
+	std::uniform_int_distribution<Graph::NodeID> distribution(0, number_of_nodes - 1);
+	while (edges.size() < number_of_nodes*average_degree/2) {
+		edges.emplace_back(distribution(generator), distribution(generator));
+	}
+
+	return edges;
+}
+
+void writeEdgeList(std::string const& graph_file, Graph::Edges const& edges)
+{
+	std::ofstream file(graph_file);
+	if (!file.is_open()) {
+		Error("The edge list couldn't be written. Filename: " + graph_file);
+	}
+
+	for (auto const& edge: edges) {
+		file << edge.first << " " << edge.second << "\n";
+	}
+}
+
+void GraphStageBenchmark::run(BenchmarkReport& report, std::string const& name,
+                              std::string const& graph_file, std::size_t repetitions)
+{
+	auto parse_seconds = std::numeric_limits<double>::max();
+	auto reduce_seconds = parse_seconds;
+	auto csr_seconds = parse_seconds;
+	std::size_t number_of_edges = 0;
+
+	for (std::size_t i = 0; i < std::max<std::size_t>(repetitions, 1); ++i) {
+		Graph graph;
+		graph.filename = graph_file;
+		Graph::Weights edge_weights;
+
+		auto start = Clock::now();
+		auto parser_edges = graph.readEdges(graph_file, edge_weights);
+		parse_seconds = std::min(parse_seconds, secondsSince(start));
+		number_of_edges = parser_edges.size();
+
+		start = Clock::now();
+		graph.reduceToLargestScc(parser_edges, edge_weights);
+		reduce_seconds = std::min(reduce_seconds, secondsSince(start));
+
+		start = Clock::now();
+		auto edges = graph.convertIDs(parser_edges);
+		graph.addAllReverseEdges(edges, edge_weights);
+		graph.sortAndMakeUnique(edges, edge_weights);
+		graph.fillOffsetsAndNeighbors(edges, edge_weights);
+		graph.buildAliasTables();
+		graph.setViews();
+		csr_seconds = std::min(csr_seconds, secondsSince(start));
+	}
+
+	// all per edge values refer to the edges in the file
+	report.add("parse", name, perEdge(parse_seconds, number_of_edges));
+	report.add("reduce_to_largest_scc", name, perEdge(reduce_seconds, number_of_edges));
+	report.add("build_csr", name, perEdge(csr_seconds, number_of_edges));
+}
+
+void benchmarkCorePeriphery(BenchmarkReport& report, std::string const& name,
+                            Graph const& graph, std::size_t repetitions)
+{
+	for (auto cp_method: {CPMethod::KRichClub, CPMethod::DensestCore}) {
+		auto seconds = minimumSeconds(repetitions, [&]() {
+			calculateCorePeripheryColoring(graph, cp_method);
+		});
+		report.add("core_periphery_" + toString(cp_method), name,
+		           perEdge(seconds, graph.getNumberOfEdges()));
+	}
+}
+
+void benchmarkRoundKernels(BenchmarkReport& report, std::string const& name,
+                           Graph const& graph, std::size_t number_of_rounds)
+{
+	auto initial_coloring = createRandomColoring(graph.getNumberOfNodes(), 2);
+
+	for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+		for (auto round_kernel: {RoundKernel::Reference, RoundKernel::Blocked,
+		                         RoundKernel::DegreeClasses}) {
+			Simulation simulation(graph, dynamics_type, initial_coloring);
+			simulation.setRoundKernel(round_kernel);
+
+			auto start = Clock::now();
+			simulation.run(number_of_rounds, 2);
+			auto seconds = secondsSince(start);
+
+			auto node_updates = static_cast<double>(number_of_rounds)*graph.getNumberOfNodes();
+			report.add("round_" + toString(dynamics_type) + "_" + toString(round_kernel), name, {
+				{"rounds", static_cast<double>(number_of_rounds)},
+				{"ns_per_round", seconds*1e9/number_of_rounds},
+				{"ns_per_node_update", seconds*1e9/node_updates},
+				{"ns_per_edge", seconds*1e9/number_of_rounds/graph.getNumberOfEdges()},
+				{"node_updates_per_second", node_updates/seconds}
+			});
+		}
+	}
+}
+
+void benchmarkMultiColorRounds(BenchmarkReport& report, std::string const& name,
+                               Graph const& graph, std::size_t number_of_rounds)
+{
+	std::mt19937_64 generator(2);
+	for (std::size_t number_of_colors: {2, 16, 255}) {
+		PackedColoring initial_coloring(graph.getNumberOfNodes(), number_of_colors);
+		for (std::size_t i = 0; i < initial_coloring.size(); ++i) {
+			initial_coloring.set(i, static_cast<Color>(generator() % number_of_colors));
+		}
+
+		for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices,
+		                          DynamicsType::HMajority}) {
+			MultiColorSimulation simulation(graph, dynamics_type, initial_coloring);
+
+			auto start = Clock::now();
+			simulation.run(number_of_rounds, 2);
+			auto seconds = secondsSince(start);
+
+			auto node_updates = static_cast<double>(number_of_rounds)*graph.getNumberOfNodes();
+			report.add("multi_color_round_" + toString(dynamics_type) + "_k" +
+			           std::to_string(number_of_colors), name, {
+				{"rounds", static_cast<double>(number_of_rounds)},
+				{"ns_per_round", seconds*1e9/number_of_rounds},
+				{"ns_per_node_update", seconds*1e9/node_updates},
+				{"node_updates_per_second", node_updates/seconds}
+			});
+		}
+	}
+}
+
+void benchmarkInstructionSets(BenchmarkReport& report, std::string const& name,
+                              Graph const& graph, std::size_t repetitions)
+{
+	auto const instruction_set = getInstructionSet();
+	auto const n = graph.getNumberOfNodes();
+	auto const old_coloring = createRandomColoring(n, 3);
+	auto const sampled_coloring = createRandomColoring(2*n, 4);
+	std::vector<Color> new_colors(n);
+
+	for (auto tested: getSupportedInstructionSets()) {
+		setInstructionSet(tested);
+		auto const& kernels = getSimdKernels();
+
+		auto round_seconds = minimumSeconds(repetitions, [&]() {
+			std::size_t blue_count, number_of_flips;
+			kernels.decideTwoChoices(old_coloring.data(), sampled_coloring.data(),
+			                         new_colors.data(), n);
+			kernels.countBlueAndFlips(old_coloring.data(), new_colors.data(), n,
+			                          blue_count, number_of_flips);
+		});
+		auto volume_seconds = minimumSeconds(repetitions, [&]() {
+			kernels.sumBlueDegrees(graph.getOffsets(), graph.getEnds(), old_coloring.data(), n);
+		});
+		auto edge_count_seconds = minimumSeconds(repetitions, [&]() {
+			std::size_t red_red, cut, blue_blue;
+			kernels.countEdgesByColors(graph.getOffsets(), graph.getEnds(), graph.getNeighbors(),
+			                           old_coloring.data(), n, red_red, cut, blue_blue);
+		});
+
+		auto const suffix = "_" + toString(tested);
+		report.add("kernel_two_choices_decision" + suffix, name, {
+			{"seconds", round_seconds},
+			{"ns_per_node", round_seconds*1e9/n}
+		});
+		report.add("kernel_volume_reduction" + suffix, name, {
+			{"seconds", volume_seconds},
+			{"ns_per_node", volume_seconds*1e9/n}
+		});
+		report.add("kernel_edge_counts_by_colors" + suffix, name,
+		           perEdge(edge_count_seconds, graph.getNumberOfEdges()));
+	}
+	setInstructionSet(instruction_set);
+}
+
+void benchmarkVolumes(BenchmarkReport& report, std::string const& name,
+                      Graph const& graph, std::size_t repetitions)
+{
+	Simulation simulation(graph, DynamicsType::TwoChoices,
+	                      createRandomColoring(graph.getNumberOfNodes(), 2));
+
+	auto seconds = minimumSeconds(repetitions, [&]() {
+		simulation.getColorVolumes();
+	});
+	report.add("color_volumes", name, {
+		{"seconds", seconds},
+		{"ns_per_node", seconds*1e9/graph.getNumberOfNodes()},
+		{"nodes_per_second", graph.getNumberOfNodes()/seconds}
+	});
+}
+
+void benchmarkEdgeUpdates(BenchmarkReport& report, std::string const& name,
+                          Graph& graph, std::size_t repetitions)
+{
+	auto start = Clock::now();
+	graph.updateEdges({}, {});
+	report.add("edge_updates_slack_layout", name, perEdge(secondsSince(start), graph.getNumberOfEdges()));
+
+	std::mt19937_64 generator(3);
+	std::uniform_int_distribution<Graph::NodeID> random_node(0, graph.getNumberOfNodes() - 1);
+	for (std::size_t batch_size: {std::size_t(1) << 8, std::size_t(1) << 14}) {
+		// only new edges, so deleting the batch restores the graph
+		Graph::Edges batch;
+		while (batch.size() < batch_size) {
+			auto const node_id = random_node(generator);
+			auto const neighbor = random_node(generator);
+			auto const range = graph.getNeighborRange(node_id);
+			if (node_id != neighbor && !std::binary_search(range.begin(), range.end(), neighbor)) {
+				batch.emplace_back(node_id, neighbor);
+			}
+		}
+		std::sort(batch.begin(), batch.end());
+		batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+		auto insertion_seconds = std::numeric_limits<double>::max();
+		auto deletion_seconds = std::numeric_limits<double>::max();
+		for (std::size_t i = 0; i < repetitions; ++i) {
+			start = Clock::now();
+			graph.updateEdges(batch, {});
+			insertion_seconds = std::min(insertion_seconds, secondsSince(start));
+
+			start = Clock::now();
+			graph.updateEdges({}, batch);
+			deletion_seconds = std::min(deletion_seconds, secondsSince(start));
+		}
+
+		for (auto insertion: {true, false}) {
+			auto const seconds = (insertion ? insertion_seconds : deletion_seconds);
+			report.add(std::string("edge_updates_") + (insertion ? "insert_" : "delete_") +
+			           std::to_string(batch.size()), name, {
+				{"seconds", seconds},
+				{"ns_per_edge", seconds*1e9/batch.size()},
+				{"edges_per_second", batch.size()/seconds}
+			});
+		}
+	}
+}
+
+void benchmarkHugePages(BenchmarkReport& report, std::size_t number_of_nodes,
+                        std::size_t average_degree, std::size_t number_of_rounds)
+{
+	auto const old_policy = getHugePagePolicy();
+	auto const edges = createRandomEdges(number_of_nodes, average_degree, 1);
+
+	std::stringstream graph_name;
+	graph_name << "random:n=" << number_of_nodes << ":d=" << average_degree;
+
+	for (auto policy: {HugePagePolicy::None, HugePagePolicy::Transparent, HugePagePolicy::HugeTLB}) {
+		setHugePagePolicy(policy);
+
+		Graph graph;
+		graph.buildFromEdges(graph_name.str(), edges);
+		auto initial_coloring = createRandomColoring(graph.getNumberOfNodes(), 2);
+		Simulation simulation(graph, DynamicsType::TwoChoices, initial_coloring);
+
+		// a win threshold above 1 is never reached, so all rounds are executed
+		auto start = Clock::now();
+		simulation.run(number_of_rounds, 2);
+		auto seconds = secondsSince(start);
+
+		auto node_updates = static_cast<double>(number_of_rounds)*graph.getNumberOfNodes();
+		report.add("round_TwoChoices_hugepages_" + toString(policy), graph.getFilename(), {
+			{"rounds", static_cast<double>(number_of_rounds)},
+			{"ns_per_round", seconds*1e9/number_of_rounds},
+			{"ns_per_node_update", seconds*1e9/node_updates},
+			{"node_updates_per_second", node_updates/seconds},
+			{"anon_huge_pages_kb", getAnonHugePagesKB()}
+		});
+	}
+
+	setHugePagePolicy(old_policy);
+}
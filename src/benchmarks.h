@@ -0,0 +1,89 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//
+// BenchmarkReport
+//
+// Collects the measurements of the benchmarks and writes them as JSON, so
+// that runs on different commits can be compared by scripts.
+//
+
+class BenchmarkReport
+{
+public:
+	using Metrics = std::map<std::string, double>;
+
+	void add(std::string const& benchmark, std::string const& graph, Metrics const& metrics);
+	void writeJson(std::ostream& out) const;
+
+private:
+	struct Entry
+	{
+		std::string benchmark;
+		std::string graph;
+		Metrics metrics;
+	};
+	std::vector<Entry> entries;
+};
+
+//
+// Benchmarks
+//
+// Every measurement is repeated and the fastest repetition is reported, which
+// is the most stable value across runs.
+//
+
+// Random connected graph: a ring plus random edges, such that the average
+// degree is about the given one.
+Graph::Edges createRandomEdges(std::size_t number_of_nodes, std::size_t average_degree,
+                               std::uint64_t seed);
+void writeEdgeList(std::string const& graph_file, Graph::Edges const& edges);
+
+// Time of every stage of Graph::buildFromFile: parsing, reduceToLargestScc
+// and building the CSR arrays. It's a friend of Graph.
+class GraphStageBenchmark
+{
+public:
+	static void run(BenchmarkReport& report, std::string const& name,
+	                std::string const& graph_file, std::size_t repetitions);
+};
+
+// calcKRichClub and calcDensestCore
+void benchmarkCorePeriphery(BenchmarkReport& report, std::string const& name,
+                            Graph const& graph, std::size_t repetitions);
+
+// Node updates per second of each dynamics with each round kernel.
+void benchmarkRoundKernels(BenchmarkReport& report, std::string const& name,
+                           Graph const& graph, std::size_t number_of_rounds);
+
+// Node updates per second of the MultiColorSimulation for 2, 16 and 255
+// colors, which use 2, 4 and 8 bits per color.
+void benchmarkMultiColorRounds(BenchmarkReport& report, std::string const& name,
+                               Graph const& graph, std::size_t number_of_rounds);
+
+// The vectorized kernels (the decision of a TwoChoices round, the volume
+// reduction and the edge counts by colors) with every instruction set the CPU
+// supports.
+void benchmarkInstructionSets(BenchmarkReport& report, std::string const& name,
+                              Graph const& graph, std::size_t repetitions);
+
+// Computation of the color volumes, which is done before every round.
+void benchmarkVolumes(BenchmarkReport& report, std::string const& name,
+                      Graph const& graph, std::size_t repetitions);
+
+// Graph::updateEdges with batches of new random edges, which are inserted and
+// deleted again. The first update, which lays out the free slots, is
+// reported separately. The graph is updated in place.
+void benchmarkEdgeUpdates(BenchmarkReport& report, std::string const& name,
+                          Graph& graph, std::size_t repetitions);
+
+// Per-round time of TwoChoices for each huge page policy.
+void benchmarkHugePages(BenchmarkReport& report, std::size_t number_of_nodes,
+                        std::size_t average_degree, std::size_t number_of_rounds);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+//
+// Binary graph file
+//
+// Layout of the files used by the out-of-core mode: a header followed by the
+// CSR arrays of the graph. Every array starts at a page boundary so that
+// access hints can be given per array. Weighted graphs additionally store the
+// edge weights, the alias tables and the node volumes; the positions of these
+// arrays are zero for unweighted graphs. A mapped file has to match its
+// header exactly and its offsets, neighbors and alias indices are checked
+// before they are used (see Graph::checkMappedNodes), so a corrupt or foreign
+// file can't lead to reads out of bounds.
+//
+
+namespace binary_graph
+{
+
+std::size_t const ALIGNMENT = 4096;
+char const MAGIC[8] = {'O', 'D', 'G', 'R', 'A', 'P', 'H', '\0'};
+std::uint64_t const VERSION = 1;
+
+struct Header
+{
+	char magic[8];
+	std::uint64_t version;
+	std::uint64_t number_of_nodes;
+	std::uint64_t number_of_edges;
+	std::uint64_t offsets_position;
+	std::uint64_t neighbors_position;
+	std::uint64_t weights_position;
+	std::uint64_t alias_probabilities_position;
+	std::uint64_t alias_indices_position;
+	std::uint64_t volumes_position;
+	std::uint64_t file_size;
+};
+
+inline std::uint64_t alignUp(std::uint64_t position)
+{
+	return (position + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Weights and alias probabilities are stored as floats, alias indices as
+// 32-bit integers and volumes as doubles.
+inline Header makeHeader(std::uint64_t number_of_nodes, std::uint64_t number_of_edges,
+                         bool weighted = false)
+{
+	Header header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.number_of_nodes = number_of_nodes;
+	header.number_of_edges = number_of_edges;
+	header.offsets_position = alignUp(sizeof(Header));
+	header.neighbors_position = alignUp(header.offsets_position +
+	                                    (number_of_nodes + 1)*sizeof(std::uint64_t));
+	header.file_size = header.neighbors_position + number_of_edges*sizeof(std::uint64_t);
+
+	header.weights_position = 0;
+	header.alias_probabilities_position = 0;
+	header.alias_indices_position = 0;
+	header.volumes_position = 0;
+	if (weighted) {
+		header.weights_position = alignUp(header.file_size);
+		header.alias_probabilities_position = alignUp(header.weights_position +
+		                                              number_of_edges*sizeof(float));
+		header.alias_indices_position = alignUp(header.alias_probabilities_position +
+		                                        number_of_edges*sizeof(float));
+		header.volumes_position = alignUp(header.alias_indices_position +
+		                                  number_of_edges*sizeof(std::uint32_t));
+		header.file_size = header.volumes_position + number_of_nodes*sizeof(double);
+	}
+
+	return header;
+}
+
+inline bool hasMagic(char const* data)
+{
+	return std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+} // end binary_graph
@@ -0,0 +1,277 @@
+#include "checkpoint.h"
+
+#include "defs.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+
+char const MAGIC[8] = {'O', 'D', 'C', 'H', 'K', 'P', 'T', '\0'};
+std::uint32_t const VERSION = 2;
+
+template <typename T>
+void writeValue(std::ostream& out, T const& value)
+{
+	out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+void readValue(std::istream& in, T& value)
+{
+	in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void writeString(std::ostream& out, std::string const& string)
+{
+	writeValue(out, static_cast<std::uint64_t>(string.size()));
+	out.write(string.data(), string.size());
+}
+
+void readString(std::istream& in, std::string& string)
+{
+	std::uint64_t size = 0;
+	readValue(in, size);
+	if (!in) { return; }
+	string.resize(size);
+	in.read(&string[0], size);
+}
+
+void writeFloats(std::ostream& out, std::vector<float> const& floats)
+{
+	writeValue(out, static_cast<std::uint64_t>(floats.size()));
+	out.write(reinterpret_cast<char const*>(floats.data()), floats.size()*sizeof(float));
+}
+
+void readFloats(std::istream& in, std::vector<float>& floats)
+{
+	std::uint64_t size = 0;
+	readValue(in, size);
+	if (!in) { return; }
+	floats.resize(size);
+	in.read(reinterpret_cast<char*>(floats.data()), size*sizeof(float));
+}
+
+// Red is stored as 0 and Blue as 1
+void writeColoring(std::ostream& out, Coloring const& coloring)
+{
+	writeValue(out, static_cast<std::uint64_t>(coloring.size()));
+
+	std::vector<std::uint64_t> words((coloring.size() + 63)/64, 0);
+	for (std::size_t i = 0; i < coloring.size(); ++i) {
+		auto color = coloring.get(i);
+		debug_assert(color == Color::Red || color == Color::Blue);
+		if (color == Color::Blue) {
+			words[i/64] |= std::uint64_t(1) << (i%64);
+		}
+	}
+	out.write(reinterpret_cast<char const*>(words.data()), words.size()*sizeof(std::uint64_t));
+}
+
+void readColoring(std::istream& in, Coloring& coloring)
+{
+	std::uint64_t size = 0;
+	readValue(in, size);
+	if (!in) { return; }
+
+	std::vector<std::uint64_t> words((size + 63)/64);
+	in.read(reinterpret_cast<char*>(words.data()), words.size()*sizeof(std::uint64_t));
+
+	coloring = Coloring(size, Color::Red);
+	for (std::size_t i = 0; i < size; ++i) {
+		if ((words[i/64] >> (i%64)) & 1) {
+			coloring.set(i, Color::Blue);
+		}
+	}
+}
+
+void writeResult(std::ostream& out, Result const& result)
+{
+	writeString(out, result.graph_file);
+	writeValue(out, result.winning_color);
+	writeFloats(out, result.color_fractions);
+	writeFloats(out, result.color_volumes);
+	writeValue(out, static_cast<std::uint64_t>(result.number_of_rounds));
+	writeValue(out, result.stop_reason);
+}
+
+void readResult(std::istream& in, Result& result)
+{
+	std::uint64_t number_of_rounds = 0;
+
+	readString(in, result.graph_file);
+	readValue(in, result.winning_color);
+	readFloats(in, result.color_fractions);
+	readFloats(in, result.color_volumes);
+	readValue(in, number_of_rounds);
+	readValue(in, result.stop_reason);
+
+	result.number_of_rounds = number_of_rounds;
+}
+
+void syncFile(std::string const& filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) { return; }
+	fsync(fd);
+	close(fd);
+}
+
+} // end anonymous
+
+void writeCheckpoint(std::string const& filename, Checkpoint const& checkpoint)
+{
+	auto const temporary_filename = filename + ".tmp";
+
+	{
+		std::ofstream file(temporary_filename, std::ios_base::binary | std::ios_base::trunc);
+		if (!file.is_open()) {
+			Error("The checkpoint file couldn't be opened. Filename: " + temporary_filename);
+		}
+
+		file.write(MAGIC, sizeof(MAGIC));
+		writeValue(file, VERSION);
+		writeValue(file, checkpoint.experiments_hash);
+		writeValue(file, static_cast<std::uint64_t>(checkpoint.experiment_id));
+		writeValue(file, static_cast<std::uint64_t>(checkpoint.trial));
+		writeValue(file, checkpoint.result_file_size);
+
+		writeValue(file, checkpoint.seed);
+
+		writeValue(file, static_cast<std::uint64_t>(checkpoint.results.size()));
+		for (auto const& result: checkpoint.results) {
+			writeResult(file, result);
+		}
+
+		writeValue(file, static_cast<std::uint8_t>(checkpoint.has_simulation_state));
+		if (checkpoint.has_simulation_state) {
+			auto const& state = checkpoint.simulation_state;
+			writeValue(file, static_cast<std::uint64_t>(state.round));
+			writeValue(file, state.hash);
+			writeValue(file, state.previous_hash);
+			writeColoring(file, state.coloring);
+		}
+
+		if (!file.flush()) {
+			Error("Writing the checkpoint file failed. Filename: " + temporary_filename);
+		}
+	}
+
+	syncFile(temporary_filename);
+	if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+		Error("The checkpoint file couldn't be renamed to " + filename);
+	}
+}
+
+bool readCheckpoint(std::string const& filename, Checkpoint& checkpoint)
+{
+	std::ifstream file(filename, std::ios_base::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	char magic[sizeof(MAGIC)] = {};
+	std::uint32_t version = 0;
+	file.read(magic, sizeof(magic));
+	readValue(file, version);
+	if (!file || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+		Error("Not a checkpoint file: " + filename);
+	}
+	if (version != VERSION) {
+		Error("Unsupported checkpoint version " << version << " in " << filename);
+	}
+
+	std::uint64_t experiment_id = 0, trial = 0, size = 0;
+	readValue(file, checkpoint.experiments_hash);
+	readValue(file, experiment_id);
+	readValue(file, trial);
+	readValue(file, checkpoint.result_file_size);
+	checkpoint.experiment_id = experiment_id;
+	checkpoint.trial = trial;
+
+	readValue(file, checkpoint.seed);
+
+	readValue(file, size);
+	checkpoint.results.assign(file ? size : 0, Result());
+	for (auto& result: checkpoint.results) {
+		readResult(file, result);
+	}
+
+	std::uint8_t has_simulation_state = 0;
+	readValue(file, has_simulation_state);
+	checkpoint.has_simulation_state = has_simulation_state;
+	if (checkpoint.has_simulation_state) {
+		auto& state = checkpoint.simulation_state;
+		std::uint64_t round = 0;
+		readValue(file, round);
+		readValue(file, state.hash);
+		readValue(file, state.previous_hash);
+		readColoring(file, state.coloring);
+		state.round = round;
+	}
+
+	if (!file) {
+		Error("The checkpoint file is truncated. Filename: " + filename);
+	}
+
+	return true;
+}
+
+//
+// CheckpointWriter
+//
+
+CheckpointWriter::CheckpointWriter(std::string const& filename)
+	: filename(filename)
+{
+	thread = std::thread(&CheckpointWriter::work, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	thread.join();
+}
+
+void CheckpointWriter::write(Checkpoint checkpoint)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.reset(new Checkpoint(std::move(checkpoint)));
+	}
+	condition.notify_all();
+}
+
+void CheckpointWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&] { return !pending && !writing; });
+}
+
+void CheckpointWriter::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		condition.wait(lock, [&] { return pending || stopping; });
+		if (!pending) { return; }
+
+		std::unique_ptr<Checkpoint> checkpoint(std::move(pending));
+		writing = true;
+		lock.unlock();
+
+		writeCheckpoint(filename, *checkpoint);
+
+		lock.lock();
+		writing = false;
+		condition.notify_all();
+	}
+}
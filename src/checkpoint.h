@@ -0,0 +1,76 @@
+#pragma once
+
+#include "basic_types.h"
+#include "simulation.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Checkpoint
+//
+// State of an experiments run from which it can be resumed: the experiment
+// and trial which are in progress, the size of the result file at that point
+// (so output written afterwards can be discarded), the results of the
+// completed trials and, if a trial was interrupted, its simulation state.
+//
+
+struct Checkpoint
+{
+	// identifies the experiments file the checkpoint belongs to
+	std::uint64_t experiments_hash;
+	std::size_t experiment_id;
+	std::size_t trial;
+	std::uint64_t result_file_size;
+	std::uint64_t seed;
+	Results results;
+
+	bool has_simulation_state;
+	SimulationState simulation_state;
+};
+
+// Colorings are stored with one bit per node. The file is written to a
+// temporary file first and then renamed, so it is always complete.
+void writeCheckpoint(std::string const& filename, Checkpoint const& checkpoint);
+// Returns false if there is no checkpoint file.
+bool readCheckpoint(std::string const& filename, Checkpoint& checkpoint);
+
+//
+// CheckpointWriter
+//
+// Writes checkpoints on a background thread so the simulation only pays for
+// copying the state. If a new checkpoint arrives while the previous one is
+// still pending, the previous one is dropped.
+//
+
+class CheckpointWriter
+{
+public:
+	CheckpointWriter(std::string const& filename);
+	// writes the pending checkpoint
+	~CheckpointWriter();
+
+	CheckpointWriter(CheckpointWriter const&) = delete;
+	CheckpointWriter& operator=(CheckpointWriter const&) = delete;
+
+	void write(Checkpoint checkpoint);
+	// blocks until all checkpoints passed so far are on disk
+	void flush();
+
+private:
+	std::string const filename;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::unique_ptr<Checkpoint> pending;
+	bool writing = false;
+	bool stopping = false;
+	std::thread thread;
+
+	void work();
+};
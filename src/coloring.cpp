@@ -2,6 +2,8 @@
 
 #include "defs.h"
 
+#include <algorithm>
+
 Coloring::Coloring(std::size_t size)
 	: Coloring(size, Color::Red)
 {
@@ -28,6 +30,23 @@ void Coloring::set(std::size_t index, Color new_color)
 	++color_counts[static_cast<std::size_t>(new_color)];
 }
 
+void Coloring::setUncounted(std::size_t index, Color new_color)
+{
+	colors[index] = new_color;
+}
+
+void Coloring::setUncounted(std::size_t first, Color const* new_colors, std::size_t count)
+{
+	debug_assert(first + count <= colors.size());
+	std::copy(new_colors, new_colors + count, colors.begin() + first);
+}
+
+void Coloring::setCounts(std::vector<std::size_t> const& counts)
+{
+	debug_assert(counts.size() == color_counts.size());
+	color_counts.assign(counts.begin(), counts.end());
+}
+
 void Coloring::assign(Coloring const& coloring)
 {
 	debug_assert(size() == coloring.size());
@@ -61,6 +80,16 @@ bool Coloring::isUnimodal() const
 	return true;
 }
 
+std::uint64_t Coloring::hash() const
+{
+	std::uint64_t result = 0;
+	for (std::size_t i = 0; i < colors.size(); ++i) {
+		result ^= hashContribution(i, colors[i]);
+	}
+
+	return result;
+}
+
 Color Coloring::getWinningColor() const
 {
 	if (colors.empty()) { return Color::None; }
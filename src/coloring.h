@@ -1,7 +1,9 @@
 #pragma once
 
 #include "basic_types.h"
+#include "huge_page_allocator.h"
 
+#include <cstdint>
 #include <vector>
 
 class Coloring
@@ -11,18 +13,39 @@ public:
 	Coloring(std::size_t size, Color color);
 
 	std::size_t size() const { return colors.size(); }
+	Color const* data() const { return colors.data(); }
 
 	Color get(std::size_t index) const;
 	void set(std::size_t index, Color new_color);
+	// Sets a color without maintaining the color counts, so disjoint ranges
+	// can be written concurrently. The counts have to be set afterwards.
+	void setUncounted(std::size_t index, Color new_color);
+	void setUncounted(std::size_t first, Color const* new_colors, std::size_t count);
+	void setCounts(std::vector<std::size_t> const& counts);
 	void assign(Coloring const& coloring);
 	void swap(Coloring& coloring);
 	bool isUnimodal() const;
 
+	// Hash of the coloring, which is the XOR of the hash contributions of all
+	// nodes. It can thus be updated on every change of a color.
+	std::uint64_t hash() const;
+	static std::uint64_t hashContribution(std::size_t index, Color color);
+
 	Color getWinningColor() const;
 	std::vector<float> getColorFractions() const;
 	std::vector<float> getColorVolumes() const;
 
 private:
-	std::vector<Color> colors;
+	HugePageVector<Color> colors;
 	std::vector<std::size_t> color_counts;
 };
+
+inline std::uint64_t Coloring::hashContribution(std::size_t index, Color color)
+{
+	// splitmix64 finalizer of the index combined with the color
+	std::uint64_t z = (static_cast<std::uint64_t>(index) << 8 | static_cast<std::uint8_t>(color));
+	z += 0x9e3779b97f4a7c15ull;
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
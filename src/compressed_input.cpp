@@ -0,0 +1,446 @@
+#include "compressed_input.h"
+
+#include "defs.h"
+
+#include <dlfcn.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using namespace compressed_input;
+
+using Chunk = std::vector<char>;
+
+// bytes of compressed input read at once
+std::size_t const INPUT_SIZE = 1 << 18;
+
+enum class Format {
+	Plain,
+	Gzip,
+	Zstd
+};
+
+Format getFormat(std::string const& filename)
+{
+	auto endsWith = [&](std::string const& suffix) {
+		return filename.size() > suffix.size() &&
+		       filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+
+	if (endsWith(".gz")) { return Format::Gzip; }
+	if (endsWith(".zst")) { return Format::Zstd; }
+	return Format::Plain;
+}
+
+//
+// ChunkQueue
+//
+// The chunks from the decompressing thread to the reader. The chunks that were
+// read are handed back and filled again, so at most QUEUE_CHUNKS + 2 of them
+// are ever allocated.
+//
+
+class ChunkQueue
+{
+public:
+	Chunk getEmpty()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Chunk chunk;
+		if (!empty_chunks.empty()) {
+			chunk = std::move(empty_chunks.back());
+			empty_chunks.pop_back();
+		}
+		chunk.resize(CHUNK_SIZE);
+		return chunk;
+	}
+
+	// Waits until the queue has space. Returns false if the reader is gone.
+	bool push(Chunk chunk)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [&]() { return full_chunks.size() < QUEUE_CHUNKS || stopped; });
+		if (stopped) { return false; }
+
+		full_chunks.push_back(std::move(chunk));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// ends the stream; with a message if decompressing failed
+	void finish(std::string const& error)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		this->error = error;
+		not_empty.notify_one();
+	}
+
+	// Waits for the next chunk. Returns false at the end of the stream.
+	bool pop(Chunk& chunk, std::string& error)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [&]() { return !full_chunks.empty() || finished; });
+		if (full_chunks.empty()) {
+			error = this->error;
+			return false;
+		}
+
+		chunk = std::move(full_chunks.front());
+		full_chunks.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	void recycle(Chunk chunk)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		empty_chunks.push_back(std::move(chunk));
+	}
+
+	// the reader is gone, so the decompressing thread stops
+	void stop()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+		not_full.notify_one();
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+	std::deque<Chunk> full_chunks;
+	std::vector<Chunk> empty_chunks;
+	bool finished = false;
+	bool stopped = false;
+	std::string error;
+};
+
+//
+// Decompression
+//
+// Both decompressors fill a chunk until it is full, then queue it. At the end
+// of the file, they are called until they don't fill a chunk anymore, as they
+// might still hold output. They return an error message or an empty string.
+//
+
+std::string decompressGzip(std::FILE* file, ChunkQueue& queue)
+{
+#ifdef HAVE_ZLIB
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	// 32 detects the gzip header
+	if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+		return "zlib couldn't be initialized";
+	}
+
+	std::vector<unsigned char> input(INPUT_SIZE);
+	auto chunk = queue.getEmpty();
+	std::size_t filled = 0;
+	bool end_of_file = false;
+	bool end_of_member = false;
+	std::string error;
+	while (true) {
+		if (stream.avail_in == 0 && !end_of_file) {
+			auto const bytes = std::fread(input.data(), 1, input.size(), file);
+			end_of_file = (bytes == 0);
+			if (end_of_file && std::ferror(file)) {
+				error = "Reading the compressed file failed";
+				break;
+			}
+			stream.next_in = input.data();
+			stream.avail_in = bytes;
+		}
+		// a further member follows
+		if (end_of_member && stream.avail_in > 0) {
+			inflateReset(&stream);
+			end_of_member = false;
+		}
+
+		stream.next_out = reinterpret_cast<unsigned char*>(chunk.data() + filled);
+		stream.avail_out = CHUNK_SIZE - filled;
+		auto const result = inflate(&stream, Z_NO_FLUSH);
+		filled = CHUNK_SIZE - stream.avail_out;
+		if (result == Z_STREAM_END) {
+			end_of_member = true;
+		}
+		else if (result != Z_OK && result != Z_BUF_ERROR) {
+			error = std::string("The gzip data is corrupt: ") + (stream.msg ? stream.msg : "unknown error");
+			break;
+		}
+
+		if (filled == CHUNK_SIZE) {
+			if (!queue.push(std::move(chunk))) { break; }
+			chunk = queue.getEmpty();
+			filled = 0;
+		}
+		else if (end_of_file && stream.avail_in == 0) {
+			if (!end_of_member) {
+				error = "The gzip file is truncated";
+			}
+			break;
+		}
+	}
+	inflateEnd(&stream);
+
+	if (error.empty() && filled > 0) {
+		chunk.resize(filled);
+		queue.push(std::move(chunk));
+	}
+	return error;
+#else
+	(void) file;
+	(void) queue;
+	return "Reading gzip files needs zlib, which wasn't found when the program was built";
+#endif
+}
+
+// The streaming API of libzstd, which is loaded at runtime. Its types and
+// functions are stable since version 1.0.
+struct ZstdInBuffer
+{
+	void const* src;
+	std::size_t size;
+	std::size_t pos;
+};
+
+struct ZstdOutBuffer
+{
+	void* dst;
+	std::size_t size;
+	std::size_t pos;
+};
+
+struct ZstdLibrary
+{
+	void* (*createDStream)();
+	std::size_t (*freeDStream)(void*);
+	std::size_t (*initDStream)(void*);
+	std::size_t (*decompressStream)(void*, ZstdOutBuffer*, ZstdInBuffer*);
+	unsigned (*isError)(std::size_t);
+	char const* (*getErrorName)(std::size_t);
+};
+
+template <typename Function>
+bool loadSymbol(void* handle, char const* name, Function& function)
+{
+	auto symbol = dlsym(handle, name);
+	function = reinterpret_cast<Function>(symbol);
+	return symbol != nullptr;
+}
+
+// nullptr if the library isn't installed; it stays loaded until the end
+ZstdLibrary const* getZstdLibrary()
+{
+	static ZstdLibrary const* const library = []() -> ZstdLibrary const* {
+		auto handle = dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL);
+		if (handle == nullptr) {
+			handle = dlopen("libzstd.so", RTLD_NOW | RTLD_LOCAL);
+		}
+		if (handle == nullptr) { return nullptr; }
+
+		static ZstdLibrary functions;
+		if (!loadSymbol(handle, "ZSTD_createDStream", functions.createDStream) ||
+		    !loadSymbol(handle, "ZSTD_freeDStream", functions.freeDStream) ||
+		    !loadSymbol(handle, "ZSTD_initDStream", functions.initDStream) ||
+		    !loadSymbol(handle, "ZSTD_decompressStream", functions.decompressStream) ||
+		    !loadSymbol(handle, "ZSTD_isError", functions.isError) ||
+		    !loadSymbol(handle, "ZSTD_getErrorName", functions.getErrorName)) {
+			dlclose(handle);
+			return nullptr;
+		}
+		return &functions;
+	}();
+
+	return library;
+}
+
+std::string decompressZstd(std::FILE* file, ChunkQueue& queue)
+{
+	auto library = getZstdLibrary();
+	auto stream = library->createDStream();
+	if (stream == nullptr || library->isError(library->initDStream(stream))) {
+		if (stream != nullptr) { library->freeDStream(stream); }
+		return "libzstd couldn't be initialized";
+	}
+
+	std::vector<char> input(INPUT_SIZE);
+	ZstdInBuffer in{input.data(), 0, 0};
+	auto chunk = queue.getEmpty();
+	std::size_t filled = 0;
+	bool end_of_file = false;
+	// whether the last frame is complete and flushed
+	bool end_of_frame = false;
+	std::string error;
+	while (true) {
+		if (in.pos == in.size && !end_of_file) {
+			auto const bytes = std::fread(input.data(), 1, input.size(), file);
+			end_of_file = (bytes == 0);
+			if (end_of_file && std::ferror(file)) {
+				error = "Reading the compressed file failed";
+				break;
+			}
+			in.size = bytes;
+			in.pos = 0;
+		}
+
+		ZstdOutBuffer out{chunk.data(), CHUNK_SIZE, filled};
+		auto const in_position = in.pos;
+		auto const result = library->decompressStream(stream, &out, &in);
+		if (library->isError(result)) {
+			error = std::string("The zstd data is corrupt: ") + library->getErrorName(result);
+			break;
+		}
+		// without progress, the result is the hint for the next frame
+		if (in.pos != in_position || out.pos != filled) {
+			end_of_frame = (result == 0);
+		}
+		filled = out.pos;
+
+		if (filled == CHUNK_SIZE) {
+			if (!queue.push(std::move(chunk))) { break; }
+			chunk = queue.getEmpty();
+			filled = 0;
+		}
+		else if (end_of_file && in.pos == in.size) {
+			if (!end_of_frame) {
+				error = "The zstd file is truncated";
+			}
+			break;
+		}
+	}
+	library->freeDStream(stream);
+
+	if (error.empty() && filled > 0) {
+		chunk.resize(filled);
+		queue.push(std::move(chunk));
+	}
+	return error;
+}
+
+//
+// DecompressingBuffer
+//
+// Stream buffer over the chunks of a decompressing thread.
+//
+
+class DecompressingBuffer : public std::streambuf
+{
+public:
+	DecompressingBuffer(std::FILE* file, Format format, std::string const& filename)
+		: file(file), filename(filename)
+	{
+		thread = std::thread([this, format]() {
+			queue.finish(format == Format::Gzip ? decompressGzip(this->file, queue)
+			                                    : decompressZstd(this->file, queue));
+		});
+	}
+
+	~DecompressingBuffer() override
+	{
+		queue.stop();
+		thread.join();
+		std::fclose(file);
+	}
+
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) {
+			return traits_type::to_int_type(*gptr());
+		}
+
+		if (!current.empty()) {
+			queue.recycle(std::move(current));
+		}
+		std::string error;
+		if (!queue.pop(current, error)) {
+			current.clear();
+			if (!error.empty()) {
+				Error(error << ". Filename: " << filename);
+			}
+			return traits_type::eof();
+		}
+
+		setg(current.data(), current.data(), current.data() + current.size());
+		return traits_type::to_int_type(*gptr());
+	}
+
+private:
+	std::FILE* const file;
+	std::string const filename;
+	ChunkQueue queue;
+	std::thread thread;
+	Chunk current;
+};
+
+class DecompressingStream : public std::istream
+{
+public:
+	DecompressingStream(std::FILE* file, Format format, std::string const& filename)
+		: std::istream(nullptr), buffer(file, format, filename)
+	{
+		rdbuf(&buffer);
+		// errors of the buffer are not swallowed by the stream, e.g., if
+		// errors throw in the server
+		exceptions(std::ios_base::badbit);
+	}
+
+private:
+	DecompressingBuffer buffer;
+};
+
+} // end anonymous
+
+std::unique_ptr<std::istream> openTextFile(std::string const& filename)
+{
+	auto const format = getFormat(filename);
+	if (format == Format::Plain) {
+		std::unique_ptr<std::istream> file(new std::ifstream(filename));
+		return (static_cast<std::ifstream&>(*file).is_open() ? std::move(file) : nullptr);
+	}
+
+	if (format == Format::Gzip && !isGzipSupported()) {
+		Error("Reading gzip files needs zlib, which wasn't found when the program was built."
+		      << " Filename: " << filename);
+	}
+	if (format == Format::Zstd && !isZstdSupported()) {
+		Error("Reading zstd files needs libzstd.so.1, which couldn't be loaded. Filename: "
+		      << filename);
+	}
+
+	auto file = std::fopen(filename.c_str(), "rb");
+	if (file == nullptr) {
+		return nullptr;
+	}
+	return std::unique_ptr<std::istream>(new DecompressingStream(file, format, filename));
+}
+
+bool isGzipSupported()
+{
+#ifdef HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool isZstdSupported()
+{
+	return getZstdLibrary() != nullptr;
+}
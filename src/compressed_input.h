@@ -0,0 +1,34 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+
+//
+// Compressed input
+//
+// Edge lists ending in .gz or .zst are read without an uncompressed copy on
+// disk: a separate thread decompresses the file into a bounded queue of
+// chunks, which the parser reads as a std::istream, so decompression and
+// parsing overlap. gzip files are read with zlib, if the build found it, and
+// zstd files with the libzstd.so.1 of the system, which is loaded when the
+// first one is opened. Concatenated gzip members and zstd frames are read as
+// one file.
+//
+
+namespace compressed_input
+{
+
+// decompressed bytes per chunk and number of chunks the queue holds at most
+std::size_t const CHUNK_SIZE = 1 << 20;
+std::size_t const QUEUE_CHUNKS = 4;
+
+} // end compressed_input
+
+// Opens the file for reading as text, decompressing it if its name ends in
+// .gz or .zst. Returns nullptr if the file can't be opened. Corrupt or
+// truncated compressed files are errors while reading.
+std::unique_ptr<std::istream> openTextFile(std::string const& filename);
+
+bool isGzipSupported();
+bool isZstdSupported();
@@ -1,5 +1,7 @@
 #include "core_periphery.h"
 
+#include "simd_kernels.h"
+
 #include <algorithm>
 #include <unordered_map>
 #include <queue>
@@ -165,30 +167,11 @@ Coloring calculateCorePeripheryColoring(Graph const& graph, CPMethod method)
 
 std::pair<float, float> calcDominanceAndRobustness(Graph const& graph, Coloring const& coloring)
 {
-	using NodeID = Graph::NodeID;
-
-	std::size_t cc_count = 0;
-	std::size_t cp_count = 0;
-	std::size_t pp_count = 0;
-
-	for (NodeID source_id = 0; source_id < graph.getNumberOfNodes(); ++source_id) {
-		auto source_color = coloring.get(source_id);
-
-		for (auto target_id: graph.getNeighborRange(source_id)) {
-			auto target_color = coloring.get(target_id);
-
-			// this implicitly assumes that there are only two colors
-			if (source_color != target_color) {
-				++cp_count;
-			}
-			else if (source_color == Color::Blue) {
-				++pp_count;
-			}
-			else {
-				++cc_count;
-			}
-		}
-	}
+	// counts the edges in both directions; only for two colors
+	std::size_t cc_count, cp_count, pp_count;
+	getSimdKernels().countEdgesByColors(graph.getOffsets(), graph.getEnds(), graph.getNeighbors(),
+	                                    coloring.data(), graph.getNumberOfNodes(),
+	                                    cc_count, cp_count, pp_count);
 
 	float dominance = (float)cp_count/pp_count;
 	float robustness = (float)cc_count/cp_count;
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 // helper macro
 
@@ -20,8 +24,40 @@
 #define Print(x) do { std::cout << x << std::endl; } while (0)
 #endif
 
-#define Error(x) do { std::cerr << "Error: " << x << std::endl;\
-                      std::exit(EXIT_FAILURE); } while (0)
+// Errors end the process. A thread that has to survive bad requests (one of
+// the server) can turn them into exceptions of type ErrorException instead.
+// The mode is per thread, so threads that don't catch them still end the
+// process with the message instead of calling std::terminate.
+
+class ErrorException : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+inline bool& errorsThrowFlag()
+{
+	static thread_local bool errors_throw = false;
+	return errors_throw;
+}
+
+inline void setErrorsThrow(bool errors_throw)
+{
+	errorsThrowFlag() = errors_throw;
+}
+
+[[noreturn]] inline void handleError(std::string const& message)
+{
+	if (errorsThrowFlag()) {
+		throw ErrorException(message);
+	}
+
+	std::cerr << "Error: " << message << std::endl;
+	std::exit(EXIT_FAILURE);
+}
+
+#define Error(x) do { std::stringstream od_error_message; od_error_message << x;\
+                      handleError(od_error_message.str()); } while (0)
 
 // assert macro
 
@@ -0,0 +1,60 @@
+#include "degree_classes.h"
+
+#include <algorithm>
+
+std::size_t const DegreeClasses::NUMBER_OF_KINDS;
+std::array<DegreeClasses::Kind, DegreeClasses::NUMBER_OF_KINDS> const DegreeClasses::KINDS = {
+	Kind::DegreeOne, Kind::DegreeTwo, Kind::PowerOfTwo, Kind::General
+};
+
+DegreeClasses::DegreeClasses(Graph const& graph)
+	: nodes(graph.getNumberOfNodes())
+{
+	auto getKind = [&](Graph::NodeID node_id) {
+		auto const degree = graph.degree(node_id);
+		if (degree == 1) {
+			return Kind::DegreeOne;
+		}
+		// weighted graphs sample with the alias tables
+		if (graph.isWeighted()) {
+			return Kind::General;
+		}
+		if (degree == 2) {
+			return Kind::DegreeTwo;
+		}
+		if ((degree & (degree - 1)) == 0) {
+			return Kind::PowerOfTwo;
+		}
+		return Kind::General;
+	};
+
+	// counting sort by class, which keeps the nodes of a class sorted by ID
+	std::array<std::size_t, NUMBER_OF_KINDS> counts = {};
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		++counts[static_cast<std::size_t>(getKind(node_id))];
+	}
+	for (std::size_t i = 0; i < NUMBER_OF_KINDS; ++i) {
+		class_begins[i + 1] = class_begins[i] + counts[i];
+	}
+
+	auto positions = class_begins;
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		nodes[positions[static_cast<std::size_t>(getKind(node_id))]++] = node_id;
+	}
+}
+
+auto DegreeClasses::getNodes(Kind kind, Graph::NodeID first, Graph::NodeID last) const
+	-> std::pair<Graph::NodeID const*, Graph::NodeID const*>
+{
+	auto const index = static_cast<std::size_t>(kind);
+	auto const class_begin = nodes.data() + class_begins[index];
+	auto const class_end = nodes.data() + class_begins[index + 1];
+	return {std::lower_bound(class_begin, class_end, first),
+	        std::lower_bound(class_begin, class_end, last)};
+}
+
+std::size_t DegreeClasses::size(Kind kind) const
+{
+	auto const index = static_cast<std::size_t>(kind);
+	return class_begins[index + 1] - class_begins[index];
+}
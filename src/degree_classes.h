@@ -0,0 +1,50 @@
+#pragma once
+
+#include "graph.h"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//
+// DegreeClasses
+//
+// The nodes of a graph grouped by how a neighbor is sampled, for the
+// DegreeClasses round kernel. The only neighbor of a node of degree one
+// needs no random numbers, and neither does a node of degree two whose
+// neighbors have the same color. For a power of two 2^k, CounterRandom::getSizeT
+// is the top k bits of the random number, so these nodes sample with a shift
+// instead of a multiplication. All other nodes, and all nodes of degree
+// larger than one in weighted graphs, are sampled like by the other kernels.
+// So all kernels give the same results.
+//
+// Within a class, the nodes are sorted by ID, so the nodes of a class in a
+// range of IDs are a contiguous part of it.
+//
+
+class DegreeClasses
+{
+public:
+	enum class Kind {
+		DegreeOne,
+		DegreeTwo,
+		PowerOfTwo,
+		General
+	};
+	static std::size_t const NUMBER_OF_KINDS = 4;
+	static std::array<Kind, NUMBER_OF_KINDS> const KINDS;
+
+	DegreeClasses() = default;
+	explicit DegreeClasses(Graph const& graph);
+
+	// the nodes of the class with an ID in [first, last)
+	std::pair<Graph::NodeID const*, Graph::NodeID const*>
+	getNodes(Kind kind, Graph::NodeID first, Graph::NodeID last) const;
+	std::size_t size(Kind kind) const;
+
+private:
+	// the nodes of all classes, one class after the other
+	std::vector<Graph::NodeID> nodes;
+	std::array<std::size_t, NUMBER_OF_KINDS + 1> class_begins = {};
+};
@@ -0,0 +1,158 @@
+#include "distributed_experiments.h"
+
+#include "core_periphery.h"
+#include "defs.h"
+#include "experiments.h"
+#include "graph.h"
+#include "multi_color_simulation.h"
+#include "partitioned_simulation.h"
+#include "progress.h"
+#include "random.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+void DistributedExperiments::run()
+{
+	Print("Running the experiments as worker " << transport.getRank() << " of "
+	      << transport.getNumberOfWorkers() << ".");
+
+	auto experiments_data = readExperiments();
+	for (ExperimentID id = 0; id < experiments_data.size(); ++id) {
+		auto progress = getActiveProgressMonitor();
+		if (progress) {
+			auto const& experiment_data = experiments_data[id];
+			auto const replay_trial = experiment_data.replay_trial;
+			progress->beginExperiment(id, experiments_data.size(), experiment_data.graph_file,
+			                          replay_trial == -1 ? experiment_data.number_of_exps
+			                                             : replay_trial + 1);
+		}
+
+		run(id, experiments_data[id]);
+	}
+}
+
+ExperimentsData DistributedExperiments::readExperiments()
+{
+	std::ifstream file(experiments_file);
+	if (!file.is_open()) {
+		Error("The experiments file couldn't be opened");
+	}
+
+	ExperimentsData experiments_data;
+	Random seeder;
+	std::string line;
+	ExperimentData experiment_data;
+	while (std::getline(file, line)) {
+		if (readExperiment(line, seeder, experiment_data)) {
+			if (isMultiColorExperiment(experiment_data)) {
+				Error("The distributed mode only supports two colors: " + line);
+			}
+			if (experiment_data.update_model == UpdateModel::Asynchronous) {
+				Error("The distributed mode only supports synchronous updates: " + line);
+			}
+			experiments_data.push_back(experiment_data);
+		}
+	}
+
+	// the seeds that are not given are drawn by every worker, so all take the
+	// ones of worker 0
+	std::vector<std::uint64_t> seeds;
+	for (auto const& data: experiments_data) {
+		seeds.push_back(data.seed);
+	}
+	Transport::Message message(seeds.size()*sizeof(std::uint64_t));
+	if (!seeds.empty()) {
+		std::memcpy(message.data(), seeds.data(), message.size());
+	}
+	auto incoming = transport.exchange(std::vector<Transport::Message>(
+		transport.getNumberOfWorkers(), message));
+	if (incoming[0].size() != message.size()) {
+		Error("The experiments file of worker 0 has a different number of experiments");
+	}
+	std::memcpy(seeds.data(), incoming[0].data(), message.size());
+	for (std::size_t id = 0; id < experiments_data.size(); ++id) {
+		experiments_data[id].seed = seeds[id];
+	}
+
+	return experiments_data;
+}
+
+void DistributedExperiments::run(ExperimentID id, ExperimentData const& experiment_data)
+{
+	// Mapped, so every worker only loads the part of the graph it visits.
+	// The core extraction needs the whole graph and is only run by worker 0,
+	// which sends the other workers their part of the initial coloring.
+	if (!isBinaryGraphFile(experiment_data.graph_file)) {
+		Error("The distributed mode needs a binary graph file (see --convert): "
+		      << experiment_data.graph_file);
+	}
+	Graph graph;
+	// worker 0 reads the whole file anyway, the others only check their part
+	graph.buildFromFile(experiment_data.graph_file, transport.getRank() == 0);
+	Coloring initial_coloring(0);
+	if (transport.getRank() == 0) {
+		initial_coloring = calculateCorePeripheryColoring(graph, experiment_data.cp_method);
+	}
+
+	PartitionedSimulation simulation(graph, experiment_data.dynamics_type, &initial_coloring,
+	                                 transport);
+	simulation.setSeed(experiment_data.seed);
+	auto const initial_volumes = simulation.getColorVolumes();
+
+	// only worker 0 writes, the others just take part in the simulations
+	std::ofstream file;
+	if (transport.getRank() == 0) {
+		std::string const exp_filename = result_files_prefix + std::to_string(id);
+		file.open(exp_filename);
+		if (!file.is_open()) {
+			Error("The experiments file couldn't be opened. Filename: " + exp_filename);
+		}
+
+		file << "Experiment data\n";
+		file << "===============\n";
+		file << "ID: " << id << "\n";
+		file << "Graph file: " << experiment_data.graph_file << "\n";
+		file << "Dynamics type: " << toString(experiment_data.dynamics_type) << "\n";
+		file << "Core extraction method: " << toString(experiment_data.cp_method) << "\n";
+		file << "Max rounds: " << experiment_data.max_rounds << "\n";
+		file << "Workers: " << transport.getNumberOfWorkers() << "\n";
+		file << "Seed: " << experiment_data.seed << "\n";
+		file << "Number of experiments: " << experiment_data.number_of_exps << "\n";
+		file << "\n";
+
+		file << "Graph data" << "\n";
+		file << "==========" << "\n";
+		file << "Number of nodes: " << graph.getNumberOfNodes() << "\n";
+		file << "Number of edges: " << graph.getNumberOfEdges() << "\n";
+		file << "Weighted: no\n";
+		file << "\n";
+
+		// without dominance and robustness, which need all edges
+		file << "Initial coloring:\n";
+		file << "=================\n";
+		file << "Fractions (red/blue): ";
+		for (auto fraction: initial_coloring.getColorFractions()) { file << fraction << " "; }
+		file << "\nVolumes (red/blue): ";
+		for (auto volume: initial_volumes) { file << volume << " "; }
+		file << "\n\n";
+		file << "Results: (winning_color frac_red frac_blue vol_red vol_blue num_rounds stop_reason)\n";
+		file << "========\n";
+		file.flush();
+	}
+
+	for (std::size_t trial = 0; trial < experiment_data.number_of_exps; ++trial) {
+		if (experiment_data.replay_trial != -1 && (std::size_t)experiment_data.replay_trial != trial) {
+			continue;
+		}
+
+		auto result = simulation.run(experiment_data.max_rounds, experiment_data.win_threshold,
+		                             trial);
+		if (file.is_open()) {
+			file << "Round " << trial << ": " << toString(result) << "\n";
+			file.flush();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "basic_types.h"
+#include "transport.h"
+
+#include <cstddef>
+#include <string>
+
+//
+// DistributedExperiments
+//
+// Runs the experiments file with all workers of a transport, every trial as
+// one PartitionedSimulation. Every worker reads the experiments file and
+// maps the graphs itself, which have to be binary graph files, so it only
+// loads the part it visits. The seeds are the ones of worker 0, which also
+// computes the core coloring for all workers and writes the result files, in
+// the format of Experiments. Only unweighted graphs, two colors and
+// synchronous updates are supported; checkpoints and reports are not written.
+//
+
+class DistributedExperiments
+{
+public:
+	DistributedExperiments(std::string const& experiments_file,
+	                       std::string const& result_files_prefix, Transport& transport)
+		: experiments_file(experiments_file), result_files_prefix(result_files_prefix),
+		  transport(transport) {}
+	void run();
+
+private:
+	std::string const experiments_file;
+	std::string const result_files_prefix;
+	Transport& transport;
+
+	using ExperimentID = std::size_t;
+
+	ExperimentsData readExperiments();
+	void run(ExperimentID id, ExperimentData const& experiment_data);
+};
@@ -1,51 +1,411 @@
 #include "dynamics.h"
 
-Dynamics::Dynamics(DynamicsType dynamics_type, Graph const& graph)
-	: type(dynamics_type), graph(graph) {}
+#include "defs.h"
+#include "simd_kernels.h"
 
-void Dynamics::simulateOneRound(Coloring const& current_coloring,
-                                Coloring& next_coloring)
+#include <algorithm>
+#include <array>
+
+std::size_t const Dynamics::BLOCK_SIZE;
+std::size_t const Dynamics::KERNEL_BLOCK_SIZE;
+
+Dynamics::Dynamics(DynamicsType dynamics_type, Graph const& graph,
+                   ParallelEngine* engine)
+	: type(dynamics_type), graph(graph), engine(engine), seed(Random().getSizeT(0, SIZE_MAX))
 {
-	switch (type) {
-	case DynamicsType::VoterModel:
-		executeVoterModel(current_coloring, next_coloring);
-		break;
-	case DynamicsType::TwoChoices:
-		executeTwoChoices(current_coloring, next_coloring);
-		break;
+	if (dynamics_type == DynamicsType::HMajority) {
+		Error("HMajority is only supported by the multi-color simulation.");
+	}
+
+	auto const number_of_states = (engine ? engine->getNumberOfWorkers() : 1);
+
+	for (std::size_t i = 0; i < number_of_states; ++i) {
+		worker_states.push_back({std::vector<std::size_t>(COLORS.size()),
+		                         RoundStatistics{0, 0},
+		                         std::vector<CounterRandom::Block>(KERNEL_BLOCK_SIZE),
+		                         std::vector<Graph::NodeID>(2*KERNEL_BLOCK_SIZE),
+		                         std::vector<Color>(2*KERNEL_BLOCK_SIZE),
+		                         std::vector<Color>(KERNEL_BLOCK_SIZE),
+		                         std::vector<Color>(KERNEL_BLOCK_SIZE),
+		                         std::vector<Graph::NodeID>(KERNEL_BLOCK_SIZE),
+		                         std::vector<std::size_t>(KERNEL_BLOCK_SIZE), {}});
 	}
 }
 
+RoundStatistics Dynamics::simulateOneRound(Coloring const& current_coloring,
+                                           Coloring& next_coloring,
+                                           std::size_t trial, std::size_t round)
+{
+	random_key = CounterRandom::makeKey(seed, trial);
+	this->round = round;
+
+	if (round_kernel == RoundKernel::DegreeClasses &&
+	    (!degree_classes || degree_classes_updates != graph.getNumberOfUpdates())) {
+		degree_classes.reset(new DegreeClasses(graph));
+		degree_classes_updates = graph.getNumberOfUpdates();
+	}
+
+	if (engine) {
+		engine->run([&](std::size_t worker) {
+			auto const range = engine->getRange(worker);
+			simulateRange(current_coloring, next_coloring, range.first, range.second,
+			              worker_states[worker]);
+		});
+	}
+	else {
+		simulateRange(current_coloring, next_coloring, 0, graph.getNumberOfNodes(),
+		              worker_states[0]);
+	}
+
+	RoundStatistics statistics{0, 0};
+	std::vector<std::size_t> color_counts(COLORS.size(), 0);
+	for (auto const& state: worker_states) {
+		for (std::size_t i = 0; i < color_counts.size(); ++i) {
+			color_counts[i] += state.color_counts[i];
+		}
+		statistics.number_of_flips += state.statistics.number_of_flips;
+		statistics.hash_change ^= state.statistics.hash_change;
+	}
+	next_coloring.setCounts(color_counts);
+
+	return statistics;
+}
+
 DynamicsType Dynamics::getType() const
 {
 	return type;
 }
 
+void Dynamics::setRoundKernel(RoundKernel new_round_kernel)
+{
+	round_kernel = new_round_kernel;
+}
+
+RoundKernel Dynamics::getRoundKernel() const
+{
+	return round_kernel;
+}
+
+void Dynamics::setSeed(std::uint64_t new_seed)
+{
+	seed = new_seed;
+}
+
+std::uint64_t Dynamics::getSeed() const
+{
+	return seed;
+}
+
+void Dynamics::simulateRange(Coloring const& current_coloring,
+                             Coloring& next_coloring,
+                             Graph::NodeID first, Graph::NodeID last,
+                             WorkerState& state)
+{
+	std::fill(state.color_counts.begin(), state.color_counts.end(), 0);
+	state.statistics = RoundStatistics{0, 0};
+	graph.willVisit(first, std::min(first + BLOCK_SIZE, last));
+
+	for (auto block_first = first; block_first < last; block_first += BLOCK_SIZE) {
+		auto const block_last = std::min(block_first + BLOCK_SIZE, last);
+		graph.willVisit(block_last, std::min(block_last + BLOCK_SIZE, last));
+
+		if (round_kernel == RoundKernel::Blocked) {
+			executeBlocked(current_coloring, next_coloring, block_first, block_last, state);
+			continue;
+		}
+		if (round_kernel == RoundKernel::DegreeClasses) {
+			executeDegreeClasses(current_coloring, next_coloring, block_first, block_last, state);
+			continue;
+		}
+
+		switch (type) {
+		case DynamicsType::VoterModel:
+			executeVoterModel(current_coloring, next_coloring, block_first, block_last, state);
+			break;
+		case DynamicsType::TwoChoices:
+		case DynamicsType::HMajority: // rejected by the constructor
+			executeTwoChoices(current_coloring, next_coloring, block_first, block_last, state);
+			break;
+		}
+	}
+}
+
 void Dynamics::executeVoterModel(Coloring const& current_coloring,
-                                 Coloring& next_coloring)
+                                 Coloring& next_coloring,
+                                 Graph::NodeID first, Graph::NodeID last,
+                                 WorkerState& state)
 {
-	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+	std::array<std::size_t, COLORS.size()> color_counts = {};
+	std::size_t number_of_flips = 0;
+	std::uint64_t hash_change = 0;
+
+	for (Graph::NodeID node_id = first; node_id < last; ++node_id) {
+		CounterRandom random(random_key, round, node_id);
 		auto neighbor = graph.getRandomNeighbor(node_id, random);
 		auto neighbor_color = current_coloring.get(neighbor);
 
-		next_coloring.set(node_id, neighbor_color);
+		next_coloring.setUncounted(node_id, neighbor_color);
+		++color_counts[static_cast<std::size_t>(neighbor_color)];
+
+		auto old_color = current_coloring.get(node_id);
+		if (neighbor_color != old_color) {
+			++number_of_flips;
+			hash_change ^= Coloring::hashContribution(node_id, old_color) ^
+			               Coloring::hashContribution(node_id, neighbor_color);
+		}
+	}
+
+	for (std::size_t i = 0; i < color_counts.size(); ++i) {
+		state.color_counts[i] += color_counts[i];
 	}
+	state.statistics.number_of_flips += number_of_flips;
+	state.statistics.hash_change ^= hash_change;
 }
 
 void Dynamics::executeTwoChoices(Coloring const& current_coloring,
-                                 Coloring& next_coloring)
+                                 Coloring& next_coloring,
+                                 Graph::NodeID first, Graph::NodeID last,
+                                 WorkerState& state)
 {
-	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+	std::array<std::size_t, COLORS.size()> color_counts = {};
+	std::size_t number_of_flips = 0;
+	std::uint64_t hash_change = 0;
+
+	for (Graph::NodeID node_id = first; node_id < last; ++node_id) {
+		CounterRandom random(random_key, round, node_id);
 		auto neighbor1 = graph.getRandomNeighbor(node_id, random);
 		auto neighbor2 = graph.getRandomNeighbor(node_id, random);
 		auto neighbor1_color = current_coloring.get(neighbor1);
 		auto neighbor2_color = current_coloring.get(neighbor2);
 
+		auto old_color = current_coloring.get(node_id);
+		auto new_color = old_color;
 		if (neighbor1_color == neighbor2_color) {
-			next_coloring.set(node_id, neighbor1_color);
+			new_color = neighbor1_color;
+		}
+
+		next_coloring.setUncounted(node_id, new_color);
+		++color_counts[static_cast<std::size_t>(new_color)];
+
+		if (new_color != old_color) {
+			++number_of_flips;
+			hash_change ^= Coloring::hashContribution(node_id, old_color) ^
+			               Coloring::hashContribution(node_id, new_color);
+		}
+	}
+
+	for (std::size_t i = 0; i < color_counts.size(); ++i) {
+		state.color_counts[i] += color_counts[i];
+	}
+	state.statistics.number_of_flips += number_of_flips;
+	state.statistics.hash_change ^= hash_change;
+}
+
+void Dynamics::executeBlocked(Coloring const& current_coloring,
+                              Coloring& next_coloring,
+                              Graph::NodeID first, Graph::NodeID last,
+                              WorkerState& state)
+{
+	std::size_t const samples_per_node = (type == DynamicsType::VoterModel ? 1 : 2);
+	auto const colors = current_coloring.data();
+	auto const random_blocks = state.random_blocks.data();
+	auto const sampled_neighbors = state.sampled_neighbors.data();
+	auto const sampled_colors = state.sampled_colors.data();
+	auto const new_colors = state.new_colors.data();
+	auto const& kernels = getSimdKernels();
+
+	std::size_t blue_count = 0;
+	std::size_t number_of_flips = 0;
+	std::uint64_t hash_change = 0;
+
+	for (auto block_first = first; block_first < last; block_first += KERNEL_BLOCK_SIZE) {
+		auto const block_size = std::min(KERNEL_BLOCK_SIZE, last - block_first);
+		auto const number_of_samples = block_size*samples_per_node;
+
+		// phase 1: sample the neighbors and prefetch their colors
+		CounterRandom::generateFirstBlocks(random_key, round, block_first, block_size, random_blocks);
+		for (std::size_t i = 0; i < block_size; ++i) {
+			CounterRandom random(random_key, round, block_first + i, random_blocks[i]);
+			for (std::size_t j = 0; j < samples_per_node; ++j) {
+				auto neighbor = graph.getRandomNeighbor(block_first + i, random);
+				sampled_neighbors[i*samples_per_node + j] = neighbor;
+				__builtin_prefetch(colors + neighbor);
+			}
+		}
+
+		// phase 2: gather the colors, which are in the cache by now
+		for (std::size_t i = 0; i < number_of_samples; ++i) {
+			sampled_colors[i] = colors[sampled_neighbors[i]];
+		}
+
+		// phase 3: decide the new colors with the vectorized kernels
+		auto const old_colors = colors + block_first;
+		if (type == DynamicsType::VoterModel) {
+			std::copy(sampled_colors, sampled_colors + block_size, new_colors);
 		}
 		else {
-			next_coloring.set(node_id, current_coloring.get(node_id));
+			kernels.decideTwoChoices(old_colors, sampled_colors, new_colors, block_size);
+		}
+
+		std::size_t block_blue, block_flips;
+		kernels.countBlueAndFlips(old_colors, new_colors, block_size, block_blue, block_flips);
+		blue_count += block_blue;
+		number_of_flips += block_flips;
+
+		// the hash contributions are only computed for blocks with flips
+		for (std::size_t i = 0; block_flips > 0 && i < block_size; ++i) {
+			if (new_colors[i] != old_colors[i]) {
+				hash_change ^= Coloring::hashContribution(block_first + i, old_colors[i]) ^
+				               Coloring::hashContribution(block_first + i, new_colors[i]);
+			}
+		}
+
+		next_coloring.setUncounted(block_first, new_colors, block_size);
+	}
+
+	state.color_counts[static_cast<std::size_t>(Color::Red)] += (last - first) - blue_count;
+	state.color_counts[static_cast<std::size_t>(Color::Blue)] += blue_count;
+	state.statistics.number_of_flips += number_of_flips;
+	state.statistics.hash_change ^= hash_change;
+}
+
+void Dynamics::executeDegreeClasses(Coloring const& current_coloring,
+                                    Coloring& next_coloring,
+                                    Graph::NodeID first, Graph::NodeID last,
+                                    WorkerState& state)
+{
+	std::size_t const samples_per_node = (type == DynamicsType::VoterModel ? 1 : 2);
+	auto const colors = current_coloring.data();
+	auto const offsets = graph.getOffsets();
+	auto const ends = graph.getEnds();
+	auto const neighbors = graph.getNeighbors();
+	auto const random_blocks = state.random_blocks.data();
+	auto const sampled_neighbors = state.sampled_neighbors.data();
+	auto const sampled_colors = state.sampled_colors.data();
+	auto const new_colors = state.new_colors.data();
+	auto const old_colors = state.old_colors.data();
+	auto const random_nodes = state.random_nodes.data();
+	auto const random_positions = state.random_positions.data();
+	auto const& kernels = getSimdKernels();
+
+	std::size_t blue_count = 0;
+	std::size_t number_of_flips = 0;
+	std::uint64_t hash_change = 0;
+
+	for (auto kind: DegreeClasses::KINDS) {
+		auto const class_nodes = degree_classes->getNodes(kind, first, last);
+		for (auto block_nodes = class_nodes.first; block_nodes < class_nodes.second;
+		     block_nodes += KERNEL_BLOCK_SIZE) {
+			auto const block_size = std::min<std::size_t>(KERNEL_BLOCK_SIZE,
+			                                              class_nodes.second - block_nodes);
+			auto const number_of_samples = block_size*samples_per_node;
+
+			// phase 1: sample the neighbors and prefetch their colors
+			switch (kind) {
+			case DegreeClasses::Kind::DegreeOne:
+				for (std::size_t i = 0; i < block_size; ++i) {
+					auto const neighbor = neighbors[offsets[block_nodes[i]]];
+					for (std::size_t j = 0; j < samples_per_node; ++j) {
+						sampled_neighbors[i*samples_per_node + j] = neighbor;
+					}
+					__builtin_prefetch(colors + neighbor);
+				}
+				break;
+			case DegreeClasses::Kind::DegreeTwo: {
+				// every sample has the color of both neighbors if they agree
+				std::size_t number_of_random = 0;
+				for (std::size_t i = 0; i < block_size; ++i) {
+					auto const first_edge = offsets[block_nodes[i]];
+					auto const neighbor = neighbors[first_edge];
+					if (colors[neighbor] == colors[neighbors[first_edge + 1]]) {
+						for (std::size_t j = 0; j < samples_per_node; ++j) {
+							sampled_neighbors[i*samples_per_node + j] = neighbor;
+						}
+					}
+					else {
+						random_nodes[number_of_random] = block_nodes[i];
+						random_positions[number_of_random] = i;
+						++number_of_random;
+					}
+				}
+
+				// the top bit of the 64-bit numbers of CounterRandom::get64
+				CounterRandom::generateFirstBlocks(random_key, round, random_nodes, number_of_random,
+				                                   random_blocks);
+				for (std::size_t k = 0; k < number_of_random; ++k) {
+					auto const i = random_positions[k];
+					auto const first_edge = offsets[random_nodes[k]];
+					for (std::size_t j = 0; j < samples_per_node; ++j) {
+						auto const index = random_blocks[k][2*j + 1] >> 31;
+						sampled_neighbors[i*samples_per_node + j] = neighbors[first_edge + index];
+					}
+				}
+				break;
+			}
+			case DegreeClasses::Kind::PowerOfTwo:
+				// the samples are the 64-bit numbers of CounterRandom::get64
+				CounterRandom::generateFirstBlocks(random_key, round, block_nodes, block_size,
+				                                   random_blocks);
+				for (std::size_t i = 0; i < block_size; ++i) {
+					auto const node_id = block_nodes[i];
+					auto const first_edge = offsets[node_id];
+					auto const shift = 64 - __builtin_ctzll(ends[node_id] - first_edge);
+					auto const& block = random_blocks[i];
+					for (std::size_t j = 0; j < samples_per_node; ++j) {
+						auto const random = block[2*j] | std::uint64_t(block[2*j + 1]) << 32;
+						auto const neighbor = neighbors[first_edge + (random >> shift)];
+						sampled_neighbors[i*samples_per_node + j] = neighbor;
+						__builtin_prefetch(colors + neighbor);
+					}
+				}
+				break;
+			case DegreeClasses::Kind::General:
+				CounterRandom::generateFirstBlocks(random_key, round, block_nodes, block_size,
+				                                   random_blocks);
+				for (std::size_t i = 0; i < block_size; ++i) {
+					CounterRandom random(random_key, round, block_nodes[i], random_blocks[i]);
+					for (std::size_t j = 0; j < samples_per_node; ++j) {
+						auto neighbor = graph.getRandomNeighbor(block_nodes[i], random);
+						sampled_neighbors[i*samples_per_node + j] = neighbor;
+						__builtin_prefetch(colors + neighbor);
+					}
+				}
+				break;
+			}
+
+			// phase 2: gather the colors of the samples and of the nodes
+			for (std::size_t i = 0; i < number_of_samples; ++i) {
+				sampled_colors[i] = colors[sampled_neighbors[i]];
+			}
+			for (std::size_t i = 0; i < block_size; ++i) {
+				old_colors[i] = colors[block_nodes[i]];
+			}
+
+			// phase 3: decide the new colors like the blocked kernel
+			if (type == DynamicsType::VoterModel) {
+				std::copy(sampled_colors, sampled_colors + block_size, new_colors);
+			}
+			else {
+				kernels.decideTwoChoices(old_colors, sampled_colors, new_colors, block_size);
+			}
+
+			std::size_t block_blue, block_flips;
+			kernels.countBlueAndFlips(old_colors, new_colors, block_size, block_blue, block_flips);
+			blue_count += block_blue;
+			number_of_flips += block_flips;
+
+			for (std::size_t i = 0; i < block_size; ++i) {
+				if (new_colors[i] != old_colors[i]) {
+					hash_change ^= Coloring::hashContribution(block_nodes[i], old_colors[i]) ^
+					               Coloring::hashContribution(block_nodes[i], new_colors[i]);
+				}
+				next_coloring.setUncounted(block_nodes[i], new_colors[i]);
+			}
 		}
 	}
+
+	state.color_counts[static_cast<std::size_t>(Color::Red)] += (last - first) - blue_count;
+	state.color_counts[static_cast<std::size_t>(Color::Blue)] += blue_count;
+	state.statistics.number_of_flips += number_of_flips;
+	state.statistics.hash_change ^= hash_change;
 }
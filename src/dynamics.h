@@ -1,25 +1,105 @@
 #pragma once
 
 #include "coloring.h"
+#include "degree_classes.h"
 #include "graph.h"
+#include "parallel_engine.h"
 #include "random.h"
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct RoundStatistics
+{
+	std::size_t number_of_flips;
+	// XOR of the hash contributions of the old and new colors of the
+	// flipped nodes, see Coloring::hash
+	std::uint64_t hash_change;
+};
+
 class Dynamics
 {
 public:
-	Dynamics(DynamicsType dynamics_type, Graph const& graph);
+	// If an engine is given, the rounds are executed in parallel by its
+	// workers. Otherwise, they are executed by the calling thread.
+	Dynamics(DynamicsType dynamics_type, Graph const& graph,
+	         ParallelEngine* engine = nullptr);
 
-	void simulateOneRound(Coloring const& current_coloring,
-	                      Coloring& next_coloring);
+	// The samples are drawn from CounterRandom streams keyed by the seed,
+	// the trial, the round and the node.
+	RoundStatistics simulateOneRound(Coloring const& current_coloring,
+	                                 Coloring& next_coloring,
+	                                 std::size_t trial, std::size_t round);
 	DynamicsType getType() const;
+	void setRoundKernel(RoundKernel new_round_kernel);
+	RoundKernel getRoundKernel() const;
+	// the seed is taken from the clock unless it is set
+	void setSeed(std::uint64_t new_seed);
+	std::uint64_t getSeed() const;
 
 private:
 	DynamicsType const type;
 	Graph const& graph;
-	Random random;
+	ParallelEngine* const engine;
+	RoundKernel round_kernel = RoundKernel::Reference;
+	std::uint64_t seed;
+
+	// nodes by degree class for the DegreeClasses kernel; rebuilt after the
+	// graph was updated
+	std::unique_ptr<DegreeClasses> degree_classes;
+	std::size_t degree_classes_updates = 0;
+
+	// random key and number of the round which is simulated
+	std::uint64_t random_key = 0;
+	std::uint64_t round = 0;
+
+	// state of every worker, or of the calling thread if there is no engine
+	struct WorkerState
+	{
+		std::vector<std::size_t> color_counts;
+		RoundStatistics statistics;
+		// buffers of the blocked kernel
+		std::vector<CounterRandom::Block> random_blocks;
+		std::vector<Graph::NodeID> sampled_neighbors;
+		std::vector<Color> sampled_colors;
+		std::vector<Color> new_colors;
+		// buffers of the DegreeClasses kernel: the colors of the nodes of a
+		// block, which aren't consecutive, and the nodes of degree two that
+		// need random numbers with their positions in the block
+		std::vector<Color> old_colors;
+		std::vector<Graph::NodeID> random_nodes;
+		std::vector<std::size_t> random_positions;
+		// avoids false sharing between the workers
+		char padding[64];
+	};
+	std::vector<WorkerState> worker_states;
+
+	// The nodes are updated in blocks of this size so that the pages of an
+	// out-of-core graph can be requested one block ahead.
+	static std::size_t const BLOCK_SIZE = 1 << 16;
+	// number of nodes handled at once by the blocked kernel; the prefetches
+	// of a whole kernel block are in flight before the first color is read
+	static std::size_t const KERNEL_BLOCK_SIZE = 128;
 
+	void simulateRange(Coloring const& current_coloring,
+	                   Coloring& next_coloring,
+	                   Graph::NodeID first, Graph::NodeID last,
+	                   WorkerState& state);
 	void executeVoterModel(Coloring const& current_coloring,
-	                       Coloring& next_coloring);
+	                       Coloring& next_coloring,
+	                       Graph::NodeID first, Graph::NodeID last,
+	                       WorkerState& state);
 	void executeTwoChoices(Coloring const& current_coloring,
-                           Coloring& next_coloring);
+	                       Coloring& next_coloring,
+	                       Graph::NodeID first, Graph::NodeID last,
+	                       WorkerState& state);
+	void executeBlocked(Coloring const& current_coloring,
+	                    Coloring& next_coloring,
+	                    Graph::NodeID first, Graph::NodeID last,
+	                    WorkerState& state);
+	void executeDegreeClasses(Coloring const& current_coloring,
+	                          Coloring& next_coloring,
+	                          Graph::NodeID first, Graph::NodeID last,
+	                          WorkerState& state);
 };
@@ -1,20 +1,179 @@
 #include "experiments.h"
 
+#include "async_simulation.h"
 #include "core_periphery.h"
 #include "defs.h"
+#include "memory_accounting.h"
+#include "multi_color_simulation.h"
+#include "performance_report.h"
+#include "progress.h"
+#include "simd_kernels.h"
+
+#include <unistd.h>
 
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <tuple>
 
+namespace
+{
+
+void readOption(std::string const& option, ExperimentData& experiment_data)
+{
+	auto separator = option.find('=');
+	if (separator == std::string::npos) {
+		Error("Experiment options have to be given as key=value: " + option);
+	}
+
+	auto key = option.substr(0, separator);
+	auto value = option.substr(separator + 1);
+	if (key == "kernel") {
+		experiment_data.round_kernel = toRoundKernel(value);
+	}
+	else if (key == "seed") {
+		experiment_data.seed = std::stoull(value);
+		experiment_data.seed_given = true;
+	}
+	else if (key == "trial") {
+		experiment_data.replay_trial = std::stoll(value);
+		if (experiment_data.replay_trial < 0 ||
+		    (std::size_t)experiment_data.replay_trial >= experiment_data.number_of_exps) {
+			Error("The trial to replay has to be smaller than the number of experiments: " + value);
+		}
+	}
+	else if (key == "colors") {
+		experiment_data.number_of_colors = std::stoull(value);
+		if (experiment_data.number_of_colors < 2 ||
+		    experiment_data.number_of_colors > MAX_NUMBER_OF_COLORS) {
+			Error("The number of colors has to be between 2 and " << MAX_NUMBER_OF_COLORS
+			      << ": " << value);
+		}
+	}
+	else if (key == "update") {
+		experiment_data.update_model = toUpdateModel(value);
+	}
+	else if (key == "h") {
+		experiment_data.h = std::stoull(value);
+		if (experiment_data.h == 0) {
+			Error("HMajority needs at least one sample: " + value);
+		}
+	}
+	else {
+		Error("Unknown experiment option: " + key);
+	}
+}
+
+std::uint64_t getFileSize(std::string const& filename)
+{
+	std::ifstream file(filename, std::ios_base::binary | std::ios_base::ate);
+	return (file.is_open() ? static_cast<std::uint64_t>(file.tellg()) : 0);
+}
+
+void clearFile(std::string const& filename)
+{
+	std::ofstream file(filename, std::ios_base::trunc);
+	if (!file.is_open()) {
+		Error("The result file couldn't be truncated. Filename: " + filename);
+	}
+}
+
+bool isTrialRun(ExperimentData const& experiment_data, std::size_t trial)
+{
+	return experiment_data.replay_trial == -1 || (std::size_t)experiment_data.replay_trial == trial;
+}
+
+} // end anonymous
+
+bool readExperiment(std::string const& line, Random& seeder, ExperimentData& experiment_data)
+{
+	if (line.empty() || line[0] == '#') {
+		return false;
+	}
+
+	std::stringstream ss(line);
+	std::string graph_file, dynamics_type_str, cp_method_str,
+	            max_rounds_str, win_threshold_str, number_of_exps_str;
+	ss >> graph_file >> dynamics_type_str >> cp_method_str
+	   >> max_rounds_str >> win_threshold_str >> number_of_exps_str;
+	if (number_of_exps_str.empty()) {
+		Error("An experiment needs six columns: " + line);
+	}
+
+	experiment_data = ExperimentData{graph_file,
+	                                 toDynamicsType(dynamics_type_str),
+	                                 toCPMethod(cp_method_str),
+	                                 std::stoll(max_rounds_str),
+	                                 std::stof(win_threshold_str),
+	                                 std::stoull(number_of_exps_str),
+	                                 RoundKernel::Reference,
+	                                 seeder.getSizeT(0, SIZE_MAX),
+	                                 -1};
+
+	std::string option;
+	while (ss >> option) {
+		readOption(option, experiment_data);
+	}
+	if (experiment_data.update_model == UpdateModel::Asynchronous &&
+	    isMultiColorExperiment(experiment_data)) {
+		Error("The asynchronous update model only supports two colors: " + line);
+	}
+
+	return true;
+}
+
 void Experiments::run()
 {
 	Print("Running the experiments.");
 
 	auto experiments_data = readExperiments(experiments_file);
-	for (ExperimentID id = 0; id < experiments_data.size(); ++id) {
-		run(id, experiments_data[id]);
+	experiments_hash = hashFileContent(experiments_file);
+
+	Checkpoint checkpoint;
+	bool resuming = false;
+	if (checkpoint_options.resume) {
+		if (!readCheckpoint(getCheckpointFilename(), checkpoint)) {
+			Error("There is no checkpoint to resume from. Filename: " + getCheckpointFilename());
+		}
+		if (checkpoint.experiments_hash != experiments_hash) {
+			Error("The checkpoint belongs to a different experiments file.");
+		}
+		resuming = true;
+		Print("Resuming experiment " << checkpoint.experiment_id << " at trial "
+		      << checkpoint.trial << ".");
+	}
+
+	if (checkpoint_options.interval_seconds > 0) {
+		checkpoint_writer.reset(new CheckpointWriter(getCheckpointFilename()));
+	}
+
+	if (checkpoint_options.ledger) {
+		if (resuming) {
+			// the checkpoint has the seed that the interrupted run drew
+			experiments_data[checkpoint.experiment_id].seed = checkpoint.seed;
+			experiments_data[checkpoint.experiment_id].seed_given = true;
+		}
+		ledger.reset(new RunLedger(result_files_prefix + "ledger"));
+		useLedger(experiments_data);
 	}
+
+	for (ExperimentID id = (resuming ? checkpoint.experiment_id : 0);
+	     id < experiments_data.size(); ++id) {
+		auto progress = getActiveProgressMonitor();
+		if (progress) {
+			auto const& experiment_data = experiments_data[id];
+			auto const replay_trial = experiment_data.replay_trial;
+			progress->beginExperiment(id, experiments_data.size(), experiment_data.graph_file,
+			                          replay_trial == -1 ? experiment_data.number_of_exps
+			                                             : replay_trial + 1);
+		}
+
+		bool resume = (resuming && id == checkpoint.experiment_id);
+		run(id, experiments_data[id], resume ? &checkpoint : nullptr);
+	}
+
+	checkpoint_writer.reset();
+	ledger.reset();
 }
 
 auto Experiments::readExperiments(std::string const& experiments_file) -> ExperimentsData
@@ -25,54 +184,338 @@ auto Experiments::readExperiments(std::string const& experiments_file) -> Experi
 	}
 
 	ExperimentsData experiments_data;
+	Random seeder;
 
 	std::string line;
+	ExperimentData experiment_data;
 	while (std::getline(file, line)) {
-		if (line.empty() || line[0] == '#') {
-			continue;
+		if (readExperiment(line, seeder, experiment_data)) {
+			experiments_data.push_back(experiment_data);
 		}
-
-		std::stringstream ss(line);
-		std::string graph_file, dynamics_type_str, cp_method_str,
-		            max_rounds_str, win_threshold_str, number_of_exps_str;
-		ss >> graph_file >> dynamics_type_str >> cp_method_str
-		   >> max_rounds_str >> win_threshold_str >> number_of_exps_str;
-
-		experiments_data.push_back({graph_file,
-		                            toDynamicsType(dynamics_type_str),
-		                            toCPMethod(cp_method_str),
-		                            std::stoll(max_rounds_str),
-		                            std::stof(win_threshold_str),
-		                            std::stoull(number_of_exps_str)});
 	}
 
 	return experiments_data;
 }
 
-void Experiments::run(ExperimentID id, ExperimentData const& experiment_data)
+void Experiments::useLedger(ExperimentsData& experiments_data)
 {
-	Graph graph;
-	graph.buildFromFile(experiment_data.graph_file);
+	// the n-th experiment with the same key (without the seed) gets the n-th
+	// recorded seed, so repeated lines keep different seeds
+	std::map<RunLedger::Key, std::size_t> occurrences;
 
-	auto initial_coloring = calculateCorePeripheryColoring(graph, experiment_data.cp_method);
-	Simulation simulation(graph, experiment_data.dynamics_type, initial_coloring);
+	experiment_keys.clear();
+	for (auto& experiment_data: experiments_data) {
+		auto const graph_hash = ledger->getGraphHash(experiment_data.graph_file);
+		if (!experiment_data.seed_given) {
+			auto const key = getExperimentKey(experiment_data, graph_hash, false);
+			auto const occurrence = occurrences[key]++;
+			if (!ledger->findSeed(key, occurrence, experiment_data.seed)) {
+				ledger->recordSeed(key, occurrence, experiment_data.seed);
+			}
+		}
+		experiment_keys.push_back(getExperimentKey(experiment_data, graph_hash));
+	}
+}
 
-	writeInformationToFile(id, experiment_data, graph, initial_coloring, simulation);
+bool Experiments::isRecorded(ExperimentData const& experiment_data) const
+{
+	ExperimentSummary summary;
+	if (!ledger || !ledger->findSummary(experiment_key, summary)) {
+		return false;
+	}
+
+	Result result;
+	for (std::size_t round = 0; round < experiment_data.number_of_exps; ++round) {
+		if (isTrialRun(experiment_data, round) && !ledger->findResult(experiment_key, round, result)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Experiments::writeRecordedExperiment(ExperimentID id, ExperimentData const& experiment_data)
+{
+	ExperimentSummary summary;
+	ledger->findSummary(experiment_key, summary);
+
+	clearFile(result_files_prefix + std::to_string(id));
+	writeInformationToFile(id, experiment_data, experiment_data.seed, summary);
 
 	Results results;
 	for (std::size_t round = 0; round < experiment_data.number_of_exps; ++round) {
-		auto result = simulation.run(experiment_data.max_rounds, experiment_data.win_threshold);
-		results.push_back(result);
+		if (!isTrialRun(experiment_data, round)) {
+			continue;
+		}
+
+		Result result;
+		ledger->findResult(experiment_key, round, result);
 		writeResultToFile(id, experiment_data, result, round);
+		results.push_back(result);
 	}
 
 	writeSummaryToFile(id, experiment_data, results);
 }
 
+void Experiments::run(ExperimentID id, ExperimentData const& experiment_data,
+                      Checkpoint const* resume_checkpoint)
+{
+	std::string const exp_filename = result_files_prefix + std::to_string(id);
+
+	experiment_key = (ledger ? experiment_keys[id] : 0);
+	if (!resume_checkpoint && isRecorded(experiment_data)) {
+		Print("Experiment " << id << " is in the run ledger.");
+		writeRecordedExperiment(id, experiment_data);
+		return;
+	}
+
+	// created before the simulation, so the hardware counters are inherited
+	// by its worker threads
+	std::unique_ptr<PerformanceReport> report;
+	if (report_options.enabled) {
+		report.reset(new PerformanceReport(report_options.hardware_counters));
+		report->addInfo("experiment", std::to_string(id));
+		report->addInfo("graph_file", experiment_data.graph_file);
+		report->addInfo("dynamics_type", toString(experiment_data.dynamics_type));
+		report->addInfo("round_kernel", toString(experiment_data.round_kernel));
+		report->addInfo("threads", std::to_string(parallel_options.number_of_threads));
+		report->addInfo("colors", std::to_string(experiment_data.number_of_colors));
+		report->addInfo("update_model", toString(experiment_data.update_model));
+		report->addInfo("instruction_set", toString(getInstructionSet()));
+		setActiveReport(report.get());
+	}
+
+	// samples the RSS for the report and to enforce the memory budget
+	std::unique_ptr<MemoryMonitor> memory_monitor;
+	if (report_options.enabled || getMemoryBudget() != 0) {
+		memory_monitor.reset(new MemoryMonitor());
+		setActiveMemoryMonitor(memory_monitor.get());
+	}
+
+	Graph graph;
+	graph.buildFromFile(experiment_data.graph_file);
+
+	Coloring initial_coloring(0);
+	{
+		ScopedPhase phase("core_extraction");
+		initial_coloring = calculateCorePeripheryColoring(graph, experiment_data.cp_method);
+	}
+
+	// The result file is rewritten, except when resuming. The checkpoint
+	// records its size, so output written after it is discarded and not
+	// duplicated when resuming.
+	Checkpoint checkpoint{experiments_hash, id, 0, 0, experiment_data.seed, {}, false,
+	                      SimulationState()};
+	if (resume_checkpoint) {
+		checkpoint = *resume_checkpoint;
+		if (truncate(exp_filename.c_str(), checkpoint.result_file_size) != 0) {
+			Error("The result file couldn't be truncated. Filename: " + exp_filename);
+		}
+	}
+	else {
+		// the checkpoint has to be on disk before the result file is changed
+		saveCheckpoint(checkpoint);
+		if (checkpoint_writer) { checkpoint_writer->flush(); }
+		clearFile(exp_filename);
+	}
+
+	if (isMultiColorExperiment(experiment_data)) {
+		runMultiColorTrials(id, experiment_data, graph, initial_coloring, checkpoint);
+	}
+	else if (experiment_data.update_model == UpdateModel::Asynchronous) {
+		runAsyncTrials(id, experiment_data, graph, initial_coloring, checkpoint);
+	}
+	else {
+		runTrials(id, experiment_data, graph, initial_coloring, checkpoint);
+	}
+
+	writeSummaryToFile(id, experiment_data, checkpoint.results);
+
+	setActiveMemoryMonitor(nullptr);
+	if (report) {
+		report->setMemory(memory_monitor->getPeak(), memory_monitor->getStructures());
+		setActiveReport(nullptr);
+		std::ofstream file(getReportFilename(id));
+		if (!file.is_open()) {
+			Error("The report file couldn't be opened. Filename: " + getReportFilename(id));
+		}
+		report->writeJson(file);
+	}
+}
+
+void Experiments::runTrials(ExperimentID id, ExperimentData const& experiment_data,
+                            Graph const& graph, Coloring const& initial_coloring,
+                            Checkpoint& checkpoint)
+{
+	Simulation simulation(graph, experiment_data.dynamics_type, initial_coloring,
+	                      parallel_options);
+	simulation.setRoundKernel(experiment_data.round_kernel);
+	simulation.setSeed(checkpoint.seed);
+
+	if (checkpoint.trial == 0 && !checkpoint.has_simulation_state) {
+		writeInformationToFile(id, experiment_data, checkpoint.seed,
+		                       summarize(graph, initial_coloring,
+		                                 initial_coloring.getColorFractions(),
+		                                 simulation.getColorVolumes()));
+		checkpoint.result_file_size = getFileSize(result_files_prefix + std::to_string(id));
+	}
+
+	if (checkpoint_writer) {
+		simulation.setCheckpointHandler(checkpoint_options.interval_seconds,
+		                                [&](SimulationState const& state) {
+			auto running_checkpoint = checkpoint;
+			running_checkpoint.has_simulation_state = true;
+			running_checkpoint.simulation_state = state;
+			saveCheckpoint(std::move(running_checkpoint));
+		});
+	}
+
+	for (std::size_t round = checkpoint.trial; round < experiment_data.number_of_exps; ++round) {
+		if (!isTrialRun(experiment_data, round)) {
+			continue;
+		}
+
+		auto result = runTrial(round, [&]() {
+			auto resume_state = (checkpoint.has_simulation_state ? &checkpoint.simulation_state
+			                                                     : nullptr);
+			return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold,
+			                      round, resume_state);
+		});
+		recordResult(id, experiment_data, result, round, checkpoint);
+	}
+}
+
+void Experiments::runMultiColorTrials(ExperimentID id, ExperimentData const& experiment_data,
+                                      Graph const& graph, Coloring const& initial_coloring,
+                                      Checkpoint& checkpoint)
+{
+	// only checkpointed between trials, so a resumed experiment repeats the
+	// trial that was interrupted
+	MultiColorSimulation simulation(graph, experiment_data.dynamics_type,
+	                                createMultiColorInitialColoring(initial_coloring,
+	                                                                experiment_data.number_of_colors,
+	                                                                checkpoint.seed),
+	                                experiment_data.h, parallel_options);
+	simulation.setSeed(checkpoint.seed);
+
+	if (checkpoint.trial == 0) {
+		writeInformationToFile(id, experiment_data, checkpoint.seed,
+		                       summarize(graph, initial_coloring,
+		                                 simulation.getColoring().getColorFractions(),
+		                                 simulation.getColorVolumes()));
+		checkpoint.result_file_size = getFileSize(result_files_prefix + std::to_string(id));
+	}
+
+	for (std::size_t round = checkpoint.trial; round < experiment_data.number_of_exps; ++round) {
+		if (!isTrialRun(experiment_data, round)) {
+			continue;
+		}
+
+		auto result = runTrial(round, [&]() {
+			return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold,
+			                      round);
+		});
+		recordResult(id, experiment_data, result, round, checkpoint);
+	}
+}
+
+void Experiments::runAsyncTrials(ExperimentID id, ExperimentData const& experiment_data,
+                                 Graph const& graph, Coloring const& initial_coloring,
+                                 Checkpoint& checkpoint)
+{
+	// only checkpointed between trials, like the multi-color trials
+	AsyncSimulation simulation(graph, experiment_data.dynamics_type, initial_coloring);
+	simulation.setSeed(checkpoint.seed);
+
+	if (checkpoint.trial == 0) {
+		writeInformationToFile(id, experiment_data, checkpoint.seed,
+		                       summarize(graph, initial_coloring,
+		                                 initial_coloring.getColorFractions(),
+		                                 simulation.getColorVolumes()));
+		checkpoint.result_file_size = getFileSize(result_files_prefix + std::to_string(id));
+	}
+
+	for (std::size_t round = checkpoint.trial; round < experiment_data.number_of_exps; ++round) {
+		if (!isTrialRun(experiment_data, round)) {
+			continue;
+		}
+
+		auto result = runTrial(round, [&]() {
+			return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold,
+			                      round);
+		});
+		recordResult(id, experiment_data, result, round, checkpoint);
+	}
+}
+
+Result Experiments::runTrial(std::size_t trial, std::function<Result()> const& simulate)
+{
+	Result result;
+	if (ledger && ledger->findResult(experiment_key, trial, result)) {
+		return result;
+	}
+
+	result = simulate();
+	if (ledger) {
+		ledger->recordResult(experiment_key, trial, result);
+	}
+	return result;
+}
+
+void Experiments::recordResult(ExperimentID id, ExperimentData const& experiment_data,
+                               Result const& result, std::size_t round, Checkpoint& checkpoint)
+{
+	checkpoint.results.push_back(result);
+	writeResultToFile(id, experiment_data, result, round);
+
+	checkpoint.trial = round + 1;
+	checkpoint.result_file_size = getFileSize(result_files_prefix + std::to_string(id));
+	checkpoint.has_simulation_state = false;
+	checkpoint.simulation_state = SimulationState();
+	saveCheckpoint(checkpoint);
+}
+
+std::string Experiments::getCheckpointFilename() const
+{
+	return result_files_prefix + "checkpoint";
+}
+
+std::string Experiments::getReportFilename(ExperimentID id) const
+{
+	return result_files_prefix + std::to_string(id) + ".report.json";
+}
+
+void Experiments::saveCheckpoint(Checkpoint checkpoint)
+{
+	if (checkpoint_writer) {
+		checkpoint_writer->write(std::move(checkpoint));
+	}
+}
+
+ExperimentSummary Experiments::summarize(Graph const& graph, Coloring const& initial_coloring,
+                                         std::vector<float> const& initial_fractions,
+                                         std::vector<float> const& initial_volumes)
+{
+	ScopedPhase phase("output");
+
+	// of the core against the periphery
+	float dominance, robustness;
+	std::tie(dominance, robustness) = calcDominanceAndRobustness(graph, initial_coloring);
+	ExperimentSummary const summary{graph.getNumberOfNodes(), graph.getNumberOfEdges(),
+	                                graph.isWeighted(), initial_fractions, initial_volumes,
+	                                dominance, robustness};
+
+	ExperimentSummary recorded;
+	if (ledger && !ledger->findSummary(experiment_key, recorded)) {
+		ledger->recordSummary(experiment_key, summary);
+	}
+	return summary;
+}
+
 void Experiments::writeInformationToFile(ExperimentID id, ExperimentData const& experiment_data,
-                                         Graph const& graph, Coloring const& initial_coloring,
-                                         Simulation const& simulation)
+                                         std::uint64_t seed, ExperimentSummary const& summary)
 {
+	ScopedPhase phase("output");
 	std::string const exp_filename = result_files_prefix + std::to_string(id);
 	std::ofstream file(exp_filename, std::ios_base::app);
 
@@ -88,36 +531,54 @@ void Experiments::writeInformationToFile(ExperimentID id, ExperimentData const&
 	file << "Dynamics type: " << toString(experiment_data.dynamics_type) << "\n";
 	file << "Core extraction method: " << toString(experiment_data.cp_method) << "\n";
 	file << "Max rounds: " << experiment_data.max_rounds << "\n";
+	file << "Round kernel: " << toString(experiment_data.round_kernel) << "\n";
+	if (experiment_data.update_model == UpdateModel::Asynchronous) {
+		file << "Update model: " << toString(experiment_data.update_model) << "\n";
+	}
+	file << "Seed: " << seed << "\n";
 	file << "Number of experiments: " << experiment_data.number_of_exps << "\n";
+	if (isMultiColorExperiment(experiment_data)) {
+		file << "Number of colors: " << experiment_data.number_of_colors << "\n";
+		if (experiment_data.dynamics_type == DynamicsType::HMajority) {
+			file << "Samples (h): " << experiment_data.h << "\n";
+		}
+	}
 	file << "\n";
 
 	// graph data
 	file << "Graph data" << "\n";
 	file << "==========" << "\n";
-	file << "Number of nodes: " << graph.getNumberOfNodes() << "\n";
-	file << "Number of edges: " << graph.getNumberOfEdges() << "\n";
+	file << "Number of nodes: " << summary.number_of_nodes << "\n";
+	file << "Number of edges: " << summary.number_of_edges << "\n";
+	file << "Weighted: " << (summary.weighted ? "yes" : "no") << "\n";
 	file << "\n";
 
 	// initial coloring data
 	file << "Initial coloring:\n";
 	file << "=================\n";
-	file << "Fractions (red/blue): ";
-	for (auto fraction: initial_coloring.getColorFractions()) { file << fraction << " "; }
-	file << "\nVolumes (red/blue): ";
-	for (auto volume: simulation.getColorVolumes()) { file << volume << " "; }
-	float dominance, robustness;
-	std::tie(dominance, robustness) = calcDominanceAndRobustness(graph, initial_coloring);
-	file << "\nDominance (c_d): " << dominance << "\n";
-	file << "Robustness (c_r): " << robustness << "\n";
+	// with more than two colors, the colors are listed in the order 0, ..., k-1
+	std::string const colors = (summary.initial_fractions.size() == 2 ? "red/blue" : "0/.../k-1");
+	file << "Fractions (" << colors << "): ";
+	for (auto fraction: summary.initial_fractions) { file << fraction << " "; }
+	file << "\nVolumes (" << colors << "): ";
+	for (auto volume: summary.initial_volumes) { file << volume << " "; }
+	file << "\nDominance (c_d): " << summary.dominance << "\n";
+	file << "Robustness (c_r): " << summary.robustness << "\n";
 
 	file << "\n";
-	file << "Results: (winning_color frac_red frac_blue vol_red vol_blue num_rounds)\n";
+	if (summary.initial_fractions.size() == 2) {
+		file << "Results: (winning_color frac_red frac_blue vol_red vol_blue num_rounds stop_reason)\n";
+	}
+	else {
+		file << "Results: (winning_color frac_0 ... frac_k-1 vol_0 ... vol_k-1 num_rounds stop_reason)\n";
+	}
 	file << "========\n";
 }
 
 void Experiments::writeResultToFile(ExperimentID id, ExperimentData const& experiment_data,
                                     Result const& result, std::size_t round)
 {
+	ScopedPhase phase("output");
 	std::string const exp_filename = result_files_prefix + std::to_string(id);
 	std::ofstream file(exp_filename, std::ios_base::app);
 
@@ -125,16 +586,13 @@ void Experiments::writeResultToFile(ExperimentID id, ExperimentData const& exper
 		Error("The experiments file couldn't be opened. Filename: " + exp_filename);
 	}
 
-	file << "Round " << round << ": "; 
-	file << toString(result.winning_color) << " ";
-	for (auto fraction: result.color_fractions) { file << fraction << " "; }
-	for (auto volume: result.color_volumes) { file << volume << " "; }
-	file << result.number_of_rounds << "\n";
+	file << "Round " << round << ": " << toString(result) << "\n";
 }
 
 void Experiments::writeSummaryToFile(ExperimentID id, ExperimentData const& experiment_data,
                                      Results const& results)
 {
+	ScopedPhase phase("output");
 	std::string const exp_filename = result_files_prefix + std::to_string(id);
 	std::ofstream file(exp_filename, std::ios_base::app);
 
@@ -2,28 +2,84 @@
 
 #include "graph.h"
 #include "basic_types.h"
+#include "checkpoint.h"
+#include "random.h"
+#include "run_ledger.h"
 #include "simulation.h"
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
+
+// Reads one line of an experiments file. Returns false for empty lines and
+// comments. Seeds that are not given are drawn from the seeder.
+bool readExperiment(std::string const& line, Random& seeder, ExperimentData& experiment_data);
 
 class Experiments
 {
 public:
-	Experiments(std::string const& experiments_file, std::string const& result_files_prefix)
-		: experiments_file(experiments_file), result_files_prefix(result_files_prefix) {}
+	Experiments(std::string const& experiments_file, std::string const& result_files_prefix,
+	            ParallelOptions const& parallel_options = ParallelOptions(),
+	            CheckpointOptions const& checkpoint_options = CheckpointOptions(),
+	            ReportOptions const& report_options = ReportOptions())
+		: experiments_file(experiments_file), result_files_prefix(result_files_prefix),
+		  parallel_options(parallel_options), checkpoint_options(checkpoint_options),
+		  report_options(report_options) {}
 	void run();
 
 private:
 	std::string const experiments_file;
 	std::string const result_files_prefix;
+	ParallelOptions const parallel_options;
+	CheckpointOptions const checkpoint_options;
+	ReportOptions const report_options;
 
 	using ExperimentID = std::size_t;
 
+	// hash of the experiments file content, to match checkpoints to it
+	std::uint64_t experiments_hash = 0;
+	std::unique_ptr<CheckpointWriter> checkpoint_writer;
+	// null with --no-ledger
+	std::unique_ptr<RunLedger> ledger;
+	// per experiment, and the one of the running experiment
+	std::vector<RunLedger::Key> experiment_keys;
+	RunLedger::Key experiment_key = 0;
+
 	ExperimentsData readExperiments(std::string const& experiments_file);
-	void run(ExperimentID id, ExperimentData const& experiment_data);
+	// Replaces the drawn seeds of the experiments without a seed setting by
+	// the ones of the same experiments in earlier runs and calculates the keys.
+	void useLedger(ExperimentsData& experiments_data);
+	// whether the summary and all trials to run are in the ledger
+	bool isRecorded(ExperimentData const& experiment_data) const;
+	// writes the result file from the ledger
+	void writeRecordedExperiment(ExperimentID id, ExperimentData const& experiment_data);
+	// If a checkpoint is given, the experiment is resumed from it.
+	void run(ExperimentID id, ExperimentData const& experiment_data,
+	         Checkpoint const* resume_checkpoint);
+	void runTrials(ExperimentID id, ExperimentData const& experiment_data, Graph const& graph,
+	               Coloring const& initial_coloring, Checkpoint& checkpoint);
+	void runMultiColorTrials(ExperimentID id, ExperimentData const& experiment_data,
+	                         Graph const& graph, Coloring const& initial_coloring,
+	                         Checkpoint& checkpoint);
+	void runAsyncTrials(ExperimentID id, ExperimentData const& experiment_data,
+	                    Graph const& graph, Coloring const& initial_coloring,
+	                    Checkpoint& checkpoint);
+	// The result from the ledger, or the one of simulate, which is recorded.
+	Result runTrial(std::size_t trial, std::function<Result()> const& simulate);
+	// Adds the result of the trial to the result file and the checkpoint.
+	void recordResult(ExperimentID id, ExperimentData const& experiment_data,
+	                  Result const& result, std::size_t round, Checkpoint& checkpoint);
+	std::string getCheckpointFilename() const;
+	std::string getReportFilename(ExperimentID id) const;
+	void saveCheckpoint(Checkpoint checkpoint);
+	// and records it in the ledger
+	ExperimentSummary summarize(Graph const& graph, Coloring const& initial_coloring,
+	                            std::vector<float> const& initial_fractions,
+	                            std::vector<float> const& initial_volumes);
 	void writeInformationToFile(ExperimentID id, ExperimentData const& experiment_data,
-	                            Graph const& graph, Coloring const& initial_coloring,
-	                            Simulation const& simulation);
+	                            std::uint64_t seed, ExperimentSummary const& summary);
 	void writeResultToFile(ExperimentID id, ExperimentData const& experiment_data,
 	                       Result const& result, std::size_t round);
 	void writeSummaryToFile(ExperimentID id, ExperimentData const& experiment_data,
@@ -0,0 +1,300 @@
+#include "external_graph_builder.h"
+
+#include "binary_graph_format.h"
+#include "compressed_input.h"
+#include "defs.h"
+#include "union_find.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+
+Graph::NodeID const NO_ID = std::numeric_limits<Graph::NodeID>::max();
+
+// maximal number of runs which are merged at once
+std::size_t const MAX_FAN_IN = 64;
+// minimal number of edges per run and per merge buffer
+std::size_t const MIN_BUFFER_SIZE = 1 << 10;
+
+template <typename T>
+class RunReader
+{
+public:
+	RunReader(std::string const& run_file, std::size_t buffer_size)
+		: file(run_file, std::ios_base::binary), buffer(buffer_size)
+	{
+		if (!file.is_open()) {
+			Error("The run file couldn't be opened. Filename: " + run_file);
+		}
+	}
+
+	bool next(T& value)
+	{
+		if (position == filled) {
+			file.read(reinterpret_cast<char*>(buffer.data()), buffer.size()*sizeof(T));
+			filled = file.gcount()/sizeof(T);
+			position = 0;
+			if (filled == 0) { return false; }
+		}
+
+		value = buffer[position++];
+		return true;
+	}
+
+private:
+	std::ifstream file;
+	std::vector<T> buffer;
+	std::size_t position = 0;
+	std::size_t filled = 0;
+};
+
+} // end anonymous
+
+ExternalGraphBuilder::ExternalGraphBuilder(std::size_t run_bytes)
+	: run_capacity(std::max(run_bytes/sizeof(Edge), MIN_BUFFER_SIZE)) {}
+
+void ExternalGraphBuilder::build(std::string const& graph_file, std::string const& binary_file)
+{
+	readRuns(graph_file, binary_file);
+	reduceRuns(binary_file);
+	writeBinaryFile(binary_file);
+	removeRuns(run_files);
+	run_files.clear();
+}
+
+void ExternalGraphBuilder::readRuns(std::string const& graph_file, std::string const& binary_file)
+{
+	auto file = openTextFile(graph_file);
+	if (!file) {
+		Error("The graph file couldn't be opened");
+	}
+
+	// Node IDs are assigned in order of first appearance like in
+	// Graph::convertIDs. As components are closed under edges, this order
+	// restricted to the largest component is the one of the in-memory builder.
+	std::unordered_map<std::string, NodeID> to_id;
+	DenseUnionFind union_find;
+	auto get_id = [&](std::string const& parser_id) {
+		auto it = to_id.find(parser_id);
+		if (it != to_id.end()) { return it->second; }
+
+		NodeID id = to_id.size();
+		to_id.emplace(parser_id, id);
+		union_find.resize(id + 1);
+		return id;
+	};
+
+	Edges run;
+	run.reserve(run_capacity);
+
+	std::string line;
+	std::string source, target;
+	Graph::Weight weight;
+	while (std::getline(*file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::stringstream ss(line);
+		ss >> source >> target;
+		if (ss >> weight) {
+			Error("Weighted edge lists are not supported by the streaming converter");
+		}
+
+		// remove loops as they are annoying
+		if (source == target) {
+			continue;
+		}
+
+		auto source_id = get_id(source);
+		auto target_id = get_id(target);
+		union_find.unite(source_id, target_id);
+
+		if (run.size() + 2 > run_capacity) {
+			spillRun(run, binary_file);
+		}
+		run.emplace_back(source_id, target_id);
+		run.emplace_back(target_id, source_id);
+	}
+	spillRun(run, binary_file);
+
+	// the parser IDs are not needed anymore
+	decltype(to_id)().swap(to_id);
+
+	// Renumber the nodes of the largest component. The renumbering is
+	// monotonic, so the order of the sorted runs is kept.
+	new_ids.assign(union_find.size(), NO_ID);
+	number_of_nodes = 0;
+	if (union_find.size() > 0) {
+		auto largest_root = union_find.findRoot(union_find.largestSetElement());
+		for (NodeID id = 0; id < union_find.size(); ++id) {
+			if (union_find.findRoot(id) == largest_root) {
+				new_ids[id] = number_of_nodes++;
+			}
+		}
+	}
+}
+
+void ExternalGraphBuilder::spillRun(Edges& run, std::string const& binary_file)
+{
+	if (run.empty()) { return; }
+
+	std::sort(run.begin(), run.end());
+	run.erase(std::unique(run.begin(), run.end()), run.end());
+
+	auto run_file = newRunFile(binary_file);
+	std::ofstream file(run_file, std::ios_base::binary | std::ios_base::trunc);
+	file.write(reinterpret_cast<char const*>(run.data()), run.size()*sizeof(Edge));
+	if (!file) {
+		Error("Writing the run file failed. Filename: " + run_file);
+	}
+
+	run_files.push_back(run_file);
+	run.clear();
+}
+
+std::string ExternalGraphBuilder::newRunFile(std::string const& binary_file)
+{
+	return binary_file + ".run" + std::to_string(number_of_created_runs++);
+}
+
+std::size_t ExternalGraphBuilder::mergeBufferSize() const
+{
+	// the buffers of all merged runs share the memory of one run
+	return std::max(run_capacity/(MAX_FAN_IN + 1), MIN_BUFFER_SIZE);
+}
+
+void ExternalGraphBuilder::reduceRuns(std::string const& binary_file)
+{
+	while (run_files.size() > MAX_FAN_IN) {
+		std::vector<std::string> merged_runs;
+		for (std::size_t first = 0; first < run_files.size(); first += MAX_FAN_IN) {
+			auto last = std::min(first + MAX_FAN_IN, run_files.size());
+			std::vector<std::string> runs(run_files.begin() + first, run_files.begin() + last);
+
+			auto run_file = newRunFile(binary_file);
+			std::ofstream file(run_file, std::ios_base::binary | std::ios_base::trunc);
+			Edges buffer;
+			buffer.reserve(mergeBufferSize());
+			auto flush = [&]() {
+				file.write(reinterpret_cast<char const*>(buffer.data()), buffer.size()*sizeof(Edge));
+				buffer.clear();
+			};
+
+			mergeRuns(runs, [&](Edge const& edge) {
+				buffer.push_back(edge);
+				if (buffer.size() == buffer.capacity()) { flush(); }
+			});
+			flush();
+
+			if (!file) {
+				Error("Writing the run file failed. Filename: " + run_file);
+			}
+
+			removeRuns(runs);
+			merged_runs.push_back(run_file);
+		}
+		run_files.swap(merged_runs);
+	}
+}
+
+template <typename EdgeConsumer>
+void ExternalGraphBuilder::mergeRuns(std::vector<std::string> const& runs, EdgeConsumer consume)
+{
+	std::vector<RunReader<Edge>> readers;
+	readers.reserve(runs.size());
+	for (auto const& run_file: runs) {
+		readers.emplace_back(run_file, mergeBufferSize());
+	}
+
+	using QueueEntry = std::pair<Edge, std::size_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	for (std::size_t i = 0; i < readers.size(); ++i) {
+		Edge edge;
+		if (readers[i].next(edge)) {
+			queue.emplace(edge, i);
+		}
+	}
+
+	Edge last_edge(NO_ID, NO_ID);
+	while (!queue.empty()) {
+		auto edge = queue.top().first;
+		auto run = queue.top().second;
+		queue.pop();
+
+		Edge next_edge;
+		if (readers[run].next(next_edge)) {
+			queue.emplace(next_edge, run);
+		}
+
+		// skip duplicates across runs
+		if (edge == last_edge) { continue; }
+		last_edge = edge;
+
+		consume(edge);
+	}
+}
+
+void ExternalGraphBuilder::writeBinaryFile(std::string const& binary_file)
+{
+	std::ofstream file(binary_file, std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open()) {
+		Error("The binary graph file couldn't be opened. Filename: " + binary_file);
+	}
+
+	// the position of the neighbors only depends on the number of nodes
+	auto const layout = binary_graph::makeHeader(number_of_nodes, 0);
+	file.seekp(layout.neighbors_position);
+
+	std::vector<std::uint64_t> offsets(number_of_nodes + 1, 0);
+	std::vector<std::uint64_t> neighbors_buffer;
+	neighbors_buffer.reserve(mergeBufferSize());
+	auto flush = [&]() {
+		file.write(reinterpret_cast<char const*>(neighbors_buffer.data()),
+		           neighbors_buffer.size()*sizeof(std::uint64_t));
+		neighbors_buffer.clear();
+	};
+
+	std::size_t number_of_edges = 0;
+	mergeRuns(run_files, [&](Edge const& edge) {
+		// skip edges outside of the largest component
+		auto source_id = new_ids[edge.first];
+		if (source_id == NO_ID) { return; }
+
+		++offsets[source_id + 1];
+		neighbors_buffer.push_back(new_ids[edge.second]);
+		if (neighbors_buffer.size() == neighbors_buffer.capacity()) {
+			flush();
+		}
+		++number_of_edges;
+	});
+	flush();
+
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	auto const header = binary_graph::makeHeader(number_of_nodes, number_of_edges);
+	file.seekp(header.offsets_position);
+	file.write(reinterpret_cast<char const*>(offsets.data()), offsets.size()*sizeof(std::uint64_t));
+	file.seekp(0);
+	file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+	if (!file) {
+		Error("Writing the binary graph file failed. Filename: " + binary_file);
+	}
+}
+
+void ExternalGraphBuilder::removeRuns(std::vector<std::string> const& runs)
+{
+	for (auto const& run_file: runs) {
+		std::remove(run_file.c_str());
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Converts an edge list into a binary graph file (see Graph::writeBinaryFile)
+// without ever holding all edges in memory. The edges are read in runs of
+// bounded size, which are sorted, made unique and spilled next to the output
+// file. The runs are then merged straight into the CSR arrays of the output.
+// The largest connected component is found during the reading pass.
+//
+// Only the per-node structures (ID map, union-find and offsets) are kept in
+// memory; the produced graph is identical to the one of Graph::buildFromFile.
+class ExternalGraphBuilder
+{
+public:
+	ExternalGraphBuilder(std::size_t run_bytes);
+
+	void build(std::string const& graph_file, std::string const& binary_file);
+
+private:
+	using NodeID = Graph::NodeID;
+	using Edge = std::pair<std::uint64_t, std::uint64_t>;
+	using Edges = std::vector<Edge>;
+
+	std::size_t const run_capacity;
+
+	std::vector<std::string> run_files;
+	std::size_t number_of_created_runs = 0;
+	std::vector<NodeID> new_ids;
+	std::size_t number_of_nodes = 0;
+
+	void readRuns(std::string const& graph_file, std::string const& binary_file);
+	void spillRun(Edges& run, std::string const& binary_file);
+	std::string newRunFile(std::string const& binary_file);
+	std::size_t mergeBufferSize() const;
+	// Merges runs until there are few enough to be merged in one pass.
+	void reduceRuns(std::string const& binary_file);
+	template <typename EdgeConsumer>
+	void mergeRuns(std::vector<std::string> const& runs, EdgeConsumer consume);
+	void writeBinaryFile(std::string const& binary_file);
+	void removeRuns(std::vector<std::string> const& runs);
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+//
+// FenwickTree
+//
+// Prefix sums over non-negative weights with O(log n) updates, so an index
+// can be drawn proportionally to its weight in O(log n). The inner sums are
+// updated by differences, which accumulates rounding errors; therefore the
+// tree is rebuilt from the weights after n updates, which adds O(1) per
+// update amortized, or earlier once the changes since the last rebuild are so
+// large compared to the total that its error could exceed about 2^-20 of it.
+//
+
+class FenwickTree
+{
+public:
+	FenwickTree() = default;
+
+	std::size_t size() const { return weights.size(); }
+	// O(n)
+	void assign(std::vector<double> const& new_weights);
+	double get(std::size_t index) const { return weights[index]; }
+	void set(std::size_t index, double weight);
+	double getTotal() const { return total; }
+	// The first index whose prefix sum including itself exceeds the target,
+	// or the last index if there is none. For a target drawn uniformly from
+	// [0, getTotal()), the index is drawn proportionally to its weight. Due
+	// to rounding, the index can rarely be one of weight zero next to it.
+	std::size_t find(double target) const;
+
+private:
+	std::vector<double> weights;
+	// tree[i] is the sum of the weights at the indices i - (i & -i), ..., i-1
+	std::vector<double> tree;
+	double total = 0;
+	std::size_t highest_bit = 0;
+	std::size_t number_of_updates = 0;
+	// sum of the absolute changes since the last rebuild
+	double changes = 0;
+
+	static constexpr double MAX_CHANGES_PER_TOTAL = 1 << 26;
+
+	void rebuild();
+};
+
+inline void FenwickTree::assign(std::vector<double> const& new_weights)
+{
+	weights = new_weights;
+
+	highest_bit = 1;
+	while (highest_bit <= weights.size()/2) { highest_bit *= 2; }
+	rebuild();
+}
+
+inline void FenwickTree::set(std::size_t index, double weight)
+{
+	auto const difference = weight - weights[index];
+	weights[index] = weight;
+
+	for (auto i = index + 1; i <= weights.size(); i += (i & -i)) {
+		tree[i] += difference;
+	}
+	total += difference;
+
+	changes += std::abs(difference);
+	if (++number_of_updates >= weights.size() || changes > total*MAX_CHANGES_PER_TOTAL) {
+		rebuild();
+	}
+}
+
+inline std::size_t FenwickTree::find(double target) const
+{
+	std::size_t position = 0;
+	for (auto step = highest_bit; step != 0; step /= 2) {
+		if (position + step <= weights.size() && tree[position + step] <= target) {
+			position += step;
+			target -= tree[position];
+		}
+	}
+
+	return (position < weights.size() ? position : weights.size() - 1);
+}
+
+inline void FenwickTree::rebuild()
+{
+	tree.assign(weights.size() + 1, 0);
+	for (std::size_t i = 1; i <= weights.size(); ++i) {
+		tree[i] += weights[i - 1];
+		auto const parent = i + (i & -i);
+		if (parent <= weights.size()) {
+			tree[parent] += tree[i];
+		}
+	}
+
+	total = 0;
+	for (auto i = weights.size(); i > 0; i -= (i & -i)) {
+		total += tree[i];
+	}
+	number_of_updates = 0;
+	changes = 0;
+}
@@ -1,24 +1,730 @@
 #include "graph.h"
 
+#include "binary_graph_format.h"
+#include "compressed_input.h"
 #include "defs.h"
+#include "graph_generators.h"
+#include "memory_accounting.h"
+#include "performance_report.h"
 #include "union_find.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <fstream>
 #include <sstream>
 
-void Graph::buildFromFile(std::string const& graph_file)
+static_assert(sizeof(Graph::NodeID) == sizeof(std::uint64_t) &&
+              sizeof(std::size_t) == sizeof(std::uint64_t),
+              "The binary graph format assumes 64-bit IDs and offsets.");
+
+namespace
+{
+
+Graph::NodeID const NO_NODE = std::numeric_limits<Graph::NodeID>::max();
+
+// Densities of the slots of updated graphs: after the slots of the whole graph
+// are resized, and the largest density of a window of nodes before it is
+// rebalanced. The largest density decreases from 1 for single nodes to this
+// value for the whole graph.
+double const RESIZED_DENSITY = 0.6;
+double const ROOT_MAX_DENSITY = 0.8;
+
+std::size_t getNumberOfSlots(std::size_t number_of_edges)
+{
+	return static_cast<std::size_t>(std::ceil(number_of_edges/RESIZED_DENSITY));
+}
+
+// Calls fn(first, last) for chunks of [0, size) on all hardware threads. The
+// helper threads take over the error mode of the caller, and the first
+// exception of any thread is rethrown by the caller once all are joined.
+template <typename Function>
+void forEachChunkInParallel(std::size_t size, std::size_t chunk_size, Function fn)
+{
+	std::atomic<std::size_t> next_chunk(0);
+	std::mutex exception_mutex;
+	std::exception_ptr exception;
+	auto const errors_throw = errorsThrowFlag();
+	auto process_chunks = [&]() {
+		setErrorsThrow(errors_throw);
+		try {
+			for (auto first = next_chunk.fetch_add(chunk_size); first < size;
+			     first = next_chunk.fetch_add(chunk_size)) {
+				fn(first, std::min(first + chunk_size, size));
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(exception_mutex);
+			if (!exception) { exception = std::current_exception(); }
+			// the other threads stop after their current chunk
+			next_chunk = size;
+		}
+	};
+
+	auto const number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < number_of_threads; ++i) {
+		threads.emplace_back(process_chunks);
+	}
+	process_chunks();
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+} // end anonymous
+
+bool isBinaryGraphFile(std::string const& graph_file)
+{
+	std::ifstream file(graph_file, std::ios_base::binary);
+	char magic[sizeof(binary_graph::MAGIC)];
+	return file.read(magic, sizeof(magic)) && binary_graph::hasMagic(magic);
+}
+
+void Graph::buildFromFile(std::string const& graph_file, bool check_mapped_file)
 {
 	filename = graph_file;
 
-	auto parser_edges = readEdges(graph_file);
-	reduceToLargestScc(parser_edges);
+	if (isGeneratorSpec(graph_file)) {
+		buildFromGenerator(graph_file, *createEdgeGenerator(graph_file));
+		return;
+	}
+	if (isBinaryGraphFile(graph_file)) {
+		ScopedPhase phase("map");
+		mapBinaryFile(graph_file, check_mapped_file);
+		return;
+	}
+
+	Weights edge_weights;
+	ParserEdges parser_edges;
+	{
+		ScopedPhase phase("parse");
+		parser_edges = readEdges(graph_file, edge_weights);
+		recordStructure("parser_edges", [&]() { return getMemoryBytes(parser_edges); });
+		recordStructure("edge_weights", [&]() { return getMemoryBytes(edge_weights); });
+	}
+	{
+		ScopedPhase phase("components");
+		reduceToLargestScc(parser_edges, edge_weights);
+	}
+
+	ScopedPhase phase("csr_build");
 	auto edges = convertIDs(parser_edges);
-	addAllReverseEdges(edges);
-	sortAndMakeUnique(edges);
-	fillOffsetsAndNeighbors(edges);
+	addAllReverseEdges(edges, edge_weights);
+	sortAndMakeUnique(edges, edge_weights);
+	fillOffsetsAndNeighbors(edges, edge_weights);
+	buildAliasTables();
+	setViews();
+	recordCsrStructures();
+}
+
+void Graph::buildFromEdges(std::string const& name, Edges edges)
+{
+	filename = name;
+
+	Weights edge_weights;
+	reduceToLargestComponent(edges);
+	addAllReverseEdges(edges, edge_weights);
+	sortAndMakeUnique(edges, edge_weights);
+	fillOffsetsAndNeighbors(edges, edge_weights);
+	setViews();
+}
+
+void Graph::viewArrays(std::string const& name, std::size_t number_of_nodes,
+                       std::size_t const* offsets, NodeID const* neighbors)
+{
+	filename = name;
+
+	this->number_of_nodes = number_of_nodes;
+	number_of_edges = offsets[number_of_nodes] - offsets[0];
+	total_volume = number_of_edges;
+	offsets_data = offsets;
+	ends_data = offsets + 1;
+	neighbors_data = neighbors;
+}
+
+void Graph::buildFromGenerator(std::string const& name, EdgeGenerator const& generator,
+                               std::size_t chunk_size)
+{
+	filename = name;
+
+	auto const node_count = generator.getNumberOfNodes();
+	auto const edge_count = generator.getNumberOfEdges();
+	// the number of neighbors written to each node so far and then the
+	// number of unique neighbors
+	HugePageVector<std::size_t> positions;
+	{
+		ScopedPhase phase("generate");
+
+		// The edges are generated twice: first to count the degrees and then to
+		// write the neighbors. Every edge only depends on its index, so the
+		// edges are the same both times.
+		offsets.assign(node_count + 1, 0);
+		forEachChunkInParallel(edge_count, chunk_size, [&](std::size_t first, std::size_t last) {
+			std::vector<Edge> chunk(last - first);
+			generator.generate(first, last, chunk.data());
+			for (auto const& edge: chunk) {
+				if (edge.first == edge.second) { continue; }
+				__atomic_fetch_add(&offsets[edge.first + 1], 1, __ATOMIC_RELAXED);
+				__atomic_fetch_add(&offsets[edge.second + 1], 1, __ATOMIC_RELAXED);
+			}
+		});
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		neighbors.resize(offsets.back());
+		positions.assign(offsets.begin(), offsets.end() - 1);
+		forEachChunkInParallel(edge_count, chunk_size, [&](std::size_t first, std::size_t last) {
+			std::vector<Edge> chunk(last - first);
+			generator.generate(first, last, chunk.data());
+
+			// A locked add waits for all pending stores, so the slots of a batch
+			// are reserved before the scattered neighbor writes.
+			std::size_t const batch_size = 256;
+			std::array<std::size_t, 2*batch_size> slots;
+			for (std::size_t batch_first = 0; batch_first < chunk.size(); batch_first += batch_size) {
+				auto const batch_last = std::min(batch_first + batch_size, chunk.size());
+				for (auto i = batch_first; i < batch_last; ++i) {
+					__builtin_prefetch(&positions[chunk[i].first]);
+					__builtin_prefetch(&positions[chunk[i].second]);
+				}
+				for (auto i = batch_first; i < batch_last; ++i) {
+					if (chunk[i].first == chunk[i].second) { continue; }
+					auto const j = 2*(i - batch_first);
+					slots[j] = __atomic_fetch_add(&positions[chunk[i].first], 1, __ATOMIC_RELAXED);
+					slots[j + 1] = __atomic_fetch_add(&positions[chunk[i].second], 1, __ATOMIC_RELAXED);
+				}
+				for (auto i = batch_first; i < batch_last; ++i) {
+					if (chunk[i].first == chunk[i].second) { continue; }
+					auto const j = 2*(i - batch_first);
+					neighbors[slots[j]] = chunk[i].second;
+					neighbors[slots[j + 1]] = chunk[i].first;
+				}
+			}
+		});
+
+		// The order within the neighborhoods depends on the threads, sorting makes
+		// it deterministic. positions then holds the number of unique neighbors.
+		forEachChunkInParallel(node_count, chunk_size, [&](std::size_t first, std::size_t last) {
+			for (auto node_id = first; node_id < last; ++node_id) {
+				auto const begin = neighbors.begin() + offsets[node_id];
+				auto const end = neighbors.begin() + offsets[node_id + 1];
+				std::sort(begin, end);
+				positions[node_id] = std::unique(begin, end) - begin;
+			}
+		});
+		recordStructure("positions", [&]() { return getMemoryBytes(positions); });
+	}
+
+	ScopedPhase phase("components");
+	DenseUnionFind union_find(node_count);
+	for (NodeID node_id = 0; node_id < node_count; ++node_id) {
+		for (std::size_t i = 0; i < positions[node_id]; ++i) {
+			union_find.unite(node_id, neighbors[offsets[node_id] + i]);
+		}
+	}
+
+	// renumber the nodes of the largest component in increasing order
+	auto const largest_root = union_find.findRoot(union_find.largestSetElement());
+	std::vector<NodeID> new_ids(node_count, NO_NODE);
+	recordStructure("new_ids", [&]() { return getMemoryBytes(new_ids); });
+	NodeID current_id = 0;
+	for (NodeID node_id = 0; node_id < node_count; ++node_id) {
+		if (union_find.findRoot(node_id) == largest_root) {
+			new_ids[node_id] = current_id++;
+		}
+	}
+
+	// compact in place; nodes and edges only move to the front
+	std::size_t number_of_kept_edges = 0;
+	for (NodeID node_id = 0; node_id < node_count; ++node_id) {
+		if (new_ids[node_id] == NO_NODE) { continue; }
+
+		auto const first_edge = offsets[node_id];
+		offsets[new_ids[node_id]] = number_of_kept_edges;
+		for (std::size_t i = 0; i < positions[node_id]; ++i) {
+			neighbors[number_of_kept_edges++] = new_ids[neighbors[first_edge + i]];
+		}
+	}
+	offsets[current_id] = number_of_kept_edges;
+	offsets.resize(current_id + 1);
+	neighbors.resize(number_of_kept_edges);
+
+	setViews();
+	recordCsrStructures();
+}
+
+void Graph::recordCsrStructures() const
+{
+	recordStructure("offsets", [&]() { return getMemoryBytes(offsets); });
+	recordStructure("neighbors", [&]() { return getMemoryBytes(neighbors); });
+	if (!ends.empty()) {
+		recordStructure("ends", [&]() { return getMemoryBytes(ends); });
+	}
+	if (isWeighted()) {
+		recordStructure("weights", [&]() { return getMemoryBytes(weights); });
+		recordStructure("alias_tables", [&]() {
+			return getMemoryBytes(alias_probabilities) + getMemoryBytes(alias_indices);
+		});
+		recordStructure("volumes", [&]() { return getMemoryBytes(volumes); });
+	}
+}
+
+void Graph::writeBinaryFile(std::string const& binary_file) const
+{
+	if (!ends.empty()) {
+		Error("Updated graphs can't be written as binary graph files: " + filename);
+	}
+
+	std::ofstream file(binary_file, std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open()) {
+		Error("The binary graph file couldn't be opened. Filename: " + binary_file);
+	}
+
+	auto const header = binary_graph::makeHeader(number_of_nodes, number_of_edges, isWeighted());
+	auto write_at = [&](std::uint64_t position, void const* data, std::size_t bytes) {
+		file.seekp(position);
+		file.write(static_cast<char const*>(data), bytes);
+	};
+
+	write_at(0, &header, sizeof(header));
+	write_at(header.offsets_position, offsets_data, (number_of_nodes + 1)*sizeof(std::size_t));
+	write_at(header.neighbors_position, neighbors_data, number_of_edges*sizeof(NodeID));
+	if (isWeighted()) {
+		write_at(header.weights_position, weights_data, number_of_edges*sizeof(Weight));
+		write_at(header.alias_probabilities_position, alias_probabilities_data,
+		         number_of_edges*sizeof(float));
+		write_at(header.alias_indices_position, alias_indices_data,
+		         number_of_edges*sizeof(std::uint32_t));
+		write_at(header.volumes_position, volumes_data, number_of_nodes*sizeof(double));
+	}
+
+	if (!file) {
+		Error("Writing the binary graph file failed. Filename: " + binary_file);
+	}
+}
+
+void Graph::mapBinaryFile(std::string const& binary_file, bool check_nodes)
+{
+	mapped_file.map(binary_file);
+
+	binary_graph::Header header;
+	if (mapped_file.size() < sizeof(header)) {
+		Error("The binary graph file is truncated. Filename: " + binary_file);
+	}
+	std::memcpy(&header, mapped_file.data(), sizeof(header));
+
+	if (header.version != binary_graph::VERSION) {
+		Error("The binary graph file has an unsupported version. Filename: " + binary_file);
+	}
+	// Every position follows from the numbers of nodes and edges, so a file
+	// whose arrays don't fit exactly is rejected before any of them is read.
+	// The numbers are bounded first, so the layout can't overflow.
+	auto const number_of_words = mapped_file.size()/sizeof(std::uint64_t);
+	if (header.number_of_nodes >= number_of_words || header.number_of_edges > number_of_words) {
+		Error("The binary graph file is truncated. Filename: " + binary_file);
+	}
+	auto const layout = binary_graph::makeHeader(header.number_of_nodes, header.number_of_edges,
+	                                             header.weights_position != 0);
+	if (layout.file_size != mapped_file.size()) {
+		Error("The binary graph file is truncated or too long. Filename: " + binary_file);
+	}
+	if (std::memcmp(&header, &layout, sizeof(header)) != 0) {
+		Error("The binary graph file has an invalid header. Filename: " + binary_file);
+	}
+
+	number_of_nodes = header.number_of_nodes;
+	number_of_edges = header.number_of_edges;
+	offsets_data = reinterpret_cast<std::size_t const*>(mapped_file.data() + header.offsets_position);
+	ends_data = offsets_data + 1;
+	neighbors_data = reinterpret_cast<NodeID const*>(mapped_file.data() + header.neighbors_position);
+	if (offsets_data[0] != 0 || offsets_data[number_of_nodes] != number_of_edges) {
+		Error("The binary graph file has invalid offsets. Filename: " + binary_file);
+	}
+	if (header.weights_position != 0) {
+		auto const data = mapped_file.data();
+		weights_data = reinterpret_cast<Weight const*>(data + header.weights_position);
+		alias_probabilities_data = reinterpret_cast<float const*>(data + header.alias_probabilities_position);
+		alias_indices_data = reinterpret_cast<std::uint32_t const*>(data + header.alias_indices_position);
+		volumes_data = reinterpret_cast<double const*>(data + header.volumes_position);
+	}
+	if (check_nodes) {
+		checkMappedNodes(0, number_of_nodes);
+	}
+	// like setViews; the offsets aren't read, so a partitioned worker only
+	// loads the part of the file it visits
+	total_volume = number_of_edges;
+	if (weights_data) {
+		total_volume = 0;
+		for (NodeID node_id = 0; node_id < number_of_nodes; ++node_id) {
+			total_volume += volume(node_id);
+		}
+	}
+
+	// The simulation sweeps over the nodes in storage order, so both arrays are
+	// mostly read sequentially.
+	mapped_file.advise(0, mapped_file.size(), MappedFile::Access::Sequential);
+}
+
+void Graph::setViews()
+{
+	number_of_nodes = offsets.size() - 1;
+	offsets_data = offsets.data();
+	ends_data = (ends.empty() ? offsets_data + 1 : ends.data());
+	neighbors_data = neighbors.data();
+	// updated graphs have free slots, their edges are counted by updateEdges
+	if (ends.empty()) {
+		number_of_edges = neighbors.size();
+	}
+
+	if (!weights.empty()) {
+		weights_data = weights.data();
+		alias_probabilities_data = alias_probabilities.data();
+		alias_indices_data = alias_indices.data();
+		volumes_data = volumes.data();
+		total_volume = std::accumulate(volumes.begin(), volumes.end(), 0.);
+	}
+	else {
+		total_volume = number_of_edges;
+	}
+}
+
+void Graph::buildAliasTables()
+{
+	if (weights.empty()) { return; }
+
+	auto const node_count = offsets.size() - 1;
+	alias_probabilities.resize(weights.size());
+	alias_indices.resize(weights.size());
+	volumes.resize(node_count);
+
+	// Vose's alias method. Every node gets its own table, so the nodes are
+	// distributed over the threads in chunks.
+	std::size_t const chunk_size = 1 << 12;
+	std::atomic<std::size_t> next_chunk(0);
+	auto build_tables = [&]() {
+		std::vector<std::uint32_t> small, large;
+		std::vector<double> scaled;
+
+		for (auto first = next_chunk.fetch_add(chunk_size); first < node_count;
+		     first = next_chunk.fetch_add(chunk_size)) {
+			auto const last = std::min(first + chunk_size, node_count);
+			for (auto node_id = first; node_id < last; ++node_id) {
+				auto const offset = offsets[node_id];
+				auto const node_degree = offsets[node_id + 1] - offset;
+				debug_assert(node_degree <= UINT32_MAX);
+
+				double node_volume = 0;
+				for (std::size_t i = 0; i < node_degree; ++i) {
+					node_volume += weights[offset + i];
+				}
+				volumes[node_id] = node_volume;
+
+				small.clear();
+				large.clear();
+				scaled.resize(node_degree);
+				for (std::uint32_t i = 0; i < node_degree; ++i) {
+					scaled[i] = weights[offset + i]*node_degree/node_volume;
+					(scaled[i] < 1 ? small : large).push_back(i);
+				}
+
+				while (!small.empty() && !large.empty()) {
+					auto const less = small.back();
+					auto const more = large.back();
+					small.pop_back();
+
+					alias_probabilities[offset + less] = scaled[less];
+					alias_indices[offset + less] = more;
+
+					scaled[more] -= 1 - scaled[less];
+					if (scaled[more] < 1) {
+						large.pop_back();
+						small.push_back(more);
+					}
+				}
+
+				// the remaining entries are full up to rounding errors
+				for (auto i: large) {
+					alias_probabilities[offset + i] = 1;
+					alias_indices[offset + i] = i;
+				}
+				for (auto i: small) {
+					alias_probabilities[offset + i] = 1;
+					alias_indices[offset + i] = i;
+				}
+			}
+		}
+	};
+
+	auto const number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < number_of_threads; ++i) {
+		threads.emplace_back(build_tables);
+	}
+	build_tables();
+	for (auto& thread: threads) {
+		thread.join();
+	}
+}
+
+bool Graph::isMapped() const
+{
+	return mapped_file.isMapped();
+}
+
+void Graph::checkMappedNodes(NodeID first, NodeID last) const
+{
+	if (!isMapped()) { return; }
+
+	if (first > last || last > number_of_nodes || offsets_data[first] > number_of_edges) {
+		Error("The binary graph file has invalid offsets. Filename: " + filename);
+	}
+	forEachChunkInParallel(last - first, 1 << 16, [&](std::size_t chunk_first, std::size_t chunk_last) {
+		for (auto node_id = first + chunk_first; node_id < first + chunk_last; ++node_id) {
+			auto const begin = offsets_data[node_id];
+			auto const end = offsets_data[node_id + 1];
+			if (end < begin || end > number_of_edges) {
+				Error("The binary graph file has invalid offsets. Filename: " + filename);
+			}
+			for (auto i = begin; i < end; ++i) {
+				if (neighbors_data[i] >= number_of_nodes) {
+					Error("The binary graph file has invalid neighbors. Filename: " + filename);
+				}
+				if (alias_indices_data && alias_indices_data[i] >= end - begin) {
+					Error("The binary graph file has invalid alias tables. Filename: " + filename);
+				}
+			}
+		}
+	});
+}
+
+void Graph::updateEdges(Edges const& insertions, Edges const& deletions)
+{
+	if (isMapped() || isWeighted()) {
+		Error("Only unweighted graphs in memory can be updated: " + filename);
+	}
+	if (offsets_data != offsets.data()) {
+		Error("Graphs on the arrays of a graph pool can't be updated: " + filename);
+	}
+
+	// Every edge updates both of its nodes. The last update of an edge
+	// decides, so deletions are sorted before insertions.
+	struct Update
+	{
+		NodeID node_id;
+		NodeID neighbor;
+		bool insertion;
+
+		bool operator<(Update const& other) const
+		{
+			return std::tie(node_id, neighbor, insertion) <
+			       std::tie(other.node_id, other.neighbor, other.insertion);
+		}
+	};
+	std::vector<Update> updates;
+	updates.reserve(2*(insertions.size() + deletions.size()));
+	for (auto insertion: {false, true}) {
+		for (auto const& edge: (insertion ? insertions : deletions)) {
+			if (edge.first >= number_of_nodes || edge.second >= number_of_nodes) {
+				Error("The updated edge (" << edge.first << ", " << edge.second
+				      << ") has a node that isn't in the graph " << filename);
+			}
+			if (edge.first == edge.second) { continue; }
+
+			updates.push_back({edge.first, edge.second, insertion});
+			updates.push_back({edge.second, edge.first, insertion});
+		}
+	}
+	std::sort(updates.begin(), updates.end());
+
+	// The new neighbors of all updated nodes are merged before the graph is
+	// changed, so a rejected batch leaves it as it was.
+	std::vector<NodeID> buffer;
+	std::vector<NeighborUpdate> neighbor_updates;
+	auto new_number_of_edges = number_of_edges;
+	for (auto update = updates.begin(); update != updates.end(); ) {
+		auto const node_id = update->node_id;
+		auto const begin = buffer.size();
+
+		auto old_neighbor = neighbors_data + offsets_data[node_id];
+		auto const old_end = neighbors_data + ends_data[node_id];
+		for (; update != updates.end() && update->node_id == node_id; ) {
+			auto const neighbor = update->neighbor;
+			for (; old_neighbor != old_end && *old_neighbor < neighbor; ++old_neighbor) {
+				buffer.push_back(*old_neighbor);
+			}
+
+			bool exists = (old_neighbor != old_end && *old_neighbor == neighbor);
+			if (exists) { ++old_neighbor; }
+			for (; update != updates.end() && update->node_id == node_id &&
+			       update->neighbor == neighbor; ++update) {
+				exists = update->insertion;
+			}
+			if (exists) { buffer.push_back(neighbor); }
+		}
+		buffer.insert(buffer.end(), old_neighbor, old_end);
+
+		if (buffer.size() == begin) {
+			Error("The update would leave node " << node_id << " without neighbors in the graph "
+			      << filename);
+		}
+		new_number_of_edges += (buffer.size() - begin);
+		new_number_of_edges -= degree(node_id);
+		neighbor_updates.push_back({node_id, begin, buffer.size()});
+	}
+
+	// the first update gives every node free slots
+	if (ends.empty()) {
+		ends.assign(offsets.begin() + 1, offsets.end());
+		spreadNeighbors(0, number_of_nodes, getNumberOfSlots(new_number_of_edges),
+		                nullptr, nullptr, buffer);
+	}
+
+	std::vector<NeighborUpdate> overflowing;
+	for (auto const& update: neighbor_updates) {
+		auto const node_id = update.node_id;
+		auto const new_degree = update.end - update.begin;
+		if (offsets[node_id] + new_degree > offsets[node_id + 1]) {
+			overflowing.push_back(update);
+			continue;
+		}
+
+		std::copy(buffer.begin() + update.begin, buffer.begin() + update.end,
+		          neighbors.begin() + offsets[node_id]);
+		ends[node_id] = offsets[node_id] + new_degree;
+	}
+
+	// A node without enough free slots takes them from the smallest aligned
+	// window of nodes around it whose density stays below the threshold of
+	// its size; the neighbors of the window are then spread evenly over it.
+	std::size_t number_of_levels = 0;
+	while ((std::size_t(1) << number_of_levels) < number_of_nodes) { ++number_of_levels; }
+
+	for (auto pending = overflowing.data(); pending != overflowing.data() + overflowing.size(); ) {
+		auto const pending_end = overflowing.data() + overflowing.size();
+		auto const node_id = pending->node_id;
+
+		NodeID first = node_id, last = node_id + 1;
+		bool fits = false;
+		for (std::size_t level = 1; level <= number_of_levels && !fits; ++level) {
+			first = (node_id >> level) << level;
+			last = std::min(first + (std::size_t(1) << level), number_of_nodes);
+
+			std::size_t window_edges = 0;
+			auto window_pending = pending;
+			for (auto window_node = first; window_node < last; ++window_node) {
+				if (window_pending != pending_end && window_pending->node_id == window_node) {
+					window_edges += window_pending->end - window_pending->begin;
+					++window_pending;
+				}
+				else {
+					window_edges += ends[window_node] - offsets[window_node];
+				}
+			}
+
+			auto const max_density = 1. - (1. - ROOT_MAX_DENSITY)*level/number_of_levels;
+			fits = (window_edges <= max_density*(offsets[last] - offsets[first]));
+		}
+
+		if (fits) {
+			spreadNeighbors(first, last, offsets[last] - offsets[first], pending, pending_end, buffer);
+		}
+		else {
+			spreadNeighbors(0, number_of_nodes, getNumberOfSlots(new_number_of_edges),
+			                pending, pending_end, buffer);
+		}
+		while (pending != pending_end && pending->node_id < last) { ++pending; }
+	}
+
+	number_of_edges = new_number_of_edges;
+	++number_of_updates;
+	setViews();
+}
+
+void Graph::spreadNeighbors(NodeID first, NodeID last, std::size_t number_of_slots,
+                            NeighborUpdate const* pending_begin, NeighborUpdate const* pending_end,
+                            std::vector<NodeID> const& buffer)
+{
+	debug_assert(number_of_slots == offsets[last] - offsets[first] ||
+	             (first == 0 && last == number_of_nodes));
+
+	std::vector<NodeID> window_neighbors;
+	std::vector<std::size_t> degrees;
+	degrees.reserve(last - first);
+	auto pending = pending_begin;
+	for (auto node_id = first; node_id < last; ++node_id) {
+		auto const size_before = window_neighbors.size();
+		if (pending != pending_end && pending->node_id == node_id) {
+			window_neighbors.insert(window_neighbors.end(), buffer.begin() + pending->begin,
+			                        buffer.begin() + pending->end);
+			++pending;
+		}
+		else {
+			window_neighbors.insert(window_neighbors.end(), neighbors.begin() + offsets[node_id],
+			                        neighbors.begin() + ends[node_id]);
+		}
+		degrees.push_back(window_neighbors.size() - size_before);
+	}
+
+	// the old slots are freed first, as all neighbors are copied anyway
+	if (number_of_slots != offsets[last] - offsets[first]) {
+		neighbors.clear();
+		neighbors.shrink_to_fit();
+		neighbors.resize(number_of_slots);
+	}
+
+	// The node gets free slots proportionally to its degree plus one. The
+	// free slots of the nodes before are rounded down, the last gets the rest.
+	auto const free_slots = number_of_slots - window_neighbors.size();
+	auto const total_weight = static_cast<double>(window_neighbors.size() + (last - first));
+	double weight = 0;
+	std::size_t given_free_slots = 0;
+	auto position = offsets[first];
+	auto window_neighbor = window_neighbors.begin();
+	for (auto node_id = first; node_id < last; ++node_id) {
+		auto const node_degree = degrees[node_id - first];
+		offsets[node_id] = position;
+		ends[node_id] = position + node_degree;
+		std::copy(window_neighbor, window_neighbor + node_degree, neighbors.begin() + position);
+		window_neighbor += node_degree;
+
+		weight += node_degree + 1;
+		auto const free_slots_until = (node_id + 1 == last ? free_slots :
+		                               std::min(free_slots, static_cast<std::size_t>(
+		                                        free_slots*(weight/total_weight))));
+		position = ends[node_id] + (free_slots_until - given_free_slots);
+		given_free_slots = free_slots_until;
+	}
+	debug_assert(last < number_of_nodes ? position == offsets[last] : position == number_of_slots);
+	offsets[last] = position;
+}
+
+void Graph::willVisit(NodeID first, NodeID last) const
+{
+	if (!isMapped()) { return; }
+
+	forEachMemoryRange(first, last, [&](void const* begin, void const* end) {
+		auto const begin_position = static_cast<char const*>(begin) - mapped_file.data();
+		auto const end_position = static_cast<char const*>(end) - mapped_file.data();
+		mapped_file.advise(begin_position, end_position - begin_position,
+		                   MappedFile::Access::WillNeed);
+	});
+}
+
+std::size_t Graph::getNumberOfUpdates() const
+{
+	return number_of_updates;
 }
 
 std::string const& Graph::getFilename() const
@@ -26,35 +732,55 @@ std::string const& Graph::getFilename() const
 	return filename;
 }
 
-auto Graph::readEdges(std::string const& graph_file) const -> ParserEdges
+auto Graph::readEdges(std::string const& graph_file, Weights& edge_weights) const -> ParserEdges
 {
 	ParserEdges parser_edges;
 
-	std::ifstream file(graph_file);
-	if (!file.is_open()) {
+	// compressed files are decompressed while they are parsed
+	auto file = openTextFile(graph_file);
+	if (!file) {
 		Error("The graph file couldn't be opened");
 	}
 
+	// Edges without weights get weight 1. If no line has a weight at all, the
+	// graph is unweighted and the weights are dropped.
+	bool weighted = false;
+
 	std::string line;
 	ParserNodeID source, target;
-	while (std::getline(file, line)) {
+	Weight weight;
+	while (std::getline(*file, line)) {
 		if (line.empty() || line[0] == '#') {
 			continue;
 		}
 
 		std::stringstream ss(line);
 		ss >> source >> target;
+		if (!(ss >> weight)) {
+			weight = 1;
+		}
+		else if (weight <= 0) {
+			Error("Edge weights have to be positive");
+		}
+		else {
+			weighted = true;
+		}
 
 		// remove loops as they are annoying
 		if (source != target) {
 			parser_edges.emplace_back(source, target);
+			edge_weights.push_back(weight);
 		}
 	}
 
+	if (!weighted) {
+		Weights().swap(edge_weights);
+	}
+
 	return parser_edges;
 }
 
-void Graph::reduceToLargestScc(ParserEdges& parser_edges) const
+void Graph::reduceToLargestScc(ParserEdges& parser_edges, Weights& edge_weights) const
 {
 	std::unordered_set<ParserNodeID> nodes;
 	for (auto const& parser_edge: parser_edges) {
@@ -62,15 +788,61 @@ void Graph::reduceToLargestScc(ParserEdges& parser_edges) const
 		nodes.insert(parser_edge.second);
 	}
 
+	recordStructure("node_set", [&]() { return getMemoryBytes(nodes); });
+
 	auto largest_partition = UnionFind<ParserNodeID>().run(nodes, parser_edges);
+	recordStructure("largest_component", [&]() { return getMemoryBytes(largest_partition); });
+
+	// Note: This is remove_if applied to the edges and their weights at once.
+	std::size_t number_of_kept = 0;
+	for (std::size_t i = 0; i < parser_edges.size(); ++i) {
+		if (!largest_partition.count(parser_edges[i].first)) {
+			continue;
+		}
+
+		if (number_of_kept != i) {
+			parser_edges[number_of_kept] = std::move(parser_edges[i]);
+			if (!edge_weights.empty()) {
+				edge_weights[number_of_kept] = edge_weights[i];
+			}
+		}
+		++number_of_kept;
+	}
+	parser_edges.resize(number_of_kept);
+	if (!edge_weights.empty()) {
+		edge_weights.resize(number_of_kept);
+	}
+}
 
-	auto not_in_largest_partition = [&](ParserEdge const& parser_edge) {
-		return !largest_partition.count(parser_edge.first);
+void Graph::reduceToLargestComponent(Edges& edges) const
+{
+	NodeID max_id = 0;
+	for (auto const& edge: edges) {
+		max_id = std::max({max_id, edge.first, edge.second});
+	}
+
+	DenseUnionFind union_find(edges.empty() ? 0 : max_id + 1);
+	for (auto const& edge: edges) {
+		union_find.unite(edge.first, edge.second);
+	}
+
+	// renumber the nodes of the largest component in increasing order
+	std::vector<NodeID> new_ids(union_find.size(), 0);
+	if (!edges.empty()) {
+		auto const largest_root = union_find.findRoot(union_find.largestSetElement());
+		NodeID current_id = 0;
+		for (NodeID id = 0; id < new_ids.size(); ++id) {
+			new_ids[id] = (union_find.findRoot(id) == largest_root ? current_id++ : NO_NODE);
+		}
+	}
+
+	auto not_in_largest_component = [&](Edge const& edge) {
+		return new_ids[edge.first] == NO_NODE || edge.first == edge.second;
 	};
-	auto first_to_erase = std::remove_if(parser_edges.begin(),
-	                                     parser_edges.end(),
-	                                     not_in_largest_partition);
-	parser_edges.erase(first_to_erase, parser_edges.end());
+	edges.erase(std::remove_if(edges.begin(), edges.end(), not_in_largest_component), edges.end());
+	for (auto& edge: edges) {
+		edge = Edge(new_ids[edge.first], new_ids[edge.second]);
+	}
 }
 
 auto Graph::convertIDs(ParserEdges& parser_edges) -> Edges
@@ -94,8 +866,13 @@ auto Graph::convertIDs(ParserEdges& parser_edges) -> Edges
 		}
 	}
 
+	recordStructure("id_map", [&]() { return getMemoryBytes(to_id); });
+	recordStructure("old_ids", [&]() { return getMemoryBytes(old_ids); });
+
 	// ... then write new edges with new IDs into new edges vector
+	checkMemoryBudget(parser_edges.size()*sizeof(Edge), "edges");
 	Edges edges;
+	edges.reserve(parser_edges.size());
 	for (auto& parser_edge: parser_edges) {
 		auto source_id = to_id.at(parser_edge.first);
 		auto target_id = to_id.at(parser_edge.second);
@@ -105,27 +882,70 @@ auto Graph::convertIDs(ParserEdges& parser_edges) -> Edges
 	return edges;
 }
 
-void Graph::addAllReverseEdges(Edges& edges) const
+void Graph::addAllReverseEdges(Edges& edges, Weights& edge_weights) const
 {
 	// Note: We use this type of loop as we cannot use a range-based loop due to
 	// possible iterator invalidation on push.
 	auto old_size = edges.size();
+	checkMemoryBudget(2*old_size*sizeof(Edge), "reverse edges");
+	edges.reserve(2*old_size);
 	for (std::size_t i = 0; i < old_size; ++i) {
 		auto const& edge = edges[i];
 		edges.emplace_back(edge.second, edge.first);
 	}
+	recordStructure("edges", [&]() { return getMemoryBytes(edges); });
+
+	if (!edge_weights.empty()) {
+		edge_weights.insert(edge_weights.end(), edge_weights.begin(), edge_weights.end());
+	}
 }
 
-void Graph::sortAndMakeUnique(Edges& edges) const
+void Graph::sortAndMakeUnique(Edges& edges, Weights& edge_weights) const
 {
-	// Note: Pairs are sorted lexicographically and thus exactly as we want.
-	std::sort(edges.begin(), edges.end());
-	auto first_to_erase = std::unique(edges.begin(), edges.end());
-	edges.erase(first_to_erase, edges.end());
+	if (edge_weights.empty()) {
+		// Note: Pairs are sorted lexicographically and thus exactly as we want.
+		std::sort(edges.begin(), edges.end());
+		auto first_to_erase = std::unique(edges.begin(), edges.end());
+		edges.erase(first_to_erase, edges.end());
+		return;
+	}
+
+	// Sort edges and weights together. The weights of multiple occurrences of
+	// an edge (in any direction) are summed up.
+	std::vector<std::size_t> order(edges.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](std::size_t i, std::size_t j) {
+		return edges[i] < edges[j];
+	});
+
+	Edges unique_edges;
+	Weights unique_weights;
+	for (auto i: order) {
+		if (!unique_edges.empty() && unique_edges.back() == edges[i]) {
+			unique_weights.back() += edge_weights[i];
+		}
+		else {
+			unique_edges.push_back(edges[i]);
+			unique_weights.push_back(edge_weights[i]);
+		}
+	}
+
+	edges.swap(unique_edges);
+	edge_weights.swap(unique_weights);
 }
 
-void Graph::fillOffsetsAndNeighbors(Edges const& edges)
+void Graph::fillOffsetsAndNeighbors(Edges const& edges, Weights& edge_weights)
 {
+	weights.swap(edge_weights);
+
+	if (edges.empty()) {
+		offsets.assign(1, 0);
+		return;
+	}
+
+	offsets.reserve(edges.back().first + 2);
+	neighbors.reserve(edges.size());
+
 	NodeID current_source = 0;
 	offsets.push_back(current_source);
 
@@ -147,17 +967,52 @@ void Graph::fillOffsetsAndNeighbors(Edges const& edges)
 
 std::size_t Graph::getNumberOfNodes() const
 {
-	return old_ids.size();
+	return number_of_nodes;
 }
 
 std::size_t Graph::getNumberOfEdges() const
 {
-	return neighbors.size();
+	return number_of_edges;
 }
 
 std::size_t Graph::degree(NodeID node_id) const
 {
-	return offsets[node_id + 1] - offsets[node_id];
+	return ends_data[node_id] - offsets_data[node_id];
+}
+
+bool Graph::isWeighted() const
+{
+	return weights_data != nullptr;
+}
+
+double Graph::volume(NodeID node_id) const
+{
+	return isWeighted() ? volumes_data[node_id] : degree(node_id);
+}
+
+double Graph::getTotalVolume() const
+{
+	return total_volume;
+}
+
+std::size_t const* Graph::getOffsets() const
+{
+	return offsets_data;
+}
+
+std::size_t const* Graph::getEnds() const
+{
+	return ends_data;
+}
+
+auto Graph::getNeighbors() const -> NodeID const*
+{
+	return neighbors_data;
+}
+
+auto Graph::getWeights() const -> Weight const*
+{
+	return weights_data;
 }
 
 auto Graph::getNodesSortedByDegree() const -> std::vector<NodeID>
@@ -165,8 +1020,11 @@ auto Graph::getNodesSortedByDegree() const -> std::vector<NodeID>
 	std::vector<NodeID> node_ids(getNumberOfNodes());
 	std::iota(node_ids.begin(), node_ids.end(), 0);
 
+	// ties are broken by ID, so the order doesn't depend on the sort algorithm
 	auto comp_degree = [&](NodeID node_id1, NodeID node_id2) {
-		return degree(node_id1) > degree(node_id2);
+		auto const degree1 = degree(node_id1);
+		auto const degree2 = degree(node_id2);
+		return degree1 > degree2 || (degree1 == degree2 && node_id1 < node_id2);
 	};
 	std::sort(node_ids.begin(), node_ids.end(), comp_degree);
 
@@ -175,8 +1033,8 @@ auto Graph::getNodesSortedByDegree() const -> std::vector<NodeID>
 
 auto Graph::getNeighborRange(NodeID node_id) const -> NeighborRange
 {
-	auto const begin = neighbors.cbegin() + offsets[node_id];
-	auto const end = neighbors.cbegin() + offsets[node_id+1];
+	auto const begin = neighbors_data + offsets_data[node_id];
+	auto const end = neighbors_data + ends_data[node_id];
 	return NeighborRange(begin, end);
 }
 
@@ -185,7 +1043,11 @@ auto Graph::getRandomNeighbor(NodeID node_id, Random& random) const -> NodeID
 	debug_assert(degree(node_id) != 0);
 
 	auto neighbor_offset = random.getSizeT(0, degree(node_id) - 1);
-	auto neighbor_index = offsets[node_id] + neighbor_offset;
+	auto neighbor_index = offsets_data[node_id] + neighbor_offset;
+
+	if (isWeighted() && random.getDouble() >= alias_probabilities_data[neighbor_index]) {
+		neighbor_index = offsets_data[node_id] + alias_indices_data[neighbor_index];
+	}
 
-	return neighbors[neighbor_index];
+	return neighbors_data[neighbor_index];
 }
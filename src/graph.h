@@ -1,20 +1,29 @@
 #pragma once
 
+#include "defs.h"
+#include "huge_page_allocator.h"
+#include "mapped_file.h"
 #include "random.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+class EdgeGenerator;
+
 class Graph
 {
 public:
 	// member types
 	using NodeID = std::size_t;
 	using ParserNodeID = std::string;
-	using Neighbors = std::vector<NodeID>;
+	using Neighbors = HugePageVector<NodeID>;
+	using Weight = float;
+	using Edge = std::pair<NodeID, NodeID>;
+	using Edges = std::vector<Edge>;
 	class NeighborRange
 	{
-		using const_iterator = Neighbors::const_iterator;
+		using const_iterator = NodeID const*;
 		const_iterator const _begin;
 		const_iterator const _end;
 
@@ -29,40 +38,206 @@ public:
 	// member functions
 
 	Graph() = default;
+	Graph(Graph const&) = delete;
+	Graph(Graph&&) = default;
+	Graph& operator=(Graph const&) = delete;
+	Graph& operator=(Graph&&) = default;
 
-	void buildFromFile(std::string const& graph_file);
+	// Binary graph files (see writeBinaryFile) are not parsed but mapped into
+	// memory, i.e., the graph is then kept out of core. If the lines of an edge
+	// list have a third column, it is parsed as the weight of the edge. Names
+	// starting with "gen:" are generated instead (see graph_generators.h).
+	// A mapped file is checked completely unless check_mapped_file is false,
+	// e.g., to only load a part of it; then checkMappedNodes has to be called
+	// for the nodes that are visited.
+	void buildFromFile(std::string const& graph_file, bool check_mapped_file = true);
+	// Writes the generated edges directly into the CSR arrays, in parallel.
+	// Loops and duplicates are removed and the graph is reduced to its
+	// largest component; the nodes keep their relative order. The chunks of
+	// edges generated at once don't change the graph.
+	void buildFromGenerator(std::string const& name, EdgeGenerator const& generator,
+	                        std::size_t chunk_size = 1 << 16);
+	// Builds the graph from edges between the nodes 0, ..., n-1. Like for
+	// files, the graph is made undirected and reduced to its largest
+	// component; the nodes keep their relative order.
+	void buildFromEdges(std::string const& name, Edges edges);
+	// Uses unweighted CSR arrays owned by someone else, e.g., a GraphPool,
+	// which have to outlive the graph: the neighbors of node i are at the
+	// indices from offsets[i] to offsets[i+1]. Such a graph can't be updated.
+	void viewArrays(std::string const& name, std::size_t number_of_nodes,
+	                std::size_t const* offsets, NodeID const* neighbors);
+	// Not possible after updateEdges.
+	void writeBinaryFile(std::string const& binary_file) const;
+	bool isMapped() const;
+	// Fails if the mapped arrays of the nodes in [first, last) would lead to
+	// reads out of bounds: offsets that decrease or exceed the edges, neighbors
+	// that aren't nodes and alias indices beyond the degree. Graphs in memory
+	// are built consistent, so nothing is checked for them.
+	void checkMappedNodes(NodeID first, NodeID last) const;
+	// Inserts and deletes undirected edges between the nodes 0, ..., n-1 in
+	// place, deletions before insertions. Inserting an existing edge, deleting
+	// a missing one and loops have no effect. The work is proportional to the
+	// batch and the degrees of its nodes, except for the rare rebalancing of
+	// the free slots (see ends). A batch that would leave a node without
+	// neighbors is rejected as a whole. Only unweighted graphs in memory can
+	// be updated, and not while a simulation runs on them.
+	void updateEdges(Edges const& insertions, Edges const& deletions);
+	// number of batches applied by updateEdges, e.g., to rebuild structures
+	// derived from the graph
+	std::size_t getNumberOfUpdates() const;
+	// Hints that the nodes in [first, last) will be visited soon. Only has an
+	// effect if the graph is mapped.
+	void willVisit(NodeID first, NodeID last) const;
+	// Calls fn(begin, end) for the memory of every array that holds data of
+	// the nodes in [first, last) or of their edges.
+	template <typename Function>
+	void forEachMemoryRange(NodeID first, NodeID last, Function fn) const;
 
 	std::string const& getFilename() const;
 	std::size_t getNumberOfNodes() const;
 	std::size_t getNumberOfEdges() const;
 	std::size_t degree(NodeID node_id) const;
+	bool isWeighted() const;
+	// The volume of a node is its degree or, in weighted graphs, the sum of the
+	// weights of its edges.
+	double volume(NodeID node_id) const;
+	double getTotalVolume() const;
+	// Nodes of equal degree are sorted by ID.
 	// Note: This function builds a new vector with the size being the number
 	// of nodes. So, beware of calling this too often.
 	std::vector<NodeID> getNodesSortedByDegree() const;
 
 	NeighborRange getNeighborRange(NodeID node_id) const;
+	// The CSR arrays for kernels over all nodes (see simd_kernels.h): the
+	// neighbors of a node are at the indices from its offset to its end.
+	std::size_t const* getOffsets() const;
+	std::size_t const* getEnds() const;
+	NodeID const* getNeighbors() const;
+	// the weights of the edges at the same indices, or nullptr if the graph is
+	// unweighted
+	Weight const* getWeights() const;
+	// In weighted graphs, neighbors are sampled proportionally to the weight of
+	// the connecting edge in O(1) using the alias method.
 	NodeID getRandomNeighbor(NodeID node_id, Random& random) const;
+	// inline, as this is the innermost operation of every round
+	NodeID getRandomNeighbor(NodeID node_id, CounterRandom& random) const;
 
 private:
+	// times the stages of buildFromFile
+	friend class GraphStageBenchmark;
+
 	std::string filename;
 
 	// node structures
 	std::vector<ParserNodeID> old_ids;
 
 	// edge structures
-	std::vector<std::size_t> offsets;
+	HugePageVector<std::size_t> offsets;
 	Neighbors neighbors;
+	// Updated graphs keep free slots behind the neighbors of every node, like
+	// a packed memory array over the nodes: the neighbors of a node start at
+	// its offset and end at its end, its free slots end at the next offset.
+	// The ends are only stored once the graph is updated; before, their view
+	// points to the offsets of the next nodes.
+	HugePageVector<std::size_t> ends;
+	std::size_t number_of_updates = 0;
+
+	// weighted edge structures; the alias tables are stored per edge slot and
+	// the alias indices are relative to the offset of the node
+	HugePageVector<Weight> weights;
+	HugePageVector<float> alias_probabilities;
+	HugePageVector<std::uint32_t> alias_indices;
+	HugePageVector<double> volumes;
+
+	// out-of-core edge structures
+	MappedFile mapped_file;
+
+	// Views of the edge structures. They either point into the vectors above
+	// or into the mapped file.
+	std::size_t number_of_nodes = 0;
+	std::size_t number_of_edges = 0;
+	double total_volume = 0;
+	std::size_t const* offsets_data = nullptr;
+	std::size_t const* ends_data = nullptr;
+	NodeID const* neighbors_data = nullptr;
+	Weight const* weights_data = nullptr;
+	float const* alias_probabilities_data = nullptr;
+	std::uint32_t const* alias_indices_data = nullptr;
+	double const* volumes_data = nullptr;
+
+	void mapBinaryFile(std::string const& binary_file, bool check_nodes);
+	void setViews();
+	void buildAliasTables();
+	// sizes of the CSR arrays for the memory accounting
+	void recordCsrStructures() const;
 
 	// helper definitions and functions for buildFromFile
 	using ParserEdge = std::pair<ParserNodeID, ParserNodeID>;
 	using ParserEdges = std::vector<ParserEdge>;
-	using Edge = std::pair<NodeID, NodeID>;
-	using Edges = std::vector<Edge>;
+	// Weights are kept in a separate vector parallel to the edges. It is
+	// empty for unweighted graphs.
+	using Weights = HugePageVector<Weight>;
 
-	ParserEdges readEdges(std::string const& graph_file) const;
-	void reduceToLargestScc(ParserEdges& edges) const;
+	ParserEdges readEdges(std::string const& graph_file, Weights& edge_weights) const;
+	void reduceToLargestScc(ParserEdges& edges, Weights& edge_weights) const;
+	void reduceToLargestComponent(Edges& edges) const;
 	Edges convertIDs(ParserEdges& edges);
-	void addAllReverseEdges(Edges& edges) const;
-	void sortAndMakeUnique(Edges& edges) const;
-	void fillOffsetsAndNeighbors(Edges const& edges);
+	void addAllReverseEdges(Edges& edges, Weights& edge_weights) const;
+	void sortAndMakeUnique(Edges& edges, Weights& edge_weights) const;
+	void fillOffsetsAndNeighbors(Edges const& edges, Weights& edge_weights);
+
+	// helper definitions and functions for updateEdges
+	struct NeighborUpdate
+	{
+		NodeID node_id;
+		// the new neighbors are in [begin, end) of a buffer
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	// Lays out the neighbors of the nodes in [first, last) in the given
+	// number of slots; the free slots are distributed proportionally to the
+	// degrees. The new neighbors of the pending nodes are taken from the
+	// buffer. Only the whole graph can be laid out in a different number of
+	// slots.
+	void spreadNeighbors(NodeID first, NodeID last, std::size_t number_of_slots,
+	                     NeighborUpdate const* pending_begin, NeighborUpdate const* pending_end,
+	                     std::vector<NodeID> const& buffer);
 };
+
+// whether the file is a binary graph file written by writeBinaryFile
+bool isBinaryGraphFile(std::string const& graph_file);
+
+inline auto Graph::getRandomNeighbor(NodeID node_id, CounterRandom& random) const -> NodeID
+{
+	auto const first_edge = offsets_data[node_id];
+	auto const degree = ends_data[node_id] - first_edge;
+	debug_assert(degree != 0);
+
+	auto neighbor_index = first_edge + random.getSizeT(0, degree - 1);
+	if (weights_data != nullptr && random.getDouble() >= alias_probabilities_data[neighbor_index]) {
+		neighbor_index = first_edge + alias_indices_data[neighbor_index];
+	}
+
+	return neighbors_data[neighbor_index];
+}
+
+template <typename Function>
+void Graph::forEachMemoryRange(NodeID first, NodeID last, Function fn) const
+{
+	if (first >= last) { return; }
+
+	auto const first_edge = offsets_data[first];
+	auto const last_edge = offsets_data[last];
+	fn(offsets_data + first, offsets_data + last + 1);
+	if (!ends.empty()) {
+		fn(ends_data + first, ends_data + last);
+	}
+	fn(neighbors_data + first_edge, neighbors_data + last_edge);
+	if (isWeighted()) {
+		fn(weights_data + first_edge, weights_data + last_edge);
+		fn(alias_probabilities_data + first_edge, alias_probabilities_data + last_edge);
+		fn(alias_indices_data + first_edge, alias_indices_data + last_edge);
+		fn(volumes_data + first, volumes_data + last);
+	}
+}
@@ -0,0 +1,275 @@
+#include "graph_generators.h"
+
+#include "defs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+namespace
+{
+
+using Parameters = std::map<std::string, double>;
+
+// Takes the parameter out of the map, so unknown parameters remain.
+double takeParameter(Parameters& parameters, std::string const& key, double default_value)
+{
+	auto it = parameters.find(key);
+	if (it == parameters.end()) { return default_value; }
+
+	auto value = it->second;
+	parameters.erase(it);
+	return value;
+}
+
+std::size_t toSize(double value)
+{
+	return static_cast<std::size_t>(std::llround(value));
+}
+
+//
+// Erdős–Rényi G(n, M) with M = n*d/2 uniform node pairs
+//
+
+class ErdosRenyiGenerator : public EdgeGenerator
+{
+public:
+	ErdosRenyiGenerator(std::size_t number_of_nodes, double average_degree, std::uint64_t seed)
+		: number_of_nodes(number_of_nodes),
+		  number_of_edges(toSize(number_of_nodes*average_degree/2)),
+		  key(CounterRandom::makeKey(seed, 0)) {}
+
+	std::size_t getNumberOfNodes() const override { return number_of_nodes; }
+	std::size_t getNumberOfEdges() const override { return number_of_edges; }
+
+	void generate(std::size_t first, std::size_t last, Graph::Edge* edges) const override
+	{
+		for (auto i = first; i < last; ++i) {
+			CounterRandom random(key, 0, i);
+			auto node1 = random.getSizeT(0, number_of_nodes - 1);
+			auto node2 = random.getSizeT(0, number_of_nodes - 1);
+			edges[i - first] = {node1, node2};
+		}
+	}
+
+private:
+	std::size_t const number_of_nodes;
+	std::size_t const number_of_edges;
+	std::uint64_t const key;
+};
+
+//
+// Chung-Lu with power law weights w_i ~ (i + 1)^(-1/(beta - 1)): both
+// endpoints of the n*d/2 edges are drawn proportionally to the weights, by
+// inverting the distribution function of the continuous weight function.
+//
+
+class ChungLuGenerator : public EdgeGenerator
+{
+public:
+	ChungLuGenerator(std::size_t number_of_nodes, double average_degree, double beta,
+	                 std::uint64_t seed)
+		: number_of_nodes(number_of_nodes),
+		  number_of_edges(toSize(number_of_nodes*average_degree/2)),
+		  key(CounterRandom::makeKey(seed, 0)),
+		  exponent(1 - 1/(beta - 1)),
+		  range(std::pow(number_of_nodes + 1., exponent) - 1)
+	{
+		if (beta <= 2) {
+			Error("The power law exponent of chunglu has to be larger than 2.");
+		}
+	}
+
+	std::size_t getNumberOfNodes() const override { return number_of_nodes; }
+	std::size_t getNumberOfEdges() const override { return number_of_edges; }
+
+	void generate(std::size_t first, std::size_t last, Graph::Edge* edges) const override
+	{
+		for (auto i = first; i < last; ++i) {
+			CounterRandom random(key, 0, i);
+			auto node1 = sampleNode(random);
+			auto node2 = sampleNode(random);
+			edges[i - first] = {node1, node2};
+		}
+	}
+
+private:
+	std::size_t const number_of_nodes;
+	std::size_t const number_of_edges;
+	std::uint64_t const key;
+	double const exponent;
+	double const range;
+
+	Graph::NodeID sampleNode(CounterRandom& random) const
+	{
+		auto x = std::pow(random.getDouble()*range + 1, 1/exponent) - 1;
+		return std::min(static_cast<Graph::NodeID>(x), number_of_nodes - 1);
+	}
+};
+
+//
+// Barabási–Albert: every node attaches m edges to earlier nodes chosen
+// proportionally to their degree. In the edge list of Batagelj and Brandes,
+// the target of edge e is the node at a uniformly random earlier position;
+// if that is again a target, its position is followed further. As the
+// positions are drawn from a counter-based stream keyed by the position,
+// every target can be resolved independently (Sanders and Schulz).
+//
+
+class BarabasiAlbertGenerator : public EdgeGenerator
+{
+public:
+	BarabasiAlbertGenerator(std::size_t number_of_nodes, std::size_t edges_per_node,
+	                        std::uint64_t seed)
+		: number_of_nodes(number_of_nodes), edges_per_node(edges_per_node),
+		  key(CounterRandom::makeKey(seed, 0))
+	{
+		if (edges_per_node == 0) {
+			Error("The number of edges per node of ba has to be positive.");
+		}
+	}
+
+	std::size_t getNumberOfNodes() const override { return number_of_nodes; }
+	std::size_t getNumberOfEdges() const override { return number_of_nodes*edges_per_node; }
+
+	void generate(std::size_t first, std::size_t last, Graph::Edge* edges) const override
+	{
+		for (auto i = first; i < last; ++i) {
+			// positions 2i and 2i + 1 hold the source and the target of edge i
+			auto position = 2*i + 1;
+			while (position % 2 == 1) {
+				CounterRandom random(key, 0, position);
+				position = random.getSizeT(0, position - 1);
+			}
+			edges[i - first] = {i/edges_per_node, position/2/edges_per_node};
+		}
+	}
+
+private:
+	std::size_t const number_of_nodes;
+	std::size_t const edges_per_node;
+	std::uint64_t const key;
+};
+
+//
+// Stochastic block model with a planted core: uniform node pairs within the
+// core, between core and periphery and within the periphery.
+//
+
+class CorePeripheryGenerator : public EdgeGenerator
+{
+public:
+	CorePeripheryGenerator(std::size_t number_of_nodes, double core_fraction,
+	                       double core_degree, double cross_degree, double periphery_degree,
+	                       std::uint64_t seed)
+		: number_of_nodes(number_of_nodes),
+		  core_size(std::max<std::size_t>(1, toSize(core_fraction*number_of_nodes))),
+		  core_edges(toSize(core_size*core_degree/2)),
+		  cross_edges(toSize((number_of_nodes - core_size)*cross_degree)),
+		  periphery_edges(toSize((number_of_nodes - core_size)*periphery_degree/2)),
+		  key(CounterRandom::makeKey(seed, 0))
+	{
+		if (core_size >= number_of_nodes) {
+			Error("The core of sbm has to be smaller than the graph.");
+		}
+	}
+
+	std::size_t getNumberOfNodes() const override { return number_of_nodes; }
+	std::size_t getNumberOfEdges() const override
+	{
+		return core_edges + cross_edges + periphery_edges;
+	}
+
+	void generate(std::size_t first, std::size_t last, Graph::Edge* edges) const override
+	{
+		for (auto i = first; i < last; ++i) {
+			CounterRandom random(key, 0, i);
+			Graph::NodeID node1, node2;
+			if (i < core_edges) {
+				node1 = random.getSizeT(0, core_size - 1);
+				node2 = random.getSizeT(0, core_size - 1);
+			}
+			else if (i < core_edges + cross_edges) {
+				node1 = random.getSizeT(0, core_size - 1);
+				node2 = random.getSizeT(core_size, number_of_nodes - 1);
+			}
+			else {
+				node1 = random.getSizeT(core_size, number_of_nodes - 1);
+				node2 = random.getSizeT(core_size, number_of_nodes - 1);
+			}
+			edges[i - first] = {node1, node2};
+		}
+	}
+
+private:
+	std::size_t const number_of_nodes;
+	std::size_t const core_size;
+	std::size_t const core_edges;
+	std::size_t const cross_edges;
+	std::size_t const periphery_edges;
+	std::uint64_t const key;
+};
+
+} // end anonymous
+
+bool isGeneratorSpec(std::string const& graph_file)
+{
+	return graph_file.compare(0, 4, "gen:") == 0;
+}
+
+std::unique_ptr<EdgeGenerator> createEdgeGenerator(std::string const& spec)
+{
+	debug_assert(isGeneratorSpec(spec));
+
+	std::stringstream ss(spec.substr(4));
+	std::string model, parameter;
+	std::getline(ss, model, ':');
+
+	Parameters parameters;
+	while (std::getline(ss, parameter, ':')) {
+		auto separator = parameter.find('=');
+		if (separator == std::string::npos) {
+			Error("Generator parameters have to be given as key=value: " + parameter);
+		}
+		parameters[parameter.substr(0, separator)] = std::stod(parameter.substr(separator + 1));
+	}
+
+	auto number_of_nodes = toSize(takeParameter(parameters, "n", 1 << 20));
+	auto seed = static_cast<std::uint64_t>(takeParameter(parameters, "seed", 1));
+	if (number_of_nodes < 2) {
+		Error("A generated graph needs at least two nodes: " + spec);
+	}
+
+	std::unique_ptr<EdgeGenerator> generator;
+	if (model == "er") {
+		auto average_degree = takeParameter(parameters, "d", 16);
+		generator.reset(new ErdosRenyiGenerator(number_of_nodes, average_degree, seed));
+	}
+	else if (model == "chunglu") {
+		auto average_degree = takeParameter(parameters, "d", 16);
+		auto beta = takeParameter(parameters, "beta", 2.5);
+		generator.reset(new ChungLuGenerator(number_of_nodes, average_degree, beta, seed));
+	}
+	else if (model == "ba") {
+		auto edges_per_node = toSize(takeParameter(parameters, "m", 8));
+		generator.reset(new BarabasiAlbertGenerator(number_of_nodes, edges_per_node, seed));
+	}
+	else if (model == "sbm") {
+		auto core_fraction = takeParameter(parameters, "core", 0.05);
+		auto core_degree = takeParameter(parameters, "dcore", 32);
+		auto cross_degree = takeParameter(parameters, "dcross", 4);
+		auto periphery_degree = takeParameter(parameters, "dper", 4);
+		generator.reset(new CorePeripheryGenerator(number_of_nodes, core_fraction, core_degree,
+		                                           cross_degree, periphery_degree, seed));
+	}
+	else {
+		Error("Unknown graph generator: " + model);
+	}
+
+	if (!parameters.empty()) {
+		Error("Unknown parameter " + parameters.begin()->first + " of generator " + model);
+	}
+
+	return generator;
+}
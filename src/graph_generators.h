@@ -0,0 +1,44 @@
+#pragma once
+
+#include "graph.h"
+#include "random.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//
+// EdgeGenerator
+//
+// Random graph models whose edges can be generated in independent chunks:
+// every edge only depends on the seed and on its index, so the graph is the
+// same for any chunks and any number of threads. The edges may
+// contain loops and duplicates, which Graph::buildFromGenerator removes.
+//
+// Generators are referenced like graph files, as
+//   gen:<model>:<key>=<value>:...
+// with the models and keys (numbers may be given like 1e8)
+//   er        n, d (average degree), seed
+//   chunglu   n, d, beta (power law exponent > 2), seed
+//   ba        n, m (edges per new node), seed
+//   sbm       n, core (fraction of core nodes), dcore (core neighbors of a core
+//             node), dcross (core neighbors of a periphery node), dper
+//             (periphery neighbors of a periphery node), seed
+// The nodes of the planted core of sbm are the first ones.
+//
+
+class EdgeGenerator
+{
+public:
+	virtual ~EdgeGenerator() = default;
+
+	virtual std::size_t getNumberOfNodes() const = 0;
+	virtual std::size_t getNumberOfEdges() const = 0;
+	// Writes the edges with indices in [first, last) to edges. The random
+	// numbers of an edge are drawn from a CounterRandom stream keyed by the
+	// seed and its index.
+	virtual void generate(std::size_t first, std::size_t last, Graph::Edge* edges) const = 0;
+};
+
+bool isGeneratorSpec(std::string const& graph_file);
+std::unique_ptr<EdgeGenerator> createEdgeGenerator(std::string const& spec);
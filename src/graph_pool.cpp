@@ -0,0 +1,252 @@
+#include "graph_pool.h"
+
+#include "compressed_input.h"
+#include "defs.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+Graph::NodeID const NO_NODE = std::numeric_limits<Graph::NodeID>::max();
+
+bool isDirectory(std::string const& path)
+{
+	struct stat status;
+	return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+bool isRegularFile(std::string const& path)
+{
+	struct stat status;
+	return stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode);
+}
+
+bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Sets the range [begin, end) of the next column of the line, starting at end.
+bool nextColumn(std::string const& line, std::size_t& begin, std::size_t& end)
+{
+	begin = end;
+	while (begin < line.size() && isSpace(line[begin])) { ++begin; }
+	end = begin;
+	while (end < line.size() && !isSpace(line[end])) { ++end; }
+
+	return begin != end;
+}
+
+} // end anonymous
+
+GraphPool::GraphPool(std::string const& path)
+{
+	if (isDirectory(path)) {
+		readDirectory(path);
+	}
+	else {
+		readContainerFile(path);
+	}
+
+	// only now, as the arrays don't move anymore
+	graphs.resize(entries.size());
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		auto const& entry = entries[i];
+		graphs[i].viewArrays(entry.name, entry.number_of_nodes, offsets.data() + entry.first_offset,
+		                     neighbors.data() + entry.first_neighbor);
+	}
+}
+
+std::size_t GraphPool::size() const
+{
+	return graphs.size();
+}
+
+Graph const& GraphPool::getGraph(std::size_t index) const
+{
+	return graphs[index];
+}
+
+void GraphPool::readContainerFile(std::string const& container_file)
+{
+	auto file = openTextFile(container_file);
+	if (!file) {
+		Error("The graph container file couldn't be opened. Filename: " + container_file);
+	}
+
+	std::string name;
+	bool has_graph = false;
+	std::string line;
+	while (std::getline(*file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		if (line.compare(0, 6, "graph ") == 0) {
+			if (has_graph) {
+				addGraph(name);
+			}
+			std::size_t begin, end = 6;
+			if (!nextColumn(line, begin, end)) {
+				Error("A graph in a container file needs a name: " + container_file);
+			}
+			name = line.substr(begin, end - begin);
+			has_graph = true;
+		}
+		else if (!has_graph) {
+			Error("The edges of a container file have to follow a graph line: " + container_file);
+		}
+		else {
+			readEdge(line, name);
+		}
+	}
+	if (has_graph) {
+		addGraph(name);
+	}
+}
+
+void GraphPool::readDirectory(std::string const& directory)
+{
+	auto dir = opendir(directory.c_str());
+	if (dir == nullptr) {
+		Error("The graph directory couldn't be opened. Directory: " + directory);
+	}
+
+	std::vector<std::string> names;
+	while (auto entry = readdir(dir)) {
+		std::string name(entry->d_name);
+		if (name[0] != '.' && isRegularFile(directory + "/" + name)) {
+			names.push_back(name);
+		}
+	}
+	closedir(dir);
+	std::sort(names.begin(), names.end());
+
+	std::string line;
+	for (auto const& name: names) {
+		auto file = openTextFile(directory + "/" + name);
+		if (!file) {
+			Error("The graph file couldn't be opened. Filename: " + directory + "/" + name);
+		}
+
+		while (std::getline(*file, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			readEdge(line, name);
+		}
+		addGraph(name);
+	}
+}
+
+void GraphPool::readEdge(std::string const& line, std::string const& name)
+{
+	std::size_t source_begin, source_end = 0;
+	if (!nextColumn(line, source_begin, source_end)) {
+		return;
+	}
+	std::size_t target_begin, target_end = source_end;
+	if (!nextColumn(line, target_begin, target_end)) {
+		Error("An edge of the graph " + name + " needs two columns: " + line);
+	}
+	std::size_t weight_begin, weight_end = target_end;
+	if (nextColumn(line, weight_begin, weight_end)) {
+		Error("The graphs of a graph pool have to be unweighted: " + name);
+	}
+
+	// remove loops as they are annoying; before the IDs are assigned, so the
+	// nodes are numbered like by Graph::buildFromFile
+	if (line.compare(source_begin, source_end - source_begin,
+	                 line, target_begin, target_end - target_begin) == 0) {
+		return;
+	}
+
+	auto getID = [&](std::size_t begin, std::size_t end) {
+		auto node = line.substr(begin, end - begin);
+		auto it = to_id.find(node);
+		if (it == to_id.end()) {
+			it = to_id.emplace(std::move(node), to_id.size()).first;
+		}
+		return it->second;
+	};
+	auto const source = getID(source_begin, source_end);
+	auto const target = getID(target_begin, target_end);
+	edges.emplace_back(source, target);
+}
+
+void GraphPool::addGraph(std::string const& name)
+{
+	auto const number_of_ids = to_id.size();
+	to_id.clear();
+	if (edges.empty()) {
+		Print("Skipping the graph " << name << ", which has no edges.");
+		return;
+	}
+
+	// reduce to the largest component; the nodes keep their relative order
+	union_find.clear();
+	union_find.resize(number_of_ids);
+	for (auto const& edge: edges) {
+		union_find.unite(edge.first, edge.second);
+	}
+	auto const largest_root = union_find.findRoot(union_find.largestSetElement());
+	new_ids.assign(number_of_ids, NO_NODE);
+	std::size_t number_of_nodes = 0;
+	for (Graph::NodeID id = 0; id < number_of_ids; ++id) {
+		if (union_find.findRoot(id) == largest_root) {
+			new_ids[id] = number_of_nodes++;
+		}
+	}
+
+	// counting sort of the edges in both directions by their source; the
+	// offsets are the ends of the nodes afterwards and are shifted back
+	auto const first_offset = offsets.size();
+	offsets.resize(first_offset + number_of_nodes + 1, 0);
+	auto const node_offsets = offsets.data() + first_offset;
+	for (auto const& edge: edges) {
+		if (new_ids[edge.first] != NO_NODE) {
+			++node_offsets[new_ids[edge.first] + 1];
+			++node_offsets[new_ids[edge.second] + 1];
+		}
+	}
+	std::partial_sum(node_offsets, node_offsets + number_of_nodes + 1, node_offsets);
+
+	auto const first_neighbor = neighbors.size();
+	neighbors.resize(first_neighbor + node_offsets[number_of_nodes]);
+	auto const node_neighbors = neighbors.data() + first_neighbor;
+	for (auto const& edge: edges) {
+		auto const source = new_ids[edge.first];
+		auto const target = new_ids[edge.second];
+		if (source != NO_NODE) {
+			node_neighbors[node_offsets[source]++] = target;
+			node_neighbors[node_offsets[target]++] = source;
+		}
+	}
+	std::copy_backward(node_offsets, node_offsets + number_of_nodes, node_offsets + number_of_nodes + 1);
+	node_offsets[0] = 0;
+
+	// sort the neighbors of every node and remove duplicates in place
+	std::size_t number_of_edges = 0;
+	for (Graph::NodeID node_id = 0; node_id < number_of_nodes; ++node_id) {
+		auto const begin = node_neighbors + node_offsets[node_id];
+		auto const end = node_neighbors + node_offsets[node_id + 1];
+		std::sort(begin, end);
+		auto const unique_end = std::unique(begin, end);
+
+		node_offsets[node_id] = number_of_edges;
+		for (auto neighbor = begin; neighbor != unique_end; ++neighbor) {
+			node_neighbors[number_of_edges++] = *neighbor;
+		}
+	}
+	node_offsets[number_of_nodes] = number_of_edges;
+	neighbors.resize(first_neighbor + number_of_edges);
+
+	entries.push_back({name, number_of_nodes, first_offset, first_neighbor});
+	edges.clear();
+}
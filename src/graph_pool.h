@@ -0,0 +1,67 @@
+#pragma once
+
+#include "graph.h"
+#include "huge_page_allocator.h"
+#include "union_find.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// GraphPool
+//
+// Many small graphs, e.g., thousands of ego networks or subgraph samples, in
+// one pair of CSR arrays. Building a Graph per file costs more than the
+// simulation of such a graph, so the pool reads all of them from one
+// container file or from the files of a directory and reuses the buffers of
+// the build from graph to graph. The graphs of the pool view its arrays (see
+// Graph::viewArrays).
+//
+// The graphs are built like unweighted edge lists by Graph::buildFromFile:
+// loops and duplicates are removed, the graph is made undirected and reduced
+// to its largest component, and the nodes are numbered in the order of their
+// first appearance. Graphs without edges are skipped.
+//
+// A container file lists the edges of all graphs; a line "graph <name>"
+// starts the next graph and lines starting with # are comments. The graphs of
+// a directory are its files in the order of their names, named by them.
+//
+
+class GraphPool
+{
+public:
+	explicit GraphPool(std::string const& path);
+	GraphPool(GraphPool const&) = delete;
+	GraphPool& operator=(GraphPool const&) = delete;
+
+	std::size_t size() const;
+	Graph const& getGraph(std::size_t index) const;
+
+private:
+	HugePageVector<std::size_t> offsets;
+	HugePageVector<Graph::NodeID> neighbors;
+
+	struct Entry
+	{
+		std::string name;
+		std::size_t number_of_nodes;
+		std::size_t first_offset;
+		std::size_t first_neighbor;
+	};
+	std::vector<Entry> entries;
+	std::vector<Graph> graphs;
+
+	// buffers of the graph that is currently read
+	std::unordered_map<std::string, Graph::NodeID> to_id;
+	Graph::Edges edges;
+	DenseUnionFind union_find;
+	std::vector<Graph::NodeID> new_ids;
+
+	void readContainerFile(std::string const& container_file);
+	void readDirectory(std::string const& directory);
+	// Adds the edge of a line of an edge list to the current graph.
+	void readEdge(std::string const& line, std::string const& name);
+	// Appends the current graph to the arrays and clears the buffers.
+	void addGraph(std::string const& name);
+};
@@ -0,0 +1,123 @@
+#include "huge_page_allocator.h"
+
+#include "defs.h"
+#include "memory_accounting.h"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+std::atomic<HugePagePolicy> global_policy(HugePagePolicy::Transparent);
+
+std::size_t roundToHugePages(std::size_t bytes)
+{
+	return (bytes + huge_pages::PAGE_SIZE - 1)/huge_pages::PAGE_SIZE*huge_pages::PAGE_SIZE;
+}
+
+bool usesMapping(std::size_t bytes, HugePagePolicy policy)
+{
+	return policy != HugePagePolicy::None && bytes >= huge_pages::LARGE_ALLOCATION;
+}
+
+// Maps bytes + one huge page and unmaps the unaligned head and the tail.
+void* mapAligned(std::size_t bytes)
+{
+	auto const mapped_bytes = bytes + huge_pages::PAGE_SIZE;
+	void* address = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+	                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (address == MAP_FAILED) { return nullptr; }
+
+	auto const begin = reinterpret_cast<std::uintptr_t>(address);
+	auto const aligned = (begin + huge_pages::PAGE_SIZE - 1)/huge_pages::PAGE_SIZE*huge_pages::PAGE_SIZE;
+	auto const end = begin + mapped_bytes;
+
+	if (aligned > begin) {
+		munmap(address, aligned - begin);
+	}
+	if (end > aligned + bytes) {
+		munmap(reinterpret_cast<void*>(aligned + bytes), end - aligned - bytes);
+	}
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+} // end anonymous
+
+HugePagePolicy toHugePagePolicy(std::string const& policy_string)
+{
+	if (policy_string == "none") {
+		return HugePagePolicy::None;
+	}
+	else if (policy_string == "thp") {
+		return HugePagePolicy::Transparent;
+	}
+	else if (policy_string == "hugetlb") {
+		return HugePagePolicy::HugeTLB;
+	}
+
+	Error("No matching huge page policy on call of toHugePagePolicy");
+}
+
+std::string toString(HugePagePolicy policy)
+{
+	switch (policy) {
+	case HugePagePolicy::None: return "none";
+	case HugePagePolicy::Transparent: return "thp";
+	case HugePagePolicy::HugeTLB: default: return "hugetlb";
+	}
+}
+
+void setHugePagePolicy(HugePagePolicy policy)
+{
+	global_policy = policy;
+}
+
+HugePagePolicy getHugePagePolicy()
+{
+	return global_policy;
+}
+
+void* huge_pages::allocate(std::size_t bytes, HugePagePolicy policy)
+{
+	if (bytes == 0) { return nullptr; }
+
+	if (!usesMapping(bytes, policy)) {
+		void* address = std::malloc(bytes);
+		if (address == nullptr) { throw std::bad_alloc(); }
+		return address;
+	}
+
+	auto const rounded_bytes = roundToHugePages(bytes);
+	checkMemoryBudget(rounded_bytes, "a large array");
+
+	if (policy == HugePagePolicy::HugeTLB) {
+		void* address = mmap(nullptr, rounded_bytes, PROT_READ | PROT_WRITE,
+		                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (address != MAP_FAILED) { return address; }
+	}
+
+	void* address = mapAligned(rounded_bytes);
+	if (address == nullptr) { throw std::bad_alloc(); }
+
+	// a hint only; without THP support we simply keep the small pages
+	madvise(address, rounded_bytes, MADV_HUGEPAGE);
+	return address;
+}
+
+void huge_pages::deallocate(void* pointer, std::size_t bytes, HugePagePolicy policy)
+{
+	if (pointer == nullptr) { return; }
+
+	if (!usesMapping(bytes, policy)) {
+		std::free(pointer);
+		return;
+	}
+
+	munmap(pointer, roundToHugePages(bytes));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//
+// HugePagePolicy
+//
+// Large arrays (the CSR arrays and the colorings) are randomly accessed
+// across gigabytes, so with 4 KB pages nearly every access is a TLB miss.
+// Depending on the policy, allocations of at least LARGE_ALLOCATION bytes
+// are 2 MB aligned and backed by huge pages:
+// - None: plain heap allocations
+// - Transparent: anonymous mappings advised with MADV_HUGEPAGE
+// - HugeTLB: mappings from the reserved huge page pool (MAP_HUGETLB), falling
+//   back to Transparent if the pool is exhausted
+//
+
+enum class HugePagePolicy {
+	None,
+	Transparent,
+	HugeTLB
+};
+HugePagePolicy toHugePagePolicy(std::string const& policy_string);
+std::string toString(HugePagePolicy policy);
+
+// The policy is used for all allocators created afterwards.
+void setHugePagePolicy(HugePagePolicy policy);
+HugePagePolicy getHugePagePolicy();
+
+namespace huge_pages
+{
+
+std::size_t const PAGE_SIZE = std::size_t(1) << 21;
+std::size_t const LARGE_ALLOCATION = std::size_t(1) << 20;
+
+void* allocate(std::size_t bytes, HugePagePolicy policy);
+void deallocate(void* pointer, std::size_t bytes, HugePagePolicy policy);
+
+} // end huge_pages
+
+//
+// HugePageAllocator
+//
+// Allocator for std::vector which remembers the policy it was created with,
+// so memory is always released the way it was allocated.
+//
+
+template <typename T>
+class HugePageAllocator
+{
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	HugePageAllocator() : policy(getHugePagePolicy()) {}
+	template <typename U>
+	HugePageAllocator(HugePageAllocator<U> const& other) : policy(other.getPolicy()) {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(huge_pages::allocate(n*sizeof(T), policy));
+	}
+
+	void deallocate(T* pointer, std::size_t n)
+	{
+		huge_pages::deallocate(pointer, n*sizeof(T), policy);
+	}
+
+	HugePagePolicy getPolicy() const { return policy; }
+
+private:
+	HugePagePolicy policy;
+};
+
+template <typename T, typename U>
+bool operator==(HugePageAllocator<T> const& lhs, HugePageAllocator<U> const& rhs)
+{
+	return lhs.getPolicy() == rhs.getPolicy();
+}
+
+template <typename T, typename U>
+bool operator!=(HugePageAllocator<T> const& lhs, HugePageAllocator<U> const& rhs)
+{
+	return !(lhs == rhs);
+}
+
+template <typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
@@ -1,27 +1,210 @@
+#include "batch_experiments.h"
 #include "defs.h"
+#include "distributed_experiments.h"
 #include "experiments.h"
+#include "external_graph_builder.h"
+#include "huge_page_allocator.h"
+#include "memory_accounting.h"
+#include "progress.h"
+#include "server.h"
+#include "simd_kernels.h"
+#include "transport.h"
 
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 void printUsage();
+std::size_t toMemoryBudget(std::string const& megabytes_string);
 
 int main(int argc, char* argv[])
 {
-	if (argc != 3) {
-		Error("Wrong number of arguments");
+	if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--convert") {
+		std::size_t run_megabytes = (argc == 5 ? std::stoull(argv[4]) : 1024);
+		ExternalGraphBuilder builder(run_megabytes << 20);
+		builder.build(argv[2], argv[3]);
+		return EXIT_SUCCESS;
+	}
+
+	ParallelOptions parallel_options;
+	CheckpointOptions checkpoint_options;
+	ReportOptions report_options;
+	std::string server_socket, submit_socket, progress_file, workers;
+	std::size_t rank = 0;
+	double progress_interval_seconds = 1;
+	bool threads_given = false;
+	bool batch = false;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument(argv[i]);
+		bool has_value = (i + 1 < argc);
+
+		if (argument == "--threads" && has_value) {
+			parallel_options.number_of_threads = std::stoull(argv[++i]);
+			if (parallel_options.number_of_threads == 0) {
+				Error("The number of threads has to be at least 1.");
+			}
+			threads_given = true;
+		}
+		else if (argument == "--numa") {
+			parallel_options.numa_aware = true;
+		}
+		else if (argument == "--simulate-numa" && has_value) {
+			parallel_options.simulated_numa_nodes = std::stoull(argv[++i]);
+		}
+		else if (argument == "--checkpoint-interval" && has_value) {
+			checkpoint_options.interval_seconds = std::stod(argv[++i]);
+		}
+		else if (argument == "--resume") {
+			checkpoint_options.resume = true;
+		}
+		else if (argument == "--no-ledger") {
+			checkpoint_options.ledger = false;
+		}
+		else if (argument == "--report") {
+			report_options.enabled = true;
+		}
+		else if (argument == "--hardware-counters") {
+			report_options.enabled = true;
+			report_options.hardware_counters = true;
+		}
+		else if (argument == "--memory-budget" && has_value) {
+			setMemoryBudget(toMemoryBudget(argv[++i]));
+		}
+		else if (argument == "--progress" && has_value) {
+			progress_file = argv[++i];
+		}
+		else if (argument == "--progress-interval" && has_value) {
+			progress_interval_seconds = std::stod(argv[++i]);
+		}
+		else if (argument == "--batch") {
+			batch = true;
+		}
+		else if (argument == "--workers" && has_value) {
+			workers = argv[++i];
+		}
+		else if (argument == "--rank" && has_value) {
+			rank = std::stoull(argv[++i]);
+		}
+		else if (argument == "--server" && has_value) {
+			server_socket = argv[++i];
+		}
+		else if (argument == "--submit" && has_value) {
+			submit_socket = argv[++i];
+		}
+		else if (argument == "--huge-pages" && has_value) {
+			setHugePagePolicy(toHugePagePolicy(argv[++i]));
+		}
+		else if (argument == "--instruction-set" && has_value) {
+			std::string instruction_set(argv[++i]);
+			if (instruction_set != "auto") {
+				setInstructionSet(toInstructionSet(instruction_set));
+			}
+		}
+		else {
+			arguments.push_back(argument);
+		}
+	}
+
+	if (!server_socket.empty() && arguments.empty()) {
+		// all trials run sequentially on a shared pool, so by default on all cores
+		auto number_of_threads = (threads_given ? parallel_options.number_of_threads
+		                                        : std::max(1u, std::thread::hardware_concurrency()));
+		ExperimentServer server(server_socket, number_of_threads);
+		server.run();
+		return EXIT_SUCCESS;
+	}
+	if (!submit_socket.empty() && arguments.size() == 1) {
+		return (submitJob(submit_socket, arguments[0], std::cout) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (arguments.size() != 2) {
 		printUsage();
-		return EXIT_FAILURE;
+		Error("Wrong number of arguments");
+	}
+	std::string experiments_file(arguments[0]);
+	std::string result_files_prefix(arguments[1]);
+
+	if (batch) {
+		// the graphs are distributed over the threads, so by default all cores
+		auto number_of_threads = (threads_given ? parallel_options.number_of_threads
+		                                        : std::max(1u, std::thread::hardware_concurrency()));
+		BatchExperiments batch_experiments(experiments_file, result_files_prefix, number_of_threads);
+		batch_experiments.run();
+		return EXIT_SUCCESS;
 	}
-	std::string experiments_file(argv[1]);
-	std::string result_files_prefix(argv[2]);
 
-	Experiments experiments(experiments_file, result_files_prefix);
-	experiments.run();
+	std::unique_ptr<ProgressMonitor> progress;
+	if (!progress_file.empty()) {
+		progress.reset(new ProgressMonitor(progress_file, progress_interval_seconds));
+		setActiveProgressMonitor(progress.get());
+	}
+
+	if (!workers.empty()) {
+		TcpTransport transport(rank, splitAddresses(workers));
+		DistributedExperiments distributed_experiments(experiments_file, result_files_prefix,
+		                                               transport);
+		distributed_experiments.run();
+	}
+	else {
+		Experiments experiments(experiments_file, result_files_prefix, parallel_options,
+		                        checkpoint_options, report_options);
+		experiments.run();
+	}
+
+	setActiveProgressMonitor(nullptr);
 
 	return EXIT_SUCCESS;
 }
 
+// the budget in bytes, given in megabytes
+std::size_t toMemoryBudget(std::string const& megabytes_string)
+{
+	std::size_t megabytes = 0;
+	std::size_t length = 0;
+	try {
+		megabytes = std::stoull(megabytes_string, &length);
+	}
+	catch (std::exception const&) {
+		length = 0;
+	}
+	if (length == 0 || length != megabytes_string.size() || megabytes_string[0] == '-' ||
+	    megabytes > (std::numeric_limits<std::size_t>::max() >> 20)) {
+		Error("Invalid memory budget (in MB): " + megabytes_string);
+	}
+
+	return megabytes << 20;
+}
+
 void printUsage()
 {
-	std::cout << "Usage: ./main <experiments_file> <result_files_prefix>" << std::endl;
+	std::cout << "Usage: ./main [<options>] <experiments_file> <result_files_prefix>" << std::endl;
+	std::cout << "       ./main --convert <graph_file> <binary_graph_file> [<run_megabytes>]" << std::endl;
+	std::cout << "       ./main --batch [--threads <number>] <experiments_file> <result_file>" << std::endl;
+	std::cout << "       ./main --workers <host:port,...> --rank <number> [<options>] <experiments_file> <result_files_prefix>" << std::endl;
+	std::cout << "       ./main --server <socket> [--threads <number>] [<options>]" << std::endl;
+	std::cout << "       ./main --submit <socket> <experiments_file | status | shutdown>" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  --threads <number>        number of threads per simulation (default: 1)" << std::endl;
+	std::cout << "  --numa                    place graph and colorings by NUMA node and pin threads" << std::endl;
+	std::cout << "  --simulate-numa <number>  like --numa, but with a simulated topology" << std::endl;
+	std::cout << "  --huge-pages <policy>     none | thp | hugetlb (default: thp)" << std::endl;
+	std::cout << "  --instruction-set <isa>   auto | baseline | avx2 | avx512 for the vectorized kernels" << std::endl;
+	std::cout << "                            (default: auto, the best one the CPU supports)" << std::endl;
+	std::cout << "  --checkpoint-interval <s> seconds between checkpoints, 0 disables (default: 60)" << std::endl;
+	std::cout << "  --resume                  continue from the checkpoint of an interrupted run" << std::endl;
+	std::cout << "  --no-ledger               rerun all trials instead of the ones not in <prefix>ledger" << std::endl;
+	std::cout << "  --memory-budget <MB>      fail with the stage and the largest structures above it" << std::endl;
+	std::cout << "  --report                  write a JSON performance report per experiment" << std::endl;
+	std::cout << "  --hardware-counters       --report with cycles, IPC and cache misses of the rounds" << std::endl;
+	std::cout << "  --workers <addresses>     run every trial partitioned over the workers at these" << std::endl;
+	std::cout << "                            addresses; one process per worker, started with --rank" << std::endl;
+	std::cout << "  --rank <number>           index of this process in --workers (default: 0)" << std::endl;
+	std::cout << "  --progress <file>         rewrite a JSON file with the live progress and ETA" << std::endl;
+	std::cout << "  --progress-interval <s>   seconds between the rewrites (default: 1)" << std::endl;
 }
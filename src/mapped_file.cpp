@@ -0,0 +1,91 @@
+#include "mapped_file.h"
+
+#include "defs.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+MappedFile::MappedFile(MappedFile&& other)
+	: address(other.address), length(other.length)
+{
+	other.address = nullptr;
+	other.length = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other) {
+		unmap();
+		std::swap(address, other.address);
+		std::swap(length, other.length);
+	}
+
+	return *this;
+}
+
+void MappedFile::map(std::string const& filename)
+{
+	unmap();
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		Error("The file couldn't be opened for mapping: " + filename);
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+		close(fd);
+		Error("The file to map is empty or cannot be accessed: " + filename);
+	}
+
+	length = file_stat.st_size;
+	address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (address == MAP_FAILED) {
+		address = nullptr;
+		length = 0;
+		Error("The file couldn't be mapped: " + filename);
+	}
+}
+
+void MappedFile::unmap()
+{
+	if (address != nullptr) {
+		munmap(address, length);
+		address = nullptr;
+		length = 0;
+	}
+}
+
+void MappedFile::advise(std::size_t offset, std::size_t bytes, Access access) const
+{
+	if (address == nullptr || offset >= length) { return; }
+
+	int advice;
+	switch (access) {
+	case Access::Sequential: advice = MADV_SEQUENTIAL; break;
+	case Access::Random: advice = MADV_RANDOM; break;
+	case Access::WillNeed: advice = MADV_WILLNEED; break;
+	case Access::DontNeed: advice = MADV_DONTNEED; break;
+	case Access::Normal: default: advice = MADV_NORMAL; break;
+	}
+
+	// madvise needs a page aligned start address
+	std::size_t const page_size = sysconf(_SC_PAGESIZE);
+	std::size_t const begin = offset - offset % page_size;
+	std::size_t const end = std::min(offset + bytes, length);
+
+	// hints are best effort, so failures are ignored
+	madvise(static_cast<char*>(address) + begin, end - begin, advice);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Used for the out-of-core mode of
+// Graph, where the CSR arrays are paged in from disk on demand.
+class MappedFile
+{
+public:
+	enum class Access {
+		Normal,
+		Sequential,
+		Random,
+		WillNeed,
+		DontNeed
+	};
+
+	MappedFile() = default;
+	MappedFile(MappedFile const&) = delete;
+	MappedFile(MappedFile&& other);
+	~MappedFile();
+
+	MappedFile& operator=(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile&& other);
+
+	void map(std::string const& filename);
+	void unmap();
+
+	bool isMapped() const { return address != nullptr; }
+	char const* data() const { return static_cast<char const*>(address); }
+	std::size_t size() const { return length; }
+
+	// Passes an access hint for the given byte range to the kernel. The range
+	// is widened to page boundaries.
+	void advise(std::size_t offset, std::size_t bytes, Access access) const;
+
+private:
+	void* address = nullptr;
+	std::size_t length = 0;
+};
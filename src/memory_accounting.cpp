@@ -0,0 +1,211 @@
+#include "memory_accounting.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+std::atomic<std::size_t> memory_budget(0);
+thread_local char const* memory_stage = "startup";
+std::atomic<MemoryMonitor*> active_monitor(nullptr);
+
+std::string toMegabytes(std::size_t bytes)
+{
+	return std::to_string(bytes >> 20) + " MB";
+}
+
+void atomicMax(std::atomic<std::size_t>& maximum, std::size_t value)
+{
+	auto current = maximum.load();
+	while (current < value && !maximum.compare_exchange_weak(current, value)) {}
+}
+
+// Prints the error and exits. Other threads may still be running, so the
+// static objects are not destroyed as std::exit would do.
+[[noreturn]] void exitWithError(std::string const& message)
+{
+	std::cerr << "Error: " << message << std::endl;
+	std::_Exit(EXIT_FAILURE);
+}
+
+} // end anonymous
+
+void setMemoryBudget(std::size_t bytes)
+{
+	memory_budget = bytes;
+}
+
+std::size_t getMemoryBudget()
+{
+	return memory_budget;
+}
+
+std::size_t getResidentBytes()
+{
+	// the second number in statm is the number of resident pages
+	std::FILE* file = std::fopen("/proc/self/statm", "r");
+	if (file == nullptr) { return 0; }
+
+	unsigned long size = 0, resident = 0;
+	if (std::fscanf(file, "%lu %lu", &size, &resident) != 2) { resident = 0; }
+	std::fclose(file);
+
+	return resident*sysconf(_SC_PAGESIZE);
+}
+
+char const* setMemoryStage(char const* stage)
+{
+	auto const previous_stage = memory_stage;
+	memory_stage = stage;
+	return previous_stage;
+}
+
+char const* getMemoryStage()
+{
+	return memory_stage;
+}
+
+void checkMemoryBudget(std::size_t additional_bytes, char const* structure)
+{
+	auto const budget = getMemoryBudget();
+	if (budget == 0) { return; }
+
+	auto const resident_bytes = getResidentBytes();
+	if (resident_bytes + additional_bytes > budget) {
+		exitWithError("Allocating " + toMegabytes(additional_bytes) + " for " + structure +
+		              " in stage " + getMemoryStage() + " would exceed the memory budget of " +
+		              toMegabytes(budget) + " (" + toMegabytes(resident_bytes) +
+		              " are resident).");
+	}
+}
+
+//
+// MemoryMonitor
+//
+
+MemoryMonitor::MemoryMonitor(double interval_seconds)
+	: interval_seconds(interval_seconds), stage(getMemoryStage()), stage_peak(0), peak(0)
+{
+	sample();
+	thread = std::thread(&MemoryMonitor::work, this);
+}
+
+MemoryMonitor::~MemoryMonitor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	stop_condition.notify_one();
+	thread.join();
+}
+
+std::size_t MemoryMonitor::sample()
+{
+	auto const resident_bytes = getResidentBytes();
+	atomicMax(stage_peak, resident_bytes);
+	atomicMax(peak, resident_bytes);
+
+	auto const budget = getMemoryBudget();
+	if (budget != 0 && resident_bytes > budget) {
+		failOverBudget(resident_bytes);
+	}
+
+	return resident_bytes;
+}
+
+auto MemoryMonitor::beginStage(char const* name) -> OuterStage
+{
+	sample();
+	OuterStage const outer_stage{stage.exchange(name), stage_peak.exchange(0)};
+	sample();
+
+	return outer_stage;
+}
+
+std::size_t MemoryMonitor::endStage(OuterStage const& outer_stage)
+{
+	auto const ended_stage_peak = getStagePeak();
+	stage = outer_stage.name;
+	atomicMax(stage_peak, outer_stage.peak);
+
+	return ended_stage_peak;
+}
+
+std::size_t MemoryMonitor::getStagePeak()
+{
+	sample();
+	return stage_peak;
+}
+
+std::size_t MemoryMonitor::getPeak()
+{
+	sample();
+	return peak;
+}
+
+void MemoryMonitor::addStructure(std::string const& name, std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	structures.push_back({getMemoryStage(), name, bytes});
+}
+
+auto MemoryMonitor::getStructures() const -> std::vector<Structure>
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return structures;
+}
+
+void MemoryMonitor::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto const interval = std::chrono::duration<double>(interval_seconds);
+	while (!stop_condition.wait_for(lock, interval, [&]() { return stopping; })) {
+		lock.unlock();
+		sample();
+		lock.lock();
+	}
+}
+
+void MemoryMonitor::failOverBudget(std::size_t resident_bytes)
+{
+	std::stringstream message;
+	message << "The memory budget of " << toMegabytes(getMemoryBudget())
+	        << " is exceeded in stage " << stage.load() << " ("
+	        << toMegabytes(resident_bytes) << " are resident).";
+
+	auto largest = getStructures();
+	largest.erase(std::remove_if(largest.begin(), largest.end(), [](Structure const& structure) {
+		return structure.bytes < (std::size_t(1) << 20);
+	}), largest.end());
+	std::sort(largest.begin(), largest.end(), [](Structure const& a, Structure const& b) {
+		return a.bytes > b.bytes;
+	});
+	largest.resize(std::min<std::size_t>(largest.size(), 5));
+	if (!largest.empty()) {
+		message << " Largest structures recorded so far:";
+		for (auto const& structure: largest) {
+			message << " " << structure.name << " (" << structure.stage << ", "
+			        << toMegabytes(structure.bytes) << ")";
+		}
+	}
+
+	exitWithError(message.str());
+}
+
+MemoryMonitor* getActiveMemoryMonitor()
+{
+	return active_monitor;
+}
+
+void setActiveMemoryMonitor(MemoryMonitor* monitor)
+{
+	active_monitor = monitor;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+//
+// Memory accounting
+//
+// The MemoryMonitor samples the resident set size (RSS) of the process on a
+// background thread to find the peak of every stage (the phases timed with
+// ScopedPhase) and collects the sizes of the major containers. With a memory
+// budget, the process fails with a message naming the stage as soon as the
+// RSS exceeds the budget, and already before large allocations that would
+// exceed it, instead of being killed by the OOM killer without a trace.
+//
+
+// The budget in bytes applies to the whole process; 0 disables it.
+void setMemoryBudget(std::size_t bytes);
+std::size_t getMemoryBudget();
+
+std::size_t getResidentBytes();
+
+// The stage of the calling thread, which is named in the error message if
+// the budget is exceeded. Every thread has its own, so concurrent experiments
+// (server, batch) don't mix up their stages. Returns the previous stage.
+char const* setMemoryStage(char const* stage);
+char const* getMemoryStage();
+
+// Fails if the resident memory plus the given number of bytes, which are
+// about to be allocated for the structure, exceed the budget.
+void checkMemoryBudget(std::size_t additional_bytes, char const* structure);
+
+class MemoryMonitor
+{
+public:
+	struct Structure
+	{
+		std::string stage;
+		std::string name;
+		std::size_t bytes;
+	};
+
+	explicit MemoryMonitor(double interval_seconds = 0.01);
+	~MemoryMonitor();
+
+	MemoryMonitor(MemoryMonitor const&) = delete;
+	MemoryMonitor& operator=(MemoryMonitor const&) = delete;
+
+	// the stage that is left when a nested stage ends
+	struct OuterStage
+	{
+		char const* name;
+		std::size_t peak;
+	};
+
+	// samples the RSS now and returns it
+	std::size_t sample();
+	// Stages can be nested: the peak of the outer stage includes the peak of
+	// the inner one. endStage returns the peak of the ended stage.
+	OuterStage beginStage(char const* name);
+	std::size_t endStage(OuterStage const& outer_stage);
+	// The peak since the begin of the stage and since the construction.
+	std::size_t getStagePeak();
+	std::size_t getPeak();
+
+	void addStructure(std::string const& name, std::size_t bytes);
+	std::vector<Structure> getStructures() const;
+
+private:
+	double const interval_seconds;
+
+	// the stage of the thread that runs the stages, for the error message
+	// written by the monitor thread
+	std::atomic<char const*> stage;
+	std::atomic<std::size_t> stage_peak;
+	std::atomic<std::size_t> peak;
+
+	mutable std::mutex mutex;
+	std::condition_variable stop_condition;
+	bool stopping = false;
+	std::vector<Structure> structures;
+
+	std::thread thread;
+
+	void work();
+	[[noreturn]] void failOverBudget(std::size_t resident_bytes);
+};
+
+// the monitor that structures are recorded in; nullptr disables the recording
+MemoryMonitor* getActiveMemoryMonitor();
+void setActiveMemoryMonitor(MemoryMonitor* monitor);
+
+// Records the result of bytes() as the size of the structure in the active
+// monitor. bytes() is only called if there is one, as it may have to visit
+// all elements.
+template <typename Function>
+void recordStructure(char const* name, Function bytes)
+{
+	auto monitor = getActiveMemoryMonitor();
+	if (monitor) {
+		monitor->addStructure(name, bytes());
+	}
+}
+
+//
+// getMemoryBytes
+//
+// Approximate number of bytes held by a container, including the heap memory
+// of its elements (long strings) and the nodes and buckets of hash tables.
+//
+
+inline std::size_t getHeapBytes(std::string const& string)
+{
+	// short strings are stored inside the object
+	return (string.capacity() > 15 ? string.capacity() + 1 : 0);
+}
+
+template <typename T>
+std::size_t getHeapBytes(T const&)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Missing getHeapBytes overload.");
+	return 0;
+}
+
+template <typename T, typename U>
+std::size_t getHeapBytes(std::pair<T, U> const& pair)
+{
+	return getHeapBytes(pair.first) + getHeapBytes(pair.second);
+}
+
+template <typename Iterator>
+std::size_t getHeapBytesOfElements(Iterator begin, Iterator end)
+{
+	using T = typename std::iterator_traits<Iterator>::value_type;
+	if (std::is_trivially_copyable<T>::value) { return 0; }
+
+	std::size_t bytes = 0;
+	for (auto it = begin; it != end; ++it) {
+		bytes += getHeapBytes(*it);
+	}
+	return bytes;
+}
+
+template <typename T, typename Allocator>
+std::size_t getMemoryBytes(std::vector<T, Allocator> const& vector)
+{
+	return vector.capacity()*sizeof(T) + getHeapBytesOfElements(vector.begin(), vector.end());
+}
+
+// a node holds the next pointer, the element and the cached hash
+template <typename T, typename... Rest>
+std::size_t getMemoryBytes(std::unordered_set<T, Rest...> const& set)
+{
+	return set.bucket_count()*sizeof(void*) +
+	       set.size()*(2*sizeof(void*) + sizeof(T)) +
+	       getHeapBytesOfElements(set.begin(), set.end());
+}
+
+template <typename K, typename V, typename... Rest>
+std::size_t getMemoryBytes(std::unordered_map<K, V, Rest...> const& map)
+{
+	return map.bucket_count()*sizeof(void*) +
+	       map.size()*(2*sizeof(void*) + sizeof(std::pair<K const, V>)) +
+	       getHeapBytesOfElements(map.begin(), map.end());
+}
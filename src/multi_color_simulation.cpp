@@ -0,0 +1,394 @@
+#include "multi_color_simulation.h"
+
+#include "defs.h"
+#include "performance_report.h"
+#include "progress.h"
+
+#include <algorithm>
+
+std::size_t const MultiColorSimulation::KERNEL_BLOCK_SIZE;
+
+namespace
+{
+
+// trial of the random streams of the initial coloring, which doesn't collide
+// with the trials of the simulation
+std::uint64_t const INITIAL_COLORING_TRIAL = ~std::uint64_t(0);
+
+std::size_t getSamplesPerNode(DynamicsType dynamics_type, std::size_t h)
+{
+	switch (dynamics_type) {
+	case DynamicsType::VoterModel: return 1;
+	case DynamicsType::TwoChoices: return 2;
+	case DynamicsType::HMajority: default: return h;
+	}
+}
+
+// the index of the first node of the word of the node
+std::size_t getWordIndex(std::size_t node, std::size_t colors_per_word)
+{
+	return node & ~(colors_per_word - 1);
+}
+
+} // end anonymous
+
+MultiColorSimulation::MultiColorSimulation(Graph const& graph, DynamicsType dynamics_type,
+                                           PackedColoring initial_coloring, std::size_t h,
+                                           ParallelOptions const& parallel_options)
+	: graph(graph), engine(createParallelEngine(graph, parallel_options)),
+	dynamics_type(dynamics_type), samples_per_node(getSamplesPerNode(dynamics_type, h)),
+	word_histogram(initial_coloring.getNumberOfColors() <= 16 && samples_per_node < 16),
+	initial_coloring(initial_coloring), initial_hash(initial_coloring.hash()),
+	initial_volumes(calculateVolumes(initial_coloring)),
+	seed(Random().getSizeT(0, SIZE_MAX)),
+	current_coloring(initial_coloring), next_coloring(initial_coloring),
+	color_volumes(initial_volumes)
+{
+	if (initial_coloring.size() != graph.getNumberOfNodes()) {
+		Error("The initial coloring doesn't match the graph " + graph.getFilename());
+	}
+	if (samples_per_node == 0) {
+		Error("HMajority needs at least one sample.");
+	}
+
+	auto const number_of_colors = initial_coloring.getNumberOfColors();
+	auto const number_of_states = (engine ? engine->getNumberOfWorkers() : 1);
+	for (std::size_t i = 0; i < number_of_states; ++i) {
+		worker_states.push_back({std::vector<std::int64_t>(number_of_colors),
+		                         std::vector<double>(number_of_colors), 0, 0,
+		                         std::vector<CounterRandom::Block>(KERNEL_BLOCK_SIZE),
+		                         std::vector<Graph::NodeID>(samples_per_node*KERNEL_BLOCK_SIZE),
+		                         std::vector<Color>(samples_per_node*KERNEL_BLOCK_SIZE),
+		                         std::vector<std::uint32_t>(KERNEL_BLOCK_SIZE),
+		                         std::vector<Color>(KERNEL_BLOCK_SIZE),
+		                         std::vector<std::uint32_t>(word_histogram ? 0 : number_of_colors),
+		                         std::vector<Color>(samples_per_node), {}});
+	}
+}
+
+Result MultiColorSimulation::run(std::int64_t max_rounds, float win_threshold, std::size_t trial)
+{
+	current_coloring.assign(initial_coloring);
+	color_volumes = initial_volumes;
+	max_rounds = (max_rounds == -1 ? graph.getNumberOfNodes() : max_rounds);
+
+	// see Simulation::run
+	auto hash = initial_hash;
+	auto previous_hash = ~initial_hash;
+
+	auto report = getActiveReport();
+	if (report) { report->beginSimulation(trial); }
+	auto progress = getActiveProgressMonitor();
+	if (progress) { progress->beginTrial(trial, max_rounds); }
+
+	std::size_t round = 0;
+	auto stop_reason = StopReason::MaxRounds;
+	while (round < (std::size_t)max_rounds) {
+		if (progress) { progress->setRound(round, getColorVolumes()); }
+		if (getWinningColor(win_threshold) != Color::None) {
+			stop_reason = StopReason::WinThreshold;
+			break;
+		}
+
+		if (report) { report->beginRound(); }
+		auto const statistics = simulateOneRound(trial, round);
+		if (report) { report->endRound(statistics.first); }
+		auto next_hash = hash ^ statistics.second;
+
+		bool fixed_point = statistics.first == 0 &&
+		                   isDeterministicRound(next_coloring, next_coloring);
+		bool oscillation = statistics.first > 0 && next_hash == previous_hash &&
+		                   isDeterministicRound(current_coloring, next_coloring) &&
+		                   isDeterministicRound(next_coloring, current_coloring);
+
+		current_coloring.swap(next_coloring);
+		previous_hash = hash;
+		hash = next_hash;
+		++round;
+
+		if (fixed_point || oscillation) {
+			stop_reason = (fixed_point ? StopReason::FixedPoint : StopReason::Oscillation);
+			break;
+		}
+	}
+	if (stop_reason == StopReason::MaxRounds && getWinningColor(win_threshold) != Color::None) {
+		stop_reason = StopReason::WinThreshold;
+	}
+	if (report) { report->endSimulation(graph.getNumberOfNodes()); }
+	if (progress) {
+		progress->setRound(round, getColorVolumes());
+		progress->endTrial();
+	}
+
+	return Result{
+		graph.getFilename(),
+		getWinningColor(win_threshold),
+		current_coloring.getColorFractions(),
+		getColorVolumes(),
+		round,
+		stop_reason
+	};
+}
+
+void MultiColorSimulation::setSeed(std::uint64_t seed)
+{
+	this->seed = seed;
+}
+
+std::uint64_t MultiColorSimulation::getSeed() const
+{
+	return seed;
+}
+
+PackedColoring const& MultiColorSimulation::getColoring() const
+{
+	return current_coloring;
+}
+
+std::vector<float> MultiColorSimulation::getColorVolumes() const
+{
+	std::vector<float> volumes(color_volumes.size());
+	for (std::size_t i = 0; i < volumes.size(); ++i) {
+		volumes[i] = color_volumes[i]/graph.getTotalVolume();
+	}
+
+	return volumes;
+}
+
+Color MultiColorSimulation::getWinningColor(float win_threshold) const
+{
+	auto const volumes = getColorVolumes();
+	for (std::size_t i = 0; i < volumes.size(); ++i) {
+		if (volumes[i] >= win_threshold) {
+			return static_cast<Color>(i);
+		}
+	}
+
+	return Color::None;
+}
+
+std::pair<std::size_t, std::uint64_t> MultiColorSimulation::simulateOneRound(std::size_t trial,
+                                                                             std::size_t round)
+{
+	random_key = CounterRandom::makeKey(seed, trial);
+	this->round = round;
+
+	if (engine) {
+		// the ranges are aligned to words, so no word is written by two workers
+		auto const colors_per_word = current_coloring.getColorsPerWord();
+		auto const number_of_nodes = graph.getNumberOfNodes();
+		auto align = [&](Graph::NodeID node) {
+			return (node == number_of_nodes ? node :
+			        getWordIndex(node + colors_per_word - 1, colors_per_word));
+		};
+		engine->run([&](std::size_t worker) {
+			auto const range = engine->getRange(worker);
+			simulateRange(std::min(align(range.first), number_of_nodes),
+			              std::min(align(range.second), number_of_nodes), worker_states[worker]);
+		});
+	}
+	else {
+		simulateRange(0, graph.getNumberOfNodes(), worker_states[0]);
+	}
+
+	// the changes are added in the order of the workers
+	std::size_t number_of_flips = 0;
+	std::uint64_t hash_change = 0;
+	auto color_counts = current_coloring.getCounts();
+	for (auto const& state: worker_states) {
+		for (std::size_t i = 0; i < color_counts.size(); ++i) {
+			color_counts[i] += state.count_changes[i];
+			color_volumes[i] += state.volume_changes[i];
+		}
+		number_of_flips += state.number_of_flips;
+		hash_change ^= state.hash_change;
+	}
+	next_coloring.setCounts(color_counts);
+
+	// Sums of weights depend on their order, so they are recounted in the
+	// order of the nodes to not depend on the number of workers.
+	if (graph.isWeighted()) {
+		color_volumes = calculateVolumes(next_coloring);
+	}
+
+	return {number_of_flips, hash_change};
+}
+
+void MultiColorSimulation::simulateRange(Graph::NodeID first, Graph::NodeID last,
+                                         WorkerState& state)
+{
+	std::fill(state.count_changes.begin(), state.count_changes.end(), 0);
+	std::fill(state.volume_changes.begin(), state.volume_changes.end(), 0.);
+	state.number_of_flips = 0;
+	state.hash_change = 0;
+
+	auto const samples = samples_per_node;
+	auto const words = current_coloring.data();
+	auto const colors_per_word = current_coloring.getColorsPerWord();
+	auto const sampled_neighbors = state.sampled_neighbors.data();
+	auto const sampled_colors = state.sampled_colors.data();
+	auto const new_colors = state.new_colors.data();
+
+	for (auto block_first = first; block_first < last; block_first += KERNEL_BLOCK_SIZE) {
+		auto const block_size = std::min(KERNEL_BLOCK_SIZE, last - block_first);
+
+		// phase 1: sample the neighbors and prefetch the words of their colors
+		CounterRandom::generateFirstBlocks(random_key, round, block_first, block_size,
+		                                   state.random_blocks.data());
+		for (std::size_t i = 0; i < block_size; ++i) {
+			CounterRandom random(random_key, round, block_first + i, state.random_blocks[i]);
+			for (std::size_t j = 0; j < samples; ++j) {
+				auto neighbor = graph.getRandomNeighbor(block_first + i, random);
+				sampled_neighbors[i*samples + j] = neighbor;
+				__builtin_prefetch(words + getWordIndex(neighbor, colors_per_word)/colors_per_word);
+			}
+			if (dynamics_type == DynamicsType::HMajority) {
+				state.tie_breakers[i] = random.get32();
+			}
+		}
+
+		// phase 2: gather the colors, which are in the cache by now
+		for (std::size_t i = 0; i < block_size*samples; ++i) {
+			sampled_colors[i] = current_coloring.get(sampled_neighbors[i]);
+		}
+
+		// phase 3: decide the new colors and update the counts and volumes
+		for (std::size_t i = 0; i < block_size; ++i) {
+			auto const node_id = block_first + i;
+			auto const old_color = current_coloring.get(node_id);
+			auto new_color = old_color;
+			switch (dynamics_type) {
+			case DynamicsType::VoterModel:
+				new_color = sampled_colors[i];
+				break;
+			case DynamicsType::TwoChoices:
+				if (sampled_colors[2*i] == sampled_colors[2*i + 1]) {
+					new_color = sampled_colors[2*i];
+				}
+				break;
+			case DynamicsType::HMajority:
+				new_color = getMajority(sampled_colors + i*samples, state.tie_breakers[i], state);
+				break;
+			}
+			new_colors[i] = new_color;
+
+			if (new_color != old_color) {
+				auto const volume = graph.volume(node_id);
+				auto const old_index = static_cast<std::size_t>(old_color);
+				auto const new_index = static_cast<std::size_t>(new_color);
+				++state.number_of_flips;
+				state.hash_change ^= Coloring::hashContribution(node_id, old_color) ^
+				                     Coloring::hashContribution(node_id, new_color);
+				--state.count_changes[old_index];
+				++state.count_changes[new_index];
+				state.volume_changes[old_index] -= volume;
+				state.volume_changes[new_index] += volume;
+			}
+		}
+
+		next_coloring.setUncounted(block_first, new_colors, block_size);
+	}
+}
+
+Color MultiColorSimulation::getMajority(Color const* samples, std::uint32_t tie_breaker,
+                                        WorkerState& state) const
+{
+	// The tied colors are ordered by color in both histograms, and the tie
+	// breaker picks one of them uniformly.
+	auto pick = [&](std::size_t number_of_ties) {
+		return static_cast<std::size_t>((static_cast<std::uint64_t>(tie_breaker)*number_of_ties) >> 32);
+	};
+
+	if (word_histogram) {
+		std::uint64_t histogram = 0;
+		for (std::size_t j = 0; j < samples_per_node; ++j) {
+			histogram += std::uint64_t(1) << (4*static_cast<std::size_t>(samples[j]));
+		}
+
+		// bit c of the mask is set if color c is tied for the majority
+		std::uint64_t max_count = 0;
+		std::uint32_t tied_mask = 0;
+		for (std::size_t j = 0; j < samples_per_node; ++j) {
+			auto const color = static_cast<std::size_t>(samples[j]);
+			auto const count = (histogram >> 4*color) & 15;
+			if (count > max_count) {
+				max_count = count;
+				tied_mask = 0;
+			}
+			if (count == max_count) {
+				tied_mask |= std::uint32_t(1) << color;
+			}
+		}
+
+		for (auto tie = pick(__builtin_popcount(tied_mask)); tie > 0; --tie) {
+			tied_mask &= tied_mask - 1;
+		}
+		return static_cast<Color>(__builtin_ctz(tied_mask));
+	}
+
+	auto& histogram = state.histogram;
+	std::uint32_t max_count = 0;
+	for (std::size_t j = 0; j < samples_per_node; ++j) {
+		max_count = std::max(max_count, ++histogram[static_cast<std::size_t>(samples[j])]);
+	}
+
+	auto const ties = state.tied_colors.data();
+	std::size_t number_of_ties = 0;
+	for (std::size_t j = 0; j < samples_per_node; ++j) {
+		auto& count = histogram[static_cast<std::size_t>(samples[j])];
+		if (count == max_count) {
+			ties[number_of_ties++] = samples[j];
+		}
+		count = 0;
+	}
+	std::sort(ties, ties + number_of_ties);
+
+	return ties[pick(number_of_ties)];
+}
+
+bool MultiColorSimulation::isDeterministicRound(PackedColoring const& from_coloring,
+                                                PackedColoring const& to_coloring) const
+{
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		auto color = to_coloring.get(node_id);
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (from_coloring.get(neighbor) != color) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+std::vector<double> MultiColorSimulation::calculateVolumes(PackedColoring const& coloring) const
+{
+	std::vector<double> volumes(coloring.getNumberOfColors(), 0.);
+	for (Graph::NodeID node_id = 0; node_id < coloring.size(); ++node_id) {
+		volumes[static_cast<std::size_t>(coloring.get(node_id))] += graph.volume(node_id);
+	}
+
+	return volumes;
+}
+
+PackedColoring createMultiColorInitialColoring(Coloring const& core_periphery_coloring,
+                                               std::size_t number_of_colors, std::uint64_t seed)
+{
+	PackedColoring coloring(core_periphery_coloring.size(), number_of_colors);
+
+	auto const key = CounterRandom::makeKey(seed, INITIAL_COLORING_TRIAL);
+	for (std::size_t node_id = 0; node_id < coloring.size(); ++node_id) {
+		if (core_periphery_coloring.get(node_id) == Color::Blue) {
+			CounterRandom random(key, 0, node_id);
+			coloring.set(node_id, static_cast<Color>(1 + random.getSizeT(0, number_of_colors - 2)));
+		}
+	}
+
+	return coloring;
+}
+
+bool isMultiColorExperiment(ExperimentData const& experiment_data)
+{
+	return experiment_data.number_of_colors > 2 ||
+	       experiment_data.dynamics_type == DynamicsType::HMajority;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "graph.h"
+#include "packed_coloring.h"
+#include "parallel_engine.h"
+#include "random.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//
+// MultiColorSimulation
+//
+// Runs the dynamics with k colors on a PackedColoring. The number of nodes
+// and the volume of every color are updated with the flips of each round
+// instead of being recounted; only the volumes of weighted graphs are
+// recounted, as their sums would depend on the number of workers. A node
+// draws its samples from the same CounterRandom stream as in the two-color
+// Simulation, so with two colors the VoterModel and TwoChoices give the same
+// results as there; the Simulation remains the faster choice for them.
+//
+// HMajority counts the colors of the samples in a histogram that fits into one
+// 64-bit word (4 bits per color) for up to 16 colors and h < 16, otherwise in
+// a histogram array.
+//
+
+class MultiColorSimulation
+{
+public:
+	// h is only used by HMajority
+	MultiColorSimulation(Graph const& graph, DynamicsType dynamics_type,
+	                     PackedColoring initial_coloring, std::size_t h = 3,
+	                     ParallelOptions const& parallel_options = ParallelOptions());
+
+	Result run(std::int64_t max_rounds, float win_threshold, std::size_t trial = 0);
+	void setSeed(std::uint64_t seed);
+	std::uint64_t getSeed() const;
+
+	PackedColoring const& getColoring() const;
+	std::vector<float> getColorVolumes() const;
+	Color getWinningColor(float win_threshold) const;
+
+private:
+	Graph const& graph;
+	std::unique_ptr<ParallelEngine> engine;
+	DynamicsType const dynamics_type;
+	std::size_t const samples_per_node;
+	bool const word_histogram;
+	PackedColoring const initial_coloring;
+	std::uint64_t const initial_hash;
+	std::vector<double> initial_volumes;
+	std::uint64_t seed;
+
+	PackedColoring current_coloring;
+	PackedColoring next_coloring;
+	// volume of every color in the current coloring
+	std::vector<double> color_volumes;
+
+	// random key and number of the round which is simulated
+	std::uint64_t random_key = 0;
+	std::uint64_t round = 0;
+
+	struct WorkerState
+	{
+		// changes of the color counts and volumes by the flips of the round
+		std::vector<std::int64_t> count_changes;
+		std::vector<double> volume_changes;
+		std::size_t number_of_flips;
+		std::uint64_t hash_change;
+		// buffers of a kernel block
+		std::vector<CounterRandom::Block> random_blocks;
+		std::vector<Graph::NodeID> sampled_neighbors;
+		std::vector<Color> sampled_colors;
+		std::vector<std::uint32_t> tie_breakers;
+		std::vector<Color> new_colors;
+		// histogram of HMajority if it doesn't fit into a word, and the
+		// colors which are tied for the majority
+		std::vector<std::uint32_t> histogram;
+		std::vector<Color> tied_colors;
+		// avoids false sharing between the workers
+		char padding[64];
+	};
+	std::vector<WorkerState> worker_states;
+
+	// number of nodes handled at once; a multiple of the colors per word
+	static std::size_t const KERNEL_BLOCK_SIZE = 128;
+
+	// Returns the number of flips and the hash change of the round.
+	std::pair<std::size_t, std::uint64_t> simulateOneRound(std::size_t trial, std::size_t round);
+	void simulateRange(Graph::NodeID first, Graph::NodeID last, WorkerState& state);
+	Color getMajority(Color const* samples, std::uint32_t tie_breaker, WorkerState& state) const;
+	bool isDeterministicRound(PackedColoring const& from_coloring,
+	                          PackedColoring const& to_coloring) const;
+	std::vector<double> calculateVolumes(PackedColoring const& coloring) const;
+};
+
+// The core-periphery coloring with k colors: the core keeps color 0 and every
+// periphery node gets one of the colors 1, ..., k-1 uniformly at random. With
+// two colors, this is the core-periphery coloring itself.
+PackedColoring createMultiColorInitialColoring(Coloring const& core_periphery_coloring,
+                                               std::size_t number_of_colors, std::uint64_t seed);
+
+// Whether the experiment is run by the MultiColorSimulation.
+bool isMultiColorExperiment(ExperimentData const& experiment_data);
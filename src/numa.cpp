@@ -0,0 +1,154 @@
+#include "numa.h"
+
+#include "defs.h"
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+// the CPUs this process is allowed to run on
+NumaTopology::CPUs getAllowedCPUs()
+{
+	NumaTopology::CPUs cpus;
+
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &cpu_set)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+
+	if (cpus.empty()) {
+		cpus.push_back(0);
+	}
+
+	return cpus;
+}
+
+// parses the sysfs list format, e.g., "0-3,8-11"
+NumaTopology::CPUs parseCPUList(std::string const& cpu_list)
+{
+	NumaTopology::CPUs cpus;
+
+	std::stringstream ss(cpu_list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range == "\n") { continue; }
+
+		auto dash = range.find('-');
+		int first = std::stoi(range.substr(0, dash));
+		int last = (dash == std::string::npos ? first : std::stoi(range.substr(dash + 1)));
+		for (int cpu = first; cpu <= last; ++cpu) {
+			cpus.push_back(cpu);
+		}
+	}
+
+	return cpus;
+}
+
+} // end anonymous
+
+NumaTopology NumaTopology::detect()
+{
+	NumaTopology topology;
+	auto allowed_cpus = getAllowedCPUs();
+
+	for (int node_id = 0; ; ++node_id) {
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node_id) + "/cpulist");
+		if (!file.is_open()) { break; }
+
+		std::string cpu_list;
+		std::getline(file, cpu_list);
+
+		CPUs cpus;
+		for (auto cpu: parseCPUList(cpu_list)) {
+			if (std::binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu)) {
+				cpus.push_back(cpu);
+			}
+		}
+
+		// nodes without usable CPUs (e.g. memory-only nodes) are skipped
+		if (!cpus.empty()) {
+			topology.cpus_of_node.push_back(cpus);
+			topology.node_ids.push_back(node_id);
+		}
+	}
+
+	// no NUMA information available, so treat the machine as one node
+	if (topology.cpus_of_node.empty()) {
+		topology.cpus_of_node.push_back(allowed_cpus);
+		topology.node_ids.push_back(0);
+	}
+
+	return topology;
+}
+
+NumaTopology NumaTopology::simulate(std::size_t number_of_nodes)
+{
+	debug_assert(number_of_nodes > 0);
+
+	NumaTopology topology;
+	topology.simulated = true;
+
+	// Split the CPUs into contiguous groups. If there are fewer CPUs than
+	// nodes, the nodes share CPUs.
+	auto allowed_cpus = getAllowedCPUs();
+	for (std::size_t i = 0; i < number_of_nodes; ++i) {
+		CPUs cpus;
+		if (allowed_cpus.size() >= number_of_nodes) {
+			auto first = i*allowed_cpus.size()/number_of_nodes;
+			auto last = (i + 1)*allowed_cpus.size()/number_of_nodes;
+			cpus.assign(allowed_cpus.begin() + first, allowed_cpus.begin() + last);
+		}
+		else {
+			cpus.push_back(allowed_cpus[i % allowed_cpus.size()]);
+		}
+
+		topology.cpus_of_node.push_back(cpus);
+		topology.node_ids.push_back(0);
+	}
+
+	return topology;
+}
+
+void NumaTopology::moveMemory(void const* begin, void const* end, std::size_t numa_node) const
+{
+	if (simulated || getNumberOfNodes() == 1) { return; }
+
+	std::uintptr_t const page_size = sysconf(_SC_PAGESIZE);
+	auto first = (reinterpret_cast<std::uintptr_t>(begin) + page_size - 1)/page_size*page_size;
+	auto last = reinterpret_cast<std::uintptr_t>(end)/page_size*page_size;
+	if (first >= last) { return; }
+
+	auto const node_id = node_ids[numa_node];
+	std::vector<unsigned long> node_mask(node_id/(8*sizeof(unsigned long)) + 1, 0);
+	node_mask[node_id/(8*sizeof(unsigned long))] |= 1ul << (node_id % (8*sizeof(unsigned long)));
+
+	syscall(SYS_mbind, first, last - first, MPOL_BIND, node_mask.data(),
+	        node_mask.size()*8*sizeof(unsigned long), MPOL_MF_MOVE);
+}
+
+void NumaTopology::bindThread(CPUs const& cpus)
+{
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (auto cpu: cpus) {
+		CPU_SET(cpu, &cpu_set);
+	}
+
+	// binding is an optimization only, so failures are ignored
+	sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// The NUMA nodes of the machine together with the CPUs this process may run
+// on. A topology can also be simulated by splitting the available CPUs into
+// several nodes, which allows to exercise the NUMA-aware code paths on
+// machines with a single memory node. Memory is never moved in that case.
+class NumaTopology
+{
+public:
+	using CPUs = std::vector<int>;
+
+	static NumaTopology detect();
+	static NumaTopology simulate(std::size_t number_of_nodes);
+
+	std::size_t getNumberOfNodes() const { return cpus_of_node.size(); }
+	CPUs const& getCPUs(std::size_t numa_node) const { return cpus_of_node[numa_node]; }
+	bool isSimulated() const { return simulated; }
+
+	// Moves the pages of [begin, end) to the given NUMA node. Only pages which
+	// lie completely inside the range are moved. Best effort, errors are
+	// ignored.
+	void moveMemory(void const* begin, void const* end, std::size_t numa_node) const;
+
+	// Pins the calling thread to the given CPUs.
+	static void bindThread(CPUs const& cpus);
+
+private:
+	NumaTopology() = default;
+
+	std::vector<CPUs> cpus_of_node;
+	// the IDs of the NUMA nodes as used by the kernel
+	std::vector<int> node_ids;
+	bool simulated = false;
+};
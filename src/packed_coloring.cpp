@@ -0,0 +1,115 @@
+#include "packed_coloring.h"
+
+#include <algorithm>
+
+PackedColoring::PackedColoring(std::size_t size, std::size_t number_of_colors, Color color)
+	: number_of_nodes(size), color_counts(number_of_colors, 0)
+{
+	if (number_of_colors < 2 || number_of_colors > MAX_NUMBER_OF_COLORS) {
+		Error("The number of colors has to be between 2 and " << MAX_NUMBER_OF_COLORS
+		      << ": " << number_of_colors);
+	}
+	if (static_cast<std::size_t>(color) >= number_of_colors) {
+		Error("The color " << static_cast<int>(color) << " isn't one of the "
+		      << number_of_colors << " colors.");
+	}
+
+	auto const bits_per_color = getBitsPerColor(number_of_colors);
+	bits_shift = (bits_per_color == 2 ? 1 : bits_per_color == 4 ? 2 : 3);
+	index_shift = 6 - bits_shift;
+	color_mask = (Word(1) << bits_per_color) - 1;
+
+	// every color slot of a word holds the color
+	Word word = 0;
+	for (std::size_t i = 0; i < getColorsPerWord(); ++i) {
+		word |= static_cast<Word>(color) << (i << bits_shift);
+	}
+	words.assign((size + getColorsPerWord() - 1) >> index_shift, word);
+	color_counts[static_cast<std::size_t>(color)] = size;
+}
+
+PackedColoring::PackedColoring(Coloring const& coloring, std::size_t number_of_colors)
+	: PackedColoring(coloring.size(), number_of_colors)
+{
+	for (std::size_t i = 0; i < coloring.size(); ++i) {
+		if (coloring.get(i) != Color::Red) {
+			set(i, coloring.get(i));
+		}
+	}
+}
+
+std::size_t PackedColoring::getBitsPerColor(std::size_t number_of_colors)
+{
+	return (number_of_colors <= 4 ? 2 : number_of_colors <= 16 ? 4 : 8);
+}
+
+void PackedColoring::set(std::size_t index, Color new_color)
+{
+	debug_assert(static_cast<std::size_t>(new_color) < getNumberOfColors());
+
+	auto& word = words[index >> index_shift];
+	auto const shift = (index & (getColorsPerWord() - 1)) << bits_shift;
+	--color_counts[static_cast<std::size_t>(get(index))];
+	++color_counts[static_cast<std::size_t>(new_color)];
+	word = (word & ~(color_mask << shift)) | (static_cast<Word>(new_color) << shift);
+}
+
+void PackedColoring::setUncounted(std::size_t first, Color const* new_colors, std::size_t count)
+{
+	auto const colors_per_word = getColorsPerWord();
+	debug_assert(first % colors_per_word == 0);
+	debug_assert(first + count <= size());
+	debug_assert(count % colors_per_word == 0 || first + count == size());
+
+	auto word = words.begin() + (first >> index_shift);
+	for (std::size_t i = 0; i < count; i += colors_per_word) {
+		auto const word_count = std::min(colors_per_word, count - i);
+		Word new_word = 0;
+		for (std::size_t j = 0; j < word_count; ++j) {
+			new_word |= static_cast<Word>(new_colors[i + j]) << (j << bits_shift);
+		}
+		*word++ = new_word;
+	}
+}
+
+void PackedColoring::setCounts(std::vector<std::size_t> const& counts)
+{
+	debug_assert(counts.size() == color_counts.size());
+	color_counts.assign(counts.begin(), counts.end());
+}
+
+void PackedColoring::assign(PackedColoring const& coloring)
+{
+	debug_assert(size() == coloring.size() && getNumberOfColors() == coloring.getNumberOfColors());
+
+	words.assign(coloring.words.begin(), coloring.words.end());
+	color_counts.assign(coloring.color_counts.begin(), coloring.color_counts.end());
+}
+
+void PackedColoring::swap(PackedColoring& coloring)
+{
+	debug_assert(size() == coloring.size() && getNumberOfColors() == coloring.getNumberOfColors());
+
+	words.swap(coloring.words);
+	color_counts.swap(coloring.color_counts);
+}
+
+std::uint64_t PackedColoring::hash() const
+{
+	std::uint64_t result = 0;
+	for (std::size_t i = 0; i < size(); ++i) {
+		result ^= Coloring::hashContribution(i, get(i));
+	}
+
+	return result;
+}
+
+std::vector<float> PackedColoring::getColorFractions() const
+{
+	std::vector<float> fractions(color_counts.size());
+	for (std::size_t i = 0; i < fractions.size(); ++i) {
+		fractions[i] = (float)color_counts[i]/size();
+	}
+
+	return fractions;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "defs.h"
+#include "huge_page_allocator.h"
+
+#include <cstdint>
+#include <vector>
+
+//
+// PackedColoring
+//
+// Coloring with k colors 0, ..., k-1, which are packed into 2 bits per node
+// for up to 4 colors, 4 bits for up to 16 and 8 bits for more. The number of
+// nodes of every color is kept like in Coloring.
+//
+
+class PackedColoring
+{
+public:
+	using Word = std::uint64_t;
+
+	PackedColoring(std::size_t size, std::size_t number_of_colors, Color color = Color::Red);
+	// the colors of a two-color coloring
+	PackedColoring(Coloring const& coloring, std::size_t number_of_colors);
+
+	static std::size_t getBitsPerColor(std::size_t number_of_colors);
+
+	std::size_t size() const { return number_of_nodes; }
+	std::size_t getNumberOfColors() const { return color_counts.size(); }
+	std::size_t getBitsPerColor() const { return std::size_t(1) << bits_shift; }
+	// Ranges of nodes that start at multiples of this number can be written
+	// concurrently with setUncounted.
+	std::size_t getColorsPerWord() const { return std::size_t(1) << index_shift; }
+	Word const* data() const { return words.data(); }
+
+	Color get(std::size_t index) const;
+	void set(std::size_t index, Color new_color);
+	// Writes count colors starting at first, which has to be a multiple of
+	// the colors per word, without maintaining the color counts. The range
+	// has to end at a word boundary or at the end of the coloring.
+	void setUncounted(std::size_t first, Color const* new_colors, std::size_t count);
+	void setCounts(std::vector<std::size_t> const& counts);
+	std::vector<std::size_t> const& getCounts() const { return color_counts; }
+	void assign(PackedColoring const& coloring);
+	void swap(PackedColoring& coloring);
+
+	// the same hash as the one of a Coloring with the same colors
+	std::uint64_t hash() const;
+	std::vector<float> getColorFractions() const;
+
+private:
+	std::size_t number_of_nodes;
+	// log2 of the bits per color and of the colors per word
+	std::size_t bits_shift;
+	std::size_t index_shift;
+	Word color_mask;
+	HugePageVector<Word> words;
+	std::vector<std::size_t> color_counts;
+};
+
+inline Color PackedColoring::get(std::size_t index) const
+{
+	auto const word = words[index >> index_shift];
+	auto const shift = (index & (getColorsPerWord() - 1)) << bits_shift;
+	return static_cast<Color>((word >> shift) & color_mask);
+}
@@ -0,0 +1,127 @@
+#include "parallel_engine.h"
+
+#include "defs.h"
+
+#include <algorithm>
+
+ParallelEngine::ParallelEngine(Graph const& graph, std::size_t number_of_threads,
+                               NumaTopology const& topology)
+	: topology(topology)
+{
+	debug_assert(number_of_threads > 0);
+
+	// split the nodes such that every worker gets the same number of nodes
+	// plus edges
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	auto const total_work = number_of_nodes + graph.getNumberOfEdges();
+
+	Graph::NodeID node_id = 0;
+	std::size_t work = 0;
+	for (std::size_t i = 0; i < number_of_threads; ++i) {
+		auto const first = node_id;
+		auto const target_work = (i + 1)*total_work/number_of_threads;
+		while (node_id < number_of_nodes && work < target_work) {
+			work += 1 + graph.degree(node_id);
+			++node_id;
+		}
+
+		auto const numa_node = i*topology.getNumberOfNodes()/number_of_threads;
+		workers.push_back({{first, node_id}, numa_node});
+	}
+
+	threads.reserve(workers.size());
+	for (std::size_t i = 0; i < workers.size(); ++i) {
+		threads.emplace_back(&ParallelEngine::work, this, i);
+	}
+}
+
+ParallelEngine::~ParallelEngine()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	start_condition.notify_all();
+
+	for (auto& thread: threads) {
+		thread.join();
+	}
+}
+
+void ParallelEngine::run(Task const& task)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	current_task = &task;
+	number_of_running = workers.size();
+	++generation;
+	start_condition.notify_all();
+
+	done_condition.wait(lock, [&]() { return number_of_running == 0; });
+	current_task = nullptr;
+}
+
+void ParallelEngine::place(Graph const& graph) const
+{
+	for (auto const& worker: workers) {
+		graph.forEachMemoryRange(worker.range.first, worker.range.second,
+		                         [&](void const* begin, void const* end) {
+			topology.moveMemory(begin, end, worker.numa_node);
+		});
+	}
+}
+
+void ParallelEngine::place(Coloring const& coloring) const
+{
+	for (auto const& worker: workers) {
+		auto const begin = coloring.data() + worker.range.first;
+		auto const end = coloring.data() + worker.range.second;
+		topology.moveMemory(begin, end, worker.numa_node);
+	}
+}
+
+void ParallelEngine::work(std::size_t worker)
+{
+	NumaTopology::bindThread(topology.getCPUs(workers[worker].numa_node));
+
+	std::size_t seen_generation = 0;
+	while (true) {
+		Task const* task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start_condition.wait(lock, [&]() {
+				return stopped || generation != seen_generation;
+			});
+			if (stopped) { return; }
+
+			seen_generation = generation;
+			task = current_task;
+		}
+
+		(*task)(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--number_of_running == 0) {
+				done_condition.notify_one();
+			}
+		}
+	}
+}
+
+std::unique_ptr<ParallelEngine> createParallelEngine(Graph const& graph,
+                                                     ParallelOptions const& parallel_options)
+{
+	auto const numa_aware = parallel_options.numa_aware || parallel_options.simulated_numa_nodes > 0;
+	if (parallel_options.number_of_threads <= 1 && !numa_aware) {
+		return nullptr;
+	}
+
+	auto topology = (parallel_options.simulated_numa_nodes > 0 ?
+	                 NumaTopology::simulate(parallel_options.simulated_numa_nodes) :
+	                 numa_aware ? NumaTopology::detect() : NumaTopology::simulate(1));
+
+	// use at least one worker per NUMA node
+	auto number_of_threads = std::max(parallel_options.number_of_threads,
+	                                  topology.getNumberOfNodes());
+	return std::unique_ptr<ParallelEngine>(new ParallelEngine(graph, number_of_threads, topology));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "graph.h"
+#include "numa.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs the node updates of a round on a fixed set of worker threads. Every
+// worker owns a contiguous range of nodes of about the same number of nodes
+// plus edges. The workers are spread over the NUMA nodes in order, so every
+// NUMA node gets a contiguous slice of the nodes, and each worker is pinned to
+// the CPUs of its NUMA node.
+class ParallelEngine
+{
+public:
+	using NodeRange = std::pair<Graph::NodeID, Graph::NodeID>;
+	using Task = std::function<void(std::size_t worker)>;
+
+	ParallelEngine(Graph const& graph, std::size_t number_of_threads,
+	               NumaTopology const& topology);
+	ParallelEngine(ParallelEngine const&) = delete;
+	~ParallelEngine();
+
+	ParallelEngine& operator=(ParallelEngine const&) = delete;
+
+	std::size_t getNumberOfWorkers() const { return workers.size(); }
+	NodeRange getRange(std::size_t worker) const { return workers[worker].range; }
+
+	// Runs the task on all workers and waits until all of them are done.
+	void run(Task const& task);
+
+	// Moves the memory belonging to the nodes of each NUMA node there.
+	void place(Graph const& graph) const;
+	void place(Coloring const& coloring) const;
+
+private:
+	struct Worker
+	{
+		NodeRange range;
+		std::size_t numa_node;
+	};
+
+	NumaTopology const topology;
+	std::vector<Worker> workers;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable start_condition;
+	std::condition_variable done_condition;
+	Task const* current_task = nullptr;
+	std::size_t generation = 0;
+	std::size_t number_of_running = 0;
+	bool stopped = false;
+
+	void work(std::size_t worker);
+};
+
+// The engine for the parallel options, or none if the rounds are executed by
+// the calling thread.
+std::unique_ptr<ParallelEngine> createParallelEngine(Graph const& graph,
+                                                     ParallelOptions const& parallel_options);
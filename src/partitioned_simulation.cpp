@@ -0,0 +1,420 @@
+#include "partitioned_simulation.h"
+
+#include "defs.h"
+#include "progress.h"
+#include "random.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+template <typename T>
+Transport::Message toMessage(T const* values, std::size_t count)
+{
+	Transport::Message message(count*sizeof(T));
+	if (count > 0) {
+		std::memcpy(message.data(), values, message.size());
+	}
+	return message;
+}
+
+template <typename T>
+std::vector<T> fromMessage(Transport::Message const& message)
+{
+	std::vector<T> values(message.size()/sizeof(T));
+	if (!values.empty()) {
+		std::memcpy(values.data(), message.data(), values.size()*sizeof(T));
+	}
+	return values;
+}
+
+} // end anonymous
+
+PartitionedSimulation::PartitionedSimulation(Graph const& graph, DynamicsType dynamics_type,
+                                             Coloring const* initial_coloring, Transport& transport)
+	: graph(graph), type(dynamics_type), transport(transport), current_coloring(0),
+	  next_coloring(0)
+{
+	if (dynamics_type == DynamicsType::HMajority) {
+		Error("HMajority is only supported by the multi-color simulation.");
+	}
+	if (graph.isWeighted()) {
+		Error("The partitioned simulation only supports unweighted graphs: " << graph.getFilename());
+	}
+	if (transport.getRank() == 0 &&
+	    (!initial_coloring || initial_coloring->size() != graph.getNumberOfNodes())) {
+		Error("The initial coloring doesn't match the graph " << graph.getFilename());
+	}
+
+	// Like the ParallelEngine, every worker gets about the same number of
+	// nodes plus edges: the first k nodes have k + offsets[k] of them.
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	auto const number_of_workers = transport.getNumberOfWorkers();
+	auto const offsets = graph.getOffsets();
+	auto const total_work = number_of_nodes + offsets[number_of_nodes];
+	for (std::size_t worker = 0; worker <= number_of_workers; ++worker) {
+		auto const target_work = worker*total_work/number_of_workers;
+		Graph::NodeID low = 0, high = number_of_nodes;
+		while (low < high) {
+			auto const middle = low + (high - low)/2;
+			if (middle + offsets[middle] < target_work) {
+				low = middle + 1;
+			}
+			else {
+				high = middle;
+			}
+		}
+		range_begins.push_back(low);
+	}
+	first = range_begins[transport.getRank()];
+	last = range_begins[transport.getRank() + 1];
+	// A mapped graph was only checked on worker 0 (see DistributedExperiments),
+	// so every worker checks the part it visits. Offsets that decrease could
+	// also mix up the ranges.
+	if (first > last) {
+		Error("The graph has invalid offsets. Filename: " << graph.getFilename());
+	}
+	graph.checkMappedNodes(first, last);
+
+	for (auto node_id = first; node_id < last; ++node_id) {
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (neighbor < first || neighbor >= last) {
+				ghosts.push_back(neighbor);
+			}
+		}
+	}
+	std::sort(ghosts.begin(), ghosts.end());
+	ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+	ghosts.shrink_to_fit();
+
+	distributeInitialColoring(initial_coloring);
+	current_coloring = Coloring(last - first + ghosts.size());
+	next_coloring = Coloring(last - first + ghosts.size());
+	samples.resize((last - first)*getSamplesPerNode());
+}
+
+Result PartitionedSimulation::run(std::int64_t max_rounds, float win_threshold, std::size_t trial)
+{
+	auto const samples_per_node = getSamplesPerNode();
+	max_rounds = (max_rounds == -1 ? graph.getNumberOfNodes() : max_rounds);
+	auto const random_key = CounterRandom::makeKey(seed, trial);
+
+	current_coloring.setUncounted(0, initial_colors.data(), last - first);
+	Totals own{0, 0, 0, 0};
+	for (auto node_id = first; node_id < last; ++node_id) {
+		auto const color = initial_colors[node_id - first];
+		own.hash_change ^= Coloring::hashContribution(node_id, color);
+		if (color == Color::Blue) {
+			++own.blue_count;
+			own.blue_volume += graph.degree(node_id);
+		}
+	}
+	auto totals = reduce(own);
+
+	// as in Simulation::run
+	auto hash = totals.hash_change;
+	auto previous_hash = ~hash;
+
+	auto progress = getActiveProgressMonitor();
+	if (progress) { progress->beginTrial(trial, max_rounds); }
+
+	std::vector<std::size_t> requests;
+	std::size_t round = 0;
+	auto stop_reason = StopReason::MaxRounds;
+	while (round < (std::size_t)max_rounds) {
+		auto volumes = toVolumes(totals.blue_volume);
+		if (progress) { progress->setRound(round, volumes); }
+		if (*std::max_element(volumes.begin(), volumes.end()) >= win_threshold) {
+			stop_reason = StopReason::WinThreshold;
+			break;
+		}
+
+		// The samples don't depend on the colors, so the ghost nodes of the
+		// round are known before any color is read.
+		auto const number_of_own_nodes = last - first;
+		requests.clear();
+		for (auto node_id = first; node_id < last; ++node_id) {
+			CounterRandom random(random_key, round, node_id);
+			for (std::size_t i = 0; i < samples_per_node; ++i) {
+				auto const index = getLocalIndex(graph.getRandomNeighbor(node_id, random));
+				samples[(node_id - first)*samples_per_node + i] = index;
+				if (index >= number_of_own_nodes) {
+					requests.push_back(index - number_of_own_nodes);
+				}
+			}
+		}
+		std::sort(requests.begin(), requests.end());
+		requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+		fetchColors(requests, current_coloring);
+
+		own = Totals{0, 0, 0, 0};
+		for (auto node_id = first; node_id < last; ++node_id) {
+			auto const node_samples = samples.data() + (node_id - first)*samples_per_node;
+			auto const old_color = current_coloring.get(node_id - first);
+			auto new_color = current_coloring.get(node_samples[0]);
+			if (type == DynamicsType::TwoChoices && current_coloring.get(node_samples[1]) != new_color) {
+				new_color = old_color;
+			}
+
+			next_coloring.setUncounted(node_id - first, new_color);
+			if (new_color == Color::Blue) {
+				++own.blue_count;
+				own.blue_volume += graph.degree(node_id);
+			}
+			if (new_color != old_color) {
+				++own.number_of_flips;
+				own.hash_change ^= Coloring::hashContribution(node_id, old_color) ^
+				                   Coloring::hashContribution(node_id, new_color);
+			}
+		}
+		auto const next_totals = reduce(own);
+		auto const next_hash = hash ^ next_totals.hash_change;
+
+		// all workers know the totals, so they verify the candidates together
+		bool fixed_point = next_totals.number_of_flips == 0 &&
+		                   isDeterministicRound(next_coloring, next_coloring);
+		bool oscillation = next_totals.number_of_flips > 0 && next_hash == previous_hash &&
+		                   isDeterministicRound(current_coloring, next_coloring) &&
+		                   isDeterministicRound(next_coloring, current_coloring);
+
+		current_coloring.swap(next_coloring);
+		totals = next_totals;
+		previous_hash = hash;
+		hash = next_hash;
+		++round;
+
+		if (fixed_point || oscillation) {
+			stop_reason = (fixed_point ? StopReason::FixedPoint : StopReason::Oscillation);
+			break;
+		}
+	}
+
+	auto volumes = toVolumes(totals.blue_volume);
+	if (stop_reason == StopReason::MaxRounds &&
+	    *std::max_element(volumes.begin(), volumes.end()) >= win_threshold) {
+		stop_reason = StopReason::WinThreshold;
+	}
+	if (progress) {
+		progress->setRound(round, volumes);
+		progress->endTrial();
+	}
+
+	auto winning_color = Color::None;
+	for (auto color: COLORS) {
+		if (volumes[static_cast<std::size_t>(color)] >= win_threshold) {
+			winning_color = color;
+			break;
+		}
+	}
+
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	std::vector<float> fractions(COLORS.size());
+	fractions[static_cast<std::size_t>(Color::Red)] = (float)(number_of_nodes - totals.blue_count)/number_of_nodes;
+	fractions[static_cast<std::size_t>(Color::Blue)] = (float)totals.blue_count/number_of_nodes;
+
+	return Result{
+		graph.getFilename(),
+		winning_color,
+		fractions,
+		volumes,
+		round,
+		stop_reason
+	};
+}
+
+void PartitionedSimulation::setSeed(std::uint64_t new_seed)
+{
+	seed = new_seed;
+}
+
+std::uint64_t PartitionedSimulation::getSeed() const
+{
+	return seed;
+}
+
+auto PartitionedSimulation::getRange() const -> NodeRange
+{
+	return {first, last};
+}
+
+std::vector<float> PartitionedSimulation::getColorVolumes()
+{
+	Totals own{0, 0, 0, 0};
+	for (auto node_id = first; node_id < last; ++node_id) {
+		if (initial_colors[node_id - first] == Color::Blue) {
+			own.blue_volume += graph.degree(node_id);
+		}
+	}
+
+	return toVolumes(reduce(own).blue_volume);
+}
+
+auto PartitionedSimulation::reduce(Totals const& own) -> Totals
+{
+	// every worker gets the values of all and combines them in the same order
+	auto incoming = transport.exchange(std::vector<Transport::Message>(
+		transport.getNumberOfWorkers(), toMessage(&own, 1)));
+
+	Totals totals{0, 0, 0, 0};
+	for (auto const& message: incoming) {
+		auto const values = fromMessage<Totals>(message);
+		if (values.size() != 1) {
+			Error("A worker sent malformed totals");
+		}
+		totals.number_of_flips += values[0].number_of_flips;
+		totals.hash_change ^= values[0].hash_change;
+		totals.blue_count += values[0].blue_count;
+		totals.blue_volume += values[0].blue_volume;
+	}
+
+	return totals;
+}
+
+bool PartitionedSimulation::reduceAll(bool own)
+{
+	char const value = own;
+	auto incoming = transport.exchange(std::vector<Transport::Message>(
+		transport.getNumberOfWorkers(), toMessage(&value, 1)));
+
+	return std::all_of(incoming.begin(), incoming.end(), [](Transport::Message const& message) {
+		return message.size() == 1 && message[0] != 0;
+	});
+}
+
+std::size_t PartitionedSimulation::getSamplesPerNode() const
+{
+	return (type == DynamicsType::VoterModel ? 1 : 2);
+}
+
+std::size_t PartitionedSimulation::getOwner(Graph::NodeID node_id) const
+{
+	// the last worker whose range begins at or before the node; workers with
+	// empty ranges before it are skipped that way
+	return std::upper_bound(range_begins.begin(), range_begins.end() - 1, node_id) -
+	       range_begins.begin() - 1;
+}
+
+std::size_t PartitionedSimulation::getLocalIndex(Graph::NodeID node_id) const
+{
+	if (node_id >= first && node_id < last) {
+		return node_id - first;
+	}
+
+	auto ghost = std::lower_bound(ghosts.begin(), ghosts.end(), node_id);
+	return (last - first) + (ghost - ghosts.begin());
+}
+
+void PartitionedSimulation::distributeInitialColoring(Coloring const* initial_coloring)
+{
+	auto const number_of_workers = transport.getNumberOfWorkers();
+
+	std::vector<Transport::Message> outgoing(number_of_workers);
+	if (transport.getRank() == 0) {
+		for (std::size_t worker = 0; worker < number_of_workers; ++worker) {
+			outgoing[worker] = toMessage(initial_coloring->data() + range_begins[worker],
+			                             range_begins[worker + 1] - range_begins[worker]);
+		}
+	}
+	auto incoming = transport.exchange(std::move(outgoing));
+
+	initial_colors = fromMessage<Color>(incoming[0]);
+	if (initial_colors.size() != last - first) {
+		Error("Worker 0 sent " << initial_colors.size() << " initial colors for the "
+		      << last - first << " nodes of worker " << transport.getRank());
+	}
+}
+
+void PartitionedSimulation::fetchColors(std::vector<std::size_t> const& ghost_indices,
+                                        Coloring& coloring)
+{
+	auto const number_of_workers = transport.getNumberOfWorkers();
+	auto const number_of_own_nodes = last - first;
+
+	// the ghost nodes are sorted, so the ones of every owner are contiguous
+	std::vector<std::vector<Graph::NodeID>> requests(number_of_workers);
+	std::vector<std::size_t> request_begins(number_of_workers + 1, 0);
+	for (auto index: ghost_indices) {
+		++request_begins[getOwner(ghosts[index]) + 1];
+	}
+	for (std::size_t worker = 0; worker < number_of_workers; ++worker) {
+		request_begins[worker + 1] += request_begins[worker];
+	}
+
+	std::vector<Transport::Message> outgoing(number_of_workers);
+	for (std::size_t worker = 0; worker < number_of_workers; ++worker) {
+		auto& request = requests[worker];
+		for (auto i = request_begins[worker]; i < request_begins[worker + 1]; ++i) {
+			request.push_back(ghosts[ghost_indices[i]]);
+		}
+		outgoing[worker] = toMessage(request.data(), request.size());
+	}
+	auto incoming = transport.exchange(std::move(outgoing));
+
+	// answer the requests of the other workers
+	std::vector<Transport::Message> replies(number_of_workers);
+	for (std::size_t worker = 0; worker < number_of_workers; ++worker) {
+		auto const nodes = fromMessage<Graph::NodeID>(incoming[worker]);
+		auto& reply = replies[worker];
+		reply.resize(nodes.size());
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			if (nodes[i] < first || nodes[i] >= last) {
+				Error("Worker " << worker << " requested the color of node " << nodes[i]
+				      << ", which worker " << transport.getRank() << " doesn't own");
+			}
+			reply[i] = static_cast<char>(coloring.get(nodes[i] - first));
+		}
+	}
+	auto answers = transport.exchange(std::move(replies));
+
+	for (std::size_t worker = 0; worker < number_of_workers; ++worker) {
+		auto const begin = request_begins[worker];
+		auto const count = request_begins[worker + 1] - begin;
+		if (answers[worker].size() != count) {
+			Error("Worker " << worker << " answered " << answers[worker].size() << " of "
+			      << count << " requested colors");
+		}
+		for (std::size_t i = 0; i < count; ++i) {
+			coloring.setUncounted(number_of_own_nodes + ghost_indices[begin + i],
+			                      static_cast<Color>(answers[worker][i]));
+		}
+	}
+}
+
+bool PartitionedSimulation::isDeterministicRound(Coloring& from_coloring,
+                                                 Coloring const& to_coloring)
+{
+	std::vector<std::size_t> all_ghosts(ghosts.size());
+	for (std::size_t i = 0; i < all_ghosts.size(); ++i) { all_ghosts[i] = i; }
+	fetchColors(all_ghosts, from_coloring);
+
+	bool deterministic = true;
+	for (auto node_id = first; node_id < last && deterministic; ++node_id) {
+		auto color = to_coloring.get(node_id - first);
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (from_coloring.get(getLocalIndex(neighbor)) != color) {
+				deterministic = false;
+				break;
+			}
+		}
+	}
+
+	return reduceAll(deterministic);
+}
+
+std::vector<float> PartitionedSimulation::toVolumes(std::uint64_t blue_volume) const
+{
+	// the same operations as in Simulation::getColorVolumes, so the volumes
+	// are identical
+	std::vector<double> counts(COLORS.size());
+	counts[static_cast<std::size_t>(Color::Red)] = graph.getTotalVolume() - blue_volume;
+	counts[static_cast<std::size_t>(Color::Blue)] = blue_volume;
+
+	std::vector<float> volume(COLORS.size());
+	for (std::size_t i = 0; i < volume.size(); ++i) {
+		volume[i] = counts[i]/graph.getTotalVolume();
+	}
+
+	return volume;
+}
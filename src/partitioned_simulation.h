@@ -0,0 +1,102 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "graph.h"
+#include "transport.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//
+// PartitionedSimulation
+//
+// A simulation run by all workers of a transport together, e.g., by processes
+// on several machines for graphs that don't fit into the memory of one. The
+// nodes are split into contiguous ranges of about the same number of nodes
+// plus edges and every worker updates the nodes of its range. Before a round,
+// a worker requests the colors of the sampled neighbors outside of its range
+// (the ghost nodes) from their owners; the flips, the color counts, the blue
+// volume and the hash change are then reduced over all workers, so every
+// worker decides the win threshold and the stop of the trial alike.
+//
+// A worker only visits the nodes of its range and their edges, so with a
+// binary graph file only its part of the CSR arrays (and the few offsets
+// read to split the ranges) is loaded from the mapped file. Its colorings
+// only hold its range followed by the ghost nodes, which are all neighbors
+// outside of the range in the order of their IDs. The initial coloring is
+// only needed on worker 0, which sends every worker its range. The samples
+// are drawn like by all round kernels, so a trial gives the same result as
+// with Simulation for the same seed and trial, for any number of workers.
+// Only unweighted graphs are supported, because the weighted volumes would
+// be summed in a different order.
+//
+
+class PartitionedSimulation
+{
+public:
+	using NodeRange = std::pair<Graph::NodeID, Graph::NodeID>;
+
+	// Has to be called by all workers at once with the same graph. The
+	// initial coloring of the whole graph is only read on worker 0, the
+	// others can pass nullptr.
+	PartitionedSimulation(Graph const& graph, DynamicsType dynamics_type,
+	                      Coloring const* initial_coloring, Transport& transport);
+
+	// Has to be called by all workers at once, which get the same result.
+	Result run(std::int64_t max_rounds, float win_threshold, std::size_t trial = 0);
+	void setSeed(std::uint64_t seed);
+	std::uint64_t getSeed() const;
+
+	NodeRange getRange() const;
+	// the volumes of the initial coloring, which needs an exchange as well
+	std::vector<float> getColorVolumes();
+
+private:
+	Graph const& graph;
+	DynamicsType const type;
+	Transport& transport;
+	std::uint64_t seed = 0;
+
+	// the first node of every worker and the number of nodes at the end
+	std::vector<Graph::NodeID> range_begins;
+	Graph::NodeID first;
+	Graph::NodeID last;
+	// sorted, so the ones of every owner are contiguous
+	std::vector<Graph::NodeID> ghosts;
+
+	// the initial colors of the own range
+	std::vector<Color> initial_colors;
+	// The own range at local indices 0, ..., last-first-1, followed by the
+	// ghost nodes. Only the ghost nodes fetched in a round are valid.
+	Coloring current_coloring;
+	Coloring next_coloring;
+	// the local indices of the sampled neighbors of the own nodes in the
+	// current round
+	std::vector<std::size_t> samples;
+
+	// sums over all workers; the hash changes are combined by XOR
+	struct Totals
+	{
+		std::uint64_t number_of_flips;
+		std::uint64_t hash_change;
+		std::uint64_t blue_count;
+		std::uint64_t blue_volume;
+	};
+	Totals reduce(Totals const& own);
+	bool reduceAll(bool own);
+
+	std::size_t getSamplesPerNode() const;
+	std::size_t getOwner(Graph::NodeID node_id) const;
+	// O(log(number of ghost nodes)) for the ghost nodes
+	std::size_t getLocalIndex(Graph::NodeID node_id) const;
+	void distributeInitialColoring(Coloring const* initial_coloring);
+	// Sets the ghost nodes at these sorted indices into ghosts to their colors
+	// in the coloring of their owner.
+	void fetchColors(std::vector<std::size_t> const& ghost_indices, Coloring& coloring);
+	// Like Simulation::isDeterministicRound, over all workers. The colors of
+	// all ghost nodes are fetched into from_coloring.
+	bool isDeterministicRound(Coloring& from_coloring, Coloring const& to_coloring);
+	std::vector<float> toVolumes(std::uint64_t blue_volume) const;
+};
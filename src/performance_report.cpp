@@ -0,0 +1,299 @@
+#include "performance_report.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <numeric>
+
+namespace
+{
+
+PerformanceReport* active_report = nullptr;
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::uint64_t const HARDWARE_EVENTS[] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_REFERENCES,
+	PERF_COUNT_HW_CACHE_MISSES
+};
+
+} // end anonymous
+
+//
+// PerformanceReport::HardwareCounters
+//
+// One counter per event instead of a group, as groups cannot be read when
+// they are inherited by other threads.
+//
+
+class PerformanceReport::HardwareCounters
+{
+public:
+	HardwareCounters()
+	{
+		for (auto event: HARDWARE_EVENTS) {
+			perf_event_attr attributes;
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.config = event;
+			attributes.disabled = 1;
+			attributes.inherit = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+
+			int fd = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+			if (fd == -1) {
+				close();
+				return;
+			}
+			fds.push_back(fd);
+		}
+	}
+	~HardwareCounters() { close(); }
+
+	bool isAvailable() const { return !fds.empty(); }
+	void enable() { for (auto fd: fds) { ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); } }
+	void disable() { for (auto fd: fds) { ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); } }
+
+	CounterValues read() const
+	{
+		CounterValues values;
+		for (auto fd: fds) {
+			std::uint64_t value = 0;
+			if (::read(fd, &value, sizeof(value)) != sizeof(value)) { value = 0; }
+			values.push_back(value);
+		}
+
+		return values;
+	}
+
+private:
+	std::vector<int> fds;
+
+	void close()
+	{
+		for (auto fd: fds) { ::close(fd); }
+		fds.clear();
+	}
+};
+
+//
+// PerformanceReport
+//
+
+PerformanceReport::PerformanceReport(bool hardware_counters)
+{
+	if (hardware_counters) {
+		this->hardware_counters.reset(new HardwareCounters());
+	}
+}
+
+PerformanceReport::~PerformanceReport() = default;
+
+void PerformanceReport::addInfo(std::string const& key, std::string const& value)
+{
+	info.emplace_back(key, value);
+}
+
+void PerformanceReport::addPhase(std::string const& name, double wall_seconds,
+                                 double cpu_seconds, std::size_t peak_resident_bytes)
+{
+	auto phase = std::find_if(phases.begin(), phases.end(),
+	                          [&](Phase const& phase) { return phase.name == name; });
+	if (phase == phases.end()) {
+		phases.push_back({name, 0, 0, 0, 0});
+		phase = phases.end() - 1;
+	}
+
+	++phase->count;
+	phase->wall_seconds += wall_seconds;
+	phase->cpu_seconds += cpu_seconds;
+	phase->peak_resident_bytes = std::max(phase->peak_resident_bytes, peak_resident_bytes);
+}
+
+void PerformanceReport::setMemory(std::size_t peak_resident_bytes,
+                                  std::vector<MemoryMonitor::Structure> const& structures)
+{
+	this->peak_resident_bytes = peak_resident_bytes;
+	this->structures = structures;
+}
+
+void PerformanceReport::beginSimulation(std::size_t trial)
+{
+	simulations.emplace_back();
+	simulations.back().trial = trial;
+	simulation_start = Clock::now();
+	simulation_start_cpu_seconds = getProcessCpuSeconds();
+	if (hardware_counters && hardware_counters->isAvailable()) {
+		counters_at_start = hardware_counters->read();
+	}
+}
+
+void PerformanceReport::beginRound()
+{
+	if (hardware_counters) { hardware_counters->enable(); }
+	round_start = Clock::now();
+}
+
+void PerformanceReport::endRound(std::size_t number_of_flips)
+{
+	auto& simulation = simulations.back();
+	simulation.kernel_seconds += secondsSince(round_start);
+	if (hardware_counters) { hardware_counters->disable(); }
+	simulation.flips_per_round.push_back(number_of_flips);
+}
+
+void PerformanceReport::endSimulation(std::size_t number_of_nodes)
+{
+	auto& simulation = simulations.back();
+	simulation.number_of_nodes = number_of_nodes;
+	simulation.wall_seconds = secondsSince(simulation_start);
+	simulation.cpu_seconds = getProcessCpuSeconds() - simulation_start_cpu_seconds;
+
+	if (hardware_counters && hardware_counters->isAvailable()) {
+		simulation.hardware_counters = hardware_counters->read();
+		for (std::size_t i = 0; i < counters_at_start.size(); ++i) {
+			simulation.hardware_counters[i] -= counters_at_start[i];
+		}
+	}
+}
+
+void PerformanceReport::writeJson(std::ostream& out) const
+{
+	out << "{\n";
+	for (auto const& entry: info) {
+		out << "  \"" << escapeJson(entry.first) << "\": \"" << escapeJson(entry.second) << "\",\n";
+	}
+
+	out << "  \"phases\": [\n";
+	for (std::size_t i = 0; i < phases.size(); ++i) {
+		auto const& phase = phases[i];
+		out << "    {\"name\": \"" << escapeJson(phase.name) << "\", "
+		    << "\"count\": " << phase.count << ", "
+		    << "\"wall_seconds\": " << phase.wall_seconds << ", "
+		    << "\"cpu_seconds\": " << phase.cpu_seconds << ", "
+		    << "\"peak_rss_bytes\": " << phase.peak_resident_bytes << "}"
+		    << (i + 1 < phases.size() ? "," : "") << "\n";
+	}
+	out << "  ],\n";
+
+	out << "  \"memory\": {\"budget_bytes\": " << getMemoryBudget() << ", "
+	    << "\"peak_rss_bytes\": " << peak_resident_bytes << ", \"structures\": [\n";
+	for (std::size_t i = 0; i < structures.size(); ++i) {
+		auto const& structure = structures[i];
+		out << "    {\"stage\": \"" << escapeJson(structure.stage) << "\", "
+		    << "\"name\": \"" << escapeJson(structure.name) << "\", "
+		    << "\"bytes\": " << structure.bytes << "}"
+		    << (i + 1 < structures.size() ? "," : "") << "\n";
+	}
+	out << "  ]},\n";
+
+	out << "  \"simulations\": [\n";
+	for (std::size_t i = 0; i < simulations.size(); ++i) {
+		auto const& simulation = simulations[i];
+		auto const rounds = simulation.flips_per_round.size();
+		auto const flips = std::accumulate(simulation.flips_per_round.begin(),
+		                                   simulation.flips_per_round.end(), std::size_t(0));
+		auto const node_updates = static_cast<double>(rounds)*simulation.number_of_nodes;
+
+		out << "    {\"trial\": " << simulation.trial << ", "
+		    << "\"rounds\": " << rounds << ", "
+		    << "\"wall_seconds\": " << simulation.wall_seconds << ", "
+		    << "\"cpu_seconds\": " << simulation.cpu_seconds << ", "
+		    << "\"kernel_seconds\": " << simulation.kernel_seconds << ", "
+		    << "\"rounds_per_second\": "
+		    << (simulation.wall_seconds > 0 ? rounds/simulation.wall_seconds : 0) << ", "
+		    << "\"node_updates_per_second\": "
+		    << (simulation.kernel_seconds > 0 ? node_updates/simulation.kernel_seconds : 0) << ", "
+		    << "\"mean_flips_per_round\": "
+		    << (rounds > 0 ? static_cast<double>(flips)/rounds : 0) << ",\n";
+
+		out << "     \"hardware_counters\": ";
+		auto const& counters = simulation.hardware_counters;
+		if (counters.empty()) {
+			out << "null";
+		}
+		else {
+			out << "{\"cycles\": " << counters[0] << ", "
+			    << "\"instructions\": " << counters[1] << ", "
+			    << "\"ipc\": " << (counters[0] > 0 ? static_cast<double>(counters[1])/counters[0] : 0) << ", "
+			    << "\"cache_references\": " << counters[2] << ", "
+			    << "\"cache_misses\": " << counters[3] << "}";
+		}
+		out << ",\n";
+
+		out << "     \"flips_per_round\": [";
+		for (std::size_t round = 0; round < rounds; ++round) {
+			out << (round > 0 ? ", " : "") << simulation.flips_per_round[round];
+		}
+		out << "]}" << (i + 1 < simulations.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+PerformanceReport* getActiveReport()
+{
+	return active_report;
+}
+
+void setActiveReport(PerformanceReport* report)
+{
+	active_report = report;
+}
+
+double getProcessCpuSeconds()
+{
+	timespec time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+	return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+//
+// ScopedPhase
+//
+
+ScopedPhase::ScopedPhase(char const* name)
+	: report(getActiveReport()), monitor(getActiveMemoryMonitor()), name(name),
+	  previous_stage(setMemoryStage(name))
+{
+	if (monitor) {
+		outer_stage = monitor->beginStage(name);
+	}
+	if (report) {
+		start = std::chrono::steady_clock::now();
+		start_cpu_seconds = getProcessCpuSeconds();
+	}
+}
+
+ScopedPhase::~ScopedPhase()
+{
+	auto const peak_resident_bytes = (monitor ? monitor->endStage(outer_stage) : 0);
+	if (report) {
+		report->addPhase(name, secondsSince(start), getProcessCpuSeconds() - start_cpu_seconds,
+		                 peak_resident_bytes);
+	}
+	setMemoryStage(previous_stage);
+}
+
+std::string escapeJson(std::string const& string)
+{
+	std::string escaped;
+	for (auto c: string) {
+		if (c == '"' || c == '\\') { escaped += '\\'; }
+		escaped += c;
+	}
+
+	return escaped;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "memory_accounting.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// PerformanceReport
+//
+// Wall and CPU time and peak RSS of the phases of an experiment (parsing,
+// component reduction, CSR build, core extraction, output), the sizes of the
+// major data structures (see memory_accounting.h) and the counters of every
+// simulation in it: the time and the number of flips of every round and,
+// optionally, hardware counters of the round kernel read via perf_event_open.
+// The report is written as JSON.
+//
+// The phases are timed with ScopedPhase wherever they happen, e.g., inside
+// Graph, and are recorded in the active report. Without an active report,
+// every instrumentation point only costs a null pointer check; a ScopedPhase
+// also sets the memory stage of its thread.
+//
+
+class PerformanceReport
+{
+public:
+	// If hardware counters are requested but not available (e.g., because of
+	// perf_event_paranoid or in a virtual machine), they are reported as null.
+	// They are opened with inherit, so they cover all threads that are created
+	// after the report, e.g., the workers of the simulation.
+	explicit PerformanceReport(bool hardware_counters = false);
+	~PerformanceReport();
+
+	// information written at the top of the report, like the graph file
+	void addInfo(std::string const& key, std::string const& value);
+	// Phases with the same name are accumulated; the peak is the maximum.
+	void addPhase(std::string const& name, double wall_seconds, double cpu_seconds,
+	              std::size_t peak_resident_bytes);
+	void setMemory(std::size_t peak_resident_bytes,
+	               std::vector<MemoryMonitor::Structure> const& structures);
+
+	void beginSimulation(std::size_t trial);
+	void beginRound();
+	void endRound(std::size_t number_of_flips);
+	void endSimulation(std::size_t number_of_nodes);
+
+	void writeJson(std::ostream& out) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+	class HardwareCounters;
+
+	struct Phase
+	{
+		std::string name;
+		std::size_t count;
+		double wall_seconds;
+		double cpu_seconds;
+		std::size_t peak_resident_bytes;
+	};
+
+	// cycles, instructions, cache references and cache misses
+	using CounterValues = std::vector<std::uint64_t>;
+
+	struct SimulationCounters
+	{
+		std::size_t trial;
+		std::size_t number_of_nodes = 0;
+		double wall_seconds = 0;
+		double cpu_seconds = 0;
+		// time spent in the round kernel only
+		double kernel_seconds = 0;
+		std::vector<std::size_t> flips_per_round;
+		CounterValues hardware_counters;
+	};
+
+	std::vector<std::pair<std::string, std::string>> info;
+	std::vector<Phase> phases;
+	std::size_t peak_resident_bytes = 0;
+	std::vector<MemoryMonitor::Structure> structures;
+	std::vector<SimulationCounters> simulations;
+	std::unique_ptr<HardwareCounters> hardware_counters;
+
+	// state of the running simulation and round
+	Clock::time_point simulation_start;
+	double simulation_start_cpu_seconds = 0;
+	Clock::time_point round_start;
+	CounterValues counters_at_start;
+};
+
+// the report that ScopedPhase and Simulation record into; nullptr disables them
+PerformanceReport* getActiveReport();
+void setActiveReport(PerformanceReport* report);
+
+// CPU time of all threads of the process
+double getProcessCpuSeconds();
+
+// Records the time from its construction to its destruction as a phase of
+// the active report, if there is one, together with the peak RSS measured by
+// the active memory monitor. The phase is also the stage of the thread for
+// memory errors, so besides the null pointer checks it sets a thread-local
+// pointer. Nested phases keep the peak of the outer one.
+class ScopedPhase
+{
+public:
+	explicit ScopedPhase(char const* name);
+	~ScopedPhase();
+
+	ScopedPhase(ScopedPhase const&) = delete;
+	ScopedPhase& operator=(ScopedPhase const&) = delete;
+
+private:
+	PerformanceReport* const report;
+	MemoryMonitor* const monitor;
+	char const* const name;
+	char const* const previous_stage;
+	MemoryMonitor::OuterStage outer_stage{nullptr, 0};
+	std::chrono::steady_clock::time_point start;
+	double start_cpu_seconds = 0;
+};
+
+std::string escapeJson(std::string const& string);
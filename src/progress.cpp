@@ -0,0 +1,237 @@
+#include "progress.h"
+
+#include "defs.h"
+#include "performance_report.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2,
+              "The progress counters have to be lock-free.");
+
+namespace
+{
+
+std::atomic<ProgressMonitor*> active_monitor(nullptr);
+
+} // end anonymous
+
+ProgressMonitor::ProgressMonitor(std::string const& filename, double interval_seconds)
+	: filename(filename), interval_seconds(interval_seconds), start(Clock::now()),
+	experiment_id(0), number_of_experiments(0), number_of_trials(0), max_rounds(0),
+	trial(0), round(0), trial_running(false), finished_rounds(0), finished_trials(0),
+	finished_trials_nanoseconds(0), trial_start_nanoseconds(0), number_of_colors(0),
+	volumes(new std::atomic<std::uint32_t>[MAX_NUMBER_OF_COLORS])
+{
+	for (std::size_t i = 0; i < MAX_NUMBER_OF_COLORS; ++i) {
+		volumes[i] = 0;
+	}
+
+	// a wrong path ends the run right away, later failures only skip updates
+	if (!write(false)) {
+		Error("The progress file couldn't be written. Filename: " + filename);
+	}
+	thread = std::thread(&ProgressMonitor::work, this);
+}
+
+ProgressMonitor::~ProgressMonitor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	stop_condition.notify_one();
+	thread.join();
+
+	write(true);
+}
+
+void ProgressMonitor::beginExperiment(std::size_t id, std::size_t number_of_experiments,
+                                      std::string const& graph_file,
+                                      std::size_t number_of_trials)
+{
+	{
+		std::lock_guard<std::mutex> lock(status_mutex);
+		this->graph_file = graph_file;
+	}
+
+	auto const relaxed = std::memory_order_relaxed;
+	experiment_id.store(id, relaxed);
+	this->number_of_experiments.store(number_of_experiments, relaxed);
+	this->number_of_trials.store(number_of_trials, relaxed);
+	max_rounds.store(0, relaxed);
+	trial.store(0, relaxed);
+	round.store(0, relaxed);
+	number_of_colors.store(0, relaxed);
+	finished_trials.store(0, relaxed);
+	finished_trials_nanoseconds.store(0, relaxed);
+}
+
+void ProgressMonitor::beginTrial(std::size_t trial, std::size_t max_rounds)
+{
+	auto const relaxed = std::memory_order_relaxed;
+	this->trial.store(trial, relaxed);
+	this->max_rounds.store(max_rounds, relaxed);
+	round.store(0, relaxed);
+	trial_start_nanoseconds.store(getNanoseconds(), relaxed);
+	trial_running.store(true, relaxed);
+}
+
+void ProgressMonitor::setRound(std::size_t round, std::vector<float> const& volumes)
+{
+	auto const relaxed = std::memory_order_relaxed;
+	auto const count = std::min(volumes.size(), MAX_NUMBER_OF_COLORS);
+	for (std::size_t i = 0; i < count; ++i) {
+		std::uint32_t bits;
+		std::memcpy(&bits, &volumes[i], sizeof(bits));
+		this->volumes[i].store(bits, relaxed);
+	}
+	number_of_colors.store(count, relaxed);
+	this->round.store(round, relaxed);
+}
+
+void ProgressMonitor::endTrial()
+{
+	auto const relaxed = std::memory_order_relaxed;
+	finished_rounds.fetch_add(round.load(relaxed), relaxed);
+	round.store(0, relaxed);
+	finished_trials_nanoseconds.fetch_add(getNanoseconds() - trial_start_nanoseconds.load(relaxed),
+	                                      relaxed);
+	finished_trials.fetch_add(1, relaxed);
+	trial_running.store(false, relaxed);
+}
+
+void ProgressMonitor::writeJson(std::ostream& out, bool done)
+{
+	auto const relaxed = std::memory_order_relaxed;
+	auto const seconds = getNanoseconds()*1e-9;
+	auto const trial = this->trial.load(relaxed);
+	auto const round = this->round.load(relaxed);
+	auto const number_of_trials = this->number_of_trials.load(relaxed);
+	auto const max_rounds = this->max_rounds.load(relaxed);
+	auto const finished_trials = this->finished_trials.load(relaxed);
+	auto const trial_running = this->trial_running.load(relaxed);
+	auto const total_rounds = finished_rounds.load(relaxed) + round;
+
+	std::lock_guard<std::mutex> lock(status_mutex);
+	if (seconds > last_seconds) {
+		rounds_per_second = (total_rounds - last_rounds)/(seconds - last_seconds);
+	}
+	last_rounds = total_rounds;
+	last_seconds = seconds;
+
+	// The remaining time of the experiment is estimated from the average
+	// duration of its finished trials. Before the first one finished, the
+	// trials are assumed to take max_rounds rounds at the current rate,
+	// which is an upper bound unless a trial ends early.
+	auto const remaining_trials = (trial + 1 < number_of_trials ? number_of_trials - trial - 1 : 0);
+	double eta_seconds = -1;
+	std::string eta_basis = "none";
+	if (finished_trials > 0) {
+		auto const trial_seconds = finished_trials_nanoseconds.load(relaxed)*1e-9/finished_trials;
+		auto const current_seconds = seconds - trial_start_nanoseconds.load(relaxed)*1e-9;
+		eta_seconds = (trial_running ? std::max(0., trial_seconds - current_seconds) : 0.) +
+		              remaining_trials*trial_seconds;
+		eta_basis = "finished_trials";
+	}
+	else if (rounds_per_second > 0 && max_rounds > 0) {
+		auto const remaining_rounds = (trial_running && max_rounds > round ? max_rounds - round : 0) +
+		                              remaining_trials*max_rounds;
+		eta_seconds = remaining_rounds/rounds_per_second;
+		eta_basis = "max_rounds";
+	}
+
+	out << "{\n";
+	out << "  \"state\": \"" << (done ? "done" : "running") << "\",\n";
+	out << "  \"elapsed_seconds\": " << seconds << ",\n";
+	out << "  \"experiment\": " << experiment_id.load(relaxed) << ",\n";
+	out << "  \"number_of_experiments\": " << number_of_experiments.load(relaxed) << ",\n";
+	out << "  \"graph_file\": \"" << escapeJson(graph_file) << "\",\n";
+	out << "  \"trial\": " << trial << ",\n";
+	out << "  \"number_of_trials\": " << number_of_trials << ",\n";
+	out << "  \"round\": " << round << ",\n";
+	out << "  \"max_rounds\": " << max_rounds << ",\n";
+	out << "  \"volumes\": [";
+	auto const number_of_colors = this->number_of_colors.load(relaxed);
+	for (std::size_t i = 0; i < number_of_colors; ++i) {
+		auto const bits = volumes[i].load(relaxed);
+		float volume;
+		std::memcpy(&volume, &bits, sizeof(volume));
+		out << (i == 0 ? "" : ", ") << volume;
+	}
+	out << "],\n";
+	out << "  \"total_rounds\": " << total_rounds << ",\n";
+	out << "  \"rounds_per_second\": " << rounds_per_second << ",\n";
+	if (eta_seconds < 0) {
+		out << "  \"eta_seconds\": null,\n";
+	}
+	else {
+		out << "  \"eta_seconds\": " << eta_seconds << ",\n";
+	}
+	out << "  \"eta_basis\": \"" << eta_basis << "\"\n";
+	out << "}\n";
+}
+
+std::int64_t ProgressMonitor::getNanoseconds() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+void ProgressMonitor::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto const interval = std::chrono::duration<double>(interval_seconds);
+	while (!stop_condition.wait_for(lock, interval, [&]() { return stopping; })) {
+		lock.unlock();
+		write(false);
+		lock.lock();
+	}
+}
+
+bool ProgressMonitor::write(bool done)
+{
+	// written next to the file and renamed over it, which is atomic
+	auto const temporary_filename = filename + ".tmp";
+	{
+		std::ofstream file(temporary_filename);
+		if (!file.is_open()) {
+			return skipWrite("The progress file couldn't be opened. Filename: " + temporary_filename);
+		}
+		writeJson(file, done);
+		file.flush();
+		if (!file) {
+			std::remove(temporary_filename.c_str());
+			return skipWrite("The progress file couldn't be written. Filename: " + temporary_filename);
+		}
+	}
+	if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+		std::remove(temporary_filename.c_str());
+		return skipWrite("The progress file couldn't be replaced. Filename: " + filename);
+	}
+
+	write_failed = false;
+	return true;
+}
+
+bool ProgressMonitor::skipWrite(std::string const& message)
+{
+	// only the first failure in a row is logged, not one per interval
+	if (!write_failed) {
+		std::cerr << "Warning: " << message << " The update is skipped." << std::endl;
+	}
+	write_failed = true;
+	return false;
+}
+
+ProgressMonitor* getActiveProgressMonitor()
+{
+	return active_monitor;
+}
+
+void setActiveProgressMonitor(ProgressMonitor* monitor)
+{
+	active_monitor = monitor;
+}
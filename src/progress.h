@@ -0,0 +1,103 @@
+#pragma once
+
+#include "basic_types.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// ProgressMonitor
+//
+// Live status of a run of an experiments file for operators: a thread
+// rewrites a small JSON file every interval with the current experiment,
+// trial and round, the current color volumes, the rounds per second and an
+// estimate of the remaining time of the experiment. The file is replaced
+// atomically, so readers never see a partial file. If the file can't be
+// written during the run, the update is skipped with a warning.
+//
+// The simulation publishes its state between two rounds with relaxed stores
+// to lock-free atomics; the round kernel itself is not instrumented. Like
+// the performance report, every instrumentation point only costs a null
+// pointer check without an active monitor.
+//
+
+class ProgressMonitor
+{
+public:
+	ProgressMonitor(std::string const& filename, double interval_seconds = 1);
+	~ProgressMonitor();
+
+	ProgressMonitor(ProgressMonitor const&) = delete;
+	ProgressMonitor& operator=(ProgressMonitor const&) = delete;
+
+	// The trials of the experiment are numbered from 0 to number_of_trials-1.
+	void beginExperiment(std::size_t id, std::size_t number_of_experiments,
+	                     std::string const& graph_file, std::size_t number_of_trials);
+	void beginTrial(std::size_t trial, std::size_t max_rounds);
+	// the number of rounds of the trial so far and the volumes after them
+	void setRound(std::size_t round, std::vector<float> const& volumes);
+	void endTrial();
+
+	// The status as written to the file; "done" is only written by the
+	// destructor.
+	void writeJson(std::ostream& out, bool done = false);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::string const filename;
+	double const interval_seconds;
+	Clock::time_point const start;
+
+	// guards the graph file, which only changes at the begin of an
+	// experiment, and the rate since the last write
+	std::mutex status_mutex;
+	std::string graph_file;
+	std::uint64_t last_rounds = 0;
+	double last_seconds = 0;
+	double rounds_per_second = 0;
+
+	std::atomic<std::uint64_t> experiment_id;
+	std::atomic<std::uint64_t> number_of_experiments;
+	std::atomic<std::uint64_t> number_of_trials;
+	std::atomic<std::uint64_t> max_rounds;
+	std::atomic<std::uint64_t> trial;
+	std::atomic<std::uint64_t> round;
+	std::atomic<bool> trial_running;
+	// rounds of the finished trials of the run
+	std::atomic<std::uint64_t> finished_rounds;
+	// finished trials of the experiment and their total duration
+	std::atomic<std::uint64_t> finished_trials;
+	std::atomic<std::int64_t> finished_trials_nanoseconds;
+	std::atomic<std::int64_t> trial_start_nanoseconds;
+	// the volumes as the bits of floats
+	std::atomic<std::uint64_t> number_of_colors;
+	std::unique_ptr<std::atomic<std::uint32_t>[]> volumes;
+
+	std::mutex mutex;
+	std::condition_variable stop_condition;
+	bool stopping = false;
+	std::thread thread;
+	// whether the last write failed; only used by one thread at a time
+	bool write_failed = false;
+
+	std::int64_t getNanoseconds() const;
+	void work();
+	// Writes the file and returns whether it succeeded. A failure is logged
+	// and the update skipped, since the run shouldn't end because of a
+	// temporary problem with the progress file.
+	bool write(bool done);
+	bool skipWrite(std::string const& message);
+};
+
+// the monitor that experiments and simulations report to; nullptr disables it
+ProgressMonitor* getActiveProgressMonitor();
+void setActiveProgressMonitor(ProgressMonitor* monitor);
@@ -1,5 +1,6 @@
 #include "random.h"
 
+#include <algorithm>
 #include <chrono>
 
 Random::Random()
@@ -30,3 +31,69 @@ bool Random::throwCoin()
 	std::bernoulli_distribution distribution(0.5);
 	return distribution(generator);
 }
+
+double Random::getDouble()
+{
+	std::uniform_real_distribution<double> distribution(0., 1.);
+	return distribution(generator);
+}
+
+//
+// CounterRandom
+//
+
+std::size_t const CounterRandom::NUMBER_OF_ROUNDS;
+
+void CounterRandom::generateFirstBlocks(std::uint64_t key, std::uint64_t round,
+                                        std::uint64_t first_node, std::size_t count,
+                                        Block* blocks)
+{
+	generateFirstBlocks(key, round, count, blocks, [&](std::size_t i) { return first_node + i; });
+}
+
+void CounterRandom::generateFirstBlocks(std::uint64_t key, std::uint64_t round,
+                                        std::size_t const* nodes, std::size_t count,
+                                        Block* blocks)
+{
+	generateFirstBlocks(key, round, count, blocks, [&](std::size_t i) { return nodes[i]; });
+}
+
+template <typename GetNode>
+void CounterRandom::generateFirstBlocks(std::uint64_t key, std::uint64_t round, std::size_t count,
+                                        Block* blocks, GetNode getNode)
+{
+	// The same rounds as in philox, but on structures of arrays so that the
+	// multiplications of different nodes are independent.
+	std::size_t const CHUNK_SIZE = 64;
+	std::uint32_t x0[CHUNK_SIZE], x1[CHUNK_SIZE], x2[CHUNK_SIZE], x3[CHUNK_SIZE];
+
+	for (std::size_t first = 0; first < count; first += CHUNK_SIZE) {
+		auto const chunk_size = std::min(CHUNK_SIZE, count - first);
+		for (std::size_t i = 0; i < chunk_size; ++i) {
+			auto const node = getNode(first + i);
+			x0[i] = static_cast<std::uint32_t>(node);
+			x1[i] = static_cast<std::uint32_t>(node >> 32);
+			x2[i] = static_cast<std::uint32_t>(round);
+			x3[i] = 0;
+		}
+
+		auto key0 = static_cast<std::uint32_t>(key);
+		auto key1 = static_cast<std::uint32_t>(key >> 32);
+		for (std::size_t r = 0; r < NUMBER_OF_ROUNDS; ++r) {
+			for (std::size_t i = 0; i < chunk_size; ++i) {
+				auto const product0 = std::uint64_t(0xD2511F53)*x0[i];
+				auto const product1 = std::uint64_t(0xCD9E8D57)*x2[i];
+				x0[i] = static_cast<std::uint32_t>(product1 >> 32) ^ x1[i] ^ key0;
+				x1[i] = static_cast<std::uint32_t>(product1);
+				x2[i] = static_cast<std::uint32_t>(product0 >> 32) ^ x3[i] ^ key1;
+				x3[i] = static_cast<std::uint32_t>(product0);
+			}
+			key0 += 0x9E3779B9;
+			key1 += 0xBB67AE85;
+		}
+
+		for (std::size_t i = 0; i < chunk_size; ++i) {
+			blocks[first + i] = {{x0[i], x1[i], x2[i], x3[i]}};
+		}
+	}
+}
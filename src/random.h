@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <random>
 
 class Random
@@ -12,8 +14,149 @@ public:
 
 	std::size_t getSizeT(std::size_t first, std::size_t last);
 	bool throwCoin();
+	// uniform in [0, 1)
+	double getDouble();
 
 private:
 	unsigned int seed;
 	std::default_random_engine generator;
 };
+
+//
+// CounterRandom
+//
+// Counter-based generator (Philox4x32-10): the random numbers of a node in a
+// round are a pure function of (seed, trial, round, node), so every sample can
+// be regenerated independently and the results do not depend on which thread
+// updates which node.
+//
+
+class CounterRandom
+{
+public:
+	using Block = std::array<std::uint32_t, 4>;
+
+	// key of all streams of a trial
+	static std::uint64_t makeKey(std::uint64_t seed, std::uint64_t trial);
+	// First blocks of the streams of count consecutive nodes. The nodes are
+	// processed side by side, which is much faster than one after the other.
+	static void generateFirstBlocks(std::uint64_t key, std::uint64_t round,
+	                                std::uint64_t first_node, std::size_t count,
+	                                Block* blocks);
+	// the same for the streams of a list of nodes
+	static void generateFirstBlocks(std::uint64_t key, std::uint64_t round,
+	                                std::size_t const* nodes, std::size_t count,
+	                                Block* blocks);
+
+	CounterRandom(std::uint64_t key, std::uint64_t round, std::uint64_t node);
+	// continues a stream whose first block was generated already
+	CounterRandom(std::uint64_t key, std::uint64_t round, std::uint64_t node,
+	              Block const& first_block);
+
+	std::uint32_t get32();
+	std::uint64_t get64();
+
+	// same interface as Random
+	std::size_t getSizeT(std::size_t first, std::size_t last);
+	bool throwCoin();
+	double getDouble();
+
+private:
+	static std::size_t const NUMBER_OF_ROUNDS = 10;
+
+	Block key;
+	Block counter;
+	Block block;
+	std::size_t position;
+
+	static Block philox(Block x, std::uint32_t key0, std::uint32_t key1);
+	// the node of the i-th stream is getNode(i)
+	template <typename GetNode>
+	static void generateFirstBlocks(std::uint64_t key, std::uint64_t round, std::size_t count,
+	                                Block* blocks, GetNode getNode);
+	void generateBlock();
+};
+
+inline std::uint64_t CounterRandom::makeKey(std::uint64_t seed, std::uint64_t trial)
+{
+	// splitmix64 of the seed combined with the trial
+	std::uint64_t z = seed + (trial + 1)*0x9e3779b97f4a7c15ull;
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// The counter is (node, round, block index); rounds beyond 2^32 wrap around.
+inline CounterRandom::CounterRandom(std::uint64_t key, std::uint64_t round, std::uint64_t node)
+	: key{{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32), 0, 0}},
+	  counter{{static_cast<std::uint32_t>(node), static_cast<std::uint32_t>(node >> 32),
+	           static_cast<std::uint32_t>(round), 0}},
+	  block(), position(block.size())
+{
+
+}
+
+inline CounterRandom::CounterRandom(std::uint64_t key, std::uint64_t round, std::uint64_t node,
+                                    Block const& first_block)
+	: CounterRandom(key, round, node)
+{
+	block = first_block;
+	position = 0;
+	counter[3] = 1;
+}
+
+inline auto CounterRandom::philox(Block x, std::uint32_t key0, std::uint32_t key1) -> Block
+{
+	for (std::size_t i = 0; i < NUMBER_OF_ROUNDS; ++i) {
+		auto const product0 = std::uint64_t(0xD2511F53)*x[0];
+		auto const product1 = std::uint64_t(0xCD9E8D57)*x[2];
+		x = {{static_cast<std::uint32_t>(product1 >> 32) ^ x[1] ^ key0,
+		      static_cast<std::uint32_t>(product1),
+		      static_cast<std::uint32_t>(product0 >> 32) ^ x[3] ^ key1,
+		      static_cast<std::uint32_t>(product0)}};
+		key0 += 0x9E3779B9;
+		key1 += 0xBB67AE85;
+	}
+
+	return x;
+}
+
+inline void CounterRandom::generateBlock()
+{
+	block = philox(counter, key[0], key[1]);
+	position = 0;
+	++counter[3];
+}
+
+inline std::uint32_t CounterRandom::get32()
+{
+	if (position == block.size()) { generateBlock(); }
+	return block[position++];
+}
+
+inline std::uint64_t CounterRandom::get64()
+{
+	std::uint64_t low = get32();
+	return low | std::uint64_t(get32()) << 32;
+}
+
+// Lemire's multiply-shift maps 64 random bits to the range; the bias is at
+// most range/2^64.
+inline std::size_t CounterRandom::getSizeT(std::size_t first, std::size_t last)
+{
+	__extension__ using uint128 = unsigned __int128;
+
+	std::uint64_t const range = last - first + 1;
+	if (range == 0) { return first + get64(); }
+	return first + static_cast<std::size_t>((uint128(get64())*range) >> 64);
+}
+
+inline bool CounterRandom::throwCoin()
+{
+	return get32() & 1;
+}
+
+inline double CounterRandom::getDouble()
+{
+	return (get64() >> 11)*(1./9007199254740992.);
+}
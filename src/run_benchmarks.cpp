@@ -0,0 +1,128 @@
+#include "benchmarks.h"
+#include "defs.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef EXP_DATA_DIR
+#define EXP_DATA_DIR "../exp_data"
+#endif
+
+void printUsage();
+void benchmarkGraph(BenchmarkReport& report, std::string const& name,
+                    std::string const& graph_file, std::size_t number_of_rounds,
+                    std::size_t repetitions);
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> graph_files;
+	std::vector<std::size_t> scales;
+	std::size_t average_degree = 16;
+	std::size_t number_of_rounds = 10;
+	std::size_t repetitions = 3;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string argument(argv[i]);
+		if (argument == "--help") {
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+		if (i + 1 >= argc) {
+			printUsage();
+			Error("Missing value for " + argument);
+		}
+
+		if (argument == "--graph") {
+			graph_files.push_back(argv[++i]);
+		}
+		else if (argument == "--nodes") {
+			scales.push_back(std::stoull(argv[++i]));
+		}
+		else if (argument == "--degree") {
+			average_degree = std::stoull(argv[++i]);
+		}
+		else if (argument == "--rounds") {
+			number_of_rounds = std::stoull(argv[++i]);
+		}
+		else if (argument == "--repetitions") {
+			repetitions = std::stoull(argv[++i]);
+		}
+		else {
+			printUsage();
+			Error("Unknown argument " + argument);
+		}
+	}
+
+	if (graph_files.empty() && scales.empty()) {
+		std::string const default_graph_file = EXP_DATA_DIR "/graphs/email-core.txt";
+		if (std::ifstream(default_graph_file).is_open()) {
+			graph_files.push_back(default_graph_file);
+		}
+		else {
+			// stdout only holds the JSON
+			std::cerr << "Skipping email-core, which wasn't found: " << default_graph_file << std::endl;
+		}
+		scales = {1 << 16, 1 << 20};
+	}
+
+	BenchmarkReport report;
+	for (auto const& graph_file: graph_files) {
+		benchmarkGraph(report, graph_file, graph_file, number_of_rounds, repetitions);
+	}
+
+	// the synthetic graphs are written as edge lists, so parsing is measured too
+	for (auto number_of_nodes: scales) {
+		std::stringstream name;
+		name << "random:n=" << number_of_nodes << ":d=" << average_degree;
+
+		char graph_file[] = "/tmp/bench_graph_XXXXXX";
+		int fd = mkstemp(graph_file);
+		if (fd == -1) {
+			Error("The temporary graph file couldn't be created.");
+		}
+		close(fd);
+
+		writeEdgeList(graph_file, createRandomEdges(number_of_nodes, average_degree, 1));
+		benchmarkGraph(report, name.str(), graph_file, number_of_rounds, repetitions);
+		std::remove(graph_file);
+	}
+
+	if (!scales.empty()) {
+		benchmarkHugePages(report, scales.back(), average_degree, number_of_rounds);
+	}
+	report.writeJson(std::cout);
+
+	return EXIT_SUCCESS;
+}
+
+void benchmarkGraph(BenchmarkReport& report, std::string const& name,
+                    std::string const& graph_file, std::size_t number_of_rounds,
+                    std::size_t repetitions)
+{
+	GraphStageBenchmark::run(report, name, graph_file, repetitions);
+
+	Graph graph;
+	graph.buildFromFile(graph_file);
+	benchmarkCorePeriphery(report, name, graph, repetitions);
+	benchmarkRoundKernels(report, name, graph, number_of_rounds);
+	benchmarkMultiColorRounds(report, name, graph, number_of_rounds);
+	benchmarkInstructionSets(report, name, graph, repetitions);
+	benchmarkVolumes(report, name, graph, repetitions);
+	// last, as it changes the graph
+	benchmarkEdgeUpdates(report, name, graph, repetitions);
+}
+
+void printUsage()
+{
+	std::cout << "Usage: ./bench [--graph <file>]... [--nodes <number>]... [--degree <number>]" << std::endl;
+	std::cout << "               [--rounds <number>] [--repetitions <number>] [--help]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Without graphs and node numbers, email-core and random graphs with 2^16 and" << std::endl;
+	std::cout << "2^20 nodes are used." << std::endl;
+}
@@ -0,0 +1,270 @@
+#include "run_ledger.h"
+
+#include "defs.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+
+std::uint64_t const FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+std::uint64_t hashBytes(char const* data, std::size_t size, std::uint64_t hash)
+{
+	for (std::size_t i = 0; i < size; ++i) {
+		hash = (hash ^ static_cast<unsigned char>(data[i]))*1099511628211ull;
+	}
+
+	return hash;
+}
+
+// enough digits to read the same float again
+std::ostream& writeFloats(std::ostream& out, std::vector<float> const& floats)
+{
+	out << floats.size();
+	for (auto value: floats) { out << " " << std::setprecision(9) << value; }
+	return out;
+}
+
+std::istream& readFloats(std::istream& in, std::vector<float>& floats)
+{
+	std::size_t size = 0;
+	if (!(in >> size) || size > MAX_NUMBER_OF_COLORS) {
+		in.setstate(std::ios_base::failbit);
+		return in;
+	}
+	floats.resize(size);
+	for (auto& value: floats) { in >> value; }
+	return in;
+}
+
+// whether all fields were read and nothing follows
+bool isComplete(std::istream& in)
+{
+	return !in.fail() && (in >> std::ws).eof();
+}
+
+} // end anonymous
+
+RunLedger::RunLedger(std::string const& filename)
+	: filename(filename)
+{
+	read();
+
+	file.open(filename, std::ios_base::app);
+	if (!file.is_open()) {
+		Error("The run ledger couldn't be opened. Filename: " + filename);
+	}
+}
+
+std::uint64_t RunLedger::getGraphHash(std::string const& graph_file)
+{
+	if (graph_file.compare(0, 4, "gen:") == 0) {
+		return hashBytes(graph_file.data(), graph_file.size(), FNV_OFFSET_BASIS);
+	}
+
+	struct stat status;
+	if (stat(graph_file.c_str(), &status) != 0) {
+		Error("The graph file couldn't be opened. Filename: " + graph_file);
+	}
+	auto const size = static_cast<std::uint64_t>(status.st_size);
+	auto const modification_time = static_cast<std::int64_t>(status.st_mtim.tv_sec)*1000000000 +
+	                               status.st_mtim.tv_nsec;
+
+	auto it = graph_files.find(graph_file);
+	if (it != graph_files.end() && it->second.size == size &&
+	    it->second.modification_time == modification_time) {
+		return it->second.hash;
+	}
+
+	GraphFile const recorded{size, modification_time, hashFileContent(graph_file)};
+	graph_files[graph_file] = recorded;
+	std::stringstream record;
+	record << "graph " << recorded.hash << " " << size << " " << modification_time << " "
+	       << graph_file;
+	append(record.str());
+
+	return recorded.hash;
+}
+
+bool RunLedger::findSeed(Key key, std::size_t occurrence, std::uint64_t& seed) const
+{
+	auto it = seeds.find({key, occurrence});
+	if (it == seeds.end()) { return false; }
+
+	seed = it->second;
+	return true;
+}
+
+void RunLedger::recordSeed(Key key, std::size_t occurrence, std::uint64_t seed)
+{
+	seeds[{key, occurrence}] = seed;
+	std::stringstream record;
+	record << "seed " << key << " " << occurrence << " " << seed;
+	append(record.str());
+}
+
+bool RunLedger::findSummary(Key key, ExperimentSummary& summary) const
+{
+	auto it = summaries.find(key);
+	if (it == summaries.end()) { return false; }
+
+	summary = it->second;
+	return true;
+}
+
+void RunLedger::recordSummary(Key key, ExperimentSummary const& summary)
+{
+	summaries[key] = summary;
+	std::stringstream record;
+	record << "summary " << key << " " << summary.number_of_nodes << " "
+	       << summary.number_of_edges << " " << summary.weighted << " ";
+	writeFloats(record, summary.initial_fractions) << " ";
+	writeFloats(record, summary.initial_volumes) << " ";
+	record << std::setprecision(9) << summary.dominance << " " << summary.robustness;
+	append(record.str());
+}
+
+bool RunLedger::findResult(Key key, std::size_t trial, Result& result) const
+{
+	auto it = results.find({key, trial});
+	if (it == results.end()) { return false; }
+
+	result = it->second;
+	return true;
+}
+
+void RunLedger::recordResult(Key key, std::size_t trial, Result const& result)
+{
+	auto& recorded = results[{key, trial}];
+	recorded = result;
+	recorded.graph_file.clear();
+
+	std::stringstream record;
+	record << "result " << key << " " << trial << " "
+	       << static_cast<unsigned>(result.winning_color) << " ";
+	writeFloats(record, result.color_fractions) << " ";
+	writeFloats(record, result.color_volumes) << " ";
+	record << result.number_of_rounds << " " << static_cast<unsigned>(result.stop_reason);
+	append(record.str());
+}
+
+void RunLedger::read()
+{
+	std::ifstream in(filename, std::ios_base::binary);
+	if (!in.is_open()) { return; }
+	std::string const content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	std::size_t begin = 0;
+	std::size_t line_number = 1;
+	for (auto end = content.find('\n'); end != std::string::npos; end = content.find('\n', begin)) {
+		if (!readRecord(content.substr(begin, end - begin))) {
+			Error("The run ledger is corrupt in line " << line_number << ". Filename: " << filename);
+		}
+		begin = end + 1;
+		++line_number;
+	}
+
+	// the last record was cut off, so the next one starts on a new line
+	if (begin != content.size() && truncate(filename.c_str(), begin) != 0) {
+		Error("The run ledger couldn't be truncated. Filename: " + filename);
+	}
+}
+
+bool RunLedger::readRecord(std::string const& record)
+{
+	std::stringstream in(record);
+	std::string type;
+	Key key = 0;
+	in >> type;
+
+	if (type == "graph") {
+		GraphFile graph_file;
+		std::string path;
+		in >> graph_file.hash >> graph_file.size >> graph_file.modification_time;
+		if (in.get() != ' ' || !std::getline(in, path) || path.empty()) { return false; }
+		graph_files[path] = graph_file;
+		return true;
+	}
+	if (type == "seed") {
+		std::size_t occurrence = 0;
+		std::uint64_t seed = 0;
+		in >> key >> occurrence >> seed;
+		if (!isComplete(in)) { return false; }
+		seeds[{key, occurrence}] = seed;
+		return true;
+	}
+	if (type == "summary") {
+		ExperimentSummary summary;
+		in >> key >> summary.number_of_nodes >> summary.number_of_edges >> summary.weighted;
+		readFloats(in, summary.initial_fractions);
+		readFloats(in, summary.initial_volumes);
+		in >> summary.dominance >> summary.robustness;
+		if (!isComplete(in)) { return false; }
+		summaries[key] = summary;
+		return true;
+	}
+	if (type == "result") {
+		std::size_t trial = 0;
+		unsigned winning_color = 0, stop_reason = 0;
+		Result result;
+		in >> key >> trial >> winning_color;
+		readFloats(in, result.color_fractions);
+		readFloats(in, result.color_volumes);
+		in >> result.number_of_rounds >> stop_reason;
+		if (!isComplete(in) || winning_color > static_cast<unsigned>(Color::None) ||
+		    stop_reason > static_cast<unsigned>(StopReason::Oscillation)) {
+			return false;
+		}
+		result.winning_color = static_cast<Color>(winning_color);
+		result.stop_reason = static_cast<StopReason>(stop_reason);
+		results[{key, trial}] = result;
+		return true;
+	}
+
+	return false;
+}
+
+void RunLedger::append(std::string const& record)
+{
+	file << record << "\n";
+	file.flush();
+	if (!file) {
+		Error("The run ledger couldn't be written. Filename: " + filename);
+	}
+}
+
+RunLedger::Key getExperimentKey(ExperimentData const& experiment_data, std::uint64_t graph_hash,
+                                bool with_seed)
+{
+	std::stringstream settings;
+	settings << graph_hash << " " << toString(experiment_data.dynamics_type) << " "
+	         << toString(experiment_data.cp_method) << " " << experiment_data.max_rounds << " "
+	         << std::setprecision(9) << experiment_data.win_threshold << " "
+	         << experiment_data.number_of_colors << " " << experiment_data.h << " "
+	         << toString(experiment_data.update_model);
+	if (with_seed) {
+		settings << " " << experiment_data.seed;
+	}
+
+	auto const string = settings.str();
+	return hashBytes(string.data(), string.size(), FNV_OFFSET_BASIS);
+}
+
+std::uint64_t hashFileContent(std::string const& filename)
+{
+	std::ifstream file(filename, std::ios_base::binary);
+
+	auto hash = FNV_OFFSET_BASIS;
+	std::vector<char> buffer(1 << 20);
+	while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+		hash = hashBytes(buffer.data(), file.gcount(), hash);
+	}
+
+	return hash;
+}
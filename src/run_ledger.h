@@ -0,0 +1,99 @@
+#pragma once
+
+#include "basic_types.h"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// ExperimentSummary
+//
+// What a result file reports about the graph and the initial coloring, so it
+// can be written again without building the graph.
+//
+
+struct ExperimentSummary
+{
+	std::size_t number_of_nodes;
+	std::size_t number_of_edges;
+	bool weighted;
+	std::vector<float> initial_fractions;
+	std::vector<float> initial_volumes;
+	float dominance;
+	float robustness;
+};
+
+//
+// RunLedger
+//
+// Record of the finished trials of all runs with the same result files
+// prefix, so a re-run of an edited experiments file only runs the trials that
+// are new or whose experiment changed. Trials are identified by the key of
+// their experiment (see getExperimentKey) and their number. The ledger also
+// keeps the seeds that were drawn for experiments without a seed setting,
+// the summaries for the headers of the result files and the content hashes
+// of the graph files. Every record is a line that is appended and flushed
+// right away; a line cut off by an interruption is dropped when the ledger
+// is read again.
+//
+
+class RunLedger
+{
+public:
+	using Key = std::uint64_t;
+
+	// reads the records of the earlier runs, if there are any
+	explicit RunLedger(std::string const& filename);
+
+	// The content hash of the graph file, or of the name of a generated
+	// graph. It is recorded with the size and modification time of the file,
+	// so an unchanged file is only read once.
+	std::uint64_t getGraphHash(std::string const& graph_file);
+
+	// The seed of the experiment that is the occurrence-th one in its file
+	// with this key (without the seed) and without a seed setting.
+	bool findSeed(Key key, std::size_t occurrence, std::uint64_t& seed) const;
+	void recordSeed(Key key, std::size_t occurrence, std::uint64_t seed);
+	bool findSummary(Key key, ExperimentSummary& summary) const;
+	void recordSummary(Key key, ExperimentSummary const& summary);
+	// The graph file of the result is not recorded.
+	bool findResult(Key key, std::size_t trial, Result& result) const;
+	void recordResult(Key key, std::size_t trial, Result const& result);
+
+private:
+	std::string const filename;
+	std::ofstream file;
+
+	struct GraphFile
+	{
+		std::uint64_t size;
+		std::int64_t modification_time;
+		std::uint64_t hash;
+	};
+	std::unordered_map<std::string, GraphFile> graph_files;
+	std::map<std::pair<Key, std::size_t>, std::uint64_t> seeds;
+	std::unordered_map<Key, ExperimentSummary> summaries;
+	std::map<std::pair<Key, std::size_t>, Result> results;
+
+	void read();
+	// Returns false if the record is incomplete.
+	bool readRecord(std::string const& record);
+	void append(std::string const& record);
+};
+
+// The key of the settings that change the results of an experiment: the
+// content hash of the graph, the dynamics, the core extraction method, the
+// maximum number of rounds, the win threshold, the number of colors, the
+// samples of HMajority, the update model and, if with_seed is true, the
+// seed. Settings that give the same results, like the round kernel or the
+// number of threads, are left out.
+RunLedger::Key getExperimentKey(ExperimentData const& experiment_data, std::uint64_t graph_hash,
+                                bool with_seed = true);
+
+// FNV-1a hash of the file content
+std::uint64_t hashFileContent(std::string const& filename);
@@ -1,4 +1,34 @@
-int main()
+#include "defs.h"
+#include "unit_tests.h"
+
+#include <cstdlib>
+#include <string>
+
+void printUsage();
+
+int main(int argc, char* argv[])
 {
+	UnitTestOptions options;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument(argv[i]);
+		if (argument == "--no-timing") {
+			options.timing = false;
+		}
+		else if (argument[0] != '-' && options.filter.empty()) {
+			options.filter = argument;
+		}
+		else {
+			printUsage();
+			Error("Unknown argument " + argument);
+		}
+	}
 
+	return (runUnitTests(options) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+void printUsage()
+{
+	std::cout << "Usage: ./run_tests [--no-timing] [<filter>]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Only the tests whose names contain the filter are run." << std::endl;
 }
@@ -0,0 +1,484 @@
+#include "server.h"
+
+#include "async_simulation.h"
+#include "core_periphery.h"
+#include "defs.h"
+#include "experiments.h"
+#include "multi_color_simulation.h"
+#include "simulation.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+sockaddr_un toAddress(std::string const& socket_path)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+		Error("The socket path has to have between 1 and " << sizeof(address.sun_path) - 1
+		      << " characters: " << socket_path);
+	}
+	std::strcpy(address.sun_path, socket_path.c_str());
+
+	return address;
+}
+
+// One trial on the cached graph and coloring, run sequentially.
+Result runTrial(Graph const& graph, Coloring const& core_periphery_coloring,
+                ExperimentData const& experiment_data, std::size_t trial)
+{
+	if (isMultiColorExperiment(experiment_data)) {
+		MultiColorSimulation simulation(graph, experiment_data.dynamics_type,
+		                                createMultiColorInitialColoring(core_periphery_coloring,
+		                                                                experiment_data.number_of_colors,
+		                                                                experiment_data.seed),
+		                                experiment_data.h);
+		simulation.setSeed(experiment_data.seed);
+		return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold, trial);
+	}
+
+	if (experiment_data.update_model == UpdateModel::Asynchronous) {
+		AsyncSimulation simulation(graph, experiment_data.dynamics_type, core_periphery_coloring);
+		simulation.setSeed(experiment_data.seed);
+		return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold, trial);
+	}
+
+	Simulation simulation(graph, experiment_data.dynamics_type, core_periphery_coloring);
+	simulation.setRoundKernel(experiment_data.round_kernel);
+	simulation.setSeed(experiment_data.seed);
+	return simulation.run(experiment_data.max_rounds, experiment_data.win_threshold, trial);
+}
+
+bool sendAll(int fd, std::string const& data)
+{
+	std::size_t sent = 0;
+	while (sent < data.size()) {
+		// no SIGPIPE if the other side is gone
+		auto result = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (result <= 0) {
+			return false;
+		}
+		sent += result;
+	}
+
+	return true;
+}
+
+// Reads lines from a socket; a line at the end without a newline is returned
+// as well.
+class LineReader
+{
+public:
+	explicit LineReader(int fd) : fd(fd) {}
+
+	bool getLine(std::string& line)
+	{
+		while (true) {
+			auto newline = buffer.find('\n');
+			if (newline != std::string::npos) {
+				line = buffer.substr(0, newline);
+				buffer.erase(0, newline + 1);
+				if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+				return true;
+			}
+
+			char chunk[4096];
+			auto result = ::recv(fd, chunk, sizeof(chunk), 0);
+			if (result <= 0) {
+				line = buffer;
+				buffer.clear();
+				return !line.empty();
+			}
+			buffer.append(chunk, result);
+		}
+	}
+
+private:
+	int const fd;
+	std::string buffer;
+};
+
+// Loads the value of the key once: the first caller loads it, all others wait
+// for the result. Failed loads are not cached.
+template <typename Key, typename Value, typename Load>
+Value getCached(std::mutex& mutex, std::map<Key, std::shared_future<Value>>& cache,
+                Key const& key, Load load, bool& cached)
+{
+	std::promise<Value> promise;
+	std::shared_future<Value> future;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = cache.find(key);
+		cached = (it != cache.end());
+		if (cached) {
+			future = it->second;
+		}
+		else {
+			future = promise.get_future().share();
+			cache.emplace(key, future);
+		}
+	}
+
+	if (!cached) {
+		try {
+			promise.set_value(load());
+		}
+		catch (...) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				cache.erase(key);
+			}
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	return future.get();
+}
+
+} // end anonymous
+
+//
+// ExperimentServer::Connection
+//
+// The responses of the trials are sent from the threads of the pool, so the
+// connection outlives its serving thread until the last trial is done.
+//
+
+struct ExperimentServer::Connection
+{
+	explicit Connection(int fd) : fd(fd) {}
+	~Connection() { ::close(fd); }
+
+	int const fd;
+
+	std::mutex mutex;
+	std::condition_variable done_condition;
+	std::size_t number_of_running = 0;
+	// the client is gone, so the remaining trials are skipped
+	std::atomic<bool> closed{false};
+
+	void send(std::string const& line)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!closed && !sendAll(fd, line + "\n")) {
+			closed = true;
+		}
+	}
+
+	void sendError(std::string const& id, std::string const& message)
+	{
+		send("error " + id + ": " + message);
+	}
+
+	void startTask()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++number_of_running;
+	}
+
+	void finishTask()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--number_of_running == 0) {
+			done_condition.notify_all();
+		}
+	}
+
+	void waitForTasks()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done_condition.wait(lock, [&]() { return number_of_running == 0; });
+	}
+};
+
+//
+// ExperimentServer
+//
+
+ExperimentServer::ExperimentServer(std::string const& socket_path, std::size_t number_of_threads)
+	: socket_path(socket_path), pool(number_of_threads)
+{
+	auto address = toAddress(socket_path);
+
+	listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd == -1) {
+		Error("The server socket couldn't be created: " << std::strerror(errno));
+	}
+
+	// a socket file left behind by a server that was killed
+	::unlink(socket_path.c_str());
+	if (::bind(listen_fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0 ||
+	    ::listen(listen_fd, SOMAXCONN) != 0) {
+		Error("The server couldn't listen on " << socket_path << ": " << std::strerror(errno));
+	}
+}
+
+ExperimentServer::~ExperimentServer()
+{
+	::close(listen_fd);
+	::unlink(socket_path.c_str());
+}
+
+void ExperimentServer::run()
+{
+	Print("Serving on " << socket_path << " with " << pool.getNumberOfThreads() << " threads.");
+
+	while (true) {
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd == -1) {
+			std::lock_guard<std::mutex> lock(connections_mutex);
+			if (stopping) {
+				break;
+			}
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(connections_mutex);
+			++number_of_connections;
+		}
+		std::thread(&ExperimentServer::serve, this, std::make_shared<Connection>(fd)).detach();
+	}
+
+	std::unique_lock<std::mutex> lock(connections_mutex);
+	connections_condition.wait(lock, [&]() { return number_of_connections == 0; });
+}
+
+void ExperimentServer::serve(std::shared_ptr<Connection> connection)
+{
+	// a failing job must not end the server
+	setErrorsThrow(true);
+
+	LineReader reader(connection->fd);
+	std::vector<std::string> lines;
+	std::string line;
+	while (reader.getLine(line) && !line.empty()) {
+		lines.push_back(line);
+	}
+
+	if (lines.size() == 1 && lines[0] == "shutdown") {
+		connection->send("done 0");
+		stop();
+	}
+	else if (lines.size() == 1 && lines[0] == "status") {
+		sendStatus(*connection);
+	}
+	else {
+		runJob(*connection, lines);
+	}
+
+	std::lock_guard<std::mutex> lock(connections_mutex);
+	if (--number_of_connections == 0) {
+		connections_condition.notify_all();
+	}
+}
+
+void ExperimentServer::runJob(Connection& connection, std::vector<std::string> const& lines)
+{
+	auto const start = std::chrono::steady_clock::now();
+
+	std::vector<ExperimentData> experiments_data;
+	for (auto const& line: lines) {
+		try {
+			ExperimentData experiment_data;
+			std::lock_guard<std::mutex> lock(seeder_mutex);
+			if (readExperiment(line, seeder, experiment_data)) {
+				experiments_data.push_back(experiment_data);
+			}
+		}
+		catch (std::exception const& e) {
+			connection.sendError("-", std::string("Invalid experiment: ") + line + " (" + e.what() + ")");
+		}
+	}
+
+	// The trials of an experiment already run while the graph of the next one
+	// is loaded.
+	for (std::size_t id = 0; id < experiments_data.size() && !connection.closed; ++id) {
+		auto const& experiment_data = experiments_data[id];
+		auto const preprocessing_start = std::chrono::steady_clock::now();
+
+		GraphPointer graph;
+		ColoringPointer coloring;
+		bool graph_cached, coloring_cached;
+		try {
+			graph = getGraph(experiment_data.graph_file, graph_cached);
+			coloring = getColoring(experiment_data.graph_file, experiment_data.cp_method,
+			                       *graph, coloring_cached);
+		}
+		catch (std::exception const& e) {
+			connection.sendError(std::to_string(id), e.what());
+			continue;
+		}
+
+		connection.send("experiment " + std::to_string(id) + " " + experiment_data.graph_file +
+		                " nodes=" + std::to_string(graph->getNumberOfNodes()) +
+		                " edges=" + std::to_string(graph->getNumberOfEdges()) +
+		                " seed=" + std::to_string(experiment_data.seed) +
+		                " graph=" + (graph_cached ? "cached" : "loaded") +
+		                " coloring=" + (coloring_cached ? "cached" : "computed") +
+		                " preprocessing=" + std::to_string(secondsSince(preprocessing_start)));
+
+		for (std::size_t trial = 0; trial < experiment_data.number_of_exps; ++trial) {
+			if (experiment_data.replay_trial != -1 && (std::size_t)experiment_data.replay_trial != trial) {
+				continue;
+			}
+
+			// the trial only depends on the seed and its number, so its result is
+			// the same as in a run of ./main
+			connection.startTask();
+			pool.submit([&connection, id, trial, experiment_data, graph, coloring]() {
+				setErrorsThrow(true);
+				if (!connection.closed) {
+					try {
+						auto result = runTrial(*graph, *coloring, experiment_data, trial);
+						connection.send("result " + std::to_string(id) + " " + std::to_string(trial) +
+						                ": " + toString(result));
+					}
+					catch (std::exception const& e) {
+						connection.sendError(std::to_string(id), e.what());
+					}
+				}
+				connection.finishTask();
+			});
+		}
+	}
+
+	connection.waitForTasks();
+	connection.send("done " + std::to_string(secondsSince(start)));
+}
+
+void ExperimentServer::sendStatus(Connection& connection)
+{
+	std::vector<std::shared_future<GraphPointer>> loaded;
+	std::vector<std::string> graph_files;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (auto const& entry: graphs) {
+			graph_files.push_back(entry.first);
+			loaded.push_back(entry.second);
+		}
+	}
+
+	for (std::size_t i = 0; i < loaded.size(); ++i) {
+		auto ready = (loaded[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		connection.send("graph " + graph_files[i] + (ready ? " loaded" : " loading"));
+	}
+	connection.send("done 0");
+}
+
+void ExperimentServer::stop()
+{
+	std::lock_guard<std::mutex> lock(connections_mutex);
+	stopping = true;
+	// wakes up the accept in run
+	::shutdown(listen_fd, SHUT_RDWR);
+}
+
+auto ExperimentServer::getFileVersion(std::string const& graph_file) -> FileVersion
+{
+	struct stat status;
+	if (graph_file.compare(0, 4, "gen:") == 0 || stat(graph_file.c_str(), &status) != 0) {
+		return FileVersion(0, 0);
+	}
+
+	return FileVersion(static_cast<std::uint64_t>(status.st_size),
+	                   static_cast<std::int64_t>(status.st_mtim.tv_sec)*1000000000 +
+	                   status.st_mtim.tv_nsec);
+}
+
+auto ExperimentServer::getGraph(std::string const& graph_file, bool& cached) -> GraphPointer
+{
+	// a graph file that changed since it was loaded is loaded again, and its
+	// core colorings are computed again
+	auto const version = getFileVersion(graph_file);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = graph_versions.find(graph_file);
+		if (it != graph_versions.end() && it->second != version) {
+			graphs.erase(graph_file);
+			for (auto coloring = colorings.begin(); coloring != colorings.end();) {
+				coloring = (coloring->first.first == graph_file ? colorings.erase(coloring)
+				                                                : std::next(coloring));
+			}
+		}
+		graph_versions[graph_file] = version;
+	}
+
+	return getCached(cache_mutex, graphs, graph_file, [&]() {
+		std::shared_ptr<Graph> graph = std::make_shared<Graph>();
+		graph->buildFromFile(graph_file);
+		return GraphPointer(graph);
+	}, cached);
+}
+
+auto ExperimentServer::getColoring(std::string const& graph_file, CPMethod cp_method,
+                                   Graph const& graph, bool& cached) -> ColoringPointer
+{
+	return getCached(cache_mutex, colorings, ColoringKey(graph_file, cp_method), [&]() {
+		return ColoringPointer(std::make_shared<Coloring>(calculateCorePeripheryColoring(graph, cp_method)));
+	}, cached);
+}
+
+bool submitJob(std::string const& socket_path, std::string const& experiments_file,
+               std::ostream& out)
+{
+	std::string job;
+	if (experiments_file == "shutdown" || experiments_file == "status") {
+		job = experiments_file + "\n";
+	}
+	else {
+		std::ifstream file(experiments_file);
+		if (!file.is_open()) {
+			Error("The experiments file couldn't be opened. Filename: " + experiments_file);
+		}
+
+		// empty lines would end the job
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty()) { job += line + "\n"; }
+		}
+	}
+	job += "\n";
+
+	auto address = toAddress(socket_path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1 ||
+	    ::connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0) {
+		Error("No server is listening on " << socket_path << ": " << std::strerror(errno));
+	}
+	if (!sendAll(fd, job)) {
+		Error("The job couldn't be sent to " << socket_path);
+	}
+
+	bool success = true;
+	LineReader reader(fd);
+	std::string line;
+	while (reader.getLine(line)) {
+		out << line << std::endl;
+		if (line.compare(0, 5, "error") == 0) { success = false; }
+		if (line.compare(0, 4, "done") == 0) { break; }
+	}
+	::close(fd);
+
+	return success;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "basic_types.h"
+#include "coloring.h"
+#include "graph.h"
+#include "random.h"
+#include "thread_pool.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// ExperimentServer
+//
+// A resident process that keeps the graphs and their core colorings in memory,
+// so jobs on the same graphs pay for loading and core extraction only once.
+// Clients connect to a Unix domain socket and send a job: lines in the format
+// of the experiments file, terminated by an empty line or by closing the
+// sending side. The trials of all jobs run on one shared thread pool, one
+// sequential simulation per trial, and every response line is sent as soon as
+// it is known:
+//
+//   experiment <id> <graph_file> nodes=<n> edges=<m> seed=<seed> graph=<loaded|cached> coloring=<computed|cached> preprocessing=<seconds>
+//   result <id> <trial>: <result as in the result files>
+//   error <id>: <message>   (the id is - if the error is not about one experiment)
+//   done <seconds>
+//
+// Errors of a job (unknown graph files, bad lines) are reported to its client
+// and do not stop the server. A graph file whose size or modification time
+// changed is loaded again. The job "status" lists the cached graphs and
+// "shutdown" stops the server once the running jobs are done.
+//
+
+class ExperimentServer
+{
+public:
+	ExperimentServer(std::string const& socket_path, std::size_t number_of_threads);
+	ExperimentServer(ExperimentServer const&) = delete;
+	~ExperimentServer();
+
+	ExperimentServer& operator=(ExperimentServer const&) = delete;
+
+	// Serves jobs until a client sends "shutdown".
+	void run();
+
+private:
+	struct Connection;
+	using GraphPointer = std::shared_ptr<Graph const>;
+	using ColoringPointer = std::shared_ptr<Coloring const>;
+	using ColoringKey = std::pair<std::string, CPMethod>;
+	using FileVersion = std::pair<std::uint64_t, std::int64_t>;
+
+	std::string const socket_path;
+	int listen_fd = -1;
+	ThreadPool pool;
+
+	std::mutex cache_mutex;
+	std::map<std::string, std::shared_future<GraphPointer>> graphs;
+	std::map<ColoringKey, std::shared_future<ColoringPointer>> colorings;
+	// the size and modification time of every graph file when it was loaded
+	std::map<std::string, FileVersion> graph_versions;
+
+	// draws the seeds of experiments without a seed option
+	std::mutex seeder_mutex;
+	Random seeder;
+
+	std::mutex connections_mutex;
+	std::condition_variable connections_condition;
+	std::size_t number_of_connections = 0;
+	bool stopping = false;
+
+	void serve(std::shared_ptr<Connection> connection);
+	void runJob(Connection& connection, std::vector<std::string> const& lines);
+	void sendStatus(Connection& connection);
+	void stop();
+
+	// The size and the modification time of a graph file, which tell whether
+	// it changed since it was loaded. Generated graphs and missing files have
+	// none.
+	static FileVersion getFileVersion(std::string const& graph_file);
+	// Loads the graph or waits until another job has loaded it.
+	GraphPointer getGraph(std::string const& graph_file, bool& cached);
+	ColoringPointer getColoring(std::string const& graph_file, CPMethod cp_method,
+	                            Graph const& graph, bool& cached);
+};
+
+// Sends the experiments of the file as one job to the server and writes its
+// response lines to out. Returns false if the server reported errors.
+bool submitJob(std::string const& socket_path, std::string const& experiments_file,
+               std::ostream& out);
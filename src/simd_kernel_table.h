@@ -0,0 +1,42 @@
+#pragma once
+
+// The table of the kernels of one instruction set. It is included by the
+// translation units of the instruction sets, which are compiled with the wide
+// instructions, so it only includes headers without code that runs at
+// startup: e.g., <iostream> (through basic_types.h) adds a static initializer,
+// which would be compiled with the wide instructions and run on every CPU.
+
+#include <cstddef>
+#include <cstdint>
+
+// declared as in basic_types.h
+enum class Color : std::uint8_t;
+
+//
+// SimdKernels
+//
+// The kernels of one instruction set. They rely on Red being 0 and Blue
+// being 1.
+//
+
+struct SimdKernels
+{
+	// TwoChoices: the new color is the color of both samples if they agree
+	// and the old color otherwise. The samples of node i are at 2i and 2i+1.
+	void (*decideTwoChoices)(Color const* old_colors, Color const* sampled_colors,
+	                         Color* new_colors, std::size_t count);
+	// number of blue nodes in new_colors and number of nodes whose color
+	// differs between old_colors and new_colors
+	void (*countBlueAndFlips)(Color const* old_colors, Color const* new_colors,
+	                          std::size_t count, std::size_t& blue_count,
+	                          std::size_t& number_of_flips);
+	// sum of the degrees of the blue nodes, given the CSR offsets and ends
+	std::size_t (*sumBlueDegrees)(std::size_t const* offsets, std::size_t const* ends,
+	                              Color const* colors, std::size_t number_of_nodes);
+	// number of edge slots from red to red nodes, between red and blue nodes
+	// (in both directions) and from blue to blue nodes
+	void (*countEdgesByColors)(std::size_t const* offsets, std::size_t const* ends,
+	                           std::size_t const* neighbors, Color const* colors,
+	                           std::size_t number_of_nodes, std::size_t& red_red,
+	                           std::size_t& cut, std::size_t& blue_blue);
+};
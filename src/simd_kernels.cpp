@@ -0,0 +1,117 @@
+#include "simd_kernels.h"
+
+#include "defs.h"
+
+#include <atomic>
+
+namespace simd_kernels
+{
+namespace baseline { SimdKernels getKernels(); }
+#ifdef HAVE_X86_SIMD_KERNELS
+namespace avx2 { SimdKernels getKernels(); }
+namespace avx512 { SimdKernels getKernels(); }
+#endif
+} // end simd_kernels
+
+namespace
+{
+
+InstructionSet getBestInstructionSet()
+{
+	auto const instruction_sets = getSupportedInstructionSets();
+	return instruction_sets.back();
+}
+
+// chosen on first use, i.e., at startup
+std::atomic<InstructionSet>& currentInstructionSet()
+{
+	static std::atomic<InstructionSet> instruction_set(getBestInstructionSet());
+	return instruction_set;
+}
+
+SimdKernels const& getKernels(InstructionSet instruction_set)
+{
+#ifdef HAVE_X86_SIMD_KERNELS
+	static SimdKernels const avx2_kernels = simd_kernels::avx2::getKernels();
+	static SimdKernels const avx512_kernels = simd_kernels::avx512::getKernels();
+	if (instruction_set == InstructionSet::AVX512) { return avx512_kernels; }
+	if (instruction_set == InstructionSet::AVX2) { return avx2_kernels; }
+#endif
+	static SimdKernels const baseline_kernels = simd_kernels::baseline::getKernels();
+	return baseline_kernels;
+}
+
+} // end anonymous
+
+InstructionSet toInstructionSet(std::string const& instruction_set_string)
+{
+	if (instruction_set_string == "baseline") {
+		return InstructionSet::Baseline;
+	}
+	else if (instruction_set_string == "avx2") {
+		return InstructionSet::AVX2;
+	}
+	else if (instruction_set_string == "avx512") {
+		return InstructionSet::AVX512;
+	}
+
+	Error("No matching instruction set on call of toInstructionSet");
+}
+
+std::string toString(InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+	case InstructionSet::Baseline: return "baseline";
+	case InstructionSet::AVX2: return "avx2";
+	case InstructionSet::AVX512: default: return "avx512";
+	}
+}
+
+bool isSupported(InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+	case InstructionSet::Baseline:
+		return true;
+#ifdef HAVE_X86_SIMD_KERNELS
+	case InstructionSet::AVX2:
+		return __builtin_cpu_supports("avx2");
+	case InstructionSet::AVX512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		       __builtin_cpu_supports("avx512vl");
+#endif
+	default:
+		return false;
+	}
+}
+
+std::vector<InstructionSet> getSupportedInstructionSets()
+{
+	std::vector<InstructionSet> instruction_sets;
+	for (auto instruction_set: {InstructionSet::Baseline, InstructionSet::AVX2,
+	                            InstructionSet::AVX512}) {
+		if (isSupported(instruction_set)) {
+			instruction_sets.push_back(instruction_set);
+		}
+	}
+
+	return instruction_sets;
+}
+
+void setInstructionSet(InstructionSet instruction_set)
+{
+	if (!isSupported(instruction_set)) {
+		Error("The CPU doesn't support the instruction set " + toString(instruction_set) + ".");
+	}
+
+	currentInstructionSet() = instruction_set;
+}
+
+InstructionSet getInstructionSet()
+{
+	return currentInstructionSet();
+}
+
+SimdKernels const& getSimdKernels()
+{
+	return getKernels(currentInstructionSet());
+}
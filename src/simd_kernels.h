@@ -0,0 +1,37 @@
+#pragma once
+
+#include "basic_types.h"
+#include "simd_kernel_table.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//
+// InstructionSet
+//
+// The hot loops of the rounds and of the statistics are compiled once per
+// instruction set into the same binary (see simd_kernels_impl.h). At startup,
+// the best instruction set the CPU supports is chosen; setInstructionSet
+// overrides the choice, e.g., to compare the variants. All variants give
+// exactly the same results.
+//
+
+enum class InstructionSet {
+	Baseline,
+	AVX2,
+	AVX512
+};
+InstructionSet toInstructionSet(std::string const& instruction_set_string);
+std::string toString(InstructionSet instruction_set);
+
+bool isSupported(InstructionSet instruction_set);
+// the supported instruction sets, from the baseline to the best one
+std::vector<InstructionSet> getSupportedInstructionSets();
+// Fails if the CPU doesn't support the instruction set. Only call it while no
+// simulation runs.
+void setInstructionSet(InstructionSet instruction_set);
+InstructionSet getInstructionSet();
+
+// the kernels of the current instruction set
+SimdKernels const& getSimdKernels();
@@ -0,0 +1,3 @@
+// the kernels for CPUs with AVX2, compiled with -mavx2 (see CMakeLists.txt)
+#define SIMD_KERNELS_NAMESPACE avx2
+#include "simd_kernels_impl.h"
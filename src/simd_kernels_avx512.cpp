@@ -0,0 +1,4 @@
+// the kernels for CPUs with AVX-512 (F, BW and VL), compiled with -mavx512f
+// -mavx512bw -mavx512vl (see CMakeLists.txt)
+#define SIMD_KERNELS_NAMESPACE avx512
+#include "simd_kernels_impl.h"
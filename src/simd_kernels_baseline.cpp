@@ -0,0 +1,3 @@
+// the kernels for CPUs without AVX2, compiled with the flags of the build
+#define SIMD_KERNELS_NAMESPACE baseline
+#include "simd_kernels_impl.h"
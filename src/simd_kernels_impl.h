@@ -0,0 +1,117 @@
+// The kernels of simd_kernels.h, written such that the compiler vectorizes
+// them. This file is included by one translation unit per instruction set,
+// which defines SIMD_KERNELS_NAMESPACE and is compiled with the flags of the
+// instruction set (see CMakeLists.txt).
+//
+// Everything a variant calls has to be compiled into it: an inline function
+// of another header could be emitted with the wide instructions and then be
+// chosen by the linker for all callers. So the kernels only use built-in
+// operations on raw pointers, and the file only includes headers that emit no
+// code (see simd_kernel_table.h).
+
+#include "simd_kernel_table.h"
+
+#include <cstdint>
+
+#ifndef SIMD_KERNELS_NAMESPACE
+#error "SIMD_KERNELS_NAMESPACE has to be defined"
+#endif
+
+namespace simd_kernels
+{
+namespace SIMD_KERNELS_NAMESPACE
+{
+
+namespace
+{
+
+using Byte = std::uint8_t;
+
+void decideTwoChoices(Color const* old_colors, Color const* sampled_colors,
+                      Color* new_colors, std::size_t count)
+{
+	auto const old_bytes = reinterpret_cast<Byte const*>(old_colors);
+	auto const sampled_bytes = reinterpret_cast<Byte const*>(sampled_colors);
+	auto const new_bytes = reinterpret_cast<Byte*>(new_colors);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		// the old color is loaded unconditionally, otherwise the loop isn't
+		// vectorized
+		Byte const old_color = old_bytes[i];
+		Byte const color1 = sampled_bytes[2*i];
+		Byte const color2 = sampled_bytes[2*i + 1];
+		new_bytes[i] = (color1 == color2 ? color1 : old_color);
+	}
+}
+
+void countBlueAndFlips(Color const* old_colors, Color const* new_colors, std::size_t count,
+                       std::size_t& blue_count, std::size_t& number_of_flips)
+{
+	auto const old_bytes = reinterpret_cast<Byte const*>(old_colors);
+	auto const new_bytes = reinterpret_cast<Byte const*>(new_colors);
+
+	// 32-bit sums, so more lanes fit into a vector; every byte adds at most one
+	std::uint32_t blue = 0;
+	std::uint32_t flips = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		blue += new_bytes[i];
+		flips += (new_bytes[i] != old_bytes[i]);
+	}
+
+	blue_count = blue;
+	number_of_flips = flips;
+}
+
+std::size_t sumBlueDegrees(std::size_t const* offsets, std::size_t const* ends,
+                           Color const* colors, std::size_t number_of_nodes)
+{
+	auto const bytes = reinterpret_cast<Byte const*>(colors);
+
+	std::size_t sum = 0;
+	for (std::size_t i = 0; i < number_of_nodes; ++i) {
+		sum += (ends[i] - offsets[i]) & (std::size_t(0) - bytes[i]);
+	}
+
+	return sum;
+}
+
+void countEdgesByColors(std::size_t const* offsets, std::size_t const* ends,
+                        std::size_t const* neighbors, Color const* colors,
+                        std::size_t number_of_nodes, std::size_t& red_red,
+                        std::size_t& cut, std::size_t& blue_blue)
+{
+	auto const bytes = reinterpret_cast<Byte const*>(colors);
+
+	std::size_t from_red = 0;
+	std::size_t from_red_to_blue = 0;
+	std::size_t from_blue = 0;
+	std::size_t from_blue_to_blue = 0;
+	for (std::size_t node_id = 0; node_id < number_of_nodes; ++node_id) {
+		std::size_t blue_neighbors = 0;
+		for (auto edge = offsets[node_id]; edge < ends[node_id]; ++edge) {
+			blue_neighbors += bytes[neighbors[edge]];
+		}
+
+		// branch-free, as the colors of consecutive nodes are mixed
+		auto const degree = ends[node_id] - offsets[node_id];
+		auto const blue_mask = std::size_t(0) - bytes[node_id];
+		from_red += degree & ~blue_mask;
+		from_red_to_blue += blue_neighbors & ~blue_mask;
+		from_blue += degree & blue_mask;
+		from_blue_to_blue += blue_neighbors & blue_mask;
+	}
+
+	red_red = from_red - from_red_to_blue;
+	cut = from_red_to_blue + (from_blue - from_blue_to_blue);
+	blue_blue = from_blue_to_blue;
+}
+
+} // end anonymous
+
+SimdKernels getKernels()
+{
+	return {decideTwoChoices, countBlueAndFlips, sumBlueDegrees, countEdgesByColors};
+}
+
+} // end SIMD_KERNELS_NAMESPACE
+} // end simd_kernels
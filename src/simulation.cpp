@@ -1,33 +1,110 @@
 #include "simulation.h"
 
 #include "defs.h"
+#include "performance_report.h"
+#include "progress.h"
+#include "simd_kernels.h"
 
 #include <algorithm>
+#include <chrono>
 
 Simulation::Simulation(Graph const& graph, DynamicsType dynamics_type,
-                       Coloring initial_coloring)
-	: graph(graph), dynamics(dynamics_type, graph), initial_coloring(initial_coloring),
+                       Coloring initial_coloring, ParallelOptions const& parallel_options)
+	: graph(graph), engine(createParallelEngine(graph, parallel_options)),
+	dynamics(dynamics_type, graph, engine.get()), initial_coloring(initial_coloring),
+	initial_hash(initial_coloring.hash()),
 	current_coloring(graph.getNumberOfNodes()), next_coloring(graph.getNumberOfNodes())
 {
 	debug_assert(initial_coloring.size() == graph.getNumberOfNodes());
 
+	if (engine) {
+		engine->place(graph);
+		engine->place(current_coloring);
+		engine->place(next_coloring);
+	}
+
 	clear();
 }
 
-Result Simulation::run(std::int64_t max_rounds, float win_threshold)
+Result Simulation::run(std::int64_t max_rounds, float win_threshold, std::size_t trial,
+                       SimulationState const* resume_state)
 {
+	using Clock = std::chrono::steady_clock;
+
 	clear();
 	max_rounds = (max_rounds == -1 ? graph.getNumberOfNodes() : max_rounds);
 
+	// Rounds without flips are candidates for fixed points and the hashes of
+	// the current and the previous coloring detect candidates for cycles of
+	// length two; both are then verified (see StopReason).
+	auto hash = initial_hash;
+	auto previous_hash = ~initial_hash;
+
 	// run simulation
 	std::size_t round = 0;
-	while (round < (std::size_t)max_rounds &&
-		   getLargestVolumeFraction() < win_threshold) {
+	if (resume_state) {
+		if (resume_state->coloring.size() != graph.getNumberOfNodes()) {
+			Error("The coloring to resume from doesn't match the graph " + graph.getFilename());
+		}
+		current_coloring.assign(resume_state->coloring);
+		round = resume_state->round;
+		hash = resume_state->hash;
+		previous_hash = resume_state->previous_hash;
+	}
+
+	auto report = getActiveReport();
+	if (report) { report->beginSimulation(trial); }
+	auto progress = getActiveProgressMonitor();
+	if (progress) { progress->beginTrial(trial, max_rounds); }
+
+	auto last_checkpoint = Clock::now();
+	auto stop_reason = StopReason::MaxRounds;
+	while (round < (std::size_t)max_rounds) {
+		if (checkpoint_handler &&
+		    std::chrono::duration<double>(Clock::now() - last_checkpoint).count() >=
+		    checkpoint_interval_seconds) {
+			checkpoint_handler(SimulationState{round, current_coloring, hash, previous_hash});
+			last_checkpoint = Clock::now();
+		}
+
+		auto volumes = getColorVolumes();
+		if (progress) { progress->setRound(round, volumes); }
+		if (*std::max_element(volumes.begin(), volumes.end()) >= win_threshold) {
+			stop_reason = StopReason::WinThreshold;
+			break;
+		}
+
+		if (report) { report->beginRound(); }
+		auto statistics = dynamics.simulateOneRound(current_coloring, next_coloring,
+		                                            trial, round);
+		if (report) { report->endRound(statistics.number_of_flips); }
+		auto next_hash = hash ^ statistics.hash_change;
+
+		bool fixed_point = statistics.number_of_flips == 0 &&
+		                   isDeterministicRound(next_coloring, next_coloring);
+		bool oscillation = statistics.number_of_flips > 0 && next_hash == previous_hash &&
+		                   isDeterministicRound(current_coloring, next_coloring) &&
+		                   isDeterministicRound(next_coloring, current_coloring);
 
-		dynamics.simulateOneRound(current_coloring, next_coloring);
 		current_coloring.swap(next_coloring);
+		previous_hash = hash;
+		hash = next_hash;
 		++round;
+
+		if (fixed_point || oscillation) {
+			stop_reason = (fixed_point ? StopReason::FixedPoint : StopReason::Oscillation);
+			break;
+		}
+	}
+	if (stop_reason == StopReason::MaxRounds && getLargestVolumeFraction() >= win_threshold) {
+		stop_reason = StopReason::WinThreshold;
+	}
+	if (report) { report->endSimulation(graph.getNumberOfNodes()); }
+	if (progress) {
+		progress->setRound(round, getColorVolumes());
+		progress->endTrial();
 	}
+	final_state = SimulationState{round, current_coloring, hash, previous_hash};
 
 	debug_assert(current_coloring.size() > 0);
 	return Result{
@@ -35,10 +112,37 @@ Result Simulation::run(std::int64_t max_rounds, float win_threshold)
 		getWinningColor(win_threshold),
 		current_coloring.getColorFractions(),
 		getColorVolumes(),
-		round
+		round,
+		stop_reason
 	};
 }
 
+SimulationState const& Simulation::getFinalState() const
+{
+	return final_state;
+}
+
+void Simulation::setRoundKernel(RoundKernel round_kernel)
+{
+	dynamics.setRoundKernel(round_kernel);
+}
+
+void Simulation::setCheckpointHandler(double interval_seconds, CheckpointHandler handler)
+{
+	checkpoint_interval_seconds = interval_seconds;
+	checkpoint_handler = handler;
+}
+
+void Simulation::setSeed(std::uint64_t seed)
+{
+	dynamics.setSeed(seed);
+}
+
+std::uint64_t Simulation::getSeed() const
+{
+	return dynamics.getSeed();
+}
+
 float Simulation::getLargestVolumeFraction() const
 {
 	auto volumes = getColorVolumes();
@@ -62,23 +166,48 @@ Color Simulation::getWinningColor(float win_threshold) const
 std::vector<float> Simulation::getColorVolumes() const
 {
 
-	// count
-	std::vector<std::size_t> counts(COLORS.size());
-	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
-		auto color = current_coloring.get(node_id);
-		auto color_index = static_cast<std::size_t>(color);
-		counts[color_index] += graph.degree(node_id);
+	// count; the degree sums are exact, so the blue one is vectorized, while
+	// the weighted sums keep the order of the nodes to not change the results
+	std::vector<double> counts(COLORS.size());
+	if (graph.isWeighted()) {
+		for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+			auto color = current_coloring.get(node_id);
+			auto color_index = static_cast<std::size_t>(color);
+			counts[color_index] += graph.volume(node_id);
+		}
+	}
+	else {
+		auto blue_volume = getSimdKernels().sumBlueDegrees(graph.getOffsets(), graph.getEnds(),
+		                                                   current_coloring.data(),
+		                                                   graph.getNumberOfNodes());
+		counts[static_cast<std::size_t>(Color::Red)] = graph.getTotalVolume() - blue_volume;
+		counts[static_cast<std::size_t>(Color::Blue)] = blue_volume;
 	}
 
 	// normalize
 	std::vector<float> volume(COLORS.size());
 	for (std::size_t i = 0; i < volume.size(); ++i) {
-		volume[i] = (float)counts[i]/graph.getNumberOfEdges();
+		volume[i] = counts[i]/graph.getTotalVolume();
 	}
 
 	return volume;
 }
 
+bool Simulation::isDeterministicRound(Coloring const& from_coloring,
+                                      Coloring const& to_coloring) const
+{
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		auto color = to_coloring.get(node_id);
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (from_coloring.get(neighbor) != color) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 void Simulation::clear()
 {
 	current_coloring.assign(initial_coloring);
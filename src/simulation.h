@@ -3,14 +3,50 @@
 #include "dynamics.h"
 #include "graph.h"
 #include "basic_types.h"
+#include "parallel_engine.h"
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// SimulationState
+//
+// Everything that is needed besides the seed and the trial to continue a run
+// of a simulation exactly where it was interrupted.
+//
+
+struct SimulationState
+{
+	std::size_t round;
+	Coloring coloring = Coloring(0);
+	std::uint64_t hash;
+	std::uint64_t previous_hash;
+};
 
 class Simulation
 {
 public:
-	Simulation (Graph const& graph, DynamicsType dynamics_type, Coloring initial_coloring);
-	Result run(std::int64_t max_rounds, float win_threshold);
+	using CheckpointHandler = std::function<void(SimulationState const&)>;
+
+	Simulation (Graph const& graph, DynamicsType dynamics_type, Coloring initial_coloring,
+	            ParallelOptions const& parallel_options = ParallelOptions());
+	// The random samples only depend on the seed, the trial, the round and
+	// the node, so a trial can be replayed given its seed and number. If a
+	// state is given, the run continues from it instead of the initial coloring.
+	Result run(std::int64_t max_rounds, float win_threshold, std::size_t trial = 0,
+	           SimulationState const* resume_state = nullptr);
+	// The state after the last run. Passing it to run continues the trial,
+	// e.g., after the graph was updated (see Graph::updateEdges).
+	SimulationState const& getFinalState() const;
+	void setRoundKernel(RoundKernel round_kernel);
+	// The handler is called between two rounds whenever at least the given
+	// number of seconds passed since the last call.
+	void setCheckpointHandler(double interval_seconds, CheckpointHandler handler);
+	void setSeed(std::uint64_t seed);
+	std::uint64_t getSeed() const;
 
 	float getLargestVolumeFraction() const;
 	Color getWinningColor(float win_threshold) const;
@@ -18,12 +54,24 @@ public:
 
 private:
 	Graph const& graph;
+	std::unique_ptr<ParallelEngine> engine;
 	Dynamics dynamics;
 	Coloring const initial_coloring;
+	std::uint64_t const initial_hash;
 
 	Coloring current_coloring;
 	Coloring next_coloring;
+	SimulationState final_state;
 	std::size_t max_rounds;
 
+	double checkpoint_interval_seconds = 0;
+	CheckpointHandler checkpoint_handler;
+
 	void clear();
+	// Whether every node in to_coloring has the color which all its neighbors
+	// have in from_coloring. Then the round from from_coloring to to_coloring
+	// is deterministic for all dynamics. With from_coloring and to_coloring
+	// the same, this is a fixed point, i.e., no node has a neighbor of
+	// another color.
+	bool isDeterministicRound(Coloring const& from_coloring, Coloring const& to_coloring) const;
 };
@@ -0,0 +1,56 @@
+#include "thread_pool.h"
+
+#include "defs.h"
+
+#include <utility>
+
+ThreadPool::ThreadPool(std::size_t number_of_threads)
+{
+	// the tasks would never run
+	if (number_of_threads == 0) {
+		Error("A thread pool needs at least one thread.");
+	}
+	for (std::size_t i = 0; i < number_of_threads; ++i) {
+		threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	condition.notify_all();
+
+	for (auto& thread: threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::work()
+{
+	while (true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&]() { return stopped || !tasks.empty(); });
+			if (tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that run the submitted tasks in submission order.
+// Unlike the ParallelEngine, which splits one round over its workers, the
+// tasks are independent, e.g., whole trials of different jobs.
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	// fails without threads
+	explicit ThreadPool(std::size_t number_of_threads);
+	ThreadPool(ThreadPool const&) = delete;
+	// Runs the remaining tasks before the threads are joined.
+	~ThreadPool();
+
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	std::size_t getNumberOfThreads() const { return threads.size(); }
+	void submit(Task task);
+
+private:
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Task> tasks;
+	bool stopped = false;
+
+	void work();
+};
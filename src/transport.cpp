@@ -0,0 +1,379 @@
+#include "transport.h"
+
+#include "defs.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Resolves "host:port"; passive addresses are the ones to listen on.
+addrinfo* resolve(std::string const& address, bool passive)
+{
+	auto separator = address.rfind(':');
+	if (separator == std::string::npos || separator == 0 || separator + 1 == address.size()) {
+		Error("Worker addresses have to be given as host:port: " + address);
+	}
+	auto host = address.substr(0, separator);
+	auto port = address.substr(separator + 1);
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = (passive ? AI_PASSIVE : 0);
+
+	addrinfo* result = nullptr;
+	auto error = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+	if (error != 0) {
+		Error("The worker address " << address << " couldn't be resolved: " << ::gai_strerror(error));
+	}
+
+	return result;
+}
+
+// blocking, only used while the connections are set up
+void sendAll(int fd, void const* data, std::size_t size)
+{
+	auto bytes = static_cast<char const*>(data);
+	while (size > 0) {
+		auto result = ::send(fd, bytes, size, MSG_NOSIGNAL);
+		if (result <= 0) {
+			Error("Sending to a worker failed: " << std::strerror(errno));
+		}
+		bytes += result;
+		size -= result;
+	}
+}
+
+void receiveAll(int fd, void* data, std::size_t size)
+{
+	auto bytes = static_cast<char*>(data);
+	while (size > 0) {
+		auto result = ::recv(fd, bytes, size, 0);
+		if (result <= 0) {
+			Error("Receiving from a worker failed: " << (result == 0 ? "connection closed"
+			                                                          : std::strerror(errno)));
+		}
+		bytes += result;
+		size -= result;
+	}
+}
+
+int listenOn(std::string const& address, std::size_t backlog)
+{
+	auto info = resolve(address, true);
+	int fd = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+	int reuse = 1;
+	if (fd == -1 ||
+	    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+	    ::bind(fd, info->ai_addr, info->ai_addrlen) != 0 ||
+	    ::listen(fd, static_cast<int>(backlog)) != 0) {
+		::freeaddrinfo(info);
+		Error("The worker couldn't listen on " << address << ": " << std::strerror(errno));
+	}
+	::freeaddrinfo(info);
+
+	return fd;
+}
+
+// The other worker might not listen yet, so refused connections are retried
+// until the deadline.
+int connectTo(std::string const& address, Clock::time_point deadline)
+{
+	auto info = resolve(address, false);
+	while (true) {
+		int fd = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (fd == -1) {
+			::freeaddrinfo(info);
+			Error("The worker socket couldn't be created: " << std::strerror(errno));
+		}
+		if (::connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+			::freeaddrinfo(info);
+			return fd;
+		}
+		auto connect_errno = errno;
+		::close(fd);
+
+		if (Clock::now() >= deadline) {
+			::freeaddrinfo(info);
+			Error("The worker at " << address << " couldn't be reached: "
+			      << std::strerror(connect_errno));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
+// A message in transit: its length is sent in front of it.
+struct Transfer
+{
+	std::uint64_t length = 0;
+	Transport::Message message;
+	// bytes of length and message sent or received so far
+	std::size_t done = 0;
+
+	std::size_t size() const { return sizeof(length) + message.size(); }
+};
+
+} // end anonymous
+
+//
+// TcpTransport
+//
+
+double const TcpTransport::CONNECT_TIMEOUT_SECONDS = 60;
+
+TcpTransport::TcpTransport(std::size_t rank, std::vector<std::string> const& addresses)
+	: rank(rank), fds(addresses.size(), -1)
+{
+	if (rank >= addresses.size()) {
+		Error("The rank " << rank << " is not smaller than the number of workers "
+		      << addresses.size());
+	}
+	if (addresses.size() == 1) {
+		return;
+	}
+
+	auto const deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(CONNECT_TIMEOUT_SECONDS));
+
+	// Every worker connects to the ones with smaller ranks and accepts the
+	// ones with larger ranks. It listens before it connects, so the
+	// connections of the larger ranks are queued in the meantime.
+	int listen_fd = listenOn(addresses[rank], addresses.size());
+	for (std::size_t peer = 0; peer < rank; ++peer) {
+		fds[peer] = connectTo(addresses[peer], deadline);
+		std::uint64_t own_rank = rank;
+		sendAll(fds[peer], &own_rank, sizeof(own_rank));
+	}
+	for (std::size_t i = rank + 1; i < addresses.size(); ++i) {
+		auto const remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - Clock::now()).count();
+		pollfd listen_poll{listen_fd, POLLIN, 0};
+		if (remaining <= 0 || ::poll(&listen_poll, 1, static_cast<int>(remaining)) != 1) {
+			::close(listen_fd);
+			Error("Not all workers connected to worker " << rank << " within "
+			      << CONNECT_TIMEOUT_SECONDS << " seconds");
+		}
+
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd == -1) {
+			::close(listen_fd);
+			Error("Accepting a worker failed: " << std::strerror(errno));
+		}
+		std::uint64_t peer = 0;
+		receiveAll(fd, &peer, sizeof(peer));
+		if (peer <= rank || peer >= addresses.size() || fds[peer] != -1) {
+			::close(fd);
+			::close(listen_fd);
+			Error("Worker " << rank << " got a connection from an unexpected rank: " << peer);
+		}
+		fds[peer] = fd;
+	}
+	::close(listen_fd);
+
+	// the exchanges are latency bound and served by poll
+	for (auto fd: fds) {
+		if (fd == -1) { continue; }
+		int no_delay = 1;
+		::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+}
+
+TcpTransport::~TcpTransport()
+{
+	for (auto fd: fds) {
+		if (fd != -1) {
+			::close(fd);
+		}
+	}
+}
+
+auto TcpTransport::exchange(std::vector<Message> outgoing) -> std::vector<Message>
+{
+	auto const number_of_workers = fds.size();
+	if (outgoing.size() != number_of_workers) {
+		Error("An exchange needs one message per worker, got " << outgoing.size()
+		      << " for " << number_of_workers);
+	}
+
+	std::vector<Transfer> sends(number_of_workers), receives(number_of_workers);
+	std::size_t number_of_pending = 0;
+	for (std::size_t peer = 0; peer < number_of_workers; ++peer) {
+		if (peer == rank) { continue; }
+		sends[peer].length = outgoing[peer].size();
+		sends[peer].message = std::move(outgoing[peer]);
+		number_of_pending += 2;
+	}
+
+	std::vector<pollfd> polls;
+	std::vector<std::size_t> peers;
+	while (number_of_pending > 0) {
+		polls.clear();
+		peers.clear();
+		for (std::size_t peer = 0; peer < number_of_workers; ++peer) {
+			if (peer == rank) { continue; }
+			short events = 0;
+			if (sends[peer].done < sends[peer].size()) { events |= POLLOUT; }
+			auto const& receive = receives[peer];
+			if (receive.done < sizeof(receive.length) || receive.done < receive.size()) {
+				events |= POLLIN;
+			}
+			if (events != 0) {
+				polls.push_back({fds[peer], events, 0});
+				peers.push_back(peer);
+			}
+		}
+
+		if (::poll(polls.data(), polls.size(), -1) == -1) {
+			if (errno == EINTR) { continue; }
+			Error("Waiting for the workers failed: " << std::strerror(errno));
+		}
+
+		for (std::size_t i = 0; i < polls.size(); ++i) {
+			auto const peer = peers[i];
+			auto const revents = polls[i].revents;
+
+			auto& send = sends[peer];
+			if ((revents & (POLLOUT | POLLERR)) && send.done < send.size()) {
+				auto const header_left = (send.done < sizeof(send.length));
+				auto const data = (header_left ? reinterpret_cast<char const*>(&send.length) + send.done
+				                               : send.message.data() + send.done - sizeof(send.length));
+				auto const size = (header_left ? sizeof(send.length) - send.done : send.size() - send.done);
+				auto result = ::send(fds[peer], data, size, MSG_NOSIGNAL);
+				if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					Error("Sending to worker " << peer << " failed: " << std::strerror(errno));
+				}
+				if (result > 0) {
+					send.done += result;
+					if (send.done == send.size()) { --number_of_pending; }
+				}
+			}
+
+			auto& receive = receives[peer];
+			if ((revents & (POLLIN | POLLHUP | POLLERR)) &&
+			    (receive.done < sizeof(receive.length) || receive.done < receive.size())) {
+				auto const header_left = (receive.done < sizeof(receive.length));
+				auto const data = (header_left ? reinterpret_cast<char*>(&receive.length) + receive.done
+				                               : receive.message.data() + receive.done - sizeof(receive.length));
+				auto const size = (header_left ? sizeof(receive.length) - receive.done
+				                               : receive.size() - receive.done);
+				auto result = ::recv(fds[peer], data, size, 0);
+				if (result == 0) {
+					Error("Worker " << peer << " closed the connection");
+				}
+				if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					Error("Receiving from worker " << peer << " failed: " << std::strerror(errno));
+				}
+				if (result > 0) {
+					receive.done += result;
+					if (receive.done == sizeof(receive.length)) {
+						receive.message.resize(receive.length);
+					}
+					if (receive.done >= sizeof(receive.length) && receive.done == receive.size()) {
+						--number_of_pending;
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<Message> incoming(number_of_workers);
+	incoming[rank] = std::move(outgoing[rank]);
+	for (std::size_t peer = 0; peer < number_of_workers; ++peer) {
+		if (peer != rank) {
+			incoming[peer] = std::move(receives[peer].message);
+		}
+	}
+
+	return incoming;
+}
+
+std::vector<std::string> splitAddresses(std::string const& addresses)
+{
+	std::vector<std::string> result;
+	std::size_t begin = 0;
+	while (begin <= addresses.size()) {
+		auto end = addresses.find(',', begin);
+		if (end == std::string::npos) { end = addresses.size(); }
+		if (end > begin) {
+			result.push_back(addresses.substr(begin, end - begin));
+		}
+		begin = end + 1;
+	}
+
+	return result;
+}
+
+//
+// LocalTransport
+//
+
+auto LocalTransport::createGroup(std::size_t number_of_workers)
+	-> std::vector<std::unique_ptr<LocalTransport>>
+{
+	auto group = std::make_shared<Group>();
+	group->mailboxes.resize(number_of_workers);
+
+	std::vector<std::unique_ptr<LocalTransport>> transports;
+	for (std::size_t rank = 0; rank < number_of_workers; ++rank) {
+		transports.emplace_back(new LocalTransport(rank, group));
+	}
+
+	return transports;
+}
+
+std::size_t LocalTransport::getNumberOfWorkers() const
+{
+	return group->mailboxes.size();
+}
+
+auto LocalTransport::exchange(std::vector<Message> outgoing) -> std::vector<Message>
+{
+	auto const number_of_workers = getNumberOfWorkers();
+	if (outgoing.size() != number_of_workers) {
+		Error("An exchange needs one message per worker, got " << outgoing.size()
+		      << " for " << number_of_workers);
+	}
+
+	std::unique_lock<std::mutex> lock(group->mutex);
+
+	// all workers fill their mailboxes before any worker empties them ...
+	group->mailboxes[rank] = std::move(outgoing);
+	if (++group->number_of_sent == number_of_workers) {
+		group->condition.notify_all();
+	}
+	group->condition.wait(lock, [&]() { return group->number_of_sent == number_of_workers; });
+
+	std::vector<Message> incoming(number_of_workers);
+	for (std::size_t peer = 0; peer < number_of_workers; ++peer) {
+		incoming[peer] = std::move(group->mailboxes[peer][rank]);
+	}
+
+	// ... and all have emptied them before the next exchange starts
+	auto const generation = group->generation;
+	if (++group->number_of_received == number_of_workers) {
+		group->number_of_sent = 0;
+		group->number_of_received = 0;
+		++group->generation;
+		group->condition.notify_all();
+	}
+	group->condition.wait(lock, [&]() { return group->generation != generation; });
+
+	return incoming;
+}
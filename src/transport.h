@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// Transport
+//
+// Moves the messages between the workers of a partitioned simulation (see
+// PartitionedSimulation). The workers are numbered from 0 to n-1 and all
+// communication happens in exchanges, in which every worker takes part: it
+// passes one message per worker and gets the messages of all workers to it.
+// All workers have to make the same sequence of exchanges.
+//
+
+class Transport
+{
+public:
+	using Message = std::vector<char>;
+
+	virtual ~Transport() = default;
+
+	virtual std::size_t getRank() const = 0;
+	virtual std::size_t getNumberOfWorkers() const = 0;
+	// outgoing[i] is sent to worker i and the result holds at index i the
+	// message of worker i. The message to the worker itself is passed through.
+	virtual std::vector<Message> exchange(std::vector<Message> outgoing) = 0;
+};
+
+//
+// TcpTransport
+//
+// Connects the workers with TCP, so they can run on different machines or
+// as processes on one machine over the loopback interface. Every worker gets
+// the same list of addresses "host:port", the one at its rank is the one it
+// listens on. A worker waits up to CONNECT_TIMEOUT_SECONDS for the others.
+// Messages are sent with their length in front; the sockets of an exchange are
+// served with poll, so large messages in both directions can't block it.
+//
+
+class TcpTransport : public Transport
+{
+public:
+	static double const CONNECT_TIMEOUT_SECONDS;
+
+	TcpTransport(std::size_t rank, std::vector<std::string> const& addresses);
+	TcpTransport(TcpTransport const&) = delete;
+	~TcpTransport() override;
+
+	TcpTransport& operator=(TcpTransport const&) = delete;
+
+	std::size_t getRank() const override { return rank; }
+	std::size_t getNumberOfWorkers() const override { return fds.size(); }
+	std::vector<Message> exchange(std::vector<Message> outgoing) override;
+
+private:
+	std::size_t const rank;
+	// socket of the connection to every other worker, -1 at the own rank
+	std::vector<int> fds;
+};
+
+// Splits a comma-separated list of addresses, e.g., the --workers option.
+std::vector<std::string> splitAddresses(std::string const& addresses);
+
+//
+// LocalTransport
+//
+// Connects workers that are threads of one process through shared memory,
+// e.g., to test the partitioned simulation without sockets. All transports of
+// a group are created at once by createGroup and each is used by one thread.
+//
+
+class LocalTransport : public Transport
+{
+public:
+	static std::vector<std::unique_ptr<LocalTransport>> createGroup(std::size_t number_of_workers);
+
+	std::size_t getRank() const override { return rank; }
+	std::size_t getNumberOfWorkers() const override;
+	std::vector<Message> exchange(std::vector<Message> outgoing) override;
+
+private:
+	// messages of an exchange: mailboxes[i][j] is from worker i to worker j
+	struct Group
+	{
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::vector<std::vector<Message>> mailboxes;
+		// workers that filled their mailboxes or emptied the others' in the
+		// current exchange, and the number of finished exchanges
+		std::size_t number_of_sent = 0;
+		std::size_t number_of_received = 0;
+		std::size_t generation = 0;
+	};
+
+	LocalTransport(std::size_t rank, std::shared_ptr<Group> group)
+		: rank(rank), group(std::move(group)) {}
+
+	std::size_t const rank;
+	std::shared_ptr<Group> const group;
+};
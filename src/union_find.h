@@ -139,3 +139,89 @@ void UnionFind<T>::uniteSets(ElementID root1_id, ElementID root2_id)
 		}
 	}
 }
+
+//
+// DenseUnionFind
+//
+// Union-find over the IDs 0, ..., n-1 which can grow while elements are
+// added. Uses union by size and path halving.
+//
+
+class DenseUnionFind
+{
+public:
+	using ElementID = std::size_t;
+
+	DenseUnionFind() = default;
+	DenseUnionFind(std::size_t size) { resize(size); }
+
+	std::size_t size() const { return parent.size(); }
+	void resize(std::size_t new_size);
+	// Removes all elements, but keeps the memory for the next use.
+	void clear();
+
+	ElementID findRoot(ElementID id);
+	void unite(ElementID id1, ElementID id2);
+	std::size_t setSize(ElementID id) { return tree_size[findRoot(id)]; }
+	// Returns some element of the largest set.
+	ElementID largestSetElement() const { return max_id; }
+
+private:
+	std::vector<ElementID> parent;
+	std::vector<std::size_t> tree_size;
+
+	ElementID max_id = 0;
+	std::size_t max_size = 0;
+};
+
+inline void DenseUnionFind::resize(std::size_t new_size)
+{
+	auto old_size = parent.size();
+	parent.resize(new_size);
+	tree_size.resize(new_size, 1);
+	for (auto id = old_size; id < new_size; ++id) {
+		parent[id] = id;
+	}
+
+	if (max_size == 0 && new_size > 0) {
+		max_id = 0;
+		max_size = 1;
+	}
+}
+
+inline void DenseUnionFind::clear()
+{
+	parent.clear();
+	tree_size.clear();
+	max_id = 0;
+	max_size = 0;
+}
+
+inline auto DenseUnionFind::findRoot(ElementID id) -> ElementID
+{
+	while (parent[id] != id) {
+		parent[id] = parent[parent[id]];
+		id = parent[id];
+	}
+
+	return id;
+}
+
+inline void DenseUnionFind::unite(ElementID id1, ElementID id2)
+{
+	auto root1 = findRoot(id1);
+	auto root2 = findRoot(id2);
+	if (root1 == root2) { return; }
+
+	if (tree_size[root1] < tree_size[root2]) {
+		std::swap(root1, root2);
+	}
+
+	parent[root2] = root1;
+	tree_size[root1] += tree_size[root2];
+
+	if (tree_size[root1] > max_size) {
+		max_id = root1;
+		max_size = tree_size[root1];
+	}
+}
@@ -0,0 +1,1974 @@
+#include "unit_tests.h"
+
+#include "core_periphery.h"
+#include "async_simulation.h"
+#include "batch_experiments.h"
+#include "binary_graph_format.h"
+#include "compressed_input.h"
+#include "distributed_experiments.h"
+#include "experiments.h"
+#include "fenwick_tree.h"
+#include "external_graph_builder.h"
+#include "graph.h"
+#include "graph_generators.h"
+#include "graph_pool.h"
+#include "memory_accounting.h"
+#include "multi_color_simulation.h"
+#include "packed_coloring.h"
+#include "partitioned_simulation.h"
+#include "performance_report.h"
+#include "progress.h"
+#include "random.h"
+#include "server.h"
+#include "simd_kernels.h"
+#include "simulation.h"
+#include "transport.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+//
+// Test framework
+//
+
+struct TestFailure
+{
+	std::string message;
+};
+
+#define CheckMessage(condition, x) do { if (!(condition)) {\
+	std::stringstream failure_message;\
+	failure_message << __FILE__ << ":" << __LINE__ << ": " << #condition << " " << x;\
+	throw TestFailure{failure_message.str()}; } } while (0)
+#define Check(condition) CheckMessage(condition, "")
+
+struct UnitTest
+{
+	char const* name;
+	std::function<void()> run;
+	bool is_timing;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+class TemporaryFile
+{
+public:
+	// the suffix is kept, e.g., to mark compressed files
+	explicit TemporaryFile(std::string const& suffix = "")
+	{
+		std::string name = "/tmp/od_test_XXXXXX" + suffix;
+		int fd = mkstemps(&name[0], suffix.size());
+		if (fd == -1) {
+			throw TestFailure{"The temporary file couldn't be created."};
+		}
+		close(fd);
+		filename = name;
+	}
+	~TemporaryFile() { std::remove(filename.c_str()); }
+
+	TemporaryFile(TemporaryFile const&) = delete;
+	TemporaryFile& operator=(TemporaryFile const&) = delete;
+
+	std::string const& get() const { return filename; }
+
+private:
+	std::string filename;
+};
+
+//
+// Graphs
+//
+
+std::uint64_t const SEED = 42;
+
+std::vector<std::string> const GENERATOR_SPECS = {
+	"gen:er:n=3000:d=6:seed=3",
+	"gen:chunglu:n=4000:d=8:beta=2.3:seed=5",
+	"gen:ba:n=3000:m=3:seed=7",
+	"gen:sbm:n=4000:core=0.1:dper=1:seed=11"
+};
+
+Graph::Edges generateEdges(std::string const& spec)
+{
+	auto generator = createEdgeGenerator(spec);
+	Graph::Edges edges(generator->getNumberOfEdges());
+	generator->generate(0, edges.size(), edges.data());
+	return edges;
+}
+
+Graph buildGraph(std::string const& graph_file)
+{
+	Graph graph;
+	graph.buildFromFile(graph_file);
+	return graph;
+}
+
+// The weights, if any, are a deterministic function of the edge index.
+void writeEdgeList(std::string const& graph_file, Graph::Edges const& edges, bool weighted)
+{
+	std::ofstream file(graph_file);
+	file << "# generated by the unit tests\n";
+	for (std::size_t i = 0; i < edges.size(); ++i) {
+		file << edges[i].first << " " << edges[i].second;
+		if (weighted) { file << " " << 0.5 + (i % 7)*0.25; }
+		file << "\n";
+	}
+}
+
+// Small graphs as for batch runs; sparse enough to have several components.
+std::vector<std::string> const SMALL_GENERATOR_SPECS = {
+	"gen:er:n=300:d=2:seed=3",
+	"gen:chunglu:n=500:d=4:beta=2.3:seed=5",
+	"gen:ba:n=200:m=2:seed=7",
+	"gen:er:n=100:d=1.5:seed=13"
+};
+
+// A container file of the graphs of SMALL_GENERATOR_SPECS, named g0, g1, ...;
+// every graph gets a loop and a duplicate edge.
+void writeGraphContainer(std::string const& container_file)
+{
+	std::ofstream file(container_file);
+	file << "# generated by the unit tests\n";
+	for (std::size_t i = 0; i < SMALL_GENERATOR_SPECS.size(); ++i) {
+		auto edges = generateEdges(SMALL_GENERATOR_SPECS[i]);
+		edges.emplace_back(edges[0].first, edges[0].first);
+		edges.push_back(edges[1]);
+
+		file << "graph g" << i << "\n";
+		for (auto const& edge: edges) {
+			file << edge.first << "\t" << edge.second << "\n";
+		}
+	}
+}
+
+std::string readFile(std::string const& filename)
+{
+	std::ifstream file(filename, std::ios_base::binary);
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+#ifdef HAVE_ZLIB
+// Compresses the data into gzip members of member_size bytes each, so the
+// reader has to continue over the boundaries of the members.
+void writeGzipFile(std::string const& gzip_file, std::string const& data, std::size_t member_size)
+{
+	std::remove(gzip_file.c_str());
+	for (std::size_t begin = 0; begin < data.size(); begin += member_size) {
+		auto file = gzopen(gzip_file.c_str(), "ab");
+		auto const size = std::min(member_size, data.size() - begin);
+		Check(file != nullptr && gzwrite(file, data.data() + begin, size) == (int)size);
+		Check(gzclose(file) == Z_OK);
+	}
+}
+#endif
+
+// Writes the data as zstd frames of frame_size bytes that consist of raw
+// blocks, which every zstd decoder reads without a compressor.
+void writeZstdFile(std::string const& zstd_file, std::string const& data, std::size_t frame_size)
+{
+	std::size_t const block_size = 1 << 17;
+	auto putBytes = [](std::string& out, std::uint32_t value, std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) { out.push_back(static_cast<char>(value >> (8*i))); }
+	};
+
+	std::string out;
+	for (std::size_t frame = 0; frame < data.size(); frame += frame_size) {
+		auto const frame_end = std::min(frame + frame_size, data.size());
+		putBytes(out, 0xFD2FB528, 4);
+		// no content size and checksum, a window of 2^17 bytes
+		putBytes(out, 0x00, 1);
+		putBytes(out, 0x38, 1);
+		for (auto block = frame; block < frame_end; block += block_size) {
+			auto const size = std::min(block_size, frame_end - block);
+			auto const last = (block + size == frame_end);
+			putBytes(out, static_cast<std::uint32_t>(size << 3 | last), 3);
+			out.append(data, block, size);
+		}
+	}
+
+	std::ofstream file(zstd_file, std::ios_base::binary);
+	file << out;
+}
+
+// Compares the CSR arrays via the public interface. For weighted graphs, the
+// alias tables are compared by drawing the same samples from both graphs.
+void checkSameGraph(Graph const& graph1, Graph const& graph2)
+{
+	Check(graph1.getNumberOfNodes() == graph2.getNumberOfNodes());
+	Check(graph1.getNumberOfEdges() == graph2.getNumberOfEdges());
+	Check(graph1.isWeighted() == graph2.isWeighted());
+	Check(graph1.getTotalVolume() == graph2.getTotalVolume());
+
+	auto const key = CounterRandom::makeKey(SEED, 0);
+	for (Graph::NodeID node_id = 0; node_id < graph1.getNumberOfNodes(); ++node_id) {
+		auto range1 = graph1.getNeighborRange(node_id);
+		auto range2 = graph2.getNeighborRange(node_id);
+		CheckMessage(graph1.degree(node_id) == graph2.degree(node_id), "node " << node_id);
+		CheckMessage(std::equal(range1.begin(), range1.end(), range2.begin()), "node " << node_id);
+		CheckMessage(graph1.volume(node_id) == graph2.volume(node_id), "node " << node_id);
+
+		if (graph1.isWeighted()) {
+			CounterRandom random1(key, 0, node_id);
+			CounterRandom random2(key, 0, node_id);
+			for (int i = 0; i < 4; ++i) {
+				CheckMessage(graph1.getRandomNeighbor(node_id, random1) ==
+				             graph2.getRandomNeighbor(node_id, random2), "node " << node_id);
+			}
+		}
+	}
+}
+
+void checkSameColoring(Coloring const& coloring1, Coloring const& coloring2)
+{
+	Check(coloring1.size() == coloring2.size());
+	for (std::size_t i = 0; i < coloring1.size(); ++i) {
+		CheckMessage(coloring1.get(i) == coloring2.get(i), "node " << i);
+	}
+}
+
+//
+// Reference implementations
+//
+// Straightforward and slow versions of the core extraction methods, which
+// the optimized ones have to match exactly.
+//
+
+Coloring referenceKRichClub(Graph const& graph)
+{
+	std::vector<Graph::NodeID> order(graph.getNumberOfNodes());
+	for (Graph::NodeID node_id = 0; node_id < order.size(); ++node_id) { order[node_id] = node_id; }
+	std::stable_sort(order.begin(), order.end(), [&](Graph::NodeID a, Graph::NodeID b) {
+		return graph.degree(a) > graph.degree(b);
+	});
+
+	// add the nodes of highest degree to the core until the edges within the
+	// core outnumber the edges within the periphery
+	Coloring coloring(graph.getNumberOfNodes(), Color::Blue);
+	std::size_t core_edges = 0;
+	std::size_t periphery_edges = graph.getNumberOfEdges()/2;
+	for (auto node_id: order) {
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (coloring.get(neighbor) == Color::Red) { ++core_edges; } else { --periphery_edges; }
+		}
+		coloring.set(node_id, Color::Red);
+		if (core_edges > periphery_edges) { break; }
+	}
+
+	return coloring;
+}
+
+// Peels the periphery node of minimum degree (ties by ID) one after the other
+// and returns the densest remaining node set for which the core volume
+// doesn't exceed the periphery volume.
+std::vector<Graph::NodeID> referenceDensestSubgraph(Graph const& graph, Coloring const& coloring,
+                                                    std::size_t vol_c, std::size_t vol_p)
+{
+	auto const n = graph.getNumberOfNodes();
+	std::vector<bool> remaining(n, false);
+	std::vector<std::size_t> degrees(n, 0);
+	std::size_t number_remaining = 0;
+	std::size_t edge_count = 0;
+	for (Graph::NodeID node_id = 0; node_id < n; ++node_id) {
+		if (coloring.get(node_id) != Color::Blue) { continue; }
+		remaining[node_id] = true;
+		degrees[node_id] = graph.degree(node_id);
+		++number_remaining;
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (coloring.get(neighbor) == Color::Blue) { ++edge_count; }
+		}
+		vol_c += graph.degree(node_id);
+		vol_p -= graph.degree(node_id);
+	}
+	edge_count /= 2;
+
+	double max_density = 0;
+	std::vector<Graph::NodeID> densest;
+	for (Graph::NodeID node_id = 0; node_id < n; ++node_id) {
+		if (remaining[node_id]) { densest.push_back(node_id); }
+	}
+
+	while (number_remaining > 0) {
+		Graph::NodeID minimum = n;
+		for (Graph::NodeID node_id = 0; node_id < n; ++node_id) {
+			if (remaining[node_id] && (minimum == n || degrees[node_id] < degrees[minimum])) {
+				minimum = node_id;
+			}
+		}
+
+		remaining[minimum] = false;
+		--number_remaining;
+		for (auto neighbor: graph.getNeighborRange(minimum)) {
+			if (remaining[neighbor]) {
+				--degrees[neighbor];
+				--edge_count;
+			}
+		}
+
+		vol_c -= graph.degree(minimum);
+		vol_p += graph.degree(minimum);
+		if (vol_c > vol_p) { continue; }
+
+		double density = (double)edge_count/number_remaining;
+		if (density > max_density) {
+			max_density = density;
+			densest.clear();
+			for (Graph::NodeID node_id = 0; node_id < n; ++node_id) {
+				if (remaining[node_id]) { densest.push_back(node_id); }
+			}
+		}
+	}
+
+	return (max_density == 0 ? std::vector<Graph::NodeID>() : densest);
+}
+
+Coloring referenceDensestCore(Graph const& graph)
+{
+	Coloring coloring(graph.getNumberOfNodes(), Color::Blue);
+	std::size_t vol_c = 0;
+	std::size_t vol_p = graph.getNumberOfEdges();
+
+	while (true) {
+		auto nodes = referenceDensestSubgraph(graph, coloring, vol_c, vol_p);
+		if (nodes.empty()) { break; }
+
+		for (auto node_id: nodes) {
+			coloring.set(node_id, Color::Red);
+			vol_p -= graph.degree(node_id);
+			vol_c += graph.degree(node_id);
+		}
+	}
+
+	return coloring;
+}
+
+//
+// Simulations
+//
+
+struct SimulationSetup
+{
+	DynamicsType dynamics_type;
+	RoundKernel round_kernel;
+	ParallelOptions parallel_options;
+};
+
+struct Trajectory
+{
+	Results results;
+	// hash of the coloring before every round of every trial
+	std::vector<std::uint64_t> hashes;
+};
+
+Trajectory runTrials(Graph const& graph, SimulationSetup const& setup,
+                     std::size_t number_of_trials, std::int64_t max_rounds, float win_threshold,
+                     std::uint64_t seed = SEED)
+{
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+	Simulation simulation(graph, setup.dynamics_type, initial_coloring, setup.parallel_options);
+	simulation.setRoundKernel(setup.round_kernel);
+	simulation.setSeed(seed);
+
+	Trajectory trajectory;
+	simulation.setCheckpointHandler(0, [&](SimulationState const& state) {
+		trajectory.hashes.push_back(state.hash);
+	});
+	for (std::size_t trial = 0; trial < number_of_trials; ++trial) {
+		trajectory.results.push_back(simulation.run(max_rounds, win_threshold, trial));
+	}
+
+	return trajectory;
+}
+
+void checkSameResult(Result const& result1, Result const& result2)
+{
+	Check(result1.winning_color == result2.winning_color);
+	Check(result1.color_fractions == result2.color_fractions);
+	Check(result1.color_volumes == result2.color_volumes);
+	Check(result1.number_of_rounds == result2.number_of_rounds);
+	Check(result1.stop_reason == result2.stop_reason);
+}
+
+void checkSameTrajectory(Trajectory const& trajectory1, Trajectory const& trajectory2)
+{
+	Check(trajectory1.results.size() == trajectory2.results.size());
+	for (std::size_t i = 0; i < trajectory1.results.size(); ++i) {
+		checkSameResult(trajectory1.results[i], trajectory2.results[i]);
+	}
+	Check(trajectory1.hashes == trajectory2.hashes);
+}
+
+// The trials of runTrials, run by one thread per transport. Every worker
+// returns its own results, which have to be the same.
+std::vector<Results> runPartitionedTrials(Graph const& graph, DynamicsType dynamics_type,
+                                          std::vector<Transport*> const& transports,
+                                          std::size_t number_of_trials, std::int64_t max_rounds,
+                                          float win_threshold)
+{
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+
+	std::vector<Results> results(transports.size());
+	std::vector<std::thread> threads;
+	for (std::size_t rank = 0; rank < transports.size(); ++rank) {
+		threads.emplace_back([&, rank]() {
+			// only read on worker 0
+			PartitionedSimulation simulation(graph, dynamics_type,
+			                                 (rank == 0 ? &initial_coloring : nullptr),
+			                                 *transports[rank]);
+			simulation.setSeed(SEED);
+			for (std::size_t trial = 0; trial < number_of_trials; ++trial) {
+				results[rank].push_back(simulation.run(max_rounds, win_threshold, trial));
+			}
+		});
+	}
+	for (auto& thread: threads) { thread.join(); }
+
+	return results;
+}
+
+// A server running on its own thread, which is stopped and joined at the end
+// of the scope, also if a check fails.
+class ServerThread
+{
+public:
+	explicit ServerThread(std::string const& socket_path)
+		: socket_path(socket_path), server(socket_path, 2), thread(&ExperimentServer::run, &server) {}
+	~ServerThread()
+	{
+		if (thread.joinable()) { stop(); }
+	}
+
+	ServerThread(ServerThread const&) = delete;
+	ServerThread& operator=(ServerThread const&) = delete;
+
+	// Returns whether the server accepted the shutdown.
+	bool stop()
+	{
+		std::stringstream out;
+		auto const stopped = submitJob(socket_path, "shutdown", out);
+		thread.join();
+		return stopped;
+	}
+
+private:
+	std::string const socket_path;
+	ExperimentServer server;
+	std::thread thread;
+};
+
+// Addresses on the loopback interface with ports that were free a moment ago.
+std::vector<std::string> getLoopbackAddresses(std::size_t number_of_addresses)
+{
+	std::vector<std::string> addresses;
+	std::vector<int> fds;
+	for (std::size_t i = 0; i < number_of_addresses; ++i) {
+		sockaddr_in address;
+		std::memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = 0;
+		socklen_t length = sizeof(address);
+
+		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (fd == -1 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+		    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+			throw TestFailure{"No free port on the loopback interface."};
+		}
+		fds.push_back(fd);
+		addresses.push_back("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+	}
+	// kept open until all are chosen, so the ports are distinct
+	for (auto fd: fds) { ::close(fd); }
+
+	return addresses;
+}
+
+Results runMultiColorTrials(Graph const& graph, DynamicsType dynamics_type,
+                            PackedColoring const& initial_coloring, std::size_t h,
+                            ParallelOptions const& parallel_options,
+                            std::size_t number_of_trials, std::int64_t max_rounds,
+                            float win_threshold)
+{
+	MultiColorSimulation simulation(graph, dynamics_type, initial_coloring, h, parallel_options);
+	simulation.setSeed(SEED);
+
+	Results results;
+	for (std::size_t trial = 0; trial < number_of_trials; ++trial) {
+		results.push_back(simulation.run(max_rounds, win_threshold, trial));
+
+		// the incrementally updated counts and volumes match a recount
+		auto const& coloring = simulation.getColoring();
+		std::vector<std::size_t> counts(coloring.getNumberOfColors(), 0);
+		std::vector<double> volumes(coloring.getNumberOfColors(), 0.);
+		for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+			++counts[static_cast<std::size_t>(coloring.get(node_id))];
+			volumes[static_cast<std::size_t>(coloring.get(node_id))] += graph.volume(node_id);
+		}
+		Check(coloring.getCounts() == counts);
+		for (std::size_t i = 0; i < volumes.size(); ++i) {
+			Check(simulation.getColorVolumes()[i] == (float)(volumes[i]/graph.getTotalVolume()));
+		}
+	}
+
+	return results;
+}
+
+// The asynchronous dynamics without skipping steps: in every step, a node
+// drawn uniformly at random updates its color. Runs until consensus, but at
+// most max_steps steps, and returns the number of steps. Every step has its
+// own stream, as the three consecutive numbers of a step from Random are
+// correlated enough to keep the last minority nodes from flipping. With
+// stream 1, the steps are the ones AsyncSimulation draws one by one.
+std::uint64_t runRandomSequentialUpdates(Graph const& graph, DynamicsType dynamics_type,
+                                         Coloring& coloring, std::uint64_t random_key,
+                                         std::uint64_t max_steps = UINT64_MAX,
+                                         std::uint64_t stream = 0)
+{
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	std::size_t number_of_blue_nodes = 0;
+	for (Graph::NodeID node_id = 0; node_id < number_of_nodes; ++node_id) {
+		number_of_blue_nodes += (coloring.get(node_id) == Color::Blue);
+	}
+
+	std::uint64_t steps = 0;
+	while (number_of_blue_nodes != 0 && number_of_blue_nodes != number_of_nodes &&
+	       steps < max_steps) {
+		CounterRandom random(random_key, stream, steps);
+		++steps;
+		auto const node_id = random.getSizeT(0, number_of_nodes - 1);
+		auto const old_color = coloring.get(node_id);
+		auto new_color = coloring.get(graph.getRandomNeighbor(node_id, random));
+		if (dynamics_type == DynamicsType::TwoChoices &&
+		    coloring.get(graph.getRandomNeighbor(node_id, random)) != new_color) {
+			new_color = old_color;
+		}
+
+		if (new_color != old_color) {
+			coloring.set(node_id, new_color);
+			number_of_blue_nodes += (new_color == Color::Blue ? 1 : -1);
+		}
+	}
+
+	return steps;
+}
+
+// Whether two samples have the same mean, given their sums and sums of squares.
+void checkSameMean(std::size_t count, double sum1, double square_sum1,
+                   double sum2, double square_sum2)
+{
+	auto const mean1 = sum1/count, mean2 = sum2/count;
+	auto const variance1 = square_sum1/count - mean1*mean1;
+	auto const variance2 = square_sum2/count - mean2*mean2;
+	auto const sigma = std::sqrt((variance1 + variance2)/count);
+	CheckMessage(std::abs(mean1 - mean2) < 4.5*sigma,
+	             "means " << mean1 << " and " << mean2 << ", sigma " << sigma);
+}
+
+// Chi-square statistic of the observed counts for the expected probabilities
+// and an upper bound that it only exceeds with probability 1e-4 (Wilson-
+// Hilferty approximation).
+void checkDistribution(std::vector<std::size_t> const& counts,
+                       std::vector<double> const& probabilities)
+{
+	double total = 0;
+	for (auto count: counts) { total += count; }
+
+	double chi_square = 0;
+	for (std::size_t i = 0; i < counts.size(); ++i) {
+		auto expected = total*probabilities[i];
+		chi_square += (counts[i] - expected)*(counts[i] - expected)/expected;
+	}
+
+	double const df = counts.size() - 1;
+	double const z = 3.719;
+	auto bound = df*std::pow(1 - 2/(9*df) + z*std::sqrt(2/(9*df)), 3);
+	CheckMessage(chi_square < bound, "chi-square " << chi_square << " >= " << bound);
+}
+
+// fastest of the repetitions
+template <typename Function>
+double minimumSeconds(std::size_t repetitions, Function fn)
+{
+	auto seconds = std::numeric_limits<double>::max();
+	for (std::size_t i = 0; i < repetitions; ++i) {
+		auto start = Clock::now();
+		fn();
+		seconds = std::min(seconds, secondsSince(start));
+	}
+	return seconds;
+}
+
+// The optimized path may be at most this factor slower than its reference,
+// which leaves room for the noise of shared machines.
+double const TIMING_TOLERANCE = 1.5;
+
+//
+// Tests
+//
+
+std::vector<UnitTest> const UNIT_TESTS = {
+
+{"csr/generator_matches_edge_builder", []() {
+	for (auto const& spec: GENERATOR_SPECS) {
+		Graph reference;
+		reference.buildFromEdges(spec, generateEdges(spec));
+		checkSameGraph(buildGraph(spec), reference);
+	}
+}, false},
+
+{"csr/generator_is_deterministic", []() {
+	for (auto const& spec: GENERATOR_SPECS) {
+		checkSameGraph(buildGraph(spec), buildGraph(spec));
+	}
+	// the edges only depend on their index, not on the chunks
+	for (auto const& spec: GENERATOR_SPECS) {
+		auto generator = createEdgeGenerator(spec);
+		for (std::size_t chunk_size: {1, 1000}) {
+			Graph graph;
+			graph.buildFromGenerator(spec, *generator, chunk_size);
+			checkSameGraph(graph, buildGraph(spec));
+		}
+	}
+	auto other_seed = buildGraph("gen:er:n=3000:d=6:seed=4");
+	auto graph = buildGraph(GENERATOR_SPECS[0]);
+	Check(other_seed.getNumberOfEdges() != graph.getNumberOfEdges() ||
+	      !std::equal(graph.getNeighborRange(0).begin(), graph.getNeighborRange(0).end(),
+	                  other_seed.getNeighborRange(0).begin()));
+}, false},
+
+{"csr/binary_file_matches_edge_list", []() {
+	for (bool weighted: {false, true}) {
+		TemporaryFile edge_list, binary;
+		writeEdgeList(edge_list.get(), generateEdges(GENERATOR_SPECS[1]), weighted);
+		auto graph = buildGraph(edge_list.get());
+		graph.writeBinaryFile(binary.get());
+
+		auto mapped = buildGraph(binary.get());
+		Check(mapped.isMapped());
+		checkSameGraph(mapped, graph);
+
+		// files that don't match their header exactly are rejected
+		auto const content = readFile(binary.get());
+		binary_graph::Header header;
+		std::memcpy(&header, content.data(), sizeof(header));
+		auto moved_neighbors = header;
+		moved_neighbors.neighbors_position += binary_graph::ALIGNMENT;
+		// and so are arrays that would lead to reads out of bounds
+		auto replace = [&](std::size_t position, std::uint64_t value, std::size_t size) {
+			auto changed = content;
+			std::memcpy(&changed[position], &value, size);
+			return changed;
+		};
+		std::vector<std::string> corrupt_contents = {
+			content.substr(0, content.size() - 1),
+			content + std::string(binary_graph::ALIGNMENT, '\0'),
+			std::string(reinterpret_cast<char const*>(&moved_neighbors), sizeof(moved_neighbors)) +
+			content.substr(sizeof(moved_neighbors)),
+			// the offsets of node 1 behind the ones of node 2
+			replace(header.offsets_position + sizeof(std::uint64_t), graph.getNumberOfEdges(), 8),
+			replace(header.neighbors_position, graph.getNumberOfNodes(), 8)
+		};
+		if (weighted) {
+			corrupt_contents.push_back(replace(header.alias_indices_position, graph.degree(0), 4));
+		}
+		for (std::size_t i = 0; i < corrupt_contents.size(); ++i) {
+			TemporaryFile corrupt;
+			std::ofstream(corrupt.get(), std::ios_base::binary) << corrupt_contents[i];
+			setErrorsThrow(true);
+			bool rejected = false;
+			try {
+				buildGraph(corrupt.get());
+			}
+			catch (ErrorException const&) {
+				rejected = true;
+			}
+			CheckMessage(rejected, "file " << i);
+
+			// a file that is only loaded in part is checked by the nodes it visits
+			if (i >= 3) {
+				Graph unchecked;
+				unchecked.buildFromFile(corrupt.get(), false);
+				rejected = false;
+				try {
+					unchecked.checkMappedNodes(0, 3);
+				}
+				catch (ErrorException const&) {
+					rejected = true;
+				}
+				CheckMessage(rejected, "file " << i);
+				unchecked.checkMappedNodes(3, unchecked.getNumberOfNodes());
+			}
+			setErrorsThrow(false);
+		}
+	}
+}, false},
+
+{"csr/external_builder_matches_edge_list", []() {
+	for (auto const& spec: GENERATOR_SPECS) {
+		TemporaryFile edge_list, binary;
+		writeEdgeList(edge_list.get(), generateEdges(spec), false);
+
+		// small runs, so that several merge passes are needed
+		ExternalGraphBuilder builder(1 << 14);
+		builder.build(edge_list.get(), binary.get());
+		checkSameGraph(buildGraph(binary.get()), buildGraph(edge_list.get()));
+	}
+}, false},
+
+{"csr/updates_match_rebuild", []() {
+	auto graph = buildGraph(GENERATOR_SPECS[2]);
+	auto const number_of_nodes = graph.getNumberOfNodes();
+	std::set<Graph::Edge> edges;
+	std::vector<std::size_t> degrees(number_of_nodes);
+	for (Graph::NodeID node_id = 0; node_id < number_of_nodes; ++node_id) {
+		degrees[node_id] = graph.degree(node_id);
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			if (node_id < neighbor) { edges.emplace(node_id, neighbor); }
+		}
+	}
+
+	Random random(SEED);
+	for (std::size_t batch = 0; batch < 20; ++batch) {
+		// random edges, some existing ones and loops, and a hub that outgrows
+		// its free slots and those of its windows
+		Graph::Edges insertions, deletions;
+		for (std::size_t i = 0; i < 100 + 20*batch; ++i) {
+			insertions.emplace_back(random.getSizeT(0, number_of_nodes - 1),
+			                        random.getSizeT(0, number_of_nodes - 1));
+		}
+		auto const hub = 7*batch % 50;
+		for (std::size_t i = 0; i < 60; ++i) {
+			insertions.emplace_back(hub, random.getSizeT(0, number_of_nodes - 1));
+		}
+		insertions.push_back(*edges.begin());
+		insertions.emplace_back(hub, hub);
+
+		// deleted and inserted again in the same batch, so it is kept
+		auto const kept = *std::next(edges.begin(), random.getSizeT(0, edges.size() - 1));
+		deletions.push_back(kept);
+		insertions.emplace_back(kept.second, kept.first);
+		for (std::size_t i = 0; i < 80; ++i) {
+			auto edge = *std::next(edges.begin(), random.getSizeT(0, edges.size() - 1));
+			if (degrees[edge.first] > 2 && degrees[edge.second] > 2 && edge != kept) {
+				deletions.push_back(edge);
+				edges.erase(edge);
+				--degrees[edge.first];
+				--degrees[edge.second];
+			}
+		}
+		deletions.emplace_back(0, 0);
+
+		graph.updateEdges(insertions, deletions);
+		for (auto const& edge: insertions) {
+			if (edge.first == edge.second) { continue; }
+			if (edges.emplace(std::min(edge.first, edge.second), std::max(edge.first, edge.second)).second) {
+				++degrees[edge.first];
+				++degrees[edge.second];
+			}
+		}
+
+		Graph reference;
+		reference.buildFromEdges(graph.getFilename(), Graph::Edges(edges.begin(), edges.end()));
+		Check(reference.getNumberOfNodes() == number_of_nodes);
+		checkSameGraph(graph, reference);
+	}
+	Check(graph.degree(0) > 100);
+
+	// a batch that would leave a node without neighbors changes nothing
+	Graph::NodeID leaf = std::min_element(degrees.begin(), degrees.end()) - degrees.begin();
+	Graph::Edges leaf_edges;
+	for (auto neighbor: graph.getNeighborRange(leaf)) { leaf_edges.emplace_back(leaf, neighbor); }
+
+	setErrorsThrow(true);
+	bool rejected = false;
+	try {
+		graph.updateEdges({{0, 1}}, leaf_edges);
+	}
+	catch (ErrorException const&) {
+		rejected = true;
+	}
+	setErrorsThrow(false);
+	Check(rejected);
+
+	Graph reference;
+	reference.buildFromEdges(graph.getFilename(), Graph::Edges(edges.begin(), edges.end()));
+	checkSameGraph(graph, reference);
+}, false},
+
+{"csr/compressed_edge_lists_match", []() {
+	// several chunks of the decompressing thread
+	TemporaryFile edge_list;
+	writeEdgeList(edge_list.get(), generateEdges("gen:er:n=50000:d=8:seed=17"), true);
+	auto const data = readFile(edge_list.get());
+	Check(data.size() > 2*compressed_input::CHUNK_SIZE);
+	auto graph = buildGraph(edge_list.get());
+
+	std::vector<std::string> compressed_files;
+	TemporaryFile gzip_file(".gz"), zstd_file(".zst");
+#ifdef HAVE_ZLIB
+	writeGzipFile(gzip_file.get(), data, data.size()/3);
+	compressed_files.push_back(gzip_file.get());
+#endif
+	if (isZstdSupported()) {
+		writeZstdFile(zstd_file.get(), data, data.size()/3);
+		compressed_files.push_back(zstd_file.get());
+	}
+
+	for (auto const& compressed_file: compressed_files) {
+		checkSameGraph(buildGraph(compressed_file), graph);
+
+		// a truncated file is an error, not a smaller graph
+		auto const compressed = readFile(compressed_file);
+		TemporaryFile truncated(compressed_file.substr(compressed_file.rfind('.')));
+		std::ofstream(truncated.get(), std::ios_base::binary) << compressed.substr(0, compressed.size() - 100);
+		setErrorsThrow(true);
+		bool rejected = false;
+		try {
+			buildGraph(truncated.get());
+		}
+		catch (ErrorException const&) {
+			rejected = true;
+		}
+		setErrorsThrow(false);
+		CheckMessage(rejected, compressed_file);
+	}
+}, false},
+
+{"csr/graph_pool_matches_edge_lists", []() {
+	TemporaryFile container_file, directory;
+	writeGraphContainer(container_file.get());
+	GraphPool pool(container_file.get());
+	Check(pool.size() == SMALL_GENERATOR_SPECS.size());
+
+	// the same graphs as single edge lists and as the files of a directory
+	std::remove(directory.get().c_str());
+	Check(mkdir(directory.get().c_str(), 0700) == 0);
+	std::vector<std::string> files;
+	for (std::size_t i = 0; i < SMALL_GENERATOR_SPECS.size(); ++i) {
+		auto edges = generateEdges(SMALL_GENERATOR_SPECS[i]);
+		edges.emplace_back(edges[0].first, edges[0].first);
+		edges.push_back(edges[1]);
+		files.push_back(directory.get() + "/g" + std::to_string(i));
+		writeEdgeList(files.back(), edges, false);
+	}
+	GraphPool directory_pool(directory.get());
+
+	for (std::size_t i = 0; i < SMALL_GENERATOR_SPECS.size(); ++i) {
+		auto graph = buildGraph(files[i]);
+		CheckMessage(pool.getGraph(i).getFilename() == "g" + std::to_string(i), i);
+		checkSameGraph(pool.getGraph(i), graph);
+		checkSameGraph(directory_pool.getGraph(i), graph);
+	}
+
+	for (auto const& file: files) { std::remove(file.c_str()); }
+	rmdir(directory.get().c_str());
+}, false},
+
+{"core/k_rich_club_matches_reference", []() {
+	for (auto const& spec: GENERATOR_SPECS) {
+		auto graph = buildGraph(spec);
+		checkSameColoring(calculateCorePeripheryColoring(graph, CPMethod::KRichClub),
+		                  referenceKRichClub(graph));
+	}
+}, false},
+
+{"core/densest_core_matches_reference", []() {
+	for (auto const& spec: {GENERATOR_SPECS[1], GENERATOR_SPECS[3],
+	                        std::string("../exp_data/graphs/email-core.txt")}) {
+		auto graph = buildGraph(spec);
+		checkSameColoring(calculateCorePeripheryColoring(graph, CPMethod::DensestCore),
+		                  referenceDensestCore(graph));
+	}
+}, false},
+
+{"core/same_on_mapped_graph", []() {
+	TemporaryFile binary;
+	auto graph = buildGraph(GENERATOR_SPECS[2]);
+	graph.writeBinaryFile(binary.get());
+	auto mapped = buildGraph(binary.get());
+	for (auto method: {CPMethod::KRichClub, CPMethod::DensestCore}) {
+		checkSameColoring(calculateCorePeripheryColoring(mapped, method),
+		                  calculateCorePeripheryColoring(graph, method));
+	}
+}, false},
+
+{"dynamics/kernels_and_threads_identical", []() {
+	TemporaryFile weighted_edge_list;
+	writeEdgeList(weighted_edge_list.get(), generateEdges(GENERATOR_SPECS[0]), true);
+
+	ParallelOptions sequential;
+	ParallelOptions threads;
+	threads.number_of_threads = 3;
+	ParallelOptions numa;
+	numa.number_of_threads = 2;
+	numa.simulated_numa_nodes = 2;
+
+	for (auto const& graph_file: {GENERATOR_SPECS[1], GENERATOR_SPECS[2], weighted_edge_list.get()}) {
+		auto graph = buildGraph(graph_file);
+		for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+			auto reference = runTrials(graph, {dynamics_type, RoundKernel::Reference, sequential},
+			                           4, 30, 0.9);
+			for (auto const& setup: {SimulationSetup{dynamics_type, RoundKernel::Blocked, sequential},
+			                         SimulationSetup{dynamics_type, RoundKernel::Reference, threads},
+			                         SimulationSetup{dynamics_type, RoundKernel::Blocked, threads},
+			                         SimulationSetup{dynamics_type, RoundKernel::Blocked, numa},
+			                         SimulationSetup{dynamics_type, RoundKernel::DegreeClasses, sequential},
+			                         SimulationSetup{dynamics_type, RoundKernel::DegreeClasses, threads}}) {
+				checkSameTrajectory(runTrials(graph, setup, 4, 30, 0.9), reference);
+			}
+		}
+	}
+}, false},
+
+{"dynamics/resume_identical", []() {
+	auto graph = buildGraph(GENERATOR_SPECS[1]);
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+	Simulation simulation(graph, DynamicsType::TwoChoices, initial_coloring);
+	simulation.setSeed(SEED);
+
+	std::vector<SimulationState> states;
+	simulation.setCheckpointHandler(0, [&](SimulationState const& state) {
+		states.push_back(state);
+	});
+	auto result = simulation.run(40, 0.95, 3);
+	Check(states.size() > 2);
+
+	simulation.setCheckpointHandler(0, nullptr);
+	for (auto const& state: {states[1], states[states.size()/2], states.back()}) {
+		checkSameResult(simulation.run(40, 0.95, 3, &state), result);
+	}
+}, false},
+
+{"server/results_identical", []() {
+	TemporaryFile socket_file, experiments_file;
+	auto const socket_path = socket_file.get() + ".sock";
+
+	// without threads, no trial would ever run
+	bool rejected = false;
+	setErrorsThrow(true);
+	try {
+		ExperimentServer server_without_threads(socket_path, 0);
+	}
+	catch (ErrorException const&) {
+		rejected = true;
+	}
+	setErrorsThrow(false);
+	Check(rejected);
+
+	ServerThread server(socket_path);
+
+	auto const& graph_file = GENERATOR_SPECS[1];
+	{
+		std::ofstream file(experiments_file.get());
+		file << "# comment\n";
+		file << graph_file << " VoterModel KRichClub 30 0.9 4 seed=" << SEED << "\n";
+		file << graph_file << " TwoChoices KRichClub 30 0.9 3 seed=" << SEED << " kernel=blocked\n";
+		file << "missing_graph_file VoterModel KRichClub 30 0.9 1\n";
+	}
+
+	auto graph = buildGraph(graph_file);
+	std::vector<std::string> expected;
+	auto voter = runTrials(graph, {DynamicsType::VoterModel, RoundKernel::Reference, {}}, 4, 30, 0.9);
+	auto two_choices = runTrials(graph, {DynamicsType::TwoChoices, RoundKernel::Blocked, {}}, 3, 30, 0.9);
+	for (std::size_t trial = 0; trial < voter.results.size(); ++trial) {
+		expected.push_back("result 0 " + std::to_string(trial) + ": " + toString(voter.results[trial]));
+	}
+	for (std::size_t trial = 0; trial < two_choices.results.size(); ++trial) {
+		expected.push_back("result 1 " + std::to_string(trial) + ": " + toString(two_choices.results[trial]));
+	}
+	std::sort(expected.begin(), expected.end());
+
+	// the second job is served from the caches
+	for (std::string cached: {"loaded", "cached"}) {
+		std::stringstream out;
+		Check(!submitJob(socket_path, experiments_file.get(), out));
+
+		std::vector<std::string> results;
+		std::size_t number_of_errors = 0, number_of_cached = 0;
+		std::string line;
+		while (std::getline(out, line)) {
+			if (line.compare(0, 6, "result") == 0) { results.push_back(line); }
+			if (line.compare(0, 7, "error 2") == 0) { ++number_of_errors; }
+			if (line.find("graph=" + cached) != std::string::npos) { ++number_of_cached; }
+		}
+		std::sort(results.begin(), results.end());
+		Check(results == expected);
+		Check(number_of_errors == 1);
+		Check(number_of_cached == (cached == "loaded" ? 1u : 2u));
+	}
+
+	Check(server.stop());
+}, false},
+
+{"server/reloads_changed_graphs", []() {
+	TemporaryFile socket_file, graph_file, experiments_file;
+	auto const socket_path = socket_file.get() + ".sock";
+	ServerThread server(socket_path);
+	std::ofstream(experiments_file.get()) << graph_file.get() << " VoterModel KRichClub 30 0.9 1 seed="
+	                                      << SEED << "\n";
+
+	// the experiment line of the response
+	auto submit = [&]() {
+		std::stringstream out;
+		Check(submitJob(socket_path, experiments_file.get(), out));
+		std::string line;
+		while (std::getline(out, line) && line.compare(0, 10, "experiment") != 0) {}
+		return line;
+	};
+
+	writeEdgeList(graph_file.get(), generateEdges(SMALL_GENERATOR_SPECS[0]), false);
+	auto const number_of_nodes = buildGraph(graph_file.get()).getNumberOfNodes();
+	Check(submit().find("graph=loaded") != std::string::npos);
+	Check(submit().find("graph=cached coloring=cached") != std::string::npos);
+
+	// a changed file is loaded again, with a new core coloring
+	writeEdgeList(graph_file.get(), generateEdges(SMALL_GENERATOR_SPECS[1]), false);
+	auto const changed_number_of_nodes = buildGraph(graph_file.get()).getNumberOfNodes();
+	Check(changed_number_of_nodes != number_of_nodes);
+	auto const line = submit();
+	Check(line.find("graph=loaded coloring=computed") != std::string::npos);
+	Check(line.find(" nodes=" + std::to_string(changed_number_of_nodes) + " ") != std::string::npos);
+
+	Check(server.stop());
+}, false},
+
+{"batch/results_identical", []() {
+	TemporaryFile container_file, experiments_file;
+	writeGraphContainer(container_file.get());
+	// skipped instead of ending the batch
+	std::ofstream(container_file.get(), std::ios_base::app) << "graph empty\n";
+	{
+		std::ofstream file(experiments_file.get());
+		file << container_file.get() << " VoterModel KRichClub 30 0.9 3 seed=" << SEED << "\n";
+		file << container_file.get() << " TwoChoices KRichClub 30 0.9 2 seed=" << SEED << " kernel=blocked\n";
+		file << container_file.get() << " TwoChoices KRichClub 30 0.9 2 seed=" << SEED << " update=async\n";
+	}
+
+	// the result lines of every experiment in the order of the graphs, each
+	// with its own seed
+	GraphPool pool(container_file.get());
+	Check(pool.size() == SMALL_GENERATOR_SPECS.size());
+	std::vector<std::string> expected;
+	for (auto const& setup: {SimulationSetup{DynamicsType::VoterModel, RoundKernel::Reference, {}},
+	                         SimulationSetup{DynamicsType::TwoChoices, RoundKernel::Blocked, {}}}) {
+		auto const number_of_trials = (setup.dynamics_type == DynamicsType::VoterModel ? 3 : 2);
+		for (std::size_t i = 0; i < pool.size(); ++i) {
+			auto const& graph = pool.getGraph(i);
+			auto const seed = CounterRandom::makeKey(SEED, i);
+			auto trajectory = runTrials(graph, setup, number_of_trials, 30, 0.9, seed);
+			for (std::size_t trial = 0; trial < trajectory.results.size(); ++trial) {
+				std::stringstream line;
+				line << graph.getFilename() << " " << graph.getNumberOfNodes() << " "
+				     << graph.getNumberOfEdges()/2 << " " << seed << " " << trial << ": "
+				     << toString(trajectory.results[trial]);
+				expected.push_back(line.str());
+			}
+		}
+	}
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		auto const& graph = pool.getGraph(i);
+		AsyncSimulation simulation(graph, DynamicsType::TwoChoices,
+		                           calculateCorePeripheryColoring(graph, CPMethod::KRichClub));
+		auto const seed = CounterRandom::makeKey(SEED, i);
+		simulation.setSeed(seed);
+		for (std::size_t trial = 0; trial < 2; ++trial) {
+			std::stringstream line;
+			line << graph.getFilename() << " " << graph.getNumberOfNodes() << " "
+			     << graph.getNumberOfEdges()/2 << " " << seed << " " << trial << ": "
+			     << toString(simulation.run(30, 0.9, trial));
+			expected.push_back(line.str());
+		}
+	}
+
+	std::string first_output;
+	for (std::size_t number_of_threads: {1, 3}) {
+		TemporaryFile result_file;
+		BatchExperiments(experiments_file.get(), result_file.get(), number_of_threads).run();
+
+		std::ifstream file(result_file.get());
+		std::string output((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		std::vector<std::string> results;
+		std::stringstream lines(output);
+		std::string line;
+		while (std::getline(lines, line)) {
+			if (line.compare(0, 1, "g") == 0) { results.push_back(line); }
+		}
+		CheckMessage(results == expected, number_of_threads);
+
+		if (first_output.empty()) { first_output = output; }
+		Check(output == first_output);
+	}
+
+	// without threads, the result file would only get the headers
+	TemporaryFile result_file;
+	bool rejected = false;
+	setErrorsThrow(true);
+	try {
+		BatchExperiments(experiments_file.get(), result_file.get(), 0).run();
+	}
+	catch (ErrorException const&) {
+		rejected = true;
+	}
+	setErrorsThrow(false);
+	Check(rejected);
+	Check(readFile(result_file.get()).empty());
+}, false},
+
+{"distributed/partitioned_matches_simulation", []() {
+	TemporaryFile binary;
+	buildGraph(GENERATOR_SPECS[0]).writeBinaryFile(binary.get());
+
+	// the runs to a win threshold above one end in fixed points or oscillations
+	std::size_t number_of_verified_stops = 0;
+	for (auto const& graph_file: {GENERATOR_SPECS[1], GENERATOR_SPECS[3], binary.get()}) {
+		auto graph = buildGraph(graph_file);
+		for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+			for (auto win_threshold: {0.9f, 1.1f}) {
+				auto reference = runTrials(graph, {dynamics_type, RoundKernel::Reference, {}},
+				                           3, 60, win_threshold);
+				for (auto const& result: reference.results) {
+					if (result.stop_reason == StopReason::FixedPoint ||
+					    result.stop_reason == StopReason::Oscillation) {
+						++number_of_verified_stops;
+					}
+				}
+
+				for (std::size_t number_of_workers: {1, 2, 5}) {
+					auto group = LocalTransport::createGroup(number_of_workers);
+					std::vector<Transport*> transports;
+					for (auto& transport: group) { transports.push_back(transport.get()); }
+
+					auto results = runPartitionedTrials(graph, dynamics_type, transports,
+					                                    3, 60, win_threshold);
+					for (auto const& worker_results: results) {
+						Check(worker_results.size() == reference.results.size());
+						for (std::size_t trial = 0; trial < worker_results.size(); ++trial) {
+							checkSameResult(worker_results[trial], reference.results[trial]);
+						}
+					}
+				}
+			}
+		}
+	}
+	Check(number_of_verified_stops > 0);
+}, false},
+
+{"distributed/tcp_workers_match_experiments", []() {
+	TemporaryFile experiments_file, result_prefix, binary;
+	buildGraph(GENERATOR_SPECS[1]).writeBinaryFile(binary.get());
+	auto const& graph_file = binary.get();
+	{
+		std::ofstream file(experiments_file.get());
+		file << graph_file << " VoterModel KRichClub 30 0.9 3 seed=" << SEED << "\n";
+		// the seed is drawn by every worker, but the one of worker 0 is used
+		file << graph_file << " TwoChoices KRichClub 30 0.9 2\n";
+	}
+
+	auto const addresses = getLoopbackAddresses(3);
+	std::vector<std::thread> threads;
+	for (std::size_t rank = 0; rank < addresses.size(); ++rank) {
+		threads.emplace_back([&, rank]() {
+			TcpTransport transport(rank, addresses);
+			DistributedExperiments(experiments_file.get(), result_prefix.get(), transport).run();
+		});
+	}
+	for (auto& thread: threads) { thread.join(); }
+
+	auto graph = buildGraph(graph_file);
+	for (std::size_t id = 0; id < 2; ++id) {
+		auto const result_file = result_prefix.get() + std::to_string(id);
+		std::ifstream file(result_file);
+		std::vector<std::string> results;
+		std::uint64_t seed = 0;
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.compare(0, 5, "Round") == 0) { results.push_back(line); }
+			if (line.compare(0, 6, "Seed: ") == 0) { seed = std::stoull(line.substr(6)); }
+		}
+		std::remove(result_file.c_str());
+
+		auto const dynamics_type = (id == 0 ? DynamicsType::VoterModel : DynamicsType::TwoChoices);
+		auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+		Simulation simulation(graph, dynamics_type, initial_coloring);
+		simulation.setSeed(seed);
+		std::vector<std::string> expected;
+		for (std::size_t trial = 0; trial < (id == 0 ? 3u : 2u); ++trial) {
+			expected.push_back("Round " + std::to_string(trial) + ": " +
+			                   toString(simulation.run(30, 0.9, trial)));
+		}
+		CheckMessage(results == expected, "experiment " << id);
+		Check(id == 1 || seed == SEED);
+	}
+}, false},
+
+{"experiments/ledger_skips_recorded_trials", []() {
+	TemporaryFile experiments_file, result_prefix, binary;
+	buildGraph(GENERATOR_SPECS[0]).writeBinaryFile(binary.get());
+	auto const ledger_file = result_prefix.get() + "ledger";
+	auto writeExperiments = [&](std::size_t voter_trials, bool with_new_line) {
+		std::ofstream file(experiments_file.get());
+		file << GENERATOR_SPECS[1] << " VoterModel KRichClub 30 0.9 " << voter_trials << "\n";
+		file << binary.get() << " TwoChoices KRichClub 30 0.9 2 seed=" << SEED << "\n";
+		if (with_new_line) {
+			file << binary.get() << " VoterModel KRichClub 30 0.9 2 seed=" << SEED << "\n";
+		}
+	};
+	auto runExperiments = [&]() {
+		CheckpointOptions checkpoint_options;
+		checkpoint_options.interval_seconds = 0;
+		Experiments(experiments_file.get(), result_prefix.get(), ParallelOptions(),
+		            checkpoint_options).run();
+	};
+	auto countResults = [&]() {
+		std::stringstream lines(readFile(ledger_file));
+		std::size_t number_of_results = 0;
+		std::string line;
+		while (std::getline(lines, line)) {
+			if (line.compare(0, 7, "result ") == 0) { ++number_of_results; }
+		}
+		return number_of_results;
+	};
+
+	writeExperiments(3, false);
+	runExperiments();
+	auto const first_output = readFile(result_prefix.get() + "0");
+	auto const second_output = readFile(result_prefix.get() + "1");
+	Check(countResults() == 5);
+
+	// the result files are rewritten instead of appended to, and the drawn
+	// seed of the first line is reused
+	runExperiments();
+	Check(readFile(result_prefix.get() + "0") == first_output);
+	Check(readFile(result_prefix.get() + "1") == second_output);
+	Check(countResults() == 5);
+
+	// a record cut off by an interruption is dropped
+	std::ofstream(ledger_file, std::ios_base::app) << "result 12";
+	writeExperiments(4, true);
+	runExperiments();
+	// the number of trials is not part of the key
+	auto const old_rounds = first_output.substr(first_output.find("Round 0: "));
+	auto const output = readFile(result_prefix.get() + "0");
+	auto const new_rounds = output.substr(output.find("Round 0: "));
+	Check(new_rounds.compare(0, old_rounds.size(), old_rounds) == 0);
+	Check(new_rounds.find("Round 3: ") == old_rounds.size());
+	Check(readFile(result_prefix.get() + "1") == second_output);
+	Check(readFile(result_prefix.get() + "2").find("Round 1: ") != std::string::npos);
+	Check(countResults() == 8);
+
+	std::ofstream(ledger_file, std::ios_base::app) << "result 12\n";
+	setErrorsThrow(true);
+	bool rejected = false;
+	try {
+		runExperiments();
+	}
+	catch (ErrorException const&) {
+		rejected = true;
+	}
+	setErrorsThrow(false);
+	Check(rejected);
+
+	for (auto const& suffix: {"0", "1", "2", "ledger"}) {
+		std::remove((result_prefix.get() + suffix).c_str());
+	}
+}, false},
+
+{"dynamics/continue_on_updated_graph", []() {
+	// the degree classes have to be rebuilt after the update
+	for (auto round_kernel: {RoundKernel::Reference, RoundKernel::DegreeClasses}) {
+		auto graph = buildGraph(GENERATOR_SPECS[1]);
+		auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+		Simulation simulation(graph, DynamicsType::TwoChoices, initial_coloring);
+		simulation.setRoundKernel(round_kernel);
+		simulation.setSeed(SEED);
+		simulation.run(10, 1, 2);
+		auto state = simulation.getFinalState();
+		Check(state.round == 10);
+
+		// every node gets an edge to its successor
+		Graph::Edges insertions;
+		for (Graph::NodeID node_id = 0; node_id + 1 < graph.getNumberOfNodes(); ++node_id) {
+			insertions.emplace_back(node_id, node_id + 1);
+		}
+		graph.updateEdges(insertions, {});
+		auto result = simulation.run(30, 0.95, 2, &state);
+
+		std::vector<Graph::Edge> edges;
+		for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+			for (auto neighbor: graph.getNeighborRange(node_id)) { edges.emplace_back(node_id, neighbor); }
+		}
+		Graph rebuilt;
+		rebuilt.buildFromEdges(graph.getFilename(), edges);
+		Simulation rebuilt_simulation(rebuilt, DynamicsType::TwoChoices, initial_coloring);
+		rebuilt_simulation.setSeed(SEED);
+		checkSameResult(rebuilt_simulation.run(30, 0.95, 2, &state), result);
+	}
+}, false},
+
+// A fixed point needs a single color per component, so without a win it is
+// only found on a graph that fell apart.
+{"dynamics/fixed_point_on_several_components", []() {
+	// two triangles joined by the edge from 2 to 3
+	Graph graph;
+	graph.buildFromEdges("triangles", {{0, 1}, {1, 2}, {0, 2}, {2, 3}, {3, 4}, {4, 5}, {3, 5}});
+	Coloring initial_coloring(graph.getNumberOfNodes(), Color::Red);
+	for (Graph::NodeID node_id = 3; node_id < 6; ++node_id) {
+		initial_coloring.set(node_id, Color::Blue);
+	}
+
+	for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+		Simulation simulation(graph, dynamics_type, initial_coloring);
+		simulation.setSeed(SEED);
+		// a round without flips isn't a fixed point as long as the triangles are joined
+		auto result = simulation.run(-1, 0.9, 0);
+		Check(result.stop_reason != StopReason::FixedPoint);
+	}
+
+	graph.updateEdges({}, {{2, 3}});
+	for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+		Simulation simulation(graph, dynamics_type, initial_coloring);
+		simulation.setSeed(SEED);
+		auto result = simulation.run(-1, 0.9, 0);
+		Check(result.stop_reason == StopReason::FixedPoint && result.number_of_rounds == 1);
+		Check(result.color_fractions[0] == 0.5f);
+	}
+}, false},
+
+{"coloring/packed_get_set", []() {
+	Random random(SEED);
+	std::size_t const size = 1000;
+	for (std::size_t number_of_colors: {2, 3, 4, 5, 16, 17, 255}) {
+		PackedColoring coloring(size, number_of_colors);
+		std::vector<Color> colors(size, Color::Red);
+		for (std::size_t i = 0; i < 5*size; ++i) {
+			auto index = random.getSizeT(0, size - 1);
+			colors[index] = static_cast<Color>(random.getSizeT(0, number_of_colors - 1));
+			coloring.set(index, colors[index]);
+		}
+		std::vector<std::size_t> counts(number_of_colors, 0);
+		for (std::size_t i = 0; i < size; ++i) {
+			Check(coloring.get(i) == colors[i]);
+			++counts[static_cast<std::size_t>(colors[i])];
+		}
+		Check(coloring.getCounts() == counts);
+
+		// overwrites the words from the second one to the end
+		auto const first = coloring.getColorsPerWord();
+		std::vector<Color> new_colors(size - first);
+		for (auto& color: new_colors) {
+			color = static_cast<Color>(random.getSizeT(0, number_of_colors - 1));
+		}
+		coloring.setUncounted(first, new_colors.data(), new_colors.size());
+		for (std::size_t i = 0; i < size; ++i) {
+			Check(coloring.get(i) == (i < first ? colors[i] : new_colors[i - first]));
+		}
+	}
+
+	// the hash of a two-color coloring is the same in both representations
+	Coloring coloring(size);
+	for (std::size_t i = 0; i < size; i += 3) { coloring.set(i, Color::Blue); }
+	PackedColoring packed(coloring, 2);
+	Check(packed.hash() == coloring.hash());
+	Check(packed.getColorFractions() == coloring.getColorFractions());
+}, false},
+
+{"dynamics/multi_color_matches_two_colors", []() {
+	TemporaryFile weighted_edge_list;
+	writeEdgeList(weighted_edge_list.get(), generateEdges(GENERATOR_SPECS[0]), true);
+	ParallelOptions threads;
+	threads.number_of_threads = 3;
+
+	for (auto const& graph_file: {GENERATOR_SPECS[1], GENERATOR_SPECS[2], weighted_edge_list.get()}) {
+		auto graph = buildGraph(graph_file);
+		auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+		for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+			auto reference = runTrials(graph, {dynamics_type, RoundKernel::Reference, {}}, 4, 30, 0.9);
+			for (auto const& parallel_options: {ParallelOptions(), threads}) {
+				auto results = runMultiColorTrials(graph, dynamics_type,
+				                                   PackedColoring(initial_coloring, 2), 3,
+				                                   parallel_options, 4, 30, 0.9);
+				for (std::size_t trial = 0; trial < results.size(); ++trial) {
+					checkSameResult(results[trial], reference.results[trial]);
+				}
+			}
+		}
+	}
+}, false},
+
+{"dynamics/multi_color_threads_identical", []() {
+	TemporaryFile weighted_edge_list;
+	writeEdgeList(weighted_edge_list.get(), generateEdges(GENERATOR_SPECS[0]), true);
+	ParallelOptions threads;
+	threads.number_of_threads = 3;
+	ParallelOptions numa;
+	numa.number_of_threads = 2;
+	numa.simulated_numa_nodes = 2;
+
+	struct Setup { DynamicsType dynamics_type; std::size_t number_of_colors, h; };
+	// the histogram of HMajority fits into a word for the first two
+	std::vector<Setup> const setups = {{DynamicsType::HMajority, 5, 3},
+	                                   {DynamicsType::HMajority, 16, 15},
+	                                   {DynamicsType::HMajority, 17, 4},
+	                                   {DynamicsType::HMajority, 255, 16},
+	                                   {DynamicsType::VoterModel, 7, 3},
+	                                   {DynamicsType::TwoChoices, 200, 3}};
+	for (auto const& graph_file: {GENERATOR_SPECS[1], weighted_edge_list.get()}) {
+		auto graph = buildGraph(graph_file);
+		auto core_periphery_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+		for (auto const& setup: setups) {
+			auto initial_coloring = createMultiColorInitialColoring(core_periphery_coloring,
+			                                                        setup.number_of_colors, SEED);
+			auto reference = runMultiColorTrials(graph, setup.dynamics_type, initial_coloring,
+			                                     setup.h, {}, 3, 20, 0.9);
+			for (auto const& parallel_options: {threads, numa}) {
+				auto results = runMultiColorTrials(graph, setup.dynamics_type, initial_coloring,
+				                                   setup.h, parallel_options, 3, 20, 0.9);
+				for (std::size_t trial = 0; trial < results.size(); ++trial) {
+					checkSameResult(results[trial], reference[trial]);
+				}
+			}
+		}
+	}
+}, false},
+
+// With one sample, the majority is the sample.
+{"dynamics/h_majority_with_one_sample_is_voter_model", []() {
+	auto graph = buildGraph(GENERATOR_SPECS[2]);
+	auto initial_coloring = createMultiColorInitialColoring(
+		calculateCorePeripheryColoring(graph, CPMethod::DensestCore), 6, SEED);
+	auto voter = runMultiColorTrials(graph, DynamicsType::VoterModel, initial_coloring, 1, {},
+	                                 3, 30, 0.9);
+	auto majority = runMultiColorTrials(graph, DynamicsType::HMajority, initial_coloring, 1, {},
+	                                    3, 30, 0.9);
+	for (std::size_t trial = 0; trial < voter.size(); ++trial) {
+		checkSameResult(majority[trial], voter[trial]);
+	}
+}, false},
+
+// Ties of HMajority are broken uniformly: with two samples of different
+// colors, both are adopted equally often.
+{"dynamics/h_majority_breaks_ties_uniformly", []() {
+	Graph::Edges edges;
+	for (Graph::NodeID leaf = 1; leaf <= 2; ++leaf) { edges.emplace_back(0, leaf); }
+	TemporaryFile edge_list;
+	writeEdgeList(edge_list.get(), edges, false);
+	auto graph = buildGraph(edge_list.get());
+
+	PackedColoring initial_coloring(graph.getNumberOfNodes(), 3);
+	initial_coloring.set(1, static_cast<Color>(1));
+	initial_coloring.set(2, static_cast<Color>(2));
+	MultiColorSimulation simulation(graph, DynamicsType::HMajority, initial_coloring, 2);
+	simulation.setSeed(SEED);
+
+	// the hub keeps its color 0 only if no leaf is sampled twice
+	std::vector<std::size_t> counts(3, 0);
+	for (std::size_t trial = 0; trial < 20000; ++trial) {
+		simulation.run(1, 1.1, trial);
+		++counts[static_cast<std::size_t>(simulation.getColoring().get(0))];
+	}
+	Check(counts[0] == 0);
+	checkDistribution({counts[1], counts[2]}, {0.5, 0.5});
+}, false},
+
+// Every instruction set gives the results of the straightforward loops, also
+// for lengths that are not multiples of the vector widths.
+{"kernels/instruction_sets_identical", []() {
+	auto const instruction_set = getInstructionSet();
+	auto graph = buildGraph(GENERATOR_SPECS[1]);
+	auto coloring = calculateCorePeripheryColoring(graph, CPMethod::DensestCore);
+	auto const colors = coloring.data();
+
+	std::size_t red_red = 0, cut = 0, blue_blue = 0, blue_degrees = 0;
+	for (Graph::NodeID node_id = 0; node_id < graph.getNumberOfNodes(); ++node_id) {
+		auto color = coloring.get(node_id);
+		blue_degrees += (color == Color::Blue ? graph.degree(node_id) : 0);
+		for (auto neighbor: graph.getNeighborRange(node_id)) {
+			auto neighbor_color = coloring.get(neighbor);
+			if (color != neighbor_color) { ++cut; }
+			else if (color == Color::Blue) { ++blue_blue; }
+			else { ++red_red; }
+		}
+	}
+
+	Random random(SEED);
+	std::vector<Color> old_colors(300), sampled_colors(600), expected_colors(300);
+	for (auto& color: old_colors) { color = (random.throwCoin() ? Color::Blue : Color::Red); }
+	for (auto& color: sampled_colors) { color = (random.throwCoin() ? Color::Blue : Color::Red); }
+	for (std::size_t i = 0; i < old_colors.size(); ++i) {
+		auto const color1 = sampled_colors[2*i];
+		expected_colors[i] = (color1 == sampled_colors[2*i + 1] ? color1 : old_colors[i]);
+	}
+
+	auto reference = runTrials(graph, {DynamicsType::TwoChoices, RoundKernel::Blocked, {}}, 3, 30, 0.9);
+	for (auto tested: getSupportedInstructionSets()) {
+		setInstructionSet(tested);
+		auto const& kernels = getSimdKernels();
+
+		std::size_t counts[3];
+		kernels.countEdgesByColors(graph.getOffsets(), graph.getEnds(), graph.getNeighbors(),
+		                           colors, graph.getNumberOfNodes(), counts[0], counts[1], counts[2]);
+		CheckMessage(counts[0] == red_red && counts[1] == cut && counts[2] == blue_blue,
+		             toString(tested));
+		CheckMessage(kernels.sumBlueDegrees(graph.getOffsets(), graph.getEnds(), colors,
+		                                    graph.getNumberOfNodes()) == blue_degrees,
+		             toString(tested));
+
+		for (std::size_t count: {0, 1, 31, 33, 64, 127, 300}) {
+			std::vector<Color> new_colors(count);
+			kernels.decideTwoChoices(old_colors.data(), sampled_colors.data(), new_colors.data(), count);
+			CheckMessage(std::equal(new_colors.begin(), new_colors.end(), expected_colors.begin()),
+			             toString(tested) << " " << count);
+
+			std::size_t blue_count, number_of_flips;
+			kernels.countBlueAndFlips(old_colors.data(), new_colors.data(), count,
+			                          blue_count, number_of_flips);
+			std::size_t expected_blue = 0, expected_flips = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				expected_blue += (new_colors[i] == Color::Blue);
+				expected_flips += (new_colors[i] != old_colors[i]);
+			}
+			CheckMessage(blue_count == expected_blue && number_of_flips == expected_flips,
+			             toString(tested) << " " << count);
+		}
+
+		checkSameTrajectory(runTrials(graph, {DynamicsType::TwoChoices, RoundKernel::Blocked, {}},
+		                              3, 30, 0.9), reference);
+	}
+	setInstructionSet(instruction_set);
+}, false},
+
+// The peak of a stage includes the memory used before a nested stage, and
+// every thread has its own stage.
+{"memory/nested_stages_keep_outer_peak", []() {
+	// the thread doesn't sample during the test
+	MemoryMonitor monitor(3600);
+	setActiveMemoryMonitor(&monitor);
+	std::size_t peak_before_inner = 0;
+	{
+		ScopedPhase outer("outer");
+		{
+			// freed again before the inner stage begins
+			std::vector<char> large(std::size_t(64) << 20, 1);
+			peak_before_inner = monitor.sample();
+		}
+		{
+			ScopedPhase inner("inner");
+			Check(std::strcmp(getMemoryStage(), "inner") == 0);
+
+			char const* other_stage = nullptr;
+			std::thread([&]() { other_stage = getMemoryStage(); }).join();
+			Check(std::strcmp(other_stage, "startup") == 0);
+		}
+		Check(std::strcmp(getMemoryStage(), "outer") == 0);
+		Check(monitor.getStagePeak() >= peak_before_inner);
+	}
+	setActiveMemoryMonitor(nullptr);
+}, false},
+
+{"progress/follows_trials", []() {
+	auto graph = buildGraph(GENERATOR_SPECS[1]);
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+	Simulation simulation(graph, DynamicsType::TwoChoices, initial_coloring);
+	simulation.setSeed(SEED);
+
+	// the value of the key in the JSON written by the monitor
+	auto getValue = [](std::string const& json, std::string const& key) {
+		auto begin = json.find("\"" + key + "\": ") + key.size() + 4;
+		auto end = (json[begin] == '[' ? json.find(']', begin) + 1 : json.find_first_of(",\n", begin));
+		return json.substr(begin, end - begin);
+	};
+
+	TemporaryFile progress_file;
+	std::size_t total_rounds = 0;
+	Result result;
+	{
+		// the thread doesn't write during the test
+		ProgressMonitor progress(progress_file.get(), 3600);
+		setActiveProgressMonitor(&progress);
+		progress.beginExperiment(4, 5, graph.getFilename(), 3);
+		for (std::size_t trial = 0; trial < 3; ++trial) {
+			result = simulation.run(20, 0.99, trial);
+			total_rounds += result.number_of_rounds;
+		}
+		setActiveProgressMonitor(nullptr);
+
+		std::stringstream json;
+		progress.writeJson(json);
+		Check(getValue(json.str(), "state") == "\"running\"");
+		Check(getValue(json.str(), "experiment") == "4");
+		Check(getValue(json.str(), "trial") == "2");
+		Check(getValue(json.str(), "total_rounds") == std::to_string(total_rounds));
+		Check(getValue(json.str(), "eta_basis") == "\"finished_trials\"");
+		Check(getValue(json.str(), "eta_seconds") == "0");
+
+		std::stringstream volumes;
+		volumes << "[" << result.color_volumes[0] << ", " << result.color_volumes[1] << "]";
+		Check(getValue(json.str(), "volumes") == volumes.str());
+	}
+
+	// the last state is written when the monitor is destroyed
+	std::ifstream file(progress_file.get());
+	std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	Check(getValue(json, "state") == "\"done\"");
+	Check(getValue(json, "graph_file") == "\"" + graph.getFilename() + "\"");
+}, false},
+
+// A progress file that can't be replaced during the run only skips the
+// update instead of ending the run.
+{"progress/failed_write_is_skipped", []() {
+	TemporaryFile progress_file;
+	auto const blocker = progress_file.get() + "/blocker";
+	{
+		ProgressMonitor progress(progress_file.get(), 3600);
+
+		// a non-empty directory can't be replaced by a rename
+		std::remove(progress_file.get().c_str());
+		Check(mkdir(progress_file.get().c_str(), 0700) == 0);
+		std::ofstream(blocker).put('x');
+	}
+	// the last write failed, so the directory is still there
+	struct stat status;
+	Check(stat(blocker.c_str(), &status) == 0);
+	Check(stat((progress_file.get() + ".tmp").c_str(), &status) != 0);
+
+	std::remove(blocker.c_str());
+	rmdir(progress_file.get().c_str());
+}, false},
+
+{"random/uniform_samples", []() {
+	auto const key = CounterRandom::makeKey(SEED, 1);
+	std::size_t const k = 37;
+	std::vector<std::size_t> counts(k, 0);
+	for (std::uint64_t node = 0; node < 100000; ++node) {
+		CounterRandom random(key, node % 5, node);
+		++counts[random.getSizeT(0, k - 1)];
+		++counts[random.getSizeT(0, k - 1)];
+	}
+	checkDistribution(counts, std::vector<double>(k, 1.0/k));
+}, false},
+
+// Both generators have to sample neighbors proportionally to the weights,
+// even though their streams differ.
+{"random/weighted_neighbors_follow_weights", []() {
+	TemporaryFile edge_list;
+	Graph::Edges edges;
+	for (Graph::NodeID leaf = 1; leaf <= 20; ++leaf) { edges.emplace_back(0, leaf); }
+	writeEdgeList(edge_list.get(), edges, true);
+	auto graph = buildGraph(edge_list.get());
+
+	// the hub is the first node of the edge list and thus has ID 0
+	Check(graph.degree(0) == 20);
+	std::vector<double> probabilities;
+	for (std::size_t i = 0; i < 20; ++i) { probabilities.push_back(0.5 + (i % 7)*0.25); }
+	double total = 0;
+	for (auto p: probabilities) { total += p; }
+	for (auto& p: probabilities) { p /= total; }
+
+	// the neighbors are sorted by ID, which is the order of the edge list
+	auto const key = CounterRandom::makeKey(SEED, 2);
+	std::vector<std::size_t> counter_counts(20, 0), random_counts(20, 0);
+	Random random(SEED);
+	for (std::uint64_t round = 0; round < 100000; ++round) {
+		CounterRandom counter_random(key, round, 0);
+		++counter_counts[graph.getRandomNeighbor(0, counter_random) - 1];
+		++random_counts[graph.getRandomNeighbor(0, random) - 1];
+	}
+	checkDistribution(counter_counts, probabilities);
+	checkDistribution(random_counts, probabilities);
+}, false},
+
+// In the voter model, the volume of a color is a martingale, so the color
+// wins with the probability of its initial volume fraction.
+{"dynamics/voter_model_win_probability", []() {
+	auto graph = buildGraph("gen:chunglu:n=150:d=6:beta=2.5:seed=1");
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+	Simulation simulation(graph, DynamicsType::VoterModel, initial_coloring);
+	simulation.setSeed(SEED);
+	double const red_volume = simulation.getColorVolumes()[0];
+
+	std::size_t const number_of_trials = 400;
+	std::size_t red_wins = 0;
+	for (std::size_t trial = 0; trial < number_of_trials; ++trial) {
+		auto result = simulation.run(100000, 1, trial);
+		Check(result.color_fractions[0] == 0 || result.color_fractions[0] == 1);
+		red_wins += (result.color_fractions[0] == 1);
+	}
+
+	auto const frequency = (double)red_wins/number_of_trials;
+	auto const sigma = std::sqrt(red_volume*(1 - red_volume)/number_of_trials);
+	CheckMessage(std::abs(frequency - red_volume) < 4*sigma,
+	             "frequency " << frequency << ", expected " << red_volume);
+}, false},
+
+{"async/fenwick_tree_matches_prefix_sums", []() {
+	Random random(SEED);
+	std::vector<double> weights(1000);
+	for (auto& weight: weights) { weight = (random.throwCoin() ? random.getDouble() : 0); }
+	FenwickTree tree;
+	tree.assign(weights);
+
+	// more updates than weights, so the tree is also rebuilt
+	for (std::size_t update = 0; update < 3000; ++update) {
+		auto const index = random.getSizeT(0, weights.size() - 1);
+		weights[index] = (update % 3 == 0 ? 0 : random.getDouble());
+		tree.set(index, weights[index]);
+
+		double total = 0;
+		for (auto weight: weights) { total += weight; }
+		CheckMessage(std::abs(tree.getTotal() - total) < 1e-9, tree.getTotal() << " vs. " << total);
+
+		// the index whose range contains the target, away from the borders
+		auto const target = random.getDouble()*total;
+		double prefix_sum = 0;
+		std::size_t expected = 0;
+		while (prefix_sum + weights[expected] <= target) { prefix_sum += weights[expected++]; }
+		if (target - prefix_sum > 1e-9 && prefix_sum + weights[expected] - target > 1e-9) {
+			CheckMessage(tree.find(target) == expected, tree.find(target) << " vs. " << expected);
+		}
+	}
+}, false},
+
+// Skipping the steps that don't flip a node must not change the process.
+{"async/matches_random_sequential_updates", []() {
+	TemporaryFile weighted_edge_list;
+	writeEdgeList(weighted_edge_list.get(), generateEdges("gen:er:n=60:d=4:seed=5"), true);
+	std::vector<std::string> const graph_files = {"gen:chunglu:n=60:d=4:beta=2.5:seed=3",
+	                                              weighted_edge_list.get()};
+
+	std::size_t const number_of_trials = 300;
+	for (auto const& graph_file: graph_files) {
+		auto graph = buildGraph(graph_file);
+		auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+		for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+			AsyncSimulation simulation(graph, dynamics_type, initial_coloring);
+			simulation.setSeed(SEED);
+
+			std::size_t red_wins = 0, reference_red_wins = 0;
+			double steps = 0, square_steps = 0, reference_steps = 0, reference_square_steps = 0;
+			for (std::size_t trial = 0; trial < number_of_trials; ++trial) {
+				auto result = simulation.run(1000000, 1.1, trial);
+				Check(result.stop_reason == StopReason::FixedPoint);
+				red_wins += (result.color_fractions[0] == 1);
+				steps += simulation.getNumberOfSteps();
+				square_steps += std::pow(simulation.getNumberOfSteps(), 2);
+
+				auto coloring = initial_coloring;
+				auto const trial_steps = runRandomSequentialUpdates(
+					graph, dynamics_type, coloring, CounterRandom::makeKey(SEED + 1, trial));
+				reference_red_wins += (coloring.getColorFractions()[0] == 1);
+				reference_steps += trial_steps;
+				reference_square_steps += std::pow(trial_steps, 2);
+			}
+
+			auto const p = (red_wins + reference_red_wins)/(2.0*number_of_trials);
+			auto const sigma = std::sqrt(2*p*(1 - p)/number_of_trials);
+			CheckMessage(std::abs((double)red_wins - (double)reference_red_wins)/number_of_trials
+			             <= 4.5*sigma, red_wins << " vs. " << reference_red_wins << " red wins");
+			checkSameMean(number_of_trials, steps, square_steps,
+			              reference_steps, reference_square_steps);
+		}
+	}
+}, false},
+
+{"async/deterministic_and_stops", []() {
+	auto graph = buildGraph("gen:chunglu:n=2000:d=6:beta=2.5:seed=1");
+	auto initial_coloring = calculateCorePeripheryColoring(graph, CPMethod::KRichClub);
+	for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+		AsyncSimulation simulation(graph, dynamics_type, initial_coloring);
+		simulation.setSeed(SEED);
+
+		// the volumes are the ones of the synchronous simulation
+		Simulation reference(graph, dynamics_type, initial_coloring);
+		Check(simulation.getColorVolumes() == reference.getColorVolumes());
+
+		auto result = simulation.run(3, 1.1, 1);
+		Check(result.stop_reason == StopReason::MaxRounds && result.number_of_rounds == 3);
+		Check(simulation.getNumberOfSteps() == 3*graph.getNumberOfNodes());
+		Check(simulation.getNumberOfFlips() > 0);
+		auto const flips = simulation.getNumberOfFlips();
+		checkSameResult(simulation.run(3, 1.1, 1), result);
+		Check(simulation.getNumberOfFlips() == flips);
+
+		// the volumes are tracked by differences, but reported exactly
+		auto coloring = simulation.getColoring();
+		Simulation final_reference(graph, dynamics_type, coloring);
+		Check(result.color_volumes == final_reference.getColorVolumes());
+
+		result = simulation.run(-1, 0.9, 2);
+		Check(result.stop_reason == StopReason::WinThreshold);
+		Check(*std::max_element(result.color_volumes.begin(), result.color_volumes.end()) >= 0.9f);
+	}
+
+	// all nodes of one color can't change anymore
+	AsyncSimulation simulation(graph, DynamicsType::VoterModel,
+	                           Coloring(graph.getNumberOfNodes(), Color::Blue));
+	auto result = simulation.run(-1, 1.1, 0);
+	Check(result.stop_reason == StopReason::FixedPoint && result.number_of_rounds == 0);
+}, false},
+
+{"async/fixed_point_at_last_flip", []() {
+	// On a clique, most steps flip a node until the end, so all steps are
+	// drawn one by one and can be replayed.
+	std::size_t const number_of_nodes = 40;
+	Graph::Edges edges;
+	for (Graph::NodeID node1 = 0; node1 < number_of_nodes; ++node1) {
+		for (auto node2 = node1 + 1; node2 < number_of_nodes; ++node2) {
+			edges.emplace_back(node1, node2);
+		}
+	}
+	Graph graph;
+	graph.buildFromEdges("clique", edges);
+	Coloring initial_coloring(number_of_nodes, Color::Red);
+	for (Graph::NodeID node_id = 0; node_id < number_of_nodes/2; ++node_id) {
+		initial_coloring.set(node_id, Color::Blue);
+	}
+
+	AsyncSimulation simulation(graph, DynamicsType::VoterModel, initial_coloring);
+	simulation.setSeed(SEED);
+	for (std::size_t trial = 0; trial < 10; ++trial) {
+		auto const result = simulation.run(1000000, 1.1, trial);
+		auto coloring = initial_coloring;
+		auto const steps = runRandomSequentialUpdates(graph, DynamicsType::VoterModel, coloring,
+		                                              CounterRandom::makeKey(SEED, trial),
+		                                              UINT64_MAX, 1);
+		Check(result.stop_reason == StopReason::FixedPoint);
+		CheckMessage(simulation.getNumberOfSteps() == steps,
+		             simulation.getNumberOfSteps() << " vs. " << steps << " steps");
+		Check(result.number_of_rounds == (steps + number_of_nodes - 1)/number_of_nodes);
+		Check(simulation.getColoring().getColorFractions() == coloring.getColorFractions());
+	}
+}, false},
+
+// Two communities of opposite colors with a few edges between them: only the
+// nodes at these edges can flip, which the async engine skips to directly.
+{"timing/async_engine", []() {
+	std::size_t const community_size = 16384;
+	Random random(SEED);
+	Graph::Edges edges;
+	for (std::size_t first: {std::size_t(0), community_size}) {
+		for (std::size_t i = 0; i < 8*community_size; ++i) {
+			edges.emplace_back(first + random.getSizeT(0, community_size - 1),
+			                   first + random.getSizeT(0, community_size - 1));
+		}
+	}
+	for (std::size_t i = 0; i < 32; ++i) {
+		edges.emplace_back(random.getSizeT(0, community_size - 1),
+		                   community_size + random.getSizeT(0, community_size - 1));
+	}
+	Graph graph;
+	graph.buildFromEdges("communities", edges);
+	Coloring initial_coloring(graph.getNumberOfNodes(), Color::Red);
+	for (auto node_id = community_size; node_id < graph.getNumberOfNodes(); ++node_id) {
+		initial_coloring.set(node_id, Color::Blue);
+	}
+
+	std::size_t const rounds = 100;
+	AsyncSimulation simulation(graph, DynamicsType::TwoChoices, initial_coloring);
+	auto async_seconds = minimumSeconds(3, [&]() { simulation.run(rounds, 1.1); });
+	auto step_seconds = minimumSeconds(3, [&]() {
+		auto coloring = initial_coloring;
+		runRandomSequentialUpdates(graph, DynamicsType::TwoChoices, coloring,
+		                           CounterRandom::makeKey(SEED, 0), rounds*graph.getNumberOfNodes());
+	});
+	CheckMessage(10*async_seconds < step_seconds,
+	             async_seconds << " s vs. " << step_seconds << " s");
+}, true},
+
+{"timing/blocked_kernel", []() {
+	auto graph = buildGraph("gen:er:n=65536:d=16:seed=1");
+	for (auto dynamics_type: {DynamicsType::VoterModel, DynamicsType::TwoChoices}) {
+		auto seconds = [&](RoundKernel round_kernel) {
+			return minimumSeconds(5, [&]() {
+				runTrials(graph, {dynamics_type, round_kernel, ParallelOptions()}, 1, 3, 1.1);
+			});
+		};
+		auto reference_seconds = seconds(RoundKernel::Reference);
+		auto blocked_seconds = seconds(RoundKernel::Blocked);
+		CheckMessage(blocked_seconds < TIMING_TOLERANCE*reference_seconds,
+		             blocked_seconds << " s vs. " << reference_seconds << " s");
+	}
+}, true},
+
+{"timing/generator_build", []() {
+	auto const spec = "gen:er:n=131072:d=16:seed=1";
+	auto reference_seconds = minimumSeconds(3, [&]() {
+		Graph graph;
+		graph.buildFromEdges(spec, generateEdges(spec));
+	});
+	auto generator_seconds = minimumSeconds(3, [&]() { buildGraph(spec); });
+	CheckMessage(generator_seconds < TIMING_TOLERANCE*reference_seconds,
+	             generator_seconds << " s vs. " << reference_seconds << " s");
+}, true},
+
+{"timing/mapped_graph", []() {
+	TemporaryFile edge_list, binary;
+	writeEdgeList(edge_list.get(), generateEdges("gen:er:n=65536:d=8:seed=1"), false);
+	buildGraph(edge_list.get()).writeBinaryFile(binary.get());
+
+	auto parse_seconds = minimumSeconds(3, [&]() { buildGraph(edge_list.get()); });
+	auto map_seconds = minimumSeconds(3, [&]() { buildGraph(binary.get()); });
+	CheckMessage(map_seconds < parse_seconds,
+	             map_seconds << " s vs. " << parse_seconds << " s");
+}, true},
+
+};
+
+} // end anonymous
+
+std::size_t runUnitTests(UnitTestOptions const& options)
+{
+	std::size_t number_of_run = 0;
+	std::size_t number_of_failed = 0;
+
+	for (auto const& test: UNIT_TESTS) {
+		if (std::string(test.name).find(options.filter) == std::string::npos ||
+		    (test.is_timing && !options.timing)) {
+			continue;
+		}
+
+		++number_of_run;
+		auto start = Clock::now();
+		try {
+			test.run();
+			std::cout << "[  OK  ] " << test.name << " (" << secondsSince(start) << " s)" << std::endl;
+		}
+		catch (TestFailure const& failure) {
+			++number_of_failed;
+			std::cout << "[ FAIL ] " << test.name << ": " << failure.message << std::endl;
+		}
+	}
+
+	std::cout << number_of_run - number_of_failed << " of " << number_of_run
+	          << " tests passed." << std::endl;
+	return number_of_failed;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//
+// Unit tests
+//
+// Every optimized path (graph builders, core extraction, round kernels,
+// parallel execution, checkpoints) is compared with its reference on fixed
+// seeds and generated graphs: CSR arrays and core colorings have to be
+// identical, trial outcomes identical or, where the random streams differ,
+// statistically equivalent. A scaled-down timing guard checks that the
+// optimized paths are not slower than their references.
+//
+
+struct UnitTestOptions
+{
+	// only run the tests whose names contain the filter
+	std::string filter;
+	// the timing guard is skipped, e.g., on loaded machines
+	bool timing = true;
+};
+
+// Returns the number of failed tests.
+std::size_t runUnitTests(UnitTestOptions const& options = UnitTestOptions());